@@ -45,6 +45,16 @@ foreach ($Arch in ("x86", "x64", "arm64")) {
     & $MSBuild $SolutionFile /nologo /property:Configuration=Release /property:Platform=$Arch
 }
 
+# Validate the keyboard tables of the layouts.
+$KbdCheck = "$PSScriptRoot\x64\Release\kbdcheck.exe"
+if (Test-Path $KbdCheck) {
+    Write-Output "Validating keyboard tables ..."
+    & $KbdCheck -q "$PSScriptRoot\x64\Release"
+    if ($LASTEXITCODE -ne 0) {
+        Exit-Script "Invalid keyboard tables"
+    }
+}
+
 # Build archive binaries.
 $Archive = "$PSScriptRoot\$ProjectName.zip"
 Write-Output "Archive: $Archive"
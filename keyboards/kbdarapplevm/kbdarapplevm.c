@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Arabic Apple VM Keyboard Layout (WKL)
+// Generated from kbdarapple.c by build-apple-vm.py, do not modify, inputs 857b1fea3737bd10
 // Automatically generated from kbdprlar.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Belgian (period) Apple VM Keyboard Layout (WKL)
+// Generated from kbdbeapple.c by build-apple-vm.py, do not modify, inputs 3b087a53110cecfc
 // Automatically generated from kbdprlbe.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Portuguese (Brazil) Apple VM Keyboard Layout (WKL)
+// Generated from kbdbzapple.c by build-apple-vm.py, do not modify, inputs 2951d16abfa169ac
 // Automatically generated from kbdprlbz.dll
 //---------------------------------------------------------------------------
 
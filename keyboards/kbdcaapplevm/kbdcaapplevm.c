@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Canadian French Apple VM Keyboard Layout (WKL)
+// Generated from kbdcaapple.c by build-apple-vm.py, do not modify, inputs eb2c9bec184f63d3
 // Automatically generated from kbdprlca.dll
 //---------------------------------------------------------------------------
 
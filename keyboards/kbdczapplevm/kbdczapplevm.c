@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Czech Apple VM Keyboard Layout (WKL)
+// Generated from kbdczapple.c by build-apple-vm.py, do not modify, inputs 15d021c97abaa65a
 // Automatically generated from kbdprlcz.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Danish Apple VM Keyboard Layout (WKL)
+// Generated from kbddaapple.c by build-apple-vm.py, do not modify, inputs 54f65f2a89cb47df
 // Automatically generated from kbdprlda.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // German Apple VM Keyboard Layout (WKL)
+// Generated from kbddeapple.c by build-apple-vm.py, do not modify, inputs 33ea689b6793a362
 // Automatically generated from kbdprlde.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Dutch Apple VM Keyboard Layout (WKL)
+// Generated from kbdduapple.c by build-apple-vm.py, do not modify, inputs 0916d319b4908b2c
 // Automatically generated from kbdprldu.dll
 //---------------------------------------------------------------------------
 
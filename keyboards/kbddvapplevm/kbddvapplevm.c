@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // United States (Dvorak) Apple VM Keyboard Layout (WKL)
+// Generated from kbddvapple.c by build-apple-vm.py, do not modify, inputs e85a020cf5065faf
 // Automatically generated from kbdprldv.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // English Japanese Apple VM Keyboard Layout (WKL)
+// Generated from kbdejapple.c by build-apple-vm.py, do not modify, inputs cb1545aa49541ecd
 // Automatically generated from kbdprlej.dll
 //---------------------------------------------------------------------------
 
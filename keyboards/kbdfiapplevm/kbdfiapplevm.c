@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Finnish Apple VM Keyboard Layout (WKL)
+// Generated from kbdfiapple.c by build-apple-vm.py, do not modify, inputs a4f46887ddb75bb3
 // Automatically generated from kbdprlfi.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // French (Numerical) Apple VM Keyboard Layout (WKL)
+// Generated from kbdfnapple.c by build-apple-vm.py, do not modify, inputs a568477bf3f5e51b
 // Automatically generated from kbdprlfn.dll
 //---------------------------------------------------------------------------
 
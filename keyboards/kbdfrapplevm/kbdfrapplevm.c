@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // French Apple VM Keyboard Layout (WKL)
+// Generated from kbdfrapple.c by build-apple-vm.py, do not modify, inputs 4d1af96a01b8b237
 // Automatically generated from kbdprlfr.dll
 //---------------------------------------------------------------------------
 
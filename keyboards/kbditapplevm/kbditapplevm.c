@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Italian Apple VM Keyboard Layout (WKL)
+// Generated from kbditapple.c by build-apple-vm.py, do not modify, inputs 80fd20708eb89bb0
 // Automatically generated from kbdprlit.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Norwegian Apple VM Keyboard Layout (WKL)
+// Generated from kbdnoapple.c by build-apple-vm.py, do not modify, inputs e6bea8bffa689b9d
 // Automatically generated from kbdprlno.dll
 //---------------------------------------------------------------------------
 
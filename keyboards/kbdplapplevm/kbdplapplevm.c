@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Polish (Programmers) Apple VM Keyboard Layout (WKL)
+// Generated from kbdplapple.c by build-apple-vm.py, do not modify, inputs d5741edba68f607c
 // Automatically generated from kbdprlpl.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Portuguese Apple VM Keyboard Layout (WKL)
+// Generated from kbdpoapple.c by build-apple-vm.py, do not modify, inputs 347fc83639fa55d3
 // Automatically generated from kbdprlpo.dll
 //---------------------------------------------------------------------------
 
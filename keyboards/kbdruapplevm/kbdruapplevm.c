@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Russian Apple VM Keyboard Layout (WKL)
+// Generated from kbdruapple.c by build-apple-vm.py, do not modify, inputs 2b54bb5b460f0895
 // Automatically generated from kbdprlru.dll
 //---------------------------------------------------------------------------
 
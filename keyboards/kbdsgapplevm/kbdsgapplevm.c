@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Swiss German Apple VM Keyboard Layout (WKL)
+// Generated from kbdsgapple.c by build-apple-vm.py, do not modify, inputs 3eca052b21a08aec
 // Automatically generated from kbdprlsg.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Spanish Apple VM Keyboard Layout (WKL)
+// Generated from kbdspapple.c by build-apple-vm.py, do not modify, inputs 78baafa32d4c89fa
 // Automatically generated from kbdprlsp.dll
 //---------------------------------------------------------------------------
 
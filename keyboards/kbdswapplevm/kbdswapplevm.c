@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Swedish Apple VM Keyboard Layout (WKL)
+// Generated from kbdswapple.c by build-apple-vm.py, do not modify, inputs 55970ba9a0ff4952
 // Automatically generated from kbdprlsw.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // Swiss French Apple VM Keyboard Layout (WKL)
+// Generated from kbdszapple.c by build-apple-vm.py, do not modify, inputs f10fc04dff625f81
 // Automatically generated from kbdprlsz.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
-// Ukrainian Apple Keyboard Layout (WKL)
+// Ukrainian Apple VM Keyboard Layout (WKL)
+// Generated from kbduaapple.c by build-apple-vm.py, do not modify, inputs db14fe600565bc7d
 // Automatically generated from kbdprlru.dll and then manually modified.
 //---------------------------------------------------------------------------
 
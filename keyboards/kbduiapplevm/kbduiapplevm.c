@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // United States International Apple VM Keyboard Layout (WKL)
+// Generated from kbduiapple.c by build-apple-vm.py, do not modify, inputs 931151771fb7b6b2
 // Automatically generated from kbdprlui.dll
 //---------------------------------------------------------------------------
 
@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // United Kingdom Apple VM Keyboard Layout (WKL)
+// Generated from kbdukapple.c by build-apple-vm.py, do not modify, inputs 631c5340b1f73702
 // Automatically generated from kbdprluk.dll
 //---------------------------------------------------------------------------
 
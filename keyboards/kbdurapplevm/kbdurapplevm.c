@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // United States ISO/RU Apple VM Keyboard Layout (WKL)
+// Generated from kbdurapple.c by build-apple-vm.py, do not modify, inputs e9d34b838de90ec7
 // Automatically generated from kbdprlur.dll
 //---------------------------------------------------------------------------
 
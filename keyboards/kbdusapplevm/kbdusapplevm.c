@@ -1,5 +1,6 @@
 //---------------------------------------------------------------------------
 // United States Apple VM Keyboard Layout (WKL)
+// Generated from kbdusapple.c by build-apple-vm.py, do not modify, inputs 1e4cc0a9308f2101
 // Automatically generated from kbdprlus.dll
 //---------------------------------------------------------------------------
 
@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+#---------------------------------------------------------------------------
+#
+# Windows Keyboards Layouts (WKL)
+# Copyright (c) 2023, Thierry Lelegard
+# BSD-2-Clause license, see the LICENSE file.
+#
+# Generate the source files of the "Apple VM" keyboard layouts from the
+# source files of the "Apple" layouts and the differences which are
+# described in keyboards/applevm.txt.
+#
+# For each kbdXXapple project, kbdXXapplevm/kbdXXapplevm.c and strings.h
+# are generated. The generation is incremental: a hash of the inputs of each
+# layout (source files of the base layout, its lines in applevm.txt) is stored
+# in the generated source file and the layouts with unchanged inputs are
+# skipped. A file is rewritten only when its content changes, to avoid
+# useless rebuilds of the DLL's.
+#
+#---------------------------------------------------------------------------
+
+import sys, os, re, time, hashlib, argparse
+
+script_dir = os.path.dirname(os.path.abspath(__file__))
+keyboards_dir = os.path.join(os.path.dirname(script_dir), 'keyboards')
+delta_file = os.path.join(keyboards_dir, 'applevm.txt')
+
+# Increment when the generated files change for the same inputs.
+generator_version = '1'
+
+# Command line.
+parser = argparse.ArgumentParser(description='Generate the Apple VM keyboard layouts from the Apple layouts.')
+parser.add_argument('layouts', nargs='*', help='base layouts to generate (e.g. kbdfrapple), default: all layouts in applevm.txt')
+parser.add_argument('-c', '--check', action='store_true', help='check that the generated files are up to date, do not modify them')
+parser.add_argument('-f', '--force', action='store_true', help='regenerate all layouts, even when their inputs are unchanged')
+parser.add_argument('-v', '--verbose', action='store_true', help='display the status of each layout')
+args = parser.parse_args()
+
+def fail(message):
+    print('error: %s' % message, file=sys.stderr)
+    exit(1)
+
+# Read or write a text file, without newline translation.
+def read_file(path):
+    with open(path, 'r', encoding='utf-8', newline='') as input:
+        return input.read()
+
+def write_file(path, text):
+    with open(path, 'w', encoding='utf-8', newline='') as output:
+        output.write(text)
+
+# Read the differences: base layout name => list of (line number, directive tokens).
+deltas = {}
+for number, line in enumerate(read_file(delta_file).splitlines(), 1):
+    tokens = line.split()
+    if tokens and not tokens[0].startswith('#'):
+        deltas.setdefault(tokens[0], [])
+        if len(tokens) > 1:
+            deltas[tokens[0]].append((number, tokens[1:]))
+
+# Trailing comment of a modified line: the one of the directive, else the existing one.
+def directive_comment(words, existing):
+    return ' // ' + ' '.join(words) if words else (existing or '')
+
+# Locate a scan code in the scan code table. Return (line index, match).
+# Match groups: prefix, virtual key, rest of the line, existing comment.
+def find_scan_code(lines, where, sc):
+    pattern = re.compile(r'^(\s*/\* %02X \*/ )([^,\s]+)(,[^/]*?)(\s*//.*)?$' % int(sc, 16))
+    index = next((i for i, l in enumerate(lines) if pattern.match(l)), None)
+    if index is None:
+        fail('%s: scan code %s not found' % (where, sc))
+    return index, pattern.match(lines[index])
+
+# Swap the virtual keys of two scan codes in the scan code table.
+def apply_swap(lines, where, tokens):
+    if len(tokens) < 3:
+        fail('%s: syntax: swap SC1 SC2 [comment]' % where)
+    # The comment of the directive replaces the existing comments of the lines, if any.
+    (i1, m1), (i2, m2) = [find_scan_code(lines, where, sc) for sc in tokens[1:3]]
+    lines[i1] = m1.group(1) + m2.group(2) + m1.group(3) + directive_comment(tokens[3:], m1.group(4))
+    lines[i2] = m2.group(1) + m1.group(2) + m2.group(3) + directive_comment(tokens[3:], m2.group(4))
+
+# Set the virtual key of a scan code in the scan code table.
+def apply_sc(lines, where, tokens):
+    if len(tokens) < 3:
+        fail('%s: syntax: sc SC VK [comment]' % where)
+    index, match = find_scan_code(lines, where, tokens[1])
+    lines[index] = match.group(1) + tokens[2] + match.group(3) + directive_comment(tokens[3:], match.group(4))
+
+# Replace a character in a column of a virtual key, keeping the alignment of the columns.
+def apply_char(lines, where, tokens):
+    if len(tokens) != 4:
+        fail('%s: syntax: char VK COLUMN VALUE' % where)
+    vk, column, value = tokens[1], int(tokens[2]), tokens[3]
+    pattern = re.compile(r'^(\s*\{%s,\s*\w+,\s*\{)(.*)(\}\},.*)$' % re.escape(vk))
+    index = next((i for i, l in enumerate(lines) if pattern.match(l)), None)
+    if index is None:
+        fail('%s: virtual key %s not found' % (where, vk))
+    match = pattern.match(lines[index])
+    cells = list(re.finditer(r"(L?'(?:\\.|[^\\'])'|[^,\s]+)(\s*,\s*|\s*$)", match.group(2)))
+    if column >= len(cells):
+        fail('%s: no column %d for virtual key %s' % (where, column, vk))
+    cell = cells[column]
+    separator = cell.group(2)
+    if ',' in separator:
+        separator = ',' + ' ' * max(1, len(cell.group(0)) - len(value) - 1)
+    inner = match.group(2)[:cell.start()] + value + separator + match.group(2)[cell.end():]
+    lines[index] = match.group(1) + inner + match.group(3)
+
+# Generate the content of the VM files from the base files. Return (source, strings).
+def generate(name, base_source, base_strings, digest):
+    match = re.search(r'^#define\s+WKL_TEXT\s+"(.*)"', base_strings, re.M)
+    if match is None:
+        fail('no WKL_TEXT in %s/strings.h' % name)
+    text = match.group(1)
+    vm_text = text + ' VM'
+    strings = base_strings[:match.start(1)] + vm_text + base_strings[match.end(1):]
+
+    # Keep the line terminators of the base file.
+    eol = '\r\n' if '\r\n' in base_source else '\n'
+    lines = base_source.split(eol)
+    # The title comment of the VM layout is always derived from its description.
+    # Hand-written VM sources had drifted (kbduaapplevm.c had lost its "VM").
+    title = '// %s Keyboard Layout (WKL)' % text
+    if title not in lines:
+        fail('no line "%s" in %s.c' % (title, name))
+    index = lines.index(title)
+    lines[index] = '// %s Keyboard Layout (WKL)' % vm_text
+    lines.insert(index + 1, '// Generated from %s.c by build-apple-vm.py, do not modify, inputs %s' % (name, digest))
+
+    for number, tokens in deltas[name]:
+        where = '%s:%d' % (os.path.basename(delta_file), number)
+        if tokens[0] == 'swap':
+            apply_swap(lines, where, tokens)
+        elif tokens[0] == 'sc':
+            apply_sc(lines, where, tokens)
+        elif tokens[0] == 'char':
+            apply_char(lines, where, tokens)
+        else:
+            fail('%s: unknown directive "%s"' % (where, tokens[0]))
+    return eol.join(lines), strings
+
+start = time.perf_counter()
+names = args.layouts if args.layouts else list(deltas)
+counts = {'updated': 0, 'unchanged': 0, 'skipped': 0, 'outdated': 0}
+for name in names:
+    if name not in deltas:
+        fail('%s is not described in %s' % (name, delta_file))
+    vm = name + 'vm'
+    base_source_file = os.path.join(keyboards_dir, name, name + '.c')
+    base_strings_file = os.path.join(keyboards_dir, name, 'strings.h')
+    vm_source_file = os.path.join(keyboards_dir, vm, vm + '.c')
+    vm_strings_file = os.path.join(keyboards_dir, vm, 'strings.h')
+
+    # Hash of all inputs of the layout.
+    base_source = read_file(base_source_file)
+    base_strings = read_file(base_strings_file)
+    hash = hashlib.sha1()
+    for data in [generator_version, base_source, base_strings] + [' '.join(t) for _, t in deltas[name]]:
+        hash.update(data.encode('utf-8') + b'\0')
+    digest = hash.hexdigest()[:16]
+
+    # Skip the layout when the inputs are unchanged.
+    old_source = read_file(vm_source_file) if os.path.isfile(vm_source_file) else None
+    old_strings = read_file(vm_strings_file) if os.path.isfile(vm_strings_file) else None
+    if not args.force and not args.check and old_source is not None and old_strings is not None and ('inputs ' + digest) in old_source:
+        status = 'skipped'
+    else:
+        source, strings = generate(name, base_source, base_strings, digest)
+        if source == old_source and strings == old_strings:
+            status = 'unchanged'
+        elif args.check:
+            status = 'outdated'
+        else:
+            os.makedirs(os.path.dirname(vm_source_file), exist_ok=True)
+            if source != old_source:
+                write_file(vm_source_file, source)
+            if strings != old_strings:
+                write_file(vm_strings_file, strings)
+            if not os.path.isfile(os.path.join(keyboards_dir, vm, vm + '.vcxproj')):
+                print('warning: no project file for %s, create it and add it to the solution' % vm, file=sys.stderr)
+            status = 'updated'
+    counts[status] += 1
+    if args.verbose or status in ('updated', 'outdated'):
+        print('%s: %s' % (vm, status))
+
+print('%d layouts, %d updated, %d unchanged, %d skipped (inputs unchanged), %d outdated, %.1f ms' %
+      (len(names), counts['updated'], counts['unchanged'], counts['skipped'], counts['outdated'], (time.perf_counter() - start) * 1000.0))
+exit(1 if counts['outdated'] > 0 else 0)
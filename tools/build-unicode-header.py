@@ -5,7 +5,7 @@
 # Copyright (c) 2023, Thierry Lelegard
 # BSD-2-Clause license, see the LICENSE file.
 #
-# Utility generate a header containing "SYM" from "#define".
+# Utility generate a header containing a sorted table of symbols from "#define".
 #
 #---------------------------------------------------------------------------
 
@@ -18,9 +18,20 @@ if len(sys.argv) != 3:
 input_file = sys.argv[1]
 output_file = sys.argv[2]
 
+# Collect all symbols. When several symbols have the same value, keep the first one.
+symbols = {}
+with open(input_file, 'r', encoding='utf-8') as input:
+    for line in input:
+        match = re.search(r'#define\s+(UC_\w+)\s+(\w+)', line.strip())
+        if match is not None:
+            value = int(match.group(2), 0)
+            if value not in symbols:
+                symbols[value] = match.group(1)
+
+# Generate a table which is sorted by value, for binary search.
 with open(output_file, 'w') as output:
-    with open(input_file, 'r', encoding='utf-8') as input:
-        for line in input:
-            match = re.search(r'#define\s+(UC_\w+)\s+', line.strip())
-            if match is not None:
-                print('    SYM(%s),' % match.group(1), file=output)
+    print('// Automatically generated by build-unicode-header.py, do not modify.', file=output)
+    print('constexpr Symbol unicode_symbols[] = {', file=output)
+    for value in sorted(symbols):
+        print('    {%s, L"%s"},' % (symbols[value], symbols[value]), file=output)
+    print('};', file=output)
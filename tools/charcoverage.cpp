@@ -0,0 +1,233 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Character coverage of keyboard layouts, as sets of BMP code points.
+//
+//----------------------------------------------------------------------------
+
+#include "charcoverage.h"
+#include "kbdpack.h"
+#include <bit>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define CHARSET_X86 1
+    #include <immintrin.h>
+#endif
+
+// With GCC and clang, the vector instructions are enabled function by function.
+#if defined(CHARSET_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define CHARSET_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define CHARSET_TARGET(isa)
+#endif
+
+
+//----------------------------------------------------------------------------
+// Set algebra.
+//----------------------------------------------------------------------------
+
+CharSet& CharSet::operator|=(const CharSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] |= other._bits[i];
+    }
+    return *this;
+}
+
+CharSet& CharSet::operator&=(const CharSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] &= other._bits[i];
+    }
+    return *this;
+}
+
+CharSet& CharSet::operator-=(const CharSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] &= ~other._bits[i];
+    }
+    return *this;
+}
+
+void CharSet::getCharacters(std::vector<WCHAR>& chars) const
+{
+    chars.clear();
+    for (size_t i = 0; i < WORDS; ++i) {
+        for (uint64_t word = _bits[i]; word != 0; word &= word - 1) {
+            chars.push_back(WCHAR(i * 64 + size_t(std::countr_zero(word))));
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Population count kernels.
+//----------------------------------------------------------------------------
+
+bool CharSet::UseAVX2()
+{
+    static const bool avx2 = KbdPack::IsSupported(KbdPack::KERNEL_AVX2);
+    return avx2;
+}
+
+size_t CharSet::Count(Operation op, const CharSet& a, const CharSet& b)
+{
+    return UseAVX2() ? CountAVX2(op, a._bits.data(), b._bits.data()) : CountScalar(op, a._bits.data(), b._bits.data());
+}
+
+size_t CharSet::CountScalar(Operation op, const uint64_t* a, const uint64_t* b)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < WORDS; ++i) {
+        const uint64_t word = op == OP_OR ? a[i] | b[i] : (op == OP_AND ? a[i] & b[i] : (op == OP_ANDNOT ? a[i] & ~b[i] : a[i]));
+        count += size_t(std::popcount(word));
+    }
+    return count;
+}
+
+#if defined(CHARSET_X86)
+
+// Population count of 32 bytes at a time: lookup of the count of each nibble,
+// then sum of the bytes in each 64-bit lane.
+CHARSET_TARGET("avx2")
+size_t CharSet::CountAVX2(Operation op, const uint64_t* a, const uint64_t* b)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < WORDS; i += 4) {
+        const __m256i va = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + i));
+        const __m256i v = op == OP_OR ? _mm256_or_si256(va, vb) :
+                         (op == OP_AND ? _mm256_and_si256(va, vb) :
+                         (op == OP_ANDNOT ? _mm256_andnot_si256(vb, va) : va));
+        const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low4));
+        const __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    return size_t(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+#else
+
+// Not an x86 CPU, the vector kernel is never selected.
+size_t CharSet::CountAVX2(Operation op, const uint64_t* a, const uint64_t* b)
+{
+    return CountScalar(op, a, b);
+}
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Coverage of a keyboard layout.
+//----------------------------------------------------------------------------
+
+CharCoverage::CharCoverage(const KbdEngine& engine) :
+    _direct(),
+    _dead(),
+    _ligatures(),
+    _all()
+{
+    // Reachable virtual keys, from the scan codes, with NumLock or other modifiers.
+    std::array<bool, 256> vks{};
+    for (size_t index = 0; index < 4 * 256; ++index) {
+        const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((index >> 8) << 1)};
+        vks[engine.virtualKey(ev) & 0xFF] = true;
+        const KbdEngine::SpecialKey* key = engine.specialKey(ev);
+        if (key != nullptr) {
+            vks[key->numlock_vk] = true;
+            if (key->multi_bits != 0) {
+                vks[key->multi_vk] = true;
+            }
+        }
+    }
+    vks[0] = vks[VK__none_] = false;
+
+    // Reachable combinations of modifiers, from all combinations of pressed keys.
+    std::array<bool, 256> mods{};
+    KbdState state{};
+    for (uint32_t keys = 0; keys < 0x10000; ++keys) {
+        state.keys = uint16_t(keys);
+        mods[engine.modifiers(state)] = true;
+    }
+
+    // Characters of all reachable cells. Keep the accents of the dead keys.
+    CharSet key_accents;
+    for (size_t vk = 0; vk < vks.size(); ++vk) {
+        if (!vks[vk] || engine.isTracked(uint8_t(vk))) {
+            continue;
+        }
+        const uint8_t locks = engine.keyLocks(uint8_t(vk));
+        for (size_t modbits = 0; modbits < mods.size(); ++modbits) {
+            if (!mods[modbits]) {
+                continue;
+            }
+            for (int variant = 0; variant < 4; ++variant) {
+                const bool caps = (variant & 1) != 0;
+                const bool kana = (variant & 2) != 0;
+                if ((caps && (locks & KLOCK_CAPITAL) == 0) || (kana && (locks & KLOCK_KANA) == 0)) {
+                    continue;
+                }
+                const size_t cell = engine.cell(uint8_t(modbits | (kana ? KBDKANA : 0)), caps);
+                const WCHAR wc = engine.character(uint8_t(vk), cell);
+                if (wc == WCH_DEAD) {
+                    key_accents.set(engine.deadCharacter(uint8_t(vk), cell));
+                }
+                else if (wc == WCH_LGTR) {
+                    WCHAR lg[KbdEngine::MAX_OUTPUT];
+                    const size_t count = engine.ligature(uint8_t(vk), cell, lg);
+                    for (size_t i = 0; i < count; ++i) {
+                        // Surrogates are parts of code points outside the BMP.
+                        if (lg[i] < 0xD800 || lg[i] > 0xDFFF) {
+                            _ligatures.set(lg[i]);
+                        }
+                    }
+                }
+                else if (wc != WCH_NONE) {
+                    _direct.set(wc);
+                }
+            }
+        }
+    }
+
+    // Dead keys: a pending accent is composed with the character or the accent of the next key.
+    // Chained compositions are new pending accents. Iterate until no new accent is found.
+    // A pending accent alone is output when the next key does not compose with it.
+    CharSet accents(key_accents);
+    const CharSet bases(_direct | key_accents);
+    const DeadKeyIndex& index(engine.deadKeys());
+    for (bool more = true; more; ) {
+        more = false;
+        for (const DEADKEY* dk = engine.tables().pDeadKey; dk != nullptr && dk->dwBoth != 0; ++dk) {
+            const WCHAR base = LOWORD(dk->dwBoth);
+            const WCHAR accent = HIWORD(dk->dwBoth);
+            bool chained = false;
+            // Only the first composition of a pair is used.
+            if (accents.test(accent) && bases.test(base) && index.compose(base, accent, chained) == dk->wchComposed) {
+                if (!chained) {
+                    _dead.set(dk->wchComposed);
+                }
+                else if (!accents.test(dk->wchComposed)) {
+                    accents.set(dk->wchComposed);
+                    more = true;
+                }
+            }
+        }
+    }
+    _dead |= accents;
+    _direct.reset(0);
+    _dead.reset(0);
+
+    _all = _direct | _dead | _ligatures;
+}
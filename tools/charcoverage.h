@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Character coverage of keyboard layouts, as sets of BMP code points.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdengine.h"
+
+// A set of code points in the Basic Multilingual Plane, one bit per code point (8 KB).
+// The population counts use AVX2 when the CPU supports it.
+class CharSet
+{
+public:
+    // Number of code points and 64-bit words in a set.
+    static constexpr size_t BITS = 0x10000;
+    static constexpr size_t WORDS = BITS / 64;
+
+    // Constructor: empty set.
+    CharSet() : _bits() {}
+
+    // Add, remove, check a code point.
+    void set(WCHAR c) { _bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    void reset(WCHAR c) { _bits[c >> 6] &= ~(uint64_t(1) << (c & 63)); }
+    bool test(WCHAR c) const { return (_bits[c >> 6] & (uint64_t(1) << (c & 63))) != 0; }
+
+    // Set algebra: union, intersection, difference.
+    CharSet& operator|=(const CharSet&);
+    CharSet& operator&=(const CharSet&);
+    CharSet& operator-=(const CharSet&);
+    CharSet operator|(const CharSet& other) const { return CharSet(*this) |= other; }
+    CharSet operator&(const CharSet& other) const { return CharSet(*this) &= other; }
+    CharSet operator-(const CharSet& other) const { return CharSet(*this) -= other; }
+    bool operator==(const CharSet& other) const = default;
+
+    // Number of code points in the set.
+    size_t count() const { return Count(OP_NONE, *this, *this); }
+
+    // Number of code points in the union, intersection, difference of two sets, without building it.
+    static size_t CountUnion(const CharSet& a, const CharSet& b) { return Count(OP_OR, a, b); }
+    static size_t CountIntersection(const CharSet& a, const CharSet& b) { return Count(OP_AND, a, b); }
+    static size_t CountDifference(const CharSet& a, const CharSet& b) { return Count(OP_ANDNOT, a, b); }
+
+    // Get all code points of the set, in increasing order.
+    void getCharacters(std::vector<WCHAR>&) const;
+
+    // Check if the AVX2 population count is used on this CPU.
+    static bool UseAVX2();
+
+private:
+    // Operation on two sets before the population count.
+    enum Operation {OP_NONE, OP_OR, OP_AND, OP_ANDNOT};
+
+    alignas(32) std::array<uint64_t, WORDS> _bits;
+
+    // Population count kernels.
+    static size_t Count(Operation, const CharSet&, const CharSet&);
+    static size_t CountScalar(Operation, const uint64_t*, const uint64_t*);
+    static size_t CountAVX2(Operation, const uint64_t*, const uint64_t*);
+};
+
+// Characters which can be typed on a keyboard layout, from the tables of the translation
+// engine: characters of the keys with all reachable combinations of modifiers and locks,
+// compositions of dead keys (including chained dead keys) and ligatures. The Alt+numpad
+// characters are not included, they are the same on all layouts.
+class CharCoverage
+{
+public:
+    // Constructor. Compute the coverage of the layout of the engine.
+    CharCoverage(const KbdEngine&);
+
+    // Characters of a single key with modifiers.
+    const CharSet& direct() const { return _direct; }
+
+    // Characters from dead keys: compositions and dead characters alone.
+    const CharSet& deadKeys() const { return _dead; }
+
+    // Characters in ligatures.
+    const CharSet& ligatures() const { return _ligatures; }
+
+    // All characters which can be typed.
+    const CharSet& all() const { return _all; }
+
+private:
+    CharSet _direct;
+    CharSet _dead;
+    CharSet _ligatures;
+    CharSet _all;
+};
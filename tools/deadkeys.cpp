@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compiled index of the dead keys (DEADKEY) of a keyboard layout.
+//
+//----------------------------------------------------------------------------
+
+#include "deadkeys.h"
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+DeadKeyIndex::DeadKeyIndex(const DEADKEY* dk) :
+    _mult(0),
+    _shift(31),
+    _count(0),
+    _accent_count(0),
+    _accents(),
+    _entries()
+{
+    build(dk);
+}
+
+
+//----------------------------------------------------------------------------
+// Reference implementation: linear scan of a DEADKEY array.
+//----------------------------------------------------------------------------
+
+WCHAR DeadKeyIndex::LinearCompose(const DEADKEY* dk, WCHAR base, WCHAR accent, bool& chained)
+{
+    chained = false;
+    const DWORD both = MAKELONG(base, accent);
+    for (; dk != nullptr && dk->dwBoth != 0; dk++) {
+        if (dk->dwBoth == both) {
+            chained = (dk->uFlags & DKF_DEAD) != 0;
+            return dk->wchComposed;
+        }
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Find a collision-free multiplier and shift for a set of distinct keys.
+//----------------------------------------------------------------------------
+
+size_t DeadKeyIndex::perfectHash(const std::vector<WCHAR>& keys, uint32_t& mult, uint8_t& shift)
+{
+    // Smallest power of two which is at least the number of keys, at least 2.
+    size_t bits = 1;
+    while ((size_t(1) << bits) < keys.size()) {
+        ++bits;
+    }
+
+    // Try a few multipliers, then grow the table when there is no solution.
+    std::vector<bool> used;
+    for (;; ++bits) {
+        const size_t size = size_t(1) << bits;
+        for (uint32_t attempt = 1; attempt <= 1024; ++attempt) {
+            mult = (0x9E3779B1u * attempt) | 1;
+            shift = uint8_t(32 - bits);
+            used.assign(size, false);
+            bool ok = true;
+            for (size_t i = 0; ok && i < keys.size(); ++i) {
+                const size_t h = hash(keys[i], mult, shift);
+                ok = !used[h];
+                used[h] = true;
+            }
+            if (ok) {
+                return size;
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Compile a DEADKEY array.
+//----------------------------------------------------------------------------
+
+void DeadKeyIndex::build(const DEADKEY* dk)
+{
+    _count = 0;
+    _accent_count = 0;
+    _accents.clear();
+    _entries.clear();
+
+    // Collect distinct compositions, grouped by accent. Keep the first one, as the system does.
+    std::map<WCHAR, std::map<WCHAR, const DEADKEY*>> all;
+    for (; dk != nullptr && dk->dwBoth != 0; dk++) {
+        all[HIWORD(dk->dwBoth)].insert(std::make_pair(WCHAR(LOWORD(dk->dwBoth)), dk));
+    }
+
+    // The first two entries are never used. They are referenced by unused accents.
+    _entries.resize(2, Entry{0, 0, 0});
+
+    // First level: the accents.
+    std::vector<WCHAR> accents;
+    for (const auto& it : all) {
+        accents.push_back(it.first);
+    }
+    _accents.resize(perfectHash(accents, _mult, _shift), Accent{0, 31, 0, 0, 0});
+    _accent_count = accents.size();
+
+    // Second level: the base characters for each accent.
+    for (const auto& it : all) {
+        Accent& acc(_accents[hash(it.first, _mult, _shift)]);
+        std::vector<WCHAR> bases;
+        for (const auto& it2 : it.second) {
+            bases.push_back(it2.first);
+        }
+        acc.accent = it.first;
+        acc.offset = uint32_t(_entries.size());
+        _entries.resize(_entries.size() + perfectHash(bases, acc.mult, acc.shift), Entry{0, 0, 0});
+        for (const auto& it2 : it.second) {
+            Entry& ent(_entries[acc.offset + hash(it2.first, acc.mult, acc.shift)]);
+            ent.both = it2.second->dwBoth;
+            ent.composed = it2.second->wchComposed;
+            ent.flags = it2.second->uFlags;
+            _count++;
+        }
+    }
+}
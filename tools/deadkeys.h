@@ -0,0 +1,84 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compiled index of the dead keys (DEADKEY) of a keyboard layout.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+
+// The DEADKEY array of a keyboard layout is a zero-terminated list which
+// must be scanned linearly for each (base character, accent) pair. This class
+// compiles it into a two-level perfect hash table: first by accent, then by
+// base character. A lookup is two probes, whatever the size of the list.
+class DeadKeyIndex
+{
+public:
+    // Constructor. Compile a DEADKEY array (may be null).
+    DeadKeyIndex(const DEADKEY* = nullptr);
+
+    // Compile a DEADKEY array (may be null). Replace the previous content.
+    void build(const DEADKEY*);
+
+    // Compose a base character with an accent (a pending dead key).
+    // Return zero if there is no composition. When the composed character is
+    // itself a dead key (DKF_DEAD), 'chained' is set to true.
+    WCHAR compose(WCHAR base, WCHAR accent, bool& chained) const
+    {
+        const Accent& acc(_accents[hash(accent, _mult, _shift)]);
+        const Entry& ent(_entries[acc.offset + hash(base, acc.mult, acc.shift)]);
+        const bool found = acc.accent == accent && ent.both == uint32_t(MAKELONG(base, accent));
+        chained = found && (ent.flags & DKF_DEAD) != 0;
+        return found ? ent.composed : 0;
+    }
+
+    // Check if a character is an accent, i.e. the pending character of a dead key.
+    bool isAccent(WCHAR accent) const { return _accents[hash(accent, _mult, _shift)].accent == accent && accent != 0; }
+
+    // Reference implementation: linear scan of a DEADKEY array, as done by the system.
+    static WCHAR LinearCompose(const DEADKEY*, WCHAR base, WCHAR accent, bool& chained);
+
+    // Number of distinct compositions and accents.
+    size_t size() const { return _count; }
+    size_t accentCount() const { return _accent_count; }
+
+    // Memory size of the index in bytes.
+    size_t memorySize() const { return _accents.size() * sizeof(Accent) + _entries.size() * sizeof(Entry); }
+
+private:
+    // One composition in the second level tables.
+    struct Entry
+    {
+        uint32_t both;      // Same as DEADKEY.dwBoth, zero for unused entries.
+        WCHAR    composed;  // Composed character.
+        uint16_t flags;     // DEADKEY.uFlags.
+    };
+
+    // One accent in the first level table.
+    struct Accent
+    {
+        WCHAR    accent;    // Accent character, zero for unused entries.
+        uint8_t  shift;     // Hash shift for the second level table.
+        uint8_t  spare;
+        uint32_t mult;      // Hash multiplier for the second level table.
+        uint32_t offset;    // Index of the second level table in _entries.
+    };
+
+    uint32_t            _mult;
+    uint8_t             _shift;
+    size_t              _count;
+    size_t              _accent_count;
+    std::vector<Accent> _accents;
+    std::vector<Entry>  _entries;
+
+    // Multiplicative hash of a 16-bit character.
+    static size_t hash(WCHAR c, uint32_t mult, uint8_t shift) { return size_t(uint32_t(c * mult) >> shift); }
+
+    // Find a collision-free multiplier and shift for a set of distinct keys.
+    // Return the table size.
+    static size_t perfectHash(const std::vector<WCHAR>& keys, uint32_t& mult, uint8_t& shift);
+};
@@ -8,7 +8,6 @@
 //
 //----------------------------------------------------------------------------
 
-#pragma once
 #include "error.h"
 
 
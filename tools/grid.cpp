@@ -8,7 +8,6 @@
 //
 //----------------------------------------------------------------------------
 
-#pragma once
 #include "grid.h"
 
 
@@ -17,23 +16,68 @@
 //----------------------------------------------------------------------------
 
 Grid::Grid(const WString& margin, const WString& spacing) :
+    _text(),
+    _cells(),
     _lines(),
+    _widths(),
     _margin(margin),
     _spacing(spacing)
 {
 }
 
 
+//----------------------------------------------------------------------------
+// Clear content. Keep the allocated memory for reuse.
+//----------------------------------------------------------------------------
+
+void Grid::clear()
+{
+    _text.clear();
+    _cells.clear();
+    _lines.clear();
+    _widths.clear();
+}
+
+
+//----------------------------------------------------------------------------
+// Add one line.
+//----------------------------------------------------------------------------
+
+void Grid::addLine(const Line& line)
+{
+    _lines.push_back(_cells.size());
+    for (const auto& text : line) {
+        addColumn(text);
+    }
+}
+
+void Grid::addLine(std::initializer_list<std::wstring_view> line)
+{
+    _lines.push_back(_cells.size());
+    for (const auto& text : line) {
+        addColumn(text);
+    }
+}
+
+
 //----------------------------------------------------------------------------
 // Add one column on last line.
 //----------------------------------------------------------------------------
 
-void Grid::addColumn(const WString& text)
+void Grid::addColumn(std::wstring_view text)
 {
     if (_lines.empty()) {
-        _lines.push_back(Line());
+        _lines.push_back(0);
+    }
+    const size_t col = lineSize(_lines.size() - 1);
+    _cells.push_back(Cell{_text.size(), text.size()});
+    _text.append(text);
+    if (col >= _widths.size()) {
+        _widths.push_back(text.size());
+    }
+    else if (_widths[col] < text.size()) {
+        _widths[col] = text.size();
     }
-    _lines.back().push_back(text);
 }
 
 
@@ -44,12 +88,52 @@ void Grid::addColumn(const WString& text)
 void Grid::addUnderlines(const Line& first_colums, wchar_t underline)
 {
     if (!_lines.empty()) {
-        const Line& prev(_lines.back());
-        Line next(first_colums);
-        while (next.size() < prev.size()) {
-            next.push_back(WString(prev[next.size()].length(), underline));
+        const size_t prev = _lines.back();
+        const size_t count = lineSize(_lines.size() - 1);
+        _lines.push_back(_cells.size());
+        for (const auto& text : first_colums) {
+            addColumn(text);
+        }
+        for (size_t col = first_colums.size(); col < count; ++col) {
+            const size_t length = _cells[prev + col].length;
+            _cells.push_back(Cell{_text.size(), length});
+            _text.append(length, underline);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Remove leading and trailing spaces in a cell.
+//----------------------------------------------------------------------------
+
+void Grid::trim(Cell& cell) const
+{
+    while (cell.length > 0 && std::isspace(_text[cell.offset + cell.length - 1])) {
+        cell.length--;
+    }
+    while (cell.length > 0 && std::isspace(_text[cell.offset])) {
+        cell.offset++;
+        cell.length--;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Recompute the column widths.
+//----------------------------------------------------------------------------
+
+void Grid::computeWidths()
+{
+    _widths.clear();
+    for (size_t line = 0; line < _lines.size(); ++line) {
+        const size_t count = lineSize(line);
+        if (_widths.size() < count) {
+            _widths.resize(count, 0);
+        }
+        for (size_t col = 0; col < count; ++col) {
+            _widths[col] = std::max(_widths[col], _cells[_lines[line] + col].length);
         }
-        _lines.push_back(next);
     }
 }
 
@@ -60,62 +144,78 @@ void Grid::addUnderlines(const Line& first_colums, wchar_t underline)
 
 void Grid::removeEmptyLines(size_t header_columns_count, bool trim)
 {
-    for (auto it = _lines.begin(); it != _lines.end(); ) {
-        if (trim) {
-            for (WString& cell : *it) {
-                Trim(cell);
-            }
+    if (trim) {
+        for (auto& cell : _cells) {
+            this->trim(cell);
         }
+    }
+
+    // Compact the cells of the lines to keep.
+    size_t next_cell = 0;
+    size_t next_line = 0;
+    for (size_t line = 0; line < _lines.size(); ++line) {
+        const size_t start = _lines[line];
+        const size_t count = lineSize(line);
         bool remove = true;
-        for (size_t i = header_columns_count; remove && i < it->size(); ++i) {
-            remove = (*it)[i].empty();
+        for (size_t col = header_columns_count; remove && col < count; ++col) {
+            remove = _cells[start + col].length == 0;
         }
-        if (remove) {
-            it = _lines.erase(it);
-        }
-        else {
-            ++it;
+        if (!remove) {
+            _lines[next_line++] = next_cell;
+            for (size_t col = 0; col < count; ++col) {
+                _cells[next_cell++] = _cells[start + col];
+            }
         }
     }
+    _lines.resize(next_line);
+    _cells.resize(next_cell);
+    computeWidths();
 }
 
 void Grid::removeEmptyColumns(size_t header_lines_count, bool trim)
 {
-    size_t col = 0;
-    bool more_col = true;
+    if (trim) {
+        for (auto& cell : _cells) {
+            this->trim(cell);
+        }
+    }
 
     // Loop on columns;
-    while (more_col) {
+    for (size_t col = 0; ; ) {
 
         // First pass: check if the column shall be kept or removed.
-        more_col = false;
+        bool more_col = false;
         bool remove = true;
-        size_t line_index = 0;
-        for (auto& line : _lines) {
-            for (WString& cell : line) {
-                Trim(cell);
-            }
-            if (line_index++ >= header_lines_count && col < line.size() && remove) {
+        for (size_t line = header_lines_count; line < _lines.size(); ++line) {
+            if (col < lineSize(line)) {
                 more_col = true;
-                remove = line[col].empty();
+                remove = remove && _cells[_lines[line] + col].length == 0;
             }
         }
 
         // Second pass: remove the column if necessary.
         if (remove) {
-            for (auto& line : _lines) {
-                if (col < line.size()) {
-                    // line.erase(line.begin() + col) does not compile with VS 17.5.5 ????
-                    Line::iterator it(line.begin());
-                    std::advance(it, col);
-                    line.erase(it);
+            size_t next_cell = 0;
+            for (size_t line = 0; line < _lines.size(); ++line) {
+                const size_t start = _lines[line];
+                const size_t end = start + lineSize(line);
+                _lines[line] = next_cell;
+                for (size_t i = start; i < end; ++i) {
+                    if (i != start + col) {
+                        _cells[next_cell++] = _cells[i];
+                    }
                 }
             }
+            _cells.resize(next_cell);
         }
         else {
             ++col;
         }
+        if (!more_col) {
+            break;
+        }
     }
+    computeWidths();
 }
 
 
@@ -123,32 +223,24 @@ void Grid::removeEmptyColumns(size_t header_lines_count, bool trim)
 // Print the grid. All columns are aligned on their maximum width.
 //----------------------------------------------------------------------------
 
-void Grid::print(std::ostream& out)
+void Grid::print(std::ostream& out) const
 {
-    std::vector<size_t> widths;
-
-    // Compute columns widths.
-    for (const auto& row : _lines) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            const size_t w = row[i].length();
-            if (widths.size() <= i) {
-                widths.push_back(w);
-            }
-            else if (widths[i] < w) {
-                widths[i] = w;
-            }
-        }
-    }
+    UTF8Writer writer(out);
+    print(writer);
+}
 
-    // Then print the grid.
-    for (const auto& row : _lines) {
+void Grid::print(UTF8Writer& out) const
+{
+    for (size_t line = 0; line < _lines.size(); ++line) {
+        const size_t count = lineSize(line);
         out << _margin;
-        for (size_t i = 0; i < row.size(); ++i) {
-            out << row[i];
-            if (i < row.size() - 1) {
-                out << std::string(widths[i] - row[i].length(), ' ') << _spacing;
+        for (size_t col = 0; col < count; ++col) {
+            const Cell& cell(_cells[_lines[line] + col]);
+            out << cellText(cell);
+            if (col < count - 1) {
+                out.put(' ', _widths[col] - cell.length) << _spacing;
             }
         }
-        out << std::endl;
+        out.newLine();
     }
 }
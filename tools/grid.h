@@ -9,8 +9,10 @@
 //----------------------------------------------------------------------------
 
 #pragma once
-#include "strutils.h"
+#include "utf8writer.h"
 
+// The text of all cells is stored in one single buffer. The widths of the
+// columns are maintained while the grid is built.
 class Grid
 {
 public:
@@ -21,13 +23,14 @@ public:
     Grid(const WString& margin = L"", const WString& spacing = L" ");
 
     // Clear content.
-    void clear() { _lines.clear(); }
+    void clear();
 
     // Add one line.
-    void addLine(const Line& line) { _lines.push_back(line); }
+    void addLine(const Line& line);
+    void addLine(std::initializer_list<std::wstring_view> line);
 
     // Add one column on last line.
-    void addColumn(const WString& text);
+    void addColumn(std::wstring_view text);
 
     // Add underlines under previous line.
     void addUnderlines(const Line& first_colums = Line(), wchar_t underline = L'-');
@@ -43,10 +46,33 @@ public:
     void setSpacing(size_t width) { _spacing = WString(width, L' '); }
 
     // Print the grid. All columns are aligned on their maximum width.
-    void print(std::ostream& out);
+    void print(UTF8Writer& out) const;
+    void print(std::ostream& out) const;
 
 private:
-    std::list<Line> _lines;
-    WString         _margin;
-    WString         _spacing;
+    // One cell: a substring of _text.
+    struct Cell
+    {
+        size_t offset;
+        size_t length;
+    };
+
+    WString             _text;    // Text of all cells.
+    std::vector<Cell>   _cells;   // All cells, line after line.
+    std::vector<size_t> _lines;   // Index in _cells of the first cell of each line.
+    std::vector<size_t> _widths;  // Maximum width of each column.
+    WString             _margin;
+    WString             _spacing;
+
+    // Number of cells in a line.
+    size_t lineSize(size_t line) const { return (line + 1 < _lines.size() ? _lines[line + 1] : _cells.size()) - _lines[line]; }
+
+    // Get the text of a cell.
+    std::wstring_view cellText(const Cell& cell) const { return std::wstring_view(_text.data() + cell.offset, cell.length); }
+
+    // Remove leading and trailing spaces in a cell, without modifying the text.
+    void trim(Cell& cell) const;
+
+    // Recompute the column widths.
+    void computeWidths();
 };
@@ -0,0 +1,262 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compilation of a keyboard layout into one deterministic automaton.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdautomaton.h"
+#include <bit>
+#include <set>
+
+// Key of a translation state in the map of explored states (the Alt+numpad code is not part of it).
+static uint64_t StateKey(const KbdState& state)
+{
+    return uint64_t(state.keys) | (uint64_t(state.locks) << 16) | (uint64_t(state.numpad) << 24) | (uint64_t(state.dead) << 32);
+}
+
+bool KbdAutomaton::Transition::operator<(const Transition& other) const
+{
+    return next != other.next ? next < other.next : (output != other.output ? output < other.output : action < other.action);
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: build the automaton.
+//----------------------------------------------------------------------------
+
+KbdAutomaton::KbdAutomaton(const KbdEngine& engine, size_t max_states) :
+    _explored(0),
+    _tracked(0),
+    _dead(0),
+    _states(0),
+    _classes(0),
+    _stride(0),
+    _first(0),
+    _input(),
+    _table(),
+    _offsets(),
+    _chars(),
+    _ends()
+{
+    _input.fill(0);
+
+    // Initial input classes: the engine only uses the virtual key, with its flags, and the break flag.
+    std::map<uint32_t, uint16_t> class_ids;
+    std::vector<KeyEvent> inputs;  // First keystroke of each class.
+    std::array<uint16_t, 2*4*256> raw_input;
+    for (size_t index = 0; index < raw_input.size(); ++index) {
+        const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((((index >> 8) & 3) << 1) | (index >> 10))};
+        const uint32_t key = (uint32_t(engine.virtualKey(ev)) << 1) | (ev.flags & KEV_BREAK);
+        const auto it = class_ids.find(key);
+        if (it != class_ids.end()) {
+            raw_input[index] = it->second;
+        }
+        else {
+            raw_input[index] = class_ids[key] = uint16_t(inputs.size());
+            inputs.push_back(ev);
+        }
+    }
+    const size_t k = inputs.size();
+
+    // Output strings, the empty string is the first one.
+    std::map<std::vector<WCHAR>, uint16_t> output_ids;
+    output_ids[std::vector<WCHAR>()] = 0;
+    _offsets = {0, 0};
+    const auto output_id = [&](const WCHAR* str, size_t size) -> int {
+        const std::vector<WCHAR> key(str, str + size);
+        const auto it = output_ids.find(key);
+        if (it != output_ids.end()) {
+            return it->second;
+        }
+        if (_offsets.size() > 0xFFFF) {
+            return -1;
+        }
+        const uint16_t id = uint16_t(_offsets.size() - 1);
+        output_ids[key] = id;
+        _chars.insert(_chars.end(), key.begin(), key.end());
+        _offsets.push_back(uint32_t(_chars.size()));
+        return id;
+    };
+
+    // Index of a state, added to the explored states when new. Return -1 when there are too many states.
+    std::vector<KbdState> states{KbdState()};
+    std::map<uint64_t, uint32_t> state_ids{{0, 0}};
+    const auto state_id = [&](const KbdState& state) -> int64_t {
+        const auto it = state_ids.find(StateKey(state));
+        if (it != state_ids.end()) {
+            return it->second;
+        }
+        if (states.size() >= max_states) {
+            return -1;
+        }
+        states.push_back(state);
+        return state_ids[StateKey(state)] = uint32_t(states.size() - 1);
+    };
+
+    // Explore all reachable states. When an Alt+numpad entry is in progress, the engine is run
+    // with two values of the code to find the action of the transition on the code. The code 0
+    // produces no character at the end of an entry, the code 1 always produces one.
+    std::vector<Transition> raw;
+    std::vector<uint32_t> raw_zero;  // Next state of the ends of entries with a zero code, same as 'next' otherwise.
+    for (size_t s = 0; s < states.size(); ++s) {
+        const KbdState current(states[s]);
+        for (size_t c = 0; c < k; ++c) {
+            KbdState st0(current);
+            KbdState st1(current);
+            st1.code = 1;
+            WCHAR out0[KbdEngine::MAX_OUTPUT];
+            WCHAR out1[KbdEngine::MAX_OUTPUT];
+            const size_t n0 = engine.translate(inputs[c], st0, out0);
+            const size_t n1 = current.numpad == 0 ? n0 : engine.translate(inputs[c], st1, out1);
+
+            uint8_t action = ACTION_NONE;
+            if (current.numpad == 0) {
+                // The code is zero, the entry may start with a first digit.
+                action = st0.numpad == 0 ? uint8_t(ACTION_NONE) : uint8_t(ACTION_DIGIT + st0.code);
+            }
+            else if (st0.numpad != 0) {
+                // The entry continues, with or without a new digit.
+                action = st0.code == 0 && st1.code == 1 ? uint8_t(ACTION_NONE) : uint8_t(ACTION_DIGIT + st0.code);
+            }
+            else if (n0 != n1 || !std::equal(out0, out0 + n0, out1)) {
+                // The entry ends and the character depends on the code.
+                action = (current.numpad & KNUM_ANSI) != 0 ? ACTION_END_ANSI : ACTION_END_OEM;
+            }
+            else {
+                action = ACTION_CANCEL;
+            }
+
+            // Next states, with the code in the register only. At the end of an entry, the output of
+            // the transition is what precedes the character of the code: the flushed dead key, if any.
+            const bool end = action == ACTION_END_OEM || action == ACTION_END_ANSI;
+            st0.code = st1.code = 0;
+            const int64_t next = state_id(end ? st1 : st0);
+            const int64_t zero = end ? state_id(st0) : next;
+            const int output = end ? output_id(out1, n1 - 1) : output_id(out0, n0);
+            if (next < 0 || zero < 0 || output < 0) {
+                _explored = states.size();
+                _offsets.clear();
+                _chars.clear();
+                return;
+            }
+            raw.push_back(Transition{uint32_t(next), uint16_t(output), action, 0});
+            raw_zero.push_back(uint32_t(zero));
+        }
+    }
+    _explored = states.size();
+
+    // Factors of the number of states.
+    uint16_t keys = 0;
+    std::set<WCHAR> dead;
+    for (const auto& st : states) {
+        keys |= st.keys;
+        if (st.dead != 0) {
+            dead.insert(st.dead);
+        }
+    }
+    _tracked = size_t(std::popcount(keys));
+    _dead = dead.size();
+
+    // The explored states are the states of the automaton, without minimization: each tracked key is released
+    // separately and each pending dead key has its own compositions, a partition refinement merged no state
+    // on the layouts of this project. The initial state is zero.
+    // The ends of Alt+numpad entries point to their pair of next states.
+    const size_t count = states.size();
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> end_ids;
+    for (size_t t = 0; t < raw.size(); ++t) {
+        Transition& tr(raw[t]);
+        if (tr.action == ACTION_END_OEM || tr.action == ACTION_END_ANSI) {
+            const std::pair<uint32_t, uint32_t> key(tr.next, raw_zero[t]);
+            const auto it = end_ids.emplace(key, uint32_t(_ends.size()));
+            if (it.second) {
+                _ends.push_back(End{key.first, key.second});
+            }
+            tr.next = it.first->second;
+        }
+    }
+
+    // Merge the input classes with identical transitions in all states.
+    std::map<std::vector<Transition>, uint16_t> column_ids;
+    std::vector<uint16_t> column_of(k);
+    std::vector<Transition> column(count);
+    for (size_t c = 0; c < k; ++c) {
+        for (size_t b = 0; b < count; ++b) {
+            column[b] = raw[b * k + c];
+        }
+        column_of[c] = column_ids.emplace(column, uint16_t(column_ids.size())).first->second;
+    }
+    for (size_t index = 0; index < raw_input.size(); ++index) {
+        _input[index] = column_of[raw_input[index]];
+    }
+
+    // Final table, one cache-aligned row per state.
+    _states = count;
+    _classes = column_ids.size();
+    _stride = (_classes + LINE_TRANSITIONS - 1) / LINE_TRANSITIONS * LINE_TRANSITIONS;
+    _table.resize(_states * _stride + LINE_TRANSITIONS);
+    _first = ((64 - reinterpret_cast<uintptr_t>(_table.data()) % 64) % 64) / sizeof(Transition);
+    for (size_t b = 0; b < count; ++b) {
+        for (size_t c = 0; c < k; ++c) {
+            _table[_first + b * _stride + column_of[c]] = raw[b * k + c];
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Memory size of the automaton in bytes.
+//----------------------------------------------------------------------------
+
+size_t KbdAutomaton::memorySize() const
+{
+    return _table.size() * sizeof(Transition) + sizeof(_input) + _offsets.size() * sizeof(uint32_t) + _chars.size() * sizeof(WCHAR) + _ends.size() * sizeof(End);
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a sequence of keystrokes.
+//----------------------------------------------------------------------------
+
+void KbdAutomaton::translate(const KeyEvent* events, size_t count, State& state, std::vector<WCHAR>& out) const
+{
+    const Transition* const table = _table.data() + _first;
+    uint32_t index = state.index;
+    uint8_t code = state.code;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Transition& tr(table[index * _stride + _input[InputIndex(events[i])]]);
+        index = tr.next;
+        if (tr.action == ACTION_END_OEM || tr.action == ACTION_END_ANSI) {
+            // End of an Alt+numpad entry: the output is only the flushed dead key, before the character.
+            const WCHAR wc = KbdEngine::NumpadCharacter(code, tr.action == ACTION_END_ANSI);
+            const End& end(_ends[tr.next]);
+            index = wc == 0 ? end.zero : end.next;
+            if (wc == 0) {
+                code = 0;
+                continue;
+            }
+            if (tr.output != 0) {
+                out.insert(out.end(), _chars.data() + _offsets[tr.output], _chars.data() + _offsets[tr.output + 1]);
+            }
+            out.push_back(wc);
+            code = 0;
+            continue;
+        }
+        if (tr.output != 0) {
+            out.insert(out.end(), _chars.data() + _offsets[tr.output], _chars.data() + _offsets[tr.output + 1]);
+        }
+        if (tr.action >= ACTION_DIGIT) {
+            code = uint8_t(code * 10 + tr.action - ACTION_DIGIT);
+        }
+        else if (tr.action == ACTION_CANCEL) {
+            code = 0;
+        }
+    }
+
+    state.index = index;
+    state.code = code;
+}
@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compilation of a keyboard layout into one deterministic automaton.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdengine.h"
+
+// The automaton is built by exploring all reachable states of KbdEngine from
+// the initial state: pressed tracked keys, locks, pending dead key, Alt+numpad
+// entry. The inputs are all keystrokes (prefix, scan code, make/break), grouped
+// in classes of keystrokes which behave identically. The outputs are UTF-16
+// strings. The automaton is stored as one transition table, one cache-aligned
+// row per state.
+//
+// The only value which is not in the automaton state is the Alt+numpad code,
+// a register of 256 values which would multiply the number of states. The
+// transitions carry an action on this register (add a digit, produce the
+// character, cancel). The character of the code flushes a pending dead key, but
+// a zero code produces nothing and the dead key remains pending: the transitions
+// which end an entry have two next states. All other cases (modifiers, locks,
+// dead keys, ligatures, numeric keypad) are in the table.
+//
+// The states are those of the engine, which tracks each modifier and lock key:
+// the release of the left Shift key does not release the right one, a repeated
+// press on Caps Lock (auto-repeat) does not toggle the lock again. The explored
+// states are not minimized, the automaton has exactly the reachable states.
+//
+// The output and final state are always identical to KbdEngine::translate().
+class KbdAutomaton
+{
+public:
+    // Default maximum number of explored states.
+    static constexpr size_t DEFAULT_MAX_STATES = 100000;
+
+    // Constructor. Build the automaton of the layout of the engine.
+    // If there are more than max_states reachable states, the automaton is not built.
+    KbdAutomaton(const KbdEngine&, size_t max_states = DEFAULT_MAX_STATES);
+
+    // Check if the automaton was successfully built.
+    bool isValid() const { return _states > 0; }
+
+    // Translation state. A zero-initialized state is the initial state of the engine.
+    struct State
+    {
+        uint32_t index;  // State in the automaton.
+        uint8_t  code;   // Alt+numpad code being typed, modulo 256.
+
+        bool operator==(const State& other) const = default;
+    };
+
+    // Translate a sequence of keystrokes. The characters are appended to 'out'.
+    void translate(const KeyEvent* events, size_t count, State&, std::vector<WCHAR>& out) const;
+
+    // Number of explored states, also when the automaton was not built because there are too many.
+    size_t exploredStates() const { return _explored; }
+
+    // Number of tracked keys and of pending dead keys in the explored states, the factors of their number.
+    size_t trackedKeys() const { return _tracked; }
+    size_t pendingDeadKeys() const { return _dead; }
+
+    // Number of states, input classes, transitions and distinct output strings.
+    size_t stateCount() const { return _states; }
+    size_t inputClasses() const { return _classes; }
+    size_t transitionCount() const { return _states * _classes; }
+    size_t outputCount() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+    // Memory size of the automaton in bytes.
+    size_t memorySize() const;
+
+private:
+    // Actions on the Alt+numpad code.
+    enum : uint8_t {
+        ACTION_NONE,      // Nothing.
+        ACTION_CANCEL,    // Reset the code.
+        ACTION_END_OEM,   // Produce the character of the code in the OEM code page, reset the code.
+        ACTION_END_ANSI,  // Produce the character of the code in the ANSI code page, reset the code.
+        ACTION_DIGIT,     // Add a digit to the code, ACTION_DIGIT + digit.
+    };
+
+    // One transition, 8 bytes. With ACTION_END_xxx, 'next' is an index in _ends and
+    // 'output' is the pending dead key, which is output only before a character.
+    struct Transition
+    {
+        uint32_t next;    // Next state.
+        uint16_t output;  // Output string, index in _offsets, zero for empty string.
+        uint8_t  action;  // Action on the Alt+numpad code, ACTION_xxx.
+        uint8_t  spare;   // Unused, zero.
+
+        bool operator==(const Transition& other) const = default;
+        bool operator<(const Transition& other) const;
+    };
+
+    // Next states of the transitions which end an Alt+numpad entry.
+    struct End
+    {
+        uint32_t next;    // When the code produces a character, the dead key is flushed.
+        uint32_t zero;    // When the code produces no character, the dead key remains pending.
+    };
+
+    // Number of transitions per cache line.
+    static constexpr size_t LINE_TRANSITIONS = 64 / sizeof(Transition);
+
+    size_t                    _explored;  // Number of explored states.
+    size_t                    _tracked;   // Number of tracked keys in the explored states.
+    size_t                    _dead;      // Number of pending dead keys in the explored states.
+    size_t                    _states;    // Number of states.
+    size_t                    _classes;   // Number of input classes.
+    size_t                    _stride;    // Number of transitions per row, rounded to a cache line.
+    size_t                    _first;     // Index of first transition in _table, cache-aligned.
+    std::array<uint16_t, 2*4*256> _input; // Input class by [break][prefix + scan code].
+    std::vector<Transition>   _table;     // Transitions by [state][input class], from _first.
+    std::vector<uint32_t>     _offsets;   // Index in _chars of each output string, plus final end.
+    std::vector<WCHAR>        _chars;     // All output strings.
+    std::vector<End>          _ends;      // Next states of the ends of Alt+numpad entries.
+
+    // Index in _input of a keystroke.
+    static size_t InputIndex(KeyEvent ev) { return (size_t(ev.flags & KEV_BREAK) << 10) + KbdEngine::prefixIndex(ev) + ev.scancode; }
+
+    // Inaccessible operations. A copy would lose the alignment of the table.
+    KbdAutomaton(const KbdAutomaton&) = delete;
+    KbdAutomaton& operator=(const KbdAutomaton&) = delete;
+};
@@ -0,0 +1,962 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Utility to benchmark the translation structures on keyboard layouts.
+//
+//---------------------------------------------------------------------------
+
+#include "options.h"
+#include "strutils.h"
+#include "winutils.h"
+#include "grid.h"
+#include "kbdfile.h"
+#include "deadkeys.h"
+#include "kbdpack.h"
+#include "kbdparallel.h"
+#include "reverseindex.h"
+#include "kbdautomaton.h"
+#include <chrono>
+#include <random>
+
+// Configure the terminal console on init, restore on exit.
+ConsoleState state;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class BenchOptions : public Options
+{
+public:
+    // Constructor.
+    BenchOptions(int argc, wchar_t* argv[]);
+
+    // Command line options.
+    WStringList inputs;
+    WString     output;
+    int         iterations;
+    int         keystrokes;
+    int         threads;
+    bool        dead_keys;
+    bool        pack;
+    bool        chunks;
+    bool        reverse;
+    bool        modifiers;
+    bool        automaton;
+};
+
+BenchOptions::BenchOptions(int argc, wchar_t* argv[]) :
+    Options(argc, argv,
+        L"[options] kbd-name-file-or-directory ...\n"
+        L"\n"
+        L"  kbd-name-file-or-directory : Either the file name of a keyboard layout DLL,\n"
+        L"  the name of a keyboard layout, for instance \"fr\" for C:\\Windows\\System32\\kbdfr.dll,\n"
+        L"  or a directory containing keyboard layout DLL's\n"
+        L"\n"
+        L"Options:\n"
+        L"\n"
+        L"  -a : benchmark the translation with the layout compiled into one\n"
+        L"       automaton vs. the translation engine (default)\n"
+        L"  -c : benchmark the multi-core translation of a long keystroke sequence\n"
+        L"       in chunks vs. the sequential translation (default)\n"
+        L"  -d : benchmark dead keys composition (default)\n"
+        L"  -h : display this help text\n"
+        L"  -i count : number of iterations, default: 1000\n"
+        L"  -j count : number of threads with -c, default: number of processors\n"
+        L"  -k count : number of keystrokes in the sequence with -c, default: 2000000\n"
+        L"  -m : benchmark the modifier tracking with compiled tables vs. VK_TO_BIT\n"
+        L"       and MODIFIERS (default)\n"
+        L"  -o outfile : output file name, default is standard output\n"
+        L"  -p : benchmark the translation of one keystroke sequence through all layouts\n"
+        L"       at once (multi-layout pack) vs. one layout at a time (default)\n"
+        L"  -r : benchmark the conversion of a text into keystrokes using the reverse\n"
+        L"       index of each layout (default)\n"
+        L"  -v : verbose messages"),
+    inputs(),
+    output(),
+    iterations(1000),
+    keystrokes(2000000),
+    threads(0),
+    dead_keys(false),
+    pack(false),
+    chunks(false),
+    reverse(false),
+    modifiers(false),
+    automaton(false)
+{
+    // Parse arguments.
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == L"--help" || args[i] == L"-h") {
+            usage();
+        }
+        else if (args[i] == L"-a") {
+            automaton = true;
+        }
+        else if (args[i] == L"-c") {
+            chunks = true;
+        }
+        else if (args[i] == L"-d") {
+            dead_keys = true;
+        }
+        else if (args[i] == L"-i" && i + 1 < args.size()) {
+            iterations = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-j" && i + 1 < args.size()) {
+            threads = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-k" && i + 1 < args.size()) {
+            keystrokes = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-m") {
+            modifiers = true;
+        }
+        else if (args[i] == L"-o" && i + 1 < args.size()) {
+            output = args[++i];
+        }
+        else if (args[i] == L"-p") {
+            pack = true;
+        }
+        else if (args[i] == L"-r") {
+            reverse = true;
+        }
+        else if (args[i] == L"-v") {
+            setVerbose(true);
+        }
+        else if (!args[i].empty() && args[i].front() != '-') {
+            inputs.push_back(args[i]);
+        }
+        else {
+            fatal("invalid option '" + args[i] + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal(L"no keyboard layout specified, try --help");
+    }
+    if (iterations <= 0) {
+        fatal(L"invalid number of iterations");
+    }
+    if (keystrokes <= 0) {
+        fatal(L"invalid number of keystrokes");
+    }
+    if (!dead_keys && !pack && !chunks && !reverse && !modifiers && !automaton) {
+        // No explicit benchmark, run all of them.
+        dead_keys = pack = chunks = reverse = modifiers = automaton = true;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Measure the average duration in nanoseconds of one call to a function.
+//----------------------------------------------------------------------------
+
+template <class FUNC>
+double Measure(int iterations, size_t calls_per_iteration, FUNC func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    const std::chrono::duration<double, std::nano> duration(std::chrono::steady_clock::now() - start);
+    return calls_per_iteration == 0 ? 0.0 : duration.count() / (double(iterations) * double(calls_per_iteration));
+}
+
+
+//----------------------------------------------------------------------------
+// Build a reproducible typing sequence: mostly letters and digits, some
+// spaces, Shift and AltGr.
+//----------------------------------------------------------------------------
+
+void BuildTyping(std::vector<KeyEvent>& events, size_t keystrokes)
+{
+    // Scan codes of the main alphanumeric block.
+    static const uint8_t keys[] = {
+        0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B,
+        0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2B,
+        0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x56,
+    };
+    const KeyEvent space{0x39, 0};
+    const KeyEvent shift{0x2A, 0};
+    const KeyEvent altgr{0x38, KEV_E0};
+
+    std::minstd_rand rand(1);  // fixed seed
+    const auto press = [&events](KeyEvent ev) { events.push_back(ev); };
+    const auto release = [&events](KeyEvent ev) { events.push_back(KeyEvent{ev.scancode, uint8_t(ev.flags | KEV_BREAK)}); };
+
+    events.clear();
+    for (size_t i = 0; i < keystrokes; ++i) {
+        const unsigned int dice = rand() % 100;
+        const KeyEvent key = dice < 15 ? space : KeyEvent{keys[rand() % sizeof(keys)], 0};
+        const bool with_shift = dice >= 15 && dice < 25;
+        const bool with_altgr = dice >= 25 && dice < 28;
+        if (with_shift) {
+            press(shift);
+        }
+        if (with_altgr) {
+            press(altgr);
+        }
+        press(key);
+        release(key);
+        if (with_altgr) {
+            release(altgr);
+        }
+        if (with_shift) {
+            release(shift);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark dead keys composition: linear scan vs. compiled index.
+//----------------------------------------------------------------------------
+
+class DeadKeysBench
+{
+public:
+    // Constructor.
+    DeadKeysBench(BenchOptions& opt);
+
+    // Run the benchmark on one keyboard layout.
+    void run(const WString& name, const KBDTABLES&);
+
+    // Print the final report.
+    void print();
+
+private:
+    BenchOptions& _opt;
+    Grid          _grid;
+    double        _total_linear;
+    double        _total_index;
+    size_t        _count;
+};
+
+DeadKeysBench::DeadKeysBench(BenchOptions& opt) :
+    _opt(opt),
+    _grid(L"", L"  "),
+    _total_linear(0.0),
+    _total_index(0.0),
+    _count(0)
+{
+    _grid.addLine({L"Layout", L"Entries", L"Accents", L"Chained", L"Index bytes", L"Linear ns", L"Index ns", L"Speedup"});
+    _grid.addUnderlines();
+}
+
+void DeadKeysBench::run(const WString& name, const KBDTABLES& tables)
+{
+    const DeadKeyIndex index(tables.pDeadKey);
+
+    // Build the list of lookups: all defined compositions, plus all
+    // printable ASCII characters on each accent, mostly misses.
+    std::vector<std::pair<WCHAR, WCHAR>> lookups;
+    std::set<WCHAR> accents;
+    size_t chained = 0;
+    for (const DEADKEY* dk = tables.pDeadKey; dk != nullptr && dk->dwBoth != 0; dk++) {
+        lookups.push_back(std::make_pair(WCHAR(LOWORD(dk->dwBoth)), WCHAR(HIWORD(dk->dwBoth))));
+        accents.insert(WCHAR(HIWORD(dk->dwBoth)));
+        if ((dk->uFlags & DKF_DEAD) != 0) {
+            chained++;
+        }
+    }
+    for (WCHAR accent : accents) {
+        for (WCHAR c = 0x20; c < 0x7F; c++) {
+            lookups.push_back(std::make_pair(c, accent));
+        }
+    }
+
+    // Verify that both methods return the same results.
+    for (const auto& it : lookups) {
+        bool chained1 = false;
+        bool chained2 = false;
+        const WCHAR c1 = DeadKeyIndex::LinearCompose(tables.pDeadKey, it.first, it.second, chained1);
+        const WCHAR c2 = index.compose(it.first, it.second, chained2);
+        if (c1 != c2 || chained1 != chained2) {
+            _opt.error(Format(L"%s: dead key mismatch on U+%04X, U+%04X", name.c_str(), it.first, it.second));
+        }
+    }
+
+    // Run the benchmark. Accumulate the results to prevent the compiler from removing the calls.
+    size_t sum = 0;
+    const double linear = Measure(_opt.iterations, lookups.size(), [&]() {
+        bool ch = false;
+        for (const auto& it : lookups) {
+            sum += DeadKeyIndex::LinearCompose(tables.pDeadKey, it.first, it.second, ch);
+        }
+    });
+    const double indexed = Measure(_opt.iterations, lookups.size(), [&]() {
+        bool ch = false;
+        for (const auto& it : lookups) {
+            sum += index.compose(it.first, it.second, ch);
+        }
+    });
+    _opt.verbose(Format(L"%s: checksum %zu", name.c_str(), sum));
+
+    if (!lookups.empty()) {
+        _total_linear += linear;
+        _total_index += indexed;
+        _count++;
+    }
+    _grid.addLine({name,
+                   Format(L"%zu", index.size()),
+                   Format(L"%zu", index.accentCount()),
+                   Format(L"%zu", chained),
+                   Format(L"%zu", index.memorySize()),
+                   Format(L"%.1f", linear),
+                   Format(L"%.1f", indexed),
+                   indexed > 0.0 ? Format(L"%.1f", linear / indexed) : L"-"});
+}
+
+void DeadKeysBench::print()
+{
+    if (_count > 0) {
+        _grid.addUnderlines();
+        _grid.addLine({L"Average", L"", L"", L"", L"",
+                       Format(L"%.1f", _total_linear / _count),
+                       Format(L"%.1f", _total_index / _count),
+                       _total_index > 0.0 ? Format(L"%.1f", _total_linear / _total_index) : L"-"});
+    }
+    _grid.print(_opt.out());
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark the multi-layout pack: one keystroke sequence through all
+// layouts at once vs. one KbdEngine per layout.
+//----------------------------------------------------------------------------
+
+class PackBench
+{
+public:
+    // Constructor.
+    PackBench(BenchOptions& opt);
+
+    // Add one keyboard layout. The tables must remain valid until print().
+    void add(const WString& name, const KBDTABLES&);
+
+    // Run the benchmark on all layouts and print the report.
+    void print();
+
+private:
+    // Number of simulated keystrokes in the input sequence.
+    static constexpr size_t KEYSTROKES = 1000;
+
+    BenchOptions&                  _opt;
+    std::vector<WString>           _names;
+    std::vector<const KBDTABLES*>  _layouts;
+    std::vector<KeyEvent>          _events;
+};
+
+PackBench::PackBench(BenchOptions& opt) :
+    _opt(opt),
+    _names(),
+    _layouts(),
+    _events()
+{
+}
+
+void PackBench::add(const WString& name, const KBDTABLES& tables)
+{
+    _names.push_back(name);
+    _layouts.push_back(&tables);
+}
+
+void PackBench::print()
+{
+    if (_layouts.empty()) {
+        return;
+    }
+    const KbdPack pack(_layouts);
+    const size_t count = pack.size();
+    BuildTyping(_events, KEYSTROKES);
+
+    // Reference: one KbdEngine per layout, one after the other.
+    std::vector<KbdState> ref_states(count);
+    std::vector<std::vector<WCHAR>> ref_out(count);
+    const double loop = Measure(_opt.iterations, _events.size(), [&]() {
+        for (size_t i = 0; i < count; ++i) {
+            ref_states[i] = KbdState();
+            ref_out[i].clear();
+            pack.engine(i).translate(_events.data(), _events.size(), ref_states[i], ref_out[i]);
+        }
+    });
+
+    Grid grid(L"", L"  ");
+    grid.addLine({L"Translator", L"Layouts/pass", L"ns/event", L"ns/layout", L"Speedup"});
+    grid.addUnderlines();
+    grid.addLine({L"KbdEngine", L"1", Format(L"%.1f", loop), Format(L"%.2f", loop / count), L"1.0"});
+
+    for (KbdPack::Kernel kernel : {KbdPack::KERNEL_SCALAR, KbdPack::KERNEL_SSE4, KbdPack::KERNEL_AVX2}) {
+        if (!KbdPack::IsSupported(kernel)) {
+            _opt.verbose(Format(L"%s kernel not supported on this CPU", KbdPack::KernelName(kernel)));
+            continue;
+        }
+        std::vector<KbdState> states(count);
+        std::vector<std::vector<WCHAR>> out(count);
+        const double packed = Measure(_opt.iterations, _events.size(), [&]() {
+            for (size_t i = 0; i < count; ++i) {
+                states[i] = KbdState();
+                out[i].clear();
+            }
+            pack.translate(_events.data(), _events.size(), states, out, kernel);
+        });
+
+        // Verify that the pack and the individual engines produce the same characters.
+        for (size_t i = 0; i < count; ++i) {
+            if (out[i] != ref_out[i] || states[i] != ref_states[i]) {
+                _opt.error(Format(L"%s: %s kernel output differs from KbdEngine", _names[i].c_str(), KbdPack::KernelName(kernel)));
+            }
+        }
+
+        const size_t lanes = kernel == KbdPack::KERNEL_AVX2 ? 8 : (kernel == KbdPack::KERNEL_SSE4 ? 4 : 1);
+        grid.addLine({KbdPack::KernelName(kernel),
+                      Format(L"%zu", lanes),
+                      Format(L"%.1f", packed),
+                      Format(L"%.2f", packed / count),
+                      packed > 0.0 ? Format(L"%.1f", loop / packed) : L"-"});
+    }
+
+    _opt.out() << std::endl
+               << Format(L"Multi-layout pack: %zu layouts, %zu keystroke events, %zu bytes of packed tables",
+                         count, _events.size(), pack.memorySize())
+               << std::endl << std::endl;
+    grid.print(_opt.out());
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark the multi-core translation of a long keystroke sequence.
+//----------------------------------------------------------------------------
+
+class ChunksBench
+{
+public:
+    // Constructor.
+    ChunksBench(BenchOptions& opt);
+
+    // Run the benchmark on one keyboard layout.
+    void run(const WString& name, const KBDTABLES&);
+
+    // Print the final report.
+    void print();
+
+private:
+    BenchOptions&         _opt;
+    Grid                  _grid;
+    std::vector<KeyEvent> _events;
+    size_t                _threads;
+    double                _total_sequential;
+    double                _total_parallel;
+    size_t                _count;
+};
+
+ChunksBench::ChunksBench(BenchOptions& opt) :
+    _opt(opt),
+    _grid(L"", L"  "),
+    _events(),
+    _threads(0),
+    _total_sequential(0.0),
+    _total_parallel(0.0),
+    _count(0)
+{
+    _grid.addLine({L"Layout", L"Characters", L"Sequential ms", L"Parallel ms", L"Speedup"});
+    _grid.addUnderlines();
+}
+
+void ChunksBench::run(const WString& name, const KBDTABLES& tables)
+{
+    if (_events.empty()) {
+        BuildTyping(_events, size_t(_opt.keystrokes));
+    }
+
+    const KbdEngine engine(tables);
+    ParallelTranslator parallel(engine, size_t(std::max(0, _opt.threads)));
+    _threads = parallel.threadCount();
+
+    // Measure durations in milliseconds, on one call with the complete sequence.
+    KbdState seq_state{};
+    KbdState par_state{};
+    std::vector<WCHAR> seq_out;
+    std::vector<WCHAR> par_out;
+    const double sequential = Measure(1, 1000000, [&]() {
+        engine.translate(_events.data(), _events.size(), seq_state, seq_out);
+    });
+    const double chunked = Measure(1, 1000000, [&]() {
+        parallel.translate(_events.data(), _events.size(), par_state, par_out);
+    });
+
+    // Verify that both methods produce the same characters.
+    if (seq_out != par_out || seq_state != par_state) {
+        _opt.error(Format(L"%s: parallel translation differs from sequential translation", name.c_str()));
+    }
+
+    _total_sequential += sequential;
+    _total_parallel += chunked;
+    _count++;
+    _grid.addLine({name,
+                   Format(L"%zu", seq_out.size()),
+                   Format(L"%.1f", sequential),
+                   Format(L"%.1f", chunked),
+                   chunked > 0.0 ? Format(L"%.1f", sequential / chunked) : L"-"});
+}
+
+void ChunksBench::print()
+{
+    if (_count > 0) {
+        _grid.addUnderlines();
+        _grid.addLine({L"Average", L"",
+                       Format(L"%.1f", _total_sequential / _count),
+                       Format(L"%.1f", _total_parallel / _count),
+                       _total_parallel > 0.0 ? Format(L"%.1f", _total_sequential / _total_parallel) : L"-"});
+        _opt.out() << std::endl
+                   << Format(L"Chunked translation: %zu keystroke events, %zu events per chunk, %zu threads",
+                             _events.size(), size_t(ParallelTranslator::DEFAULT_CHUNK_SIZE), _threads)
+                   << std::endl << std::endl;
+        _grid.print(_opt.out());
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark the conversion of a text into keystrokes with the reverse index.
+//----------------------------------------------------------------------------
+
+class ReverseBench
+{
+public:
+    // Constructor.
+    ReverseBench(BenchOptions& opt);
+
+    // Run the benchmark on one keyboard layout.
+    void run(const WString& name, const KBDTABLES&);
+
+    // Print the final report.
+    void print();
+
+private:
+    // Number of simulated keystrokes to build the text.
+    static constexpr size_t KEYSTROKES = 100000;
+
+    BenchOptions&         _opt;
+    Grid                  _grid;
+    std::vector<KeyEvent> _events;
+    double                _total_rate;
+    size_t                _count;
+};
+
+ReverseBench::ReverseBench(BenchOptions& opt) :
+    _opt(opt),
+    _grid(L"", L"  "),
+    _events(),
+    _total_rate(0.0),
+    _count(0)
+{
+    _grid.addLine({L"Layout", L"Characters", L"Ligatures", L"Index bytes", L"Text bytes", L"Events/char", L"Unreachable", L"MB/s"});
+    _grid.addUnderlines();
+}
+
+void ReverseBench::run(const WString& name, const KBDTABLES& tables)
+{
+    if (_events.empty()) {
+        BuildTyping(_events, KEYSTROKES);
+    }
+
+    const KbdEngine engine(tables);
+    const ReverseIndex index(engine);
+
+    // Build a realistic text for this layout: the characters of the typing sequence.
+    KbdState state{};
+    std::vector<WCHAR> typed;
+    engine.translate(_events.data(), _events.size(), state, typed);
+    const std::string text(ToUTF8(WString(typed.begin(), typed.end())));
+
+    // Convert the text into keystrokes. Durations are in nanoseconds per byte.
+    std::vector<KeyEvent> keys;
+    std::vector<ReverseIndex::Unreachable> unreachable;
+    const double duration = Measure(_opt.iterations, text.size(), [&]() {
+        keys.clear();
+        unreachable.clear();
+        index.convert(text, keys, unreachable);
+    });
+
+    // Verify that the keystrokes give the text back, when all characters can be typed.
+    if (unreachable.empty()) {
+        KbdState check_state{};
+        std::vector<WCHAR> check;
+        engine.translate(keys.data(), keys.size(), check_state, check);
+        if (check != typed) {
+            _opt.error(Format(L"%s: keystrokes from the reverse index do not produce the same text", name.c_str()));
+        }
+    }
+
+    const double rate = duration > 0.0 ? 1000.0 / duration : 0.0;  // bytes per nanosecond * 1000 = MB/s
+    _total_rate += rate;
+    _count++;
+    _grid.addLine({name,
+                   Format(L"%zu", index.size()),
+                   Format(L"%zu", index.ligatureCount()),
+                   Format(L"%zu", index.memorySize()),
+                   Format(L"%zu", text.size()),
+                   typed.empty() ? L"-" : Format(L"%.2f", double(keys.size()) / double(typed.size())),
+                   Format(L"%zu", unreachable.size()),
+                   Format(L"%.1f", rate)});
+}
+
+void ReverseBench::print()
+{
+    if (_count > 0) {
+        _grid.addUnderlines();
+        _grid.addLine({L"Average", L"", L"", L"", L"", L"", L"", Format(L"%.1f", _total_rate / _count)});
+        _opt.out() << std::endl;
+        _grid.print(_opt.out());
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark the modifier tracking: compiled tables vs. VK_TO_BIT and MODIFIERS.
+//----------------------------------------------------------------------------
+
+class ModifiersBench
+{
+public:
+    // Constructor.
+    ModifiersBench(BenchOptions& opt);
+
+    // Run the benchmark on one keyboard layout.
+    void run(const WString& name, const KBDTABLES&);
+
+    // Print the final report.
+    void print();
+
+private:
+    // Number of simulated keystrokes in the input sequence.
+    static constexpr size_t KEYSTROKES = 1000;
+
+    // Reference modifier tracking, directly on the layout tables: walk the VK_TO_BIT
+    // list for each keystroke and index ModNumber with a bounds check.
+    class LinearModifiers
+    {
+    public:
+        LinearModifiers(const KbdEngine& engine) : _engine(engine), _pressed() {}
+        size_t column(KeyEvent ev);
+    private:
+        const KbdEngine&     _engine;
+        std::vector<uint8_t> _pressed;  // Pressed modifier keys.
+        uint8_t bits(uint8_t vk) const;
+    };
+
+    BenchOptions&         _opt;
+    Grid                  _grid;
+    std::vector<KeyEvent> _events;
+    double                _total_linear;
+    double                _total_compiled;
+    size_t                _count;
+};
+
+uint8_t ModifiersBench::LinearModifiers::bits(uint8_t vk) const
+{
+    const KBDTABLES& tables(_engine.tables());
+    uint8_t generic = vk;
+    switch (vk) {
+        case VK_LSHIFT: case VK_RSHIFT: generic = VK_SHIFT; break;
+        case VK_LCONTROL: case VK_RCONTROL: generic = VK_CONTROL; break;
+        case VK_LMENU: case VK_RMENU: generic = VK_MENU; break;
+        default: break;
+    }
+    const MODIFIERS* mods = tables.pCharModifiers;
+    for (const VK_TO_BIT* p = mods == nullptr ? nullptr : mods->pVkToBit; p != nullptr && p->Vk != 0; ++p) {
+        if (p->Vk == generic) {
+            const bool altgr = vk == VK_RMENU && p->ModBits != 0 && (tables.fLocaleFlags & KLLF_ALTGR) != 0;
+            return uint8_t(p->ModBits | (altgr ? KBDCTRL : 0));
+        }
+    }
+    return 0;
+}
+
+size_t ModifiersBench::LinearModifiers::column(KeyEvent ev)
+{
+    const uint8_t vk = uint8_t(_engine.virtualKey(ev) & 0xFF);
+    if (bits(vk) != 0) {
+        const auto it = std::find(_pressed.begin(), _pressed.end(), vk);
+        if ((ev.flags & KEV_BREAK) != 0 && it != _pressed.end()) {
+            _pressed.erase(it);
+        }
+        else if ((ev.flags & KEV_BREAK) == 0 && it == _pressed.end()) {
+            _pressed.push_back(vk);
+        }
+    }
+    uint8_t modbits = 0;
+    for (uint8_t key : _pressed) {
+        modbits |= bits(key);
+    }
+    const MODIFIERS* mods = _engine.tables().pCharModifiers;
+    return mods != nullptr && modbits <= mods->wMaxModBits ? std::min<size_t>(mods->ModNumber[modbits], SHFT_INVALID) : SHFT_INVALID;
+}
+
+ModifiersBench::ModifiersBench(BenchOptions& opt) :
+    _opt(opt),
+    _grid(L"", L"  "),
+    _events(),
+    _total_linear(0.0),
+    _total_compiled(0.0),
+    _count(0)
+{
+    _grid.addLine({L"Layout", L"VK_TO_BIT", L"Max bits", L"Linear ns", L"Compiled ns", L"Speedup"});
+    _grid.addUnderlines();
+}
+
+void ModifiersBench::run(const WString& name, const KBDTABLES& tables)
+{
+    if (_events.empty()) {
+        BuildTyping(_events, KEYSTROKES);
+    }
+    const KbdEngine engine(tables);
+
+    // Verify that both methods return the same modification numbers.
+    {
+        LinearModifiers linear(engine);
+        KbdState state{};
+        for (const auto& ev : _events) {
+            engine.trackKey(ev, state);
+            if (linear.column(ev) != engine.column(engine.modifiers(state))) {
+                _opt.error(Format(L"%s: modifier tracking mismatch", name.c_str()));
+                break;
+            }
+        }
+    }
+
+    // Run the benchmark, in nanoseconds per keystroke event. Accumulate the results to prevent
+    // the compiler from removing the calls.
+    size_t sum = 0;
+    const double linear = Measure(_opt.iterations, _events.size(), [&]() {
+        LinearModifiers mods(engine);
+        for (const auto& ev : _events) {
+            sum += mods.column(ev);
+        }
+    });
+    const double compiled = Measure(_opt.iterations, _events.size(), [&]() {
+        KbdState state{};
+        for (const auto& ev : _events) {
+            engine.trackKey(ev, state);
+            sum += engine.column(engine.modifiers(state));
+        }
+    });
+    _opt.verbose(Format(L"%s: checksum %zu", name.c_str(), sum));
+
+    size_t vk_to_bit = 0;
+    const MODIFIERS* mods = tables.pCharModifiers;
+    for (const VK_TO_BIT* p = mods == nullptr ? nullptr : mods->pVkToBit; p != nullptr && p->Vk != 0; ++p) {
+        vk_to_bit++;
+    }
+
+    _total_linear += linear;
+    _total_compiled += compiled;
+    _count++;
+    _grid.addLine({name,
+                   Format(L"%zu", vk_to_bit),
+                   Format(L"%d", mods == nullptr ? 0 : int(mods->wMaxModBits)),
+                   Format(L"%.2f", linear),
+                   Format(L"%.2f", compiled),
+                   compiled > 0.0 ? Format(L"%.1f", linear / compiled) : L"-"});
+}
+
+void ModifiersBench::print()
+{
+    if (_count > 0) {
+        _grid.addUnderlines();
+        _grid.addLine({L"Average", L"", L"",
+                       Format(L"%.2f", _total_linear / _count),
+                       Format(L"%.2f", _total_compiled / _count),
+                       _total_compiled > 0.0 ? Format(L"%.1f", _total_linear / _total_compiled) : L"-"});
+        _opt.out() << std::endl
+                   << Format(L"Modifier tracking: %zu keystroke events, nanoseconds per event", _events.size())
+                   << std::endl << std::endl;
+        _grid.print(_opt.out());
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Benchmark the translation with the layout compiled into one automaton.
+//----------------------------------------------------------------------------
+
+class AutomatonBench
+{
+public:
+    // Constructor.
+    AutomatonBench(BenchOptions& opt);
+
+    // Run the benchmark on one keyboard layout.
+    void run(const WString& name, const KBDTABLES&);
+
+    // Print the final report.
+    void print();
+
+private:
+    // Number of simulated keystrokes in the input sequence.
+    static constexpr size_t KEYSTROKES = 1000;
+
+    BenchOptions&         _opt;
+    Grid                  _grid;
+    std::vector<KeyEvent> _events;
+    double                _total_engine;
+    double                _total_automaton;
+    size_t                _count;
+};
+
+AutomatonBench::AutomatonBench(BenchOptions& opt) :
+    _opt(opt),
+    _grid(L"", L"  "),
+    _events(),
+    _total_engine(0.0),
+    _total_automaton(0.0),
+    _count(0)
+{
+    _grid.addLine({L"Layout", L"Keys", L"Dead keys", L"States", L"Classes", L"Transitions", L"Outputs", L"Bytes", L"Engine ns", L"Automaton ns", L"Speedup"});
+    _grid.addUnderlines();
+}
+
+void AutomatonBench::run(const WString& name, const KBDTABLES& tables)
+{
+    if (_events.empty()) {
+        BuildTyping(_events, KEYSTROKES);
+    }
+
+    const KbdEngine engine(tables);
+    const KbdAutomaton automaton(engine);
+    if (!automaton.isValid()) {
+        _grid.addLine({name, L"", L"", Format(L"%zu", automaton.exploredStates()), L"too large"});
+        return;
+    }
+
+    // Verify that both methods produce the same characters.
+    {
+        KbdState engine_state{};
+        KbdAutomaton::State automaton_state{};
+        std::vector<WCHAR> engine_out;
+        std::vector<WCHAR> automaton_out;
+        engine.translate(_events.data(), _events.size(), engine_state, engine_out);
+        automaton.translate(_events.data(), _events.size(), automaton_state, automaton_out);
+        if (engine_out != automaton_out || engine_state.code != automaton_state.code) {
+            _opt.error(Format(L"%s: automaton translation differs from engine translation", name.c_str()));
+        }
+    }
+
+    // Run the benchmark, in nanoseconds per keystroke event.
+    std::vector<WCHAR> out;
+    const double direct = Measure(_opt.iterations, _events.size(), [&]() {
+        KbdState state{};
+        out.clear();
+        engine.translate(_events.data(), _events.size(), state, out);
+    });
+    const double compiled = Measure(_opt.iterations, _events.size(), [&]() {
+        KbdAutomaton::State state{};
+        out.clear();
+        automaton.translate(_events.data(), _events.size(), state, out);
+    });
+
+    _total_engine += direct;
+    _total_automaton += compiled;
+    _count++;
+    _grid.addLine({name,
+                   Format(L"%zu", automaton.trackedKeys()),
+                   Format(L"%zu", automaton.pendingDeadKeys()),
+                   Format(L"%zu", automaton.stateCount()),
+                   Format(L"%zu", automaton.inputClasses()),
+                   Format(L"%zu", automaton.transitionCount()),
+                   Format(L"%zu", automaton.outputCount()),
+                   Format(L"%zu", automaton.memorySize()),
+                   Format(L"%.2f", direct),
+                   Format(L"%.2f", compiled),
+                   compiled > 0.0 ? Format(L"%.1f", direct / compiled) : L"-"});
+}
+
+void AutomatonBench::print()
+{
+    if (_count > 0) {
+        _grid.addUnderlines();
+        _grid.addLine({L"Average", L"", L"", L"", L"", L"", L"", L"",
+                       Format(L"%.2f", _total_engine / _count),
+                       Format(L"%.2f", _total_automaton / _count),
+                       _total_automaton > 0.0 ? Format(L"%.1f", _total_engine / _total_automaton) : L"-"});
+        _opt.out() << std::endl
+                   << Format(L"Automaton translation: %zu keystroke events, nanoseconds per event", _events.size())
+                   << std::endl << std::endl;
+        _grid.print(_opt.out());
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int wmain(int argc, wchar_t* argv[])
+{
+    // Parse command line options.
+    BenchOptions opt(argc, argv);
+    opt.setOutput(opt.output);
+
+    // Get the list of keyboard layout DLL's.
+    WStringList files;
+    KbdFile::ExpandNames(files, opt.inputs);
+
+    // With the multi-layout pack, all layouts remain loaded until the end.
+    DeadKeysBench dead_keys(opt);
+    PackBench pack(opt);
+    ChunksBench chunks(opt);
+    ReverseBench reverse(opt);
+    ModifiersBench modifiers(opt);
+    AutomatonBench automaton(opt);
+    std::deque<KbdFile> kbds;
+    for (const auto& file : files) {
+        if (kbds.empty() || (opt.pack && kbds.back().isLoaded())) {
+            kbds.emplace_back(opt);
+        }
+        KbdFile& kbd(kbds.back());
+        if (kbd.load(file)) {
+            const WString name(FileBaseName(kbd.fileName()));
+            if (opt.dead_keys) {
+                dead_keys.run(name, *kbd.tables());
+            }
+            if (opt.pack) {
+                pack.add(name, *kbd.tables());
+            }
+            if (opt.chunks) {
+                chunks.run(name, *kbd.tables());
+            }
+            if (opt.reverse) {
+                reverse.run(name, *kbd.tables());
+            }
+            if (opt.modifiers) {
+                modifiers.run(name, *kbd.tables());
+            }
+            if (opt.automaton) {
+                automaton.run(name, *kbd.tables());
+            }
+        }
+    }
+    if (opt.dead_keys) {
+        dead_keys.print();
+    }
+    if (opt.pack) {
+        pack.print();
+    }
+    if (opt.chunks) {
+        chunks.print();
+    }
+    if (opt.reverse) {
+        reverse.print();
+    }
+    if (opt.modifiers) {
+        modifiers.print();
+    }
+    if (opt.automaton) {
+        automaton.print();
+    }
+    opt.exit(EXIT_SUCCESS);
+}
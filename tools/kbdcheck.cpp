@@ -0,0 +1,190 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Utility to statically validate the tables of keyboard layouts.
+//
+//---------------------------------------------------------------------------
+
+#include "options.h"
+#include "strutils.h"
+#include "winutils.h"
+#include "grid.h"
+#include "kbdfile.h"
+#include "kbdvalidator.h"
+#include "workpool.h"
+#include <sstream>
+#include <chrono>
+
+// Configure the terminal console on init, restore on exit.
+ConsoleState state;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class CheckOptions : public Options
+{
+public:
+    // Constructor.
+    CheckOptions(int argc, wchar_t* argv[]);
+
+    // Command line options.
+    WStringList inputs;
+    WString     output;
+    int         threads;
+    bool        errors_only;
+    bool        strict;
+};
+
+CheckOptions::CheckOptions(int argc, wchar_t* argv[]) :
+    Options(argc, argv,
+        L"[options] kbd-name-file-or-directory ...\n"
+        L"\n"
+        L"  kbd-name-file-or-directory : Either the file name of a keyboard layout DLL\n"
+        L"  or .wklbin file, the name of a keyboard layout, for instance \"fr\" for\n"
+        L"  C:\\Windows\\System32\\kbdfr.dll, or a directory containing keyboard layouts\n"
+        L"\n"
+        L"Validate the keyboard tables of the layouts, without installing them: terminators,\n"
+        L"sizes of tables and entries, SGCAPS and dead key entries, dead keys and ligatures\n"
+        L"definitions, key names, overlapping structures. The layouts are checked in parallel.\n"
+        L"The exit status is an error when an error is found in at least one layout.\n"
+        L"\n"
+        L"Options:\n"
+        L"\n"
+        L"  -h : display this help text\n"
+        L"  -j count : number of threads, default: number of processors\n"
+        L"  -o outfile : output file name, default is standard output\n"
+        L"  -q : quiet, display errors only, not warnings\n"
+        L"  -v : verbose, display a summary for each layout\n"
+        L"  -w : strict mode, warnings are errors"),
+    inputs(),
+    output(),
+    threads(0),
+    errors_only(false),
+    strict(false)
+{
+    // Parse arguments.
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == L"--help" || args[i] == L"-h") {
+            usage();
+        }
+        else if (args[i] == L"-j" && i + 1 < args.size()) {
+            threads = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-o" && i + 1 < args.size()) {
+            output = args[++i];
+        }
+        else if (args[i] == L"-q") {
+            errors_only = true;
+        }
+        else if (args[i] == L"-v") {
+            setVerbose(true);
+        }
+        else if (args[i] == L"-w") {
+            strict = true;
+        }
+        else if (!args[i].empty() && args[i].front() != '-') {
+            inputs.push_back(args[i]);
+        }
+        else {
+            fatal("invalid option '" + args[i] + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal(L"no keyboard layout specified, try --help");
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int wmain(int argc, wchar_t* argv[])
+{
+    // Parse command line options.
+    CheckOptions opt(argc, argv);
+    opt.setOutput(opt.output);
+
+    // Get the list of keyboard layouts.
+    WStringList file_list;
+    KbdFile::ExpandNames(file_list, opt.inputs);
+    const WStringVector files(file_list.begin(), file_list.end());
+
+    // Result of each file.
+    struct Result
+    {
+        bool        loaded = false;
+        size_t      errors = 0;
+        size_t      warnings = 0;
+        double      duration = 0.0;  // in milliseconds
+        std::string messages;
+    };
+    std::vector<Result> results(files.size());
+
+    // Check all files in a pool of threads. Each file has its own error reporting.
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(files.size(), [&](size_t index, size_t) {
+        Result& res(results[index]);
+        const auto file_start = std::chrono::steady_clock::now();
+        std::ostringstream errors;
+        Error err(FileName(files[index]) + L": ", &errors);
+        KbdFile kbd(err);
+        if (kbd.load(files[index])) {
+            // The structures of a DLL must be inside its file. A .wklbin file, or the translation of
+            // a DLL with another pointer size, is already validated when loaded.
+            const bool in_dll = kbd.image().isLoaded() && !kbd.binary().isLoaded();
+            const KbdValidator validator(*kbd.tables(), in_dll ? kbd.image().fileData() : nullptr, kbd.image().fileSize());
+            res.loaded = true;
+            res.errors = validator.errorCount();
+            res.warnings = validator.warningCount();
+            for (const auto& issue : validator.issues()) {
+                if (issue.severity == KbdValidator::SEV_ERROR) {
+                    err.error(issue.message);
+                }
+                else if (!opt.errors_only) {
+                    err.warning(issue.message);
+                }
+            }
+        }
+        res.messages = errors.str();
+        res.duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - file_start).count();
+    });
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Messages, in the order of files.
+    size_t failures = 0;
+    size_t errors = 0;
+    size_t warnings = 0;
+    Grid grid(L"", L"  ");
+    grid.addLine({L"File", L"Status", L"Errors", L"Warnings", L"Time (ms)"});
+    grid.addUnderlines();
+    for (size_t i = 0; i < files.size(); ++i) {
+        const Result& res(results[i]);
+        const bool failed = !res.loaded || res.errors > 0 || (opt.strict && res.warnings > 0);
+        failures += failed ? 1 : 0;
+        errors += res.errors;
+        warnings += res.warnings;
+        opt.out() << res.messages;
+        grid.addLine({files[i],
+                      !res.loaded ? L"not loaded" : (failed ? L"FAILED" : L"ok"),
+                      Format(L"%zu", res.errors),
+                      Format(L"%zu", res.warnings),
+                      Format(L"%.2f", res.duration)});
+    }
+    if (opt.verbose()) {
+        opt.out() << std::endl;
+        grid.print(opt.out());
+    }
+    opt.out() << std::endl
+              << Format(L"%zu layouts, %zu failed, %zu errors, %zu warnings, %zu threads, %.1f ms",
+                        files.size(), failures, errors, warnings, std::min(pool.threadCount(), files.size()), duration)
+              << std::endl;
+
+    opt.exit(failures == 0 && !files.empty() ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,374 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Build a compact version of the tables of a keyboard layout.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdcompactor.h"
+#include <algorithm>
+
+namespace {
+
+    // Alignment of the simulated data section. The DLL sections start on a page boundary.
+    constexpr size_t SECTION_ALIGNMENT = 4096;
+
+    // Round up a size or an offset.
+    size_t Align(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Get a nul-terminated string.
+    std::u16string String(const WCHAR* str)
+    {
+        std::u16string res;
+        while (str != nullptr && *str != 0) {
+            res.push_back(char16_t(*str++));
+        }
+        return res;
+    }
+
+    // Number of entries in a table, including the terminating one.
+    template <typename T, typename PRED>
+    size_t Count(const T* table, PRED is_last)
+    {
+        size_t count = 0;
+        while (table != nullptr && !is_last(table[count])) {
+            count++;
+        }
+        return table == nullptr ? 0 : count + 1;
+    }
+
+    // Address of the characters of a row in a VK_TO_WCHARSn table.
+    WCHAR* RowChars(uint8_t* row)
+    {
+        return reinterpret_cast<WCHAR*>(row + offsetof(VK_TO_WCHARS1, wch));
+    }
+    const WCHAR* RowChars(const uint8_t* row)
+    {
+        return reinterpret_cast<const WCHAR*>(row + offsetof(VK_TO_WCHARS1, wch));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: build the compact tables.
+//----------------------------------------------------------------------------
+
+KbdCompactor::KbdCompactor(const KBDTABLES& tables) :
+    _buffer(),
+    _base(nullptr),
+    _size(0),
+    _strings(nullptr),
+    _strings_count(0),
+    _shared_strings(0),
+    _moved_keys(0),
+    _removed_tables(0),
+    _removed_scancodes(0)
+{
+    // Content of the compact tables.
+    const std::vector<CharTable> char_tables(buildCharTables(tables));
+    std::vector<WCHAR> pool;
+    const std::map<std::u16string, size_t> offsets(buildStrings(tables, pool));
+
+    size_t scancodes = tables.pusVSCtoVK == nullptr ? 0 : tables.bMaxVSCtoVK;
+    while (scancodes > 0 && tables.pusVSCtoVK[scancodes - 1] == VK__none_) {
+        scancodes--;
+    }
+    _removed_scancodes = tables.pusVSCtoVK == nullptr ? 0 : tables.bMaxVSCtoVK - scancodes;
+
+    const MODIFIERS* const mods = tables.pCharModifiers;
+    const size_t mods_size = mods == nullptr ? 0 : offsetof(MODIFIERS, ModNumber) + mods->wMaxModBits + 1;
+    const size_t vk_to_bits = Count(mods == nullptr ? nullptr : mods->pVkToBit, [](const VK_TO_BIT& e) { return e.Vk == 0; });
+    const size_t vsc_e0 = Count(tables.pVSCtoVK_E0, [](const VSC_VK& e) { return e.Vsc == 0; });
+    const size_t vsc_e1 = Count(tables.pVSCtoVK_E1, [](const VSC_VK& e) { return e.Vsc == 0; });
+    const size_t dead_keys = Count(tables.pDeadKey, [](const DEADKEY& e) { return e.dwBoth == 0; });
+    const size_t key_names = Count(tables.pKeyNames, [](const VSC_LPWSTR& e) { return e.vsc == 0; });
+    const size_t key_names_ext = Count(tables.pKeyNamesExt, [](const VSC_LPWSTR& e) { return e.vsc == 0; });
+    size_t key_names_dead = 0;
+    for (const DEADKEY_LPWSTR* p = tables.pKeyNamesDead; p != nullptr && *p != nullptr; ++p) {
+        key_names_dead += **p != 0 ? 1 : 0;
+    }
+    key_names_dead += tables.pKeyNamesDead == nullptr ? 0 : 1;
+    size_t ligatures = 0;
+    if (tables.pLigature != nullptr && tables.cbLgEntry > 0) {
+        const uint8_t* lg = reinterpret_cast<const uint8_t*>(tables.pLigature);
+        while (lg[ligatures * tables.cbLgEntry] != 0) {
+            ligatures++;
+        }
+        ligatures++;
+    }
+
+    // Layout of the data section, in memory order: the tables which are used on each keystroke first.
+    size_t size = 0;
+    const auto place = [&size](size_t bytes, size_t alignment) {
+        size = Align(size, alignment);
+        const size_t offset = size;
+        size += bytes;
+        return offset;
+    };
+    const size_t off_tables = place(sizeof(KBDTABLES), alignof(KBDTABLES));
+    const size_t off_vtwc = place((char_tables.size() + 1) * sizeof(VK_TO_WCHAR_TABLE), alignof(VK_TO_WCHAR_TABLE));
+    std::vector<size_t> off_chars(char_tables.size());
+    for (size_t i = char_tables.size(); i-- > 0; ) {
+        size_t rows = 1;
+        for (const auto& key : char_tables[i].keys) {
+            rows += key.has_next ? 2 : 1;
+        }
+        off_chars[i] = place(rows * char_tables[i].entry_size, alignof(VK_TO_WCHARS1));
+    }
+    const size_t off_mods = place(mods_size, alignof(MODIFIERS));
+    const size_t off_vk_to_bits = place(vk_to_bits * sizeof(VK_TO_BIT), alignof(VK_TO_BIT));
+    const size_t off_vsc_e1 = place(vsc_e1 * sizeof(VSC_VK), alignof(VSC_VK));
+    const size_t off_vsc_e0 = place(vsc_e0 * sizeof(VSC_VK), alignof(VSC_VK));
+    const size_t off_scancodes = place(scancodes * sizeof(USHORT), alignof(USHORT));
+    const size_t off_ligatures = place(ligatures * tables.cbLgEntry, alignof(LIGATURE1));
+    const size_t off_dead_keys = place(dead_keys * sizeof(DEADKEY), alignof(DEADKEY));
+    const size_t off_key_names_dead = place(key_names_dead * sizeof(DEADKEY_LPWSTR), alignof(DEADKEY_LPWSTR));
+    const size_t off_key_names_ext = place(key_names_ext * sizeof(VSC_LPWSTR), alignof(VSC_LPWSTR));
+    const size_t off_key_names = place(key_names * sizeof(VSC_LPWSTR), alignof(VSC_LPWSTR));
+    const size_t off_strings = place(pool.size() * sizeof(WCHAR), alignof(WCHAR));
+
+    // Allocate the data section, zeroed, on a page boundary and up to the end of its last page.
+    _buffer.resize(Align(size, SECTION_ALIGNMENT) + SECTION_ALIGNMENT, 0);
+    _base = _buffer.data() + (SECTION_ALIGNMENT - uintptr_t(_buffer.data()) % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+    _size = size;
+    const auto ptr = [this](size_t offset, size_t count) { return count == 0 ? nullptr : _base + offset; };
+
+    // Pool of strings.
+    WCHAR* const strings = reinterpret_cast<WCHAR*>(_base + off_strings);
+    std::copy(pool.begin(), pool.end(), strings);
+    _strings = pool.empty() ? nullptr : strings;
+    _strings_count = pool.size();
+    const auto pooled = [strings, &offsets](const WCHAR* str) {
+        return str == nullptr ? nullptr : strings + offsets.at(String(str));
+    };
+
+    // Key names.
+    VSC_LPWSTR* const names = reinterpret_cast<VSC_LPWSTR*>(ptr(off_key_names, key_names));
+    for (size_t i = 0; i + 1 < key_names; ++i) {
+        names[i].vsc = tables.pKeyNames[i].vsc;
+        names[i].pwsz = pooled(tables.pKeyNames[i].pwsz);
+    }
+    VSC_LPWSTR* const names_ext = reinterpret_cast<VSC_LPWSTR*>(ptr(off_key_names_ext, key_names_ext));
+    for (size_t i = 0; i + 1 < key_names_ext; ++i) {
+        names_ext[i].vsc = tables.pKeyNamesExt[i].vsc;
+        names_ext[i].pwsz = pooled(tables.pKeyNamesExt[i].pwsz);
+    }
+    DEADKEY_LPWSTR* const names_dead = reinterpret_cast<DEADKEY_LPWSTR*>(ptr(off_key_names_dead, key_names_dead));
+    DEADKEY_LPWSTR* dead = names_dead;
+    for (const DEADKEY_LPWSTR* p = tables.pKeyNamesDead; p != nullptr && *p != nullptr; ++p) {
+        if (**p != 0) {
+            *dead++ = pooled(*p);
+        }
+    }
+
+    // Tables which are copied as is.
+    const auto copy = [this](size_t offset, const void* data, size_t bytes) {
+        if (bytes > 0) {
+            std::memcpy(_base + offset, data, bytes);
+        }
+        return bytes == 0 ? nullptr : _base + offset;
+    };
+    DEADKEY* const dead_keys_table = reinterpret_cast<DEADKEY*>(copy(off_dead_keys, tables.pDeadKey, dead_keys * sizeof(DEADKEY)));
+    LIGATURE1* const ligatures_table = reinterpret_cast<LIGATURE1*>(copy(off_ligatures, tables.pLigature, ligatures * tables.cbLgEntry));
+    USHORT* const scancodes_table = reinterpret_cast<USHORT*>(copy(off_scancodes, tables.pusVSCtoVK, scancodes * sizeof(USHORT)));
+    VSC_VK* const vsc_e0_table = reinterpret_cast<VSC_VK*>(copy(off_vsc_e0, tables.pVSCtoVK_E0, vsc_e0 * sizeof(VSC_VK)));
+    VSC_VK* const vsc_e1_table = reinterpret_cast<VSC_VK*>(copy(off_vsc_e1, tables.pVSCtoVK_E1, vsc_e1 * sizeof(VSC_VK)));
+    VK_TO_BIT* const vk_to_bits_table = reinterpret_cast<VK_TO_BIT*>(copy(off_vk_to_bits, mods == nullptr ? nullptr : mods->pVkToBit, vk_to_bits * sizeof(VK_TO_BIT)));
+    MODIFIERS* const mods_table = reinterpret_cast<MODIFIERS*>(copy(off_mods, mods, mods_size));
+    if (mods_table != nullptr) {
+        mods_table->pVkToBit = vk_to_bits_table;
+    }
+
+    // Character tables.
+    VK_TO_WCHAR_TABLE* const vtwc = reinterpret_cast<VK_TO_WCHAR_TABLE*>(ptr(off_vtwc, tables.pVkToWcharTable == nullptr ? 0 : 1));
+    for (size_t i = 0; vtwc != nullptr && i < char_tables.size(); ++i) {
+        const CharTable& tab(char_tables[i]);
+        uint8_t* row = _base + off_chars[i];
+        vtwc[i].pVkToWchars = reinterpret_cast<PVK_TO_WCHARS1>(row);
+        vtwc[i].nModifications = BYTE(tab.columns);
+        vtwc[i].cbSize = BYTE(tab.entry_size);
+        for (const auto& key : tab.keys) {
+            row[0] = key.vk;
+            row[1] = key.attributes;
+            std::copy(key.chars.begin(), key.chars.end(), RowChars(row));
+            row += tab.entry_size;
+            if (key.has_next) {
+                row[0] = key.next_vk;
+                row[1] = key.next_attributes;
+                std::copy(key.next_chars.begin(), key.next_chars.end(), RowChars(row));
+                row += tab.entry_size;
+            }
+        }
+    }
+
+    // Main table.
+    KBDTABLES* const main = reinterpret_cast<KBDTABLES*>(_base + off_tables);
+    *main = tables;
+    main->pCharModifiers = mods_table;
+    main->pVkToWcharTable = vtwc;
+    main->pDeadKey = dead_keys_table;
+    main->pKeyNames = names;
+    main->pKeyNamesExt = names_ext;
+    main->pKeyNamesDead = names_dead;
+    main->pusVSCtoVK = scancodes_table;
+    main->bMaxVSCtoVK = BYTE(scancodes);
+    main->pVSCtoVK_E0 = vsc_e0_table;
+    main->pVSCtoVK_E1 = vsc_e1_table;
+    main->pLigature = ligatures_table;
+}
+
+
+//----------------------------------------------------------------------------
+// Build the character tables, with keys moved to narrower tables.
+//----------------------------------------------------------------------------
+
+std::vector<KbdCompactor::CharTable> KbdCompactor::buildCharTables(const KBDTABLES& tables)
+{
+    // Extract the keys of all tables.
+    std::vector<CharTable> tabs;
+    std::array<size_t, 256> vk_count{};
+    for (const VK_TO_WCHAR_TABLE* vtwc = tables.pVkToWcharTable; vtwc != nullptr && vtwc->pVkToWchars != nullptr; ++vtwc) {
+        CharTable tab{vtwc->nModifications, vtwc->cbSize, {}};
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(vtwc->pVkToWchars);
+        while (row[0] != 0) {
+            const uint8_t* next = row + tab.entry_size;
+            const WCHAR* chars = RowChars(row);
+            Key key{row[0], row[1], std::vector<WCHAR>(chars, chars + tab.columns), false, 0, 0, {}};
+            const bool dead = std::find(key.chars.begin(), key.chars.end(), WCHAR(WCH_DEAD)) != key.chars.end();
+            if (next[0] == VK__none_ || (next[0] == row[0] && (dead || (row[1] & SGCAPS) != 0))) {
+                key.has_next = true;
+                key.next_vk = next[0];
+                key.next_attributes = next[1];
+                key.next_chars.assign(RowChars(next), RowChars(next) + tab.columns);
+                next += tab.entry_size;
+            }
+            vk_count[key.vk]++;
+            tab.keys.push_back(std::move(key));
+            row = next;
+        }
+        tabs.push_back(std::move(tab));
+    }
+
+    // Move each key to the narrowest table which can contain it, when the producers of characters are unchanged.
+    const Producers reference(GetProducers(tabs));
+    for (size_t i = 0; i < tabs.size(); ++i) {
+        for (size_t k = 0; k < tabs[i].keys.size(); ) {
+            const Key& key(tabs[i].keys[k]);
+            size_t width = 1;
+            for (size_t col = 0; col < tabs[i].columns; ++col) {
+                if (key.chars[col] != WCH_NONE || (key.has_next && key.next_chars[col] != WCH_NONE)) {
+                    width = col + 1;
+                }
+            }
+            size_t target = tabs.size();
+            for (size_t j = 0; j < tabs.size(); ++j) {
+                if (tabs[j].columns >= width && tabs[j].columns < tabs[i].columns && (target == tabs.size() || tabs[j].columns < tabs[target].columns)) {
+                    target = j;
+                }
+            }
+            // A key which is defined several times is not moved: the first definition is used.
+            if (target < tabs.size() && key.vk != VK__none_ && vk_count[key.vk] == 1) {
+                std::vector<CharTable> plan(tabs);
+                Key moved(std::move(plan[i].keys[k]));
+                plan[i].keys.erase(plan[i].keys.begin() + k);
+                moved.chars.resize(plan[target].columns);
+                if (moved.has_next) {
+                    moved.next_chars.resize(plan[target].columns);
+                }
+                plan[target].keys.push_back(std::move(moved));
+                if (GetProducers(plan) == reference) {
+                    tabs.swap(plan);
+                    _moved_keys++;
+                    continue;
+                }
+            }
+            ++k;
+        }
+    }
+
+    // Remove the empty tables.
+    const size_t count = tabs.size();
+    tabs.erase(std::remove_if(tabs.begin(), tabs.end(), [](const CharTable& tab) { return tab.keys.empty(); }), tabs.end());
+    _removed_tables = count - tabs.size();
+    return tabs;
+}
+
+
+//----------------------------------------------------------------------------
+// First key and column which produce each character, in the order of the tables.
+//----------------------------------------------------------------------------
+
+KbdCompactor::Producers KbdCompactor::GetProducers(const std::vector<CharTable>& tabs)
+{
+    Producers producers;
+    const auto add = [&producers](BYTE vk, const std::vector<WCHAR>& chars) {
+        for (size_t col = 0; col < chars.size(); ++col) {
+            if (chars[col] != WCH_NONE && chars[col] != WCH_DEAD && chars[col] != WCH_LGTR) {
+                producers.insert(std::make_pair(chars[col], std::make_pair(vk, col)));
+            }
+        }
+    };
+    for (const auto& tab : tabs) {
+        for (const auto& key : tab.keys) {
+            add(key.vk, key.chars);
+            if (key.has_next) {
+                add(key.next_vk, key.next_chars);
+            }
+        }
+    }
+    return producers;
+}
+
+
+//----------------------------------------------------------------------------
+// Build the pool of key names.
+//----------------------------------------------------------------------------
+
+std::map<std::u16string, size_t> KbdCompactor::buildStrings(const KBDTABLES& tables, std::vector<WCHAR>& pool)
+{
+    // All distinct strings, in order of appearance.
+    std::vector<std::u16string> strings;
+    std::map<std::u16string, size_t> offsets;
+    const auto add = [&](const WCHAR* str) {
+        if (str != nullptr && offsets.insert(std::make_pair(String(str), 0)).second) {
+            strings.push_back(String(str));
+        }
+    };
+    for (const VSC_LPWSTR* p = tables.pKeyNames; p != nullptr && p->vsc != 0; ++p) {
+        add(p->pwsz);
+    }
+    for (const VSC_LPWSTR* p = tables.pKeyNamesExt; p != nullptr && p->vsc != 0; ++p) {
+        add(p->pwsz);
+    }
+    for (const DEADKEY_LPWSTR* p = tables.pKeyNamesDead; p != nullptr && *p != nullptr; ++p) {
+        if (**p != 0) {
+            add(*p);
+        }
+    }
+
+    // Longest strings first, a string which is the end of a previous one is not duplicated.
+    std::stable_sort(strings.begin(), strings.end(), [](const std::u16string& s1, const std::u16string& s2) { return s1.size() > s2.size(); });
+    std::vector<std::pair<size_t, const std::u16string*>> placed;
+    for (const auto& str : strings) {
+        const auto it = std::find_if(placed.begin(), placed.end(), [&str](const auto& p) {
+            return p.second->size() >= str.size() && p.second->compare(p.second->size() - str.size(), str.size(), str) == 0;
+        });
+        if (it != placed.end()) {
+            offsets[str] = it->first + it->second->size() - str.size();
+            _shared_strings++;
+        }
+        else {
+            offsets[str] = pool.size();
+            placed.push_back(std::make_pair(pool.size(), &str));
+            pool.insert(pool.end(), str.begin(), str.end());
+            pool.push_back(0);
+        }
+    }
+    return offsets;
+}
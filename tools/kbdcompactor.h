@@ -0,0 +1,92 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Build a compact version of the tables of a keyboard layout.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+
+// The compact tables have the same semantics as the original ones:
+// - All key names are in one pool of strings. A name which is the end
+//   of another name (e.g. "Shift" in "Right Shift") is not duplicated.
+// - A key is moved to the narrowest existing VK_TO_WCHARSn table which
+//   contains all its characters, when this does not change the first key
+//   which produces a character (VkKeyScan). Empty tables are removed.
+// - The trailing VK__none_ entries of the scan code table are removed.
+// - The structures are laid out in a simulated data section, starting on a
+//   page boundary, to estimate their size: the tables which are used on each
+//   keystroke first, the key names last. A source file which is generated from
+//   the compact tables defines the structures in the reverse order. MSVC was
+//   observed to lay out the static data of a translation unit in reverse order
+//   of definition, but this is not documented and other compilers differ: the
+//   layout of a rebuilt DLL must be measured on the DLL itself.
+class KbdCompactor
+{
+public:
+    // Constructor. Build the compact tables.
+    KbdCompactor(const KBDTABLES&);
+
+    // Get the compact tables. They are valid as long as the object exists.
+    const KBDTABLES& tables() const { return *reinterpret_cast<const KBDTABLES*>(_base); }
+
+    // Simulated data section: base address (page-aligned) and size in bytes.
+    const void* base() const { return _base; }
+    size_t size() const { return _size; }
+
+    // Pool of strings in the data section, a sequence of nul-terminated strings.
+    const WCHAR* strings() const { return _strings; }
+    size_t stringsCount() const { return _strings_count; }
+
+    // Statistics.
+    size_t sharedStrings() const { return _shared_strings; }     // strings which are the end of another one
+    size_t movedKeys() const { return _moved_keys; }             // keys moved to a narrower table
+    size_t removedTables() const { return _removed_tables; }     // character tables which became empty
+    size_t removedScanCodes() const { return _removed_scancodes; }
+
+private:
+    // A key in a character table, with the optional next row (VK__none_ or same
+    // virtual key) for SGCAPS and dead keys, which must remain after it.
+    struct Key
+    {
+        BYTE               vk;
+        BYTE               attributes;
+        std::vector<WCHAR> chars;
+        bool               has_next;
+        BYTE               next_vk;
+        BYTE               next_attributes;
+        std::vector<WCHAR> next_chars;
+    };
+
+    // A character table.
+    struct CharTable
+    {
+        size_t           columns;
+        size_t           entry_size;
+        std::vector<Key> keys;
+    };
+
+    // First key and column which produce each character, for VkKeyScan.
+    typedef std::map<WCHAR, std::pair<BYTE, size_t>> Producers;
+
+    std::vector<uint8_t> _buffer;
+    uint8_t*             _base;
+    size_t               _size;
+    const WCHAR*         _strings;
+    size_t               _strings_count;
+    size_t               _shared_strings;
+    size_t               _moved_keys;
+    size_t               _removed_tables;
+    size_t               _removed_scancodes;
+
+    // Build the character tables, with keys moved to narrower tables.
+    std::vector<CharTable> buildCharTables(const KBDTABLES&);
+    static Producers GetProducers(const std::vector<CharTable>&);
+
+    // Build the pool of key names, return the offset of each string in the pool.
+    std::map<std::u16string, size_t> buildStrings(const KBDTABLES&, std::vector<WCHAR>& pool);
+};
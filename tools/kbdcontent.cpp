@@ -0,0 +1,255 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Semantic content of a keyboard layout, for comparisons.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdcontent.h"
+
+namespace {
+
+    // Largest ligature entry, to access the characters of entries of any size.
+    TYPEDEF_LIGATURE(16)
+
+    // Incremental FNV-1a hash, 64 bits.
+    class Hash
+    {
+    public:
+        void add(const void* data, size_t size)
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                _value = (_value ^ p[i]) * 0x00000100000001B3ull;
+            }
+        }
+        uint64_t value() const { return _value; }
+    private:
+        uint64_t _value = 0xCBF29CE484222325ull;
+    };
+
+    // Build a value from a null-terminated string.
+    KbdContent::Value StringValue(const WCHAR* str)
+    {
+        KbdContent::Value value;
+        for (; str != nullptr && *str != 0; ++str) {
+            value.push_back(char16_t(*str));
+        }
+        return value;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Names of sections.
+//----------------------------------------------------------------------------
+
+const wchar_t* KbdContent::SectionName(Section section)
+{
+    switch (section) {
+        case SEC_SCANCODES: return L"scancode";
+        case SEC_MODIFIERS: return L"modifier";
+        case SEC_CHARACTERS: return L"character";
+        case SEC_DEADKEYS: return L"deadkey";
+        case SEC_LIGATURES: return L"ligature";
+        case SEC_KEYNAMES: return L"keyname";
+        case SEC_FLAGS: return L"flags";
+        default: return L"unknown";
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: extract the content of the tables.
+//----------------------------------------------------------------------------
+
+KbdContent::KbdContent(const KBDTABLES& tables) :
+    _entries(),
+    _hashes()
+{
+    // Build each section as a map, keep the first entry for each key, as the system does.
+    std::array<std::map<uint32_t, Value>, SECTION_COUNT> sections;
+    const auto add = [&sections](Section section, uint32_t key, const Value& value) {
+        sections[section].insert(std::make_pair(key, value));
+    };
+    const auto add_dword = [&add](Section section, uint32_t key, DWORD value) {
+        add(section, key, Value{char16_t(LOWORD(value)), char16_t(HIWORD(value))});
+    };
+
+    // Scan codes. Unmapped scan codes are absent.
+    if (tables.pusVSCtoVK != nullptr) {
+        for (uint32_t sc = 0; sc < tables.bMaxVSCtoVK; ++sc) {
+            if (tables.pusVSCtoVK[sc] != VK__none_) {
+                add(SEC_SCANCODES, sc, Value(1, char16_t(tables.pusVSCtoVK[sc])));
+            }
+        }
+    }
+    const PVSC_VK lists[2] = {tables.pVSCtoVK_E0, tables.pVSCtoVK_E1};
+    for (uint32_t i = 0; i < 2; ++i) {
+        for (const VSC_VK* p = lists[i]; p != nullptr && p->Vsc != 0; ++p) {
+            if (p->Vk != VK__none_) {
+                add(SEC_SCANCODES, ((0xE0 + i) << 8) | p->Vsc, Value(1, char16_t(p->Vk)));
+            }
+        }
+    }
+
+    // Modifiers and valid combinations of modifier bits. Keep the list of modifier bits for each column.
+    const MODIFIERS* mods = tables.pCharModifiers;
+    std::vector<std::vector<uint8_t>> column_bits;
+    if (mods != nullptr) {
+        for (const VK_TO_BIT* p = mods->pVkToBit; p != nullptr && p->Vk != 0; ++p) {
+            add(SEC_MODIFIERS, p->Vk, Value(1, char16_t(p->ModBits)));
+        }
+        for (uint32_t bits = 0; bits <= mods->wMaxModBits && bits < 256; ++bits) {
+            const size_t col = mods->ModNumber[bits];
+            if (col != SHFT_INVALID) {
+                add(SEC_MODIFIERS, 0x100 | bits, Value());
+                if (column_bits.size() <= col) {
+                    column_bits.resize(col + 1);
+                }
+                column_bits[col].push_back(uint8_t(bits));
+            }
+        }
+    }
+
+    // Characters by modifier bits, with the dead key or SGCAPS character of the following VK__none_ entry.
+    // Non-zero attributes of the keys are in the flags.
+    std::array<bool, 256> defined{};
+    for (const VK_TO_WCHAR_TABLE* tab = tables.pVkToWcharTable; tab != nullptr && tab->pVkToWchars != nullptr; tab++) {
+        const size_t count = std::min<size_t>(tab->nModifications, column_bits.size());
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(tab->pVkToWchars);
+        for (;; row += tab->cbSize) {
+            const VK_TO_WCHARS10* vtwc = reinterpret_cast<const VK_TO_WCHARS10*>(row);
+            const VK_TO_WCHARS10* next = reinterpret_cast<const VK_TO_WCHARS10*>(row + tab->cbSize);
+            const uint32_t vk = vtwc->VirtualKey;
+            if (vk == 0) {
+                break;
+            }
+            if (vk == VK__none_ || defined[vk]) {
+                continue;
+            }
+            defined[vk] = true;
+            if (vtwc->Attributes != 0) {
+                add(SEC_FLAGS, 0x100 | vk, Value(1, char16_t(vtwc->Attributes)));
+            }
+            for (size_t col = 0; col < count; ++col) {
+                if (vtwc->wch[col] == WCH_NONE) {
+                    continue;
+                }
+                Value value(1, char16_t(vtwc->wch[col]));
+                if (next->VirtualKey == VK__none_ && (vtwc->wch[col] == WCH_DEAD || (vtwc->Attributes & SGCAPS) != 0)) {
+                    value.push_back(char16_t(next->wch[col]));
+                }
+                for (uint8_t bits : column_bits[col]) {
+                    add(SEC_CHARACTERS, (vk << 8) | bits, value);
+                }
+            }
+        }
+    }
+
+    // Dead keys.
+    for (const DEADKEY* dk = tables.pDeadKey; dk != nullptr && dk->dwBoth != 0; ++dk) {
+        add(SEC_DEADKEYS, dk->dwBoth, Value{char16_t(dk->wchComposed), char16_t(dk->uFlags)});
+    }
+
+    // Ligatures, by modifier bits.
+    const uint8_t* lg = reinterpret_cast<const uint8_t*>(tables.pLigature);
+    for (; lg != nullptr && tables.cbLgEntry > 0 && reinterpret_cast<const LIGATURE1*>(lg)->VirtualKey != 0; lg += tables.cbLgEntry) {
+        const LIGATURE16* entry = reinterpret_cast<const LIGATURE16*>(lg);
+        Value value;
+        for (size_t i = 0; i < tables.nLgMax && i < 16 && entry->wch[i] != WCH_NONE; ++i) {
+            value.push_back(char16_t(entry->wch[i]));
+        }
+        if (entry->ModificationNumber < column_bits.size()) {
+            for (uint8_t bits : column_bits[entry->ModificationNumber]) {
+                add(SEC_LIGATURES, (uint32_t(entry->VirtualKey) << 8) | bits, value);
+            }
+        }
+    }
+
+    // Key names.
+    for (const VSC_LPWSTR* p = tables.pKeyNames; p != nullptr && p->vsc != 0; ++p) {
+        add(SEC_KEYNAMES, p->vsc, StringValue(p->pwsz));
+    }
+    for (const VSC_LPWSTR* p = tables.pKeyNamesExt; p != nullptr && p->vsc != 0; ++p) {
+        add(SEC_KEYNAMES, 0xE000 | p->vsc, StringValue(p->pwsz));
+    }
+    for (const DEADKEY_LPWSTR* p = tables.pKeyNamesDead; p != nullptr && *p != nullptr; ++p) {
+        if (**p != 0) {
+            add(SEC_KEYNAMES, 0x10000 | **p, StringValue(*p + 1));
+        }
+    }
+
+    // Global flags.
+    add_dword(SEC_FLAGS, 0, tables.fLocaleFlags);
+    add_dword(SEC_FLAGS, 1, tables.dwType);
+    add_dword(SEC_FLAGS, 2, tables.dwSubType);
+
+    // Sorted entries and hashes.
+    for (size_t sec = 0; sec < SECTION_COUNT; ++sec) {
+        Hash hash;
+        _entries[sec].reserve(sections[sec].size());
+        for (const auto& it : sections[sec]) {
+            const uint32_t size = uint32_t(it.second.size());
+            hash.add(&it.first, sizeof(it.first));
+            hash.add(&size, sizeof(size));
+            hash.add(it.second.data(), it.second.size() * sizeof(char16_t));
+            _entries[sec].push_back(Entry{it.first, it.second});
+        }
+        _hashes[sec] = hash.value();
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Compare with another layout.
+//----------------------------------------------------------------------------
+
+size_t KbdContent::compare(const KbdContent& other, std::vector<Difference>* diffs, std::array<size_t, SECTION_COUNT>* counts) const
+{
+    size_t total = 0;
+    for (size_t sec = 0; sec < SECTION_COUNT; ++sec) {
+        const Section section = Section(sec);
+        size_t count = 0;
+        if (!sameSection(other, section)) {
+            // Merge the two sorted lists of entries.
+            const std::vector<Entry>& e1(_entries[sec]);
+            const std::vector<Entry>& e2(other._entries[sec]);
+            size_t i1 = 0;
+            size_t i2 = 0;
+            while (i1 < e1.size() || i2 < e2.size()) {
+                Difference diff{section, 0, nullptr, nullptr};
+                if (i2 >= e2.size() || (i1 < e1.size() && e1[i1].key < e2[i2].key)) {
+                    diff = Difference{section, e1[i1].key, &e1[i1].value, nullptr};
+                    ++i1;
+                }
+                else if (i1 >= e1.size() || e2[i2].key < e1[i1].key) {
+                    diff = Difference{section, e2[i2].key, nullptr, &e2[i2].value};
+                    ++i2;
+                }
+                else if (e1[i1].value != e2[i2].value) {
+                    diff = Difference{section, e1[i1].key, &e1[i1].value, &e2[i2].value};
+                    ++i1;
+                    ++i2;
+                }
+                else {
+                    ++i1;
+                    ++i2;
+                    continue;
+                }
+                ++count;
+                if (diffs != nullptr) {
+                    diffs->push_back(diff);
+                }
+            }
+        }
+        if (counts != nullptr) {
+            (*counts)[sec] = count;
+        }
+        total += count;
+    }
+    return total;
+}
@@ -0,0 +1,80 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Semantic content of a keyboard layout, for comparisons.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+
+// The content of a keyboard layout is extracted from KBDTABLES, independently
+// of the way the data structures are built: order of the entries, modification
+// numbers (columns), size of the tables, placement of the strings. Two layouts
+// with the same content behave identically.
+//
+// The content is split in sections. Each section is a list of entries, sorted
+// by key, with a 64-bit hash of the section. Two layouts are compared section
+// by section, only the sections with different hashes are compared entry by entry.
+class KbdContent
+{
+public:
+    // Constructor. Extract the content of the tables. The tables are no longer used after.
+    KbdContent(const KBDTABLES&);
+
+    // Sections of the content. The keys and values of the entries are described below.
+    enum Section : uint8_t {
+        SEC_SCANCODES,   // Scan code (0xE0xx, 0xE1xx for prefixed codes) => virtual key with flags.
+        SEC_MODIFIERS,   // Virtual key => modifier bits (VK_TO_BIT), 0x100 + modifier bits => (empty) when valid.
+        SEC_CHARACTERS,  // Virtual key << 8 + modifier bits => character, plus dead key or SGCAPS character.
+        SEC_DEADKEYS,    // Accent << 16 + base character => composed character, flags.
+        SEC_LIGATURES,   // Virtual key << 8 + modifier bits => characters of the ligature.
+        SEC_KEYNAMES,    // Scan code (0xE0xx for extended names) => name, 0x10000 + dead character => name.
+        SEC_FLAGS,       // 0 => locale flags, 1 => type, 2 => subtype (two words), 0x100 + virtual key => attributes.
+        SECTION_COUNT
+    };
+
+    // Name of a section, for display.
+    static const wchar_t* SectionName(Section);
+
+    // Value of an entry, a sequence of 16-bit words, usually UTF-16 characters.
+    typedef std::u16string Value;
+
+    // One entry in a section.
+    struct Entry
+    {
+        uint32_t key;
+        Value    value;
+    };
+
+    // Get the entries and the hash of a section.
+    const std::vector<Entry>& entries(Section section) const { return _entries[section]; }
+    uint64_t hash(Section section) const { return _hashes[section]; }
+
+    // Check if a section has the same content as in another layout, using the hashes.
+    bool sameSection(const KbdContent& other, Section section) const
+    {
+        return _hashes[section] == other._hashes[section] && _entries[section].size() == other._entries[section].size();
+    }
+
+    // One difference with another layout. The values point into the two contents.
+    struct Difference
+    {
+        Section      section;
+        uint32_t     key;
+        const Value* old_value;  // Null if the entry was added.
+        const Value* new_value;  // Null if the entry was removed.
+    };
+
+    // Compare with another layout, the "new" one. Return the number of differences.
+    // When 'diffs' is not null, the differences are appended to it.
+    // When 'counts' is not null, it receives the number of differences per section.
+    size_t compare(const KbdContent& other, std::vector<Difference>* diffs = nullptr, std::array<size_t, SECTION_COUNT>* counts = nullptr) const;
+
+private:
+    std::array<std::vector<Entry>, SECTION_COUNT> _entries;
+    std::array<uint64_t, SECTION_COUNT>           _hashes;
+};
@@ -0,0 +1,258 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Utility to evaluate the cost of typing a text corpus on keyboard layouts.
+//
+//---------------------------------------------------------------------------
+
+#include "options.h"
+#include "strutils.h"
+#include "winutils.h"
+#include "grid.h"
+#include "kbdfile.h"
+#include "mappedfile.h"
+#include "workpool.h"
+#include "typingcost.h"
+#include <chrono>
+
+// Configure the terminal console on init, restore on exit.
+ConsoleState state;
+
+// Size of the corpus chunks which are processed in parallel.
+constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class CorpusOptions : public Options
+{
+public:
+    // Constructor.
+    CorpusOptions(int argc, wchar_t* argv[]);
+
+    // Command line options.
+    WStringList inputs;
+    WStringList corpus;
+    WString     output;
+    int         threads;
+    bool        unreachable;
+};
+
+CorpusOptions::CorpusOptions(int argc, wchar_t* argv[]) :
+    Options(argc, argv,
+        L"[options] kbd-name-file-or-directory ...\n"
+        L"\n"
+        L"  kbd-name-file-or-directory : Either the file name of a keyboard layout DLL,\n"
+        L"  the name of a keyboard layout, for instance \"fr\" for C:\\Windows\\System32\\kbdfr.dll,\n"
+        L"  or a directory containing keyboard layout DLL's\n"
+        L"\n"
+        L"Evaluate the cost of typing UTF-8 text files on each layout: number of key presses,\n"
+        L"usage of modifiers and dead keys, characters which cannot be typed. The characters\n"
+        L"are typed with the cheapest sequence of keys. The text files are read in parallel.\n"
+        L"The typed characters are checked against the character coverage of each layout.\n"
+        L"\n"
+        L"Options:\n"
+        L"\n"
+        L"  -c file : UTF-8 text file, several -c options are allowed\n"
+        L"  -h : display this help text\n"
+        L"  -j count : number of threads, default: number of processors\n"
+        L"  -o outfile : output file name, default is standard output\n"
+        L"  -u : list the characters which cannot be typed on each layout\n"
+        L"  -v : verbose messages"),
+    inputs(),
+    corpus(),
+    output(),
+    threads(0),
+    unreachable(false)
+{
+    // Parse arguments.
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == L"--help" || args[i] == L"-h") {
+            usage();
+        }
+        else if (args[i] == L"-c" && i + 1 < args.size()) {
+            corpus.push_back(args[++i]);
+        }
+        else if (args[i] == L"-j" && i + 1 < args.size()) {
+            threads = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-o" && i + 1 < args.size()) {
+            output = args[++i];
+        }
+        else if (args[i] == L"-u") {
+            unreachable = true;
+        }
+        else if (args[i] == L"-v") {
+            setVerbose(true);
+        }
+        else if (!args[i].empty() && args[i].front() != '-') {
+            inputs.push_back(args[i]);
+        }
+        else {
+            fatal("invalid option '" + args[i] + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal(L"no keyboard layout specified, try --help");
+    }
+    if (corpus.empty()) {
+        fatal(L"no text file specified, try --help");
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Count the code points of a text file, in parallel.
+//---------------------------------------------------------------------------
+
+bool CountFile(CorpusOptions& opt, WorkPool& pool, const WString& filename, CharCounts& counts, uint64_t& bytes)
+{
+    MappedFile file;
+    if (!file.open(FilePath(filename), SIZE_MAX)) {
+        opt.error("cannot open " + filename);
+        return false;
+    }
+
+    // Split the file in chunks, on UTF-8 sequence boundaries.
+    const uint8_t* const data = file.data();
+    const size_t size = file.size();
+    std::vector<size_t> bounds{0};
+    while (bounds.back() < size) {
+        size_t next = std::min(bounds.back() + CHUNK_SIZE, size);
+        while (next < size && !CharCounts::IsSequenceStart(data[next])) {
+            ++next;
+        }
+        bounds.push_back(next);
+    }
+
+    // One set of counters per thread, merged at the end.
+    std::vector<CharCounts> thread_counts(pool.threadCount());
+    pool.run(bounds.size() - 1, [&](size_t job, size_t thread) {
+        thread_counts[thread].add(data + bounds[job], bounds[job + 1] - bounds[job]);
+    });
+    for (const auto& tc : thread_counts) {
+        counts += tc;
+    }
+    bytes += size;
+    opt.verbose(Format(L"%s: %zu bytes, %zu chunks", filename.c_str(), size, bounds.size() - 1));
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int wmain(int argc, wchar_t* argv[])
+{
+    // Parse command line options.
+    CorpusOptions opt(argc, argv);
+    opt.setOutput(opt.output);
+
+    // Count the code points of all text files.
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    CharCounts counts;
+    uint64_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& file : opt.corpus) {
+        if (!CountFile(opt, pool, file, counts, bytes)) {
+            opt.exit(EXIT_FAILURE);
+        }
+    }
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Get the list of keyboard layout DLL's.
+    WStringList files;
+    KbdFile::ExpandNames(files, opt.inputs);
+
+    // Evaluate the cost of the text on each layout.
+    Grid grid(L"", L"  ");
+    grid.addLine({L"Layout", L"Characters", L"Keystrokes", L"Keys/char", L"Shift", L"AltGr", L"Ctrl", L"Alt", L"Dead keys", L"Unreachable", L"Distinct"});
+    grid.addUnderlines();
+    WStringVector names;
+    std::vector<TypingCost::Counters> results;
+    std::vector<char32_t> mismatches;
+    bool success = true;
+    for (const auto& file : files) {
+        KbdFile kbd(opt);
+        if (kbd.load(file)) {
+            const KbdEngine engine(*kbd.tables());
+            const ReverseIndex index(engine);
+            const TypingCost cost(engine, index);
+            names.push_back(FileBaseName(kbd.fileName()));
+            results.emplace_back();
+            cost.evaluate(counts, results.back());
+            const TypingCost::Counters& res(results.back());
+
+            // The unreachable characters must be the ones which are not in the coverage of the layout.
+            if (!cost.check(counts, CharCoverage(engine), mismatches)) {
+                success = false;
+                for (char32_t code : mismatches) {
+                    opt.error(Format(L"%s: U+%04X is %s by the typing cost but %s in the character coverage", names.back().c_str(),
+                                     uint32_t(code), res.missing.contains(code) ? L"unreachable" : L"typed", res.missing.contains(code) ? L"present" : L"absent"));
+                }
+            }
+            grid.addLine({names.back(),
+                          Format(L"%llu", res.characters),
+                          Format(L"%llu", res.keystrokes),
+                          Format(L"%.3f", res.characters == 0 ? 0.0 : double(res.keystrokes) / double(res.characters)),
+                          Format(L"%llu", res.shift),
+                          Format(L"%llu", res.altgr),
+                          Format(L"%llu", res.ctrl),
+                          Format(L"%llu", res.alt),
+                          Format(L"%llu", res.dead_keys),
+                          Format(L"%llu", res.unreachable),
+                          Format(L"%zu", res.missing.size())});
+        }
+    }
+    if (results.empty()) {
+        opt.exit(EXIT_FAILURE);
+    }
+
+    opt.out() << Format(L"Corpus: %zu files, %llu bytes, %llu code points, %llu invalid UTF-8 sequences",
+                        opt.corpus.size(), bytes, counts.total(), counts.invalid()) << std::endl
+              << Format(L"Read in %.1f ms, %.1f MB/s, %zu threads",
+                        duration, duration <= 0.0 ? 0.0 : double(bytes) / (duration * 1000.0), pool.threadCount()) << std::endl
+              << std::endl;
+    grid.print(opt.out());
+
+    // List of unreachable characters in each layout, most frequent first.
+    if (opt.unreachable) {
+        for (size_t i = 0; i < results.size(); ++i) {
+            std::vector<std::pair<uint64_t, char32_t>> missing;
+            for (const auto& it : results[i].missing) {
+                missing.push_back(std::make_pair(it.second, it.first));
+            }
+            if (missing.empty()) {
+                continue;
+            }
+            std::sort(missing.begin(), missing.end(), [](const auto& m1, const auto& m2) {
+                return m1.first != m2.first ? m1.first > m2.first : m1.second < m2.second;
+            });
+            opt.out() << std::endl << Format(L"%s: %zu unreachable characters", names[i].c_str(), missing.size()) << std::endl;
+            WString line;
+            for (const auto& m : missing) {
+                line.append(Format(L" U+%04X", uint32_t(m.second)));
+                if (m.second >= 0x20 && m.second != 0x7F && m.second < 0xD800) {
+                    line.append(L" ");
+                    line.push_back(wchar_t(m.second));
+                }
+                line.append(Format(L" (%llu)", m.first));
+                if (line.size() > 70) {
+                    opt.out() << line << std::endl;
+                    line.clear();
+                }
+            }
+            if (!line.empty()) {
+                opt.out() << line << std::endl;
+            }
+        }
+    }
+
+    opt.exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,206 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Utility to report the character coverage of keyboard layouts.
+//
+//---------------------------------------------------------------------------
+
+#include "options.h"
+#include "strutils.h"
+#include "winutils.h"
+#include "grid.h"
+#include "kbdfile.h"
+#include "charcoverage.h"
+
+// Configure the terminal console on init, restore on exit.
+ConsoleState state;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class CoverageOptions : public Options
+{
+public:
+    // Constructor.
+    CoverageOptions(int argc, wchar_t* argv[]);
+
+    // Command line options.
+    WStringList inputs;
+    WString     output;
+    bool        matrix;
+    bool        missing;
+};
+
+CoverageOptions::CoverageOptions(int argc, wchar_t* argv[]) :
+    Options(argc, argv,
+        L"[options] kbd-name-file-or-directory ...\n"
+        L"\n"
+        L"  kbd-name-file-or-directory : Either the file name of a keyboard layout DLL,\n"
+        L"  the name of a keyboard layout, for instance \"fr\" for C:\\Windows\\System32\\kbdfr.dll,\n"
+        L"  or a directory containing keyboard layout DLL's\n"
+        L"\n"
+        L"Display the number of characters which can be typed on each layout: directly,\n"
+        L"with dead keys, with ligatures.\n"
+        L"\n"
+        L"Options:\n"
+        L"\n"
+        L"  -h : display this help text\n"
+        L"  -m : display the coverage matrix of all layouts, the number of characters\n"
+        L"       of the layout in a row which are missing in the layout of a column\n"
+        L"  -o outfile : output file name, default is standard output\n"
+        L"  -u : list the characters of other layouts which are missing in each layout\n"
+        L"  -v : verbose messages"),
+    inputs(),
+    output(),
+    matrix(false),
+    missing(false)
+{
+    // Parse arguments.
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == L"--help" || args[i] == L"-h") {
+            usage();
+        }
+        else if (args[i] == L"-m") {
+            matrix = true;
+        }
+        else if (args[i] == L"-o" && i + 1 < args.size()) {
+            output = args[++i];
+        }
+        else if (args[i] == L"-u") {
+            missing = true;
+        }
+        else if (args[i] == L"-v") {
+            setVerbose(true);
+        }
+        else if (!args[i].empty() && args[i].front() != '-') {
+            inputs.push_back(args[i]);
+        }
+        else {
+            fatal("invalid option '" + args[i] + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal(L"no keyboard layout specified, try --help");
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int wmain(int argc, wchar_t* argv[])
+{
+    // Parse command line options.
+    CoverageOptions opt(argc, argv);
+    opt.setOutput(opt.output);
+
+    // Get the list of keyboard layout DLL's.
+    WStringList files;
+    KbdFile::ExpandNames(files, opt.inputs);
+
+    // Compute the coverage of all layouts. The layouts are unloaded after use.
+    WStringVector names;
+    std::vector<CharCoverage> coverages;
+    for (const auto& file : files) {
+        KbdFile kbd(opt);
+        if (kbd.load(file)) {
+            names.push_back(FileBaseName(kbd.fileName()));
+            coverages.emplace_back(KbdEngine(*kbd.tables()));
+            opt.verbose(Format(L"%s: %zu characters", names.back().c_str(), coverages.back().all().count()));
+        }
+    }
+    if (coverages.empty()) {
+        opt.exit(EXIT_FAILURE);
+    }
+
+    // Union and intersection of all layouts.
+    CharSet all_union;
+    CharSet all_intersection(coverages.front().all());
+    for (const auto& cov : coverages) {
+        all_union |= cov.all();
+        all_intersection &= cov.all();
+    }
+
+    // Summary, one line per layout. The dead keys and ligatures columns count the characters
+    // which cannot be typed directly.
+    Grid grid(L"", L"  ");
+    grid.addLine({L"Layout", L"Direct", L"Dead keys", L"Ligatures", L"Total", L"Not in others", L"Missing"});
+    grid.addUnderlines();
+    for (size_t i = 0; i < coverages.size(); ++i) {
+        const CharCoverage& cov(coverages[i]);
+        CharSet others;
+        for (size_t j = 0; j < coverages.size(); ++j) {
+            if (j != i) {
+                others |= coverages[j].all();
+            }
+        }
+        grid.addLine({names[i],
+                      Format(L"%zu", cov.direct().count()),
+                      Format(L"%zu", CharSet::CountDifference(cov.deadKeys(), cov.direct())),
+                      Format(L"%zu", CharSet::CountDifference(cov.ligatures(), cov.direct() | cov.deadKeys())),
+                      Format(L"%zu", cov.all().count()),
+                      Format(L"%zu", CharSet::CountDifference(cov.all(), others)),
+                      Format(L"%zu", CharSet::CountDifference(all_union, cov.all()))});
+    }
+    grid.addUnderlines();
+    grid.addLine({L"Union", L"", L"", L"", Format(L"%zu", all_union.count())});
+    grid.addLine({L"Intersection", L"", L"", L"", Format(L"%zu", all_intersection.count())});
+    opt.out() << Format(L"Character coverage: %zu layouts, %s population count", coverages.size(), CharSet::UseAVX2() ? L"AVX2" : L"scalar")
+              << std::endl << std::endl;
+    grid.print(opt.out());
+
+    // Coverage matrix: characters of the row layout which are missing in the column layout.
+    // The columns are numbered to keep the matrix readable.
+    if (opt.matrix) {
+        Grid mgrid(L"", L"  ");
+        Grid::Line header{L"", L"Layout"};
+        for (size_t j = 0; j < coverages.size(); ++j) {
+            header.push_back(Format(L"%zu", j + 1));
+        }
+        mgrid.addLine(header);
+        mgrid.addUnderlines();
+        for (size_t i = 0; i < coverages.size(); ++i) {
+            Grid::Line line{Format(L"%zu", i + 1), names[i]};
+            for (size_t j = 0; j < coverages.size(); ++j) {
+                line.push_back(i == j ? L"-" : Format(L"%zu", CharSet::CountDifference(coverages[i].all(), coverages[j].all())));
+            }
+            mgrid.addLine(line);
+        }
+        opt.out() << std::endl << L"Characters of the row layout which are missing in the column layout" << std::endl << std::endl;
+        mgrid.print(opt.out());
+    }
+
+    // List of missing characters in each layout, compared to all other layouts.
+    if (opt.missing) {
+        std::vector<WCHAR> chars;
+        for (size_t i = 0; i < coverages.size(); ++i) {
+            (all_union - coverages[i].all()).getCharacters(chars);
+            if (!chars.empty()) {
+                opt.out() << std::endl << Format(L"%s: %zu missing characters", names[i].c_str(), chars.size()) << std::endl;
+                WString line;
+                for (WCHAR c : chars) {
+                    line.append(Format(L" U+%04X", c));
+                    if (c >= 0x20 && c != 0x7F) {
+                        line.append(L" ");
+                        line.push_back(wchar_t(c));
+                    }
+                    if (line.size() > 70) {
+                        opt.out() << line << std::endl;
+                        line.clear();
+                    }
+                }
+                if (!line.empty()) {
+                    opt.out() << line << std::endl;
+                }
+            }
+        }
+    }
+
+    opt.exit(EXIT_SUCCESS);
+}
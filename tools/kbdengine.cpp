@@ -0,0 +1,592 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Portable keystroke to Unicode translation engine.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdengine.h"
+
+// Alt+numpad characters without leading zero: OEM code page 437, with the glyphs of the control characters.
+static const WCHAR OemCharacters[256] = {
+    0x0000, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022,
+    0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+    0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8,
+    0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0,
+};
+
+// Alt+numpad characters with leading zero: ANSI code page 1252, from 0x80 to 0x9F. Same as Latin-1 otherwise.
+static const WCHAR AnsiCharacters[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+
+//----------------------------------------------------------------------------
+// Constructor: precompute the flat lookup tables.
+//----------------------------------------------------------------------------
+
+KbdEngine::KbdEngine(const KBDTABLES& tables) :
+    _tables(tables),
+    _sc_vk(),
+    _sc_special(),
+    _special(),
+    _vk_slot(),
+    _vk_locks(),
+    _slot_bits(),
+    _slot_lock(),
+    _vk_bits(),
+    _keys_bits(),
+    _mod_column(),
+    _cell(),
+    _caps_column(),
+    _columns(0),
+    _cells(0),
+    _wch(),
+    _wch2(),
+    _dead_keys(tables.pDeadKey)
+{
+    buildScanCodes();
+    buildSpecialKeys();
+    buildModifiers();
+    buildSlots();
+    buildCharacters();
+}
+
+
+//----------------------------------------------------------------------------
+// Build the scan code to virtual key tables, one per prefix.
+//----------------------------------------------------------------------------
+
+void KbdEngine::buildScanCodes()
+{
+    _sc_vk.fill(VK__none_);
+
+    if (_tables.pusVSCtoVK != nullptr) {
+        for (size_t sc = 0; sc < _tables.bMaxVSCtoVK; ++sc) {
+            _sc_vk[sc] = _tables.pusVSCtoVK[sc];
+        }
+    }
+
+    // Prefixed scan codes. Keep the first definition, as the system does.
+    const PVSC_VK lists[2] = {_tables.pVSCtoVK_E0, _tables.pVSCtoVK_E1};
+    for (size_t i = 0; i < 2; ++i) {
+        uint16_t* table = &_sc_vk[(i + 1) << 8];
+        for (const VSC_VK* p = lists[i]; p != nullptr && p->Vsc != 0; ++p) {
+            if ((table[p->Vsc] & 0xFF) == VK__none_) {
+                table[p->Vsc] = p->Vk;
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Build the table of keystrokes with state-dependent processing.
+//----------------------------------------------------------------------------
+
+void KbdEngine::buildSpecialKeys()
+{
+    _sc_special.fill(0);
+    _special.clear();
+
+    for (size_t index = 0; index < _sc_vk.size(); ++index) {
+        const uint16_t vkf = _sc_vk[index];
+        const uint8_t vk = uint8_t(vkf & 0xFF);
+        SpecialKey key{0, 0, 0, 0};
+
+        // With NumLock, the navigation keys of the numeric keypad become digits.
+        // They are also the digits of Alt+numpad entries, whatever the NumLock state is.
+        if ((vkf & KBDNUMPAD) != 0) {
+            static const uint8_t navigation[10] = {VK_INSERT, VK_END, VK_DOWN, VK_NEXT, VK_LEFT, VK_CLEAR, VK_RIGHT, VK_HOME, VK_UP, VK_PRIOR};
+            for (uint8_t digit = 0; digit < 10; ++digit) {
+                if (vk == navigation[digit]) {
+                    key.numlock_vk = uint8_t(VK_NUMPAD0 + digit);
+                    key.digit = uint8_t(digit + 1);
+                }
+            }
+            if (vk == VK_DELETE) {
+                key.numlock_vk = VK_DECIMAL;
+            }
+        }
+
+        // Multiple virtual keys, depending on modifiers: Ctrl+NumLock is Pause, Ctrl+ScrollLock is Break,
+        // Shift or Alt with the numeric keypad '*' is PrintScreen.
+        if ((vkf & KBDMULTIVK) != 0) {
+            switch (vk) {
+                case VK_NUMLOCK: key.multi_bits = KBDCTRL; key.multi_vk = VK_PAUSE; break;
+                case VK_SCROLL: key.multi_bits = KBDCTRL; key.multi_vk = VK_CANCEL; break;
+                case VK_MULTIPLY: key.multi_bits = KBDSHIFT | KBDALT; key.multi_vk = VK_SNAPSHOT; break;
+                default: break;
+            }
+        }
+
+        if (key.numlock_vk != 0 || key.multi_bits != 0 || key.digit != 0) {
+            _special.push_back(key);
+            _sc_special[index] = uint8_t(_special.size());
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Build the modifier tables: VK_TO_BIT and MODIFIERS, both directions.
+//----------------------------------------------------------------------------
+
+void KbdEngine::buildModifiers()
+{
+    _vk_bits.fill(0);
+    _mod_column.fill(SHFT_INVALID);
+
+    const MODIFIERS* mods = _tables.pCharModifiers;
+    if (mods == nullptr) {
+        return;
+    }
+
+    // Keep the first definition of a virtual key. Left and right keys have the bits of the generic key.
+    std::array<bool, 256> defined{};
+    for (const VK_TO_BIT* p = mods->pVkToBit; p != nullptr && p->Vk != 0; ++p) {
+        if (!defined[p->Vk]) {
+            defined[p->Vk] = true;
+            _vk_bits[p->Vk] = p->ModBits;
+        }
+    }
+    _vk_bits[VK_LSHIFT] = _vk_bits[VK_RSHIFT] = _vk_bits[VK_SHIFT];
+    _vk_bits[VK_LCONTROL] = _vk_bits[VK_RCONTROL] = _vk_bits[VK_CONTROL];
+    _vk_bits[VK_LMENU] = _vk_bits[VK_RMENU] = _vk_bits[VK_MENU];
+
+    // Modifier bits to modification number, for all values of the modifier bits.
+    for (size_t bits = 0; bits <= mods->wMaxModBits && bits < _mod_column.size(); ++bits) {
+        _mod_column[bits] = uint8_t(std::min<size_t>(mods->ModNumber[bits], SHFT_INVALID));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Build the "key slots", the keys which are tracked in the state.
+//----------------------------------------------------------------------------
+
+void KbdEngine::buildSlots()
+{
+    _vk_slot.fill(0);
+    _slot_bits.fill(0);
+    _slot_lock.fill(0);
+
+    // Loop on all virtual keys which are produced by a scan code.
+    for (uint16_t vkf : _sc_vk) {
+        const uint8_t vk = uint8_t(vkf & 0xFF);
+        const uint8_t bits = _vk_bits[vk];
+        if (bits != 0) {
+            // With AltGr, the right Alt key is seen as Control+Alt.
+            const bool altgr = vk == VK_RMENU && (_tables.fLocaleFlags & KLLF_ALTGR) != 0;
+            addSlot(vk, uint8_t(bits | (altgr ? KBDCTRL : 0)), 0);
+        }
+        else if (vk == VK_CAPITAL) {
+            addSlot(vk, 0, KLOCK_CAPITAL);
+        }
+        else if (vk == VK_NUMLOCK) {
+            addSlot(vk, 0, KLOCK_NUMLOCK);
+        }
+        else if (vk == VK_KANA) {
+            addSlot(vk, 0, KLOCK_KANA);
+        }
+    }
+
+    // Modifier bits of all combinations of pressed key slots, one byte of KbdState::keys at a time.
+    for (size_t half = 0; half < 2; ++half) {
+        for (size_t keys = 0; keys < 256; ++keys) {
+            uint8_t bits = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                if ((keys & (size_t(1) << i)) != 0) {
+                    bits |= _slot_bits[8 * half + i];
+                }
+            }
+            _keys_bits[256 * half + keys] = bits;
+        }
+    }
+}
+
+uint8_t KbdEngine::addSlot(uint8_t vk, uint8_t bits, uint8_t lock)
+{
+    if (_vk_slot[vk] == 0) {
+        // Find first unused slot.
+        size_t slot = 0;
+        while (slot < MAX_SLOTS && (_slot_bits[slot] != 0 || _slot_lock[slot] != 0)) {
+            ++slot;
+        }
+        if (slot < MAX_SLOTS && (bits != 0 || lock != 0)) {
+            _slot_bits[slot] = bits;
+            _slot_lock[slot] = lock;
+            _vk_slot[vk] = uint8_t(slot + 1);
+        }
+    }
+    return _vk_slot[vk];
+}
+
+
+//----------------------------------------------------------------------------
+// Build the flat character tables.
+//----------------------------------------------------------------------------
+
+void KbdEngine::buildCharacters()
+{
+    _vk_locks.fill(0);
+    _caps_column.fill(SHFT_INVALID);
+    _wch.clear();
+    _wch2.clear();
+
+    // Largest number of modification numbers.
+    for (const VK_TO_WCHAR_TABLE* tab = _tables.pVkToWcharTable; tab != nullptr && tab->pVkToWchars != nullptr; tab++) {
+        _columns = std::max<size_t>(_columns, tab->nModifications);
+    }
+    _cells = _columns + CAPS_CELLS + 1;
+    _wch.resize(256 * _cells, WCH_NONE);
+    _wch2.resize(256 * _cells, WCH_NONE);
+
+    // Cell for each combination of modifiers, without and with Caps Lock.
+    const size_t invalid = _cells - 1;
+    for (size_t bits = 0; bits < 256; ++bits) {
+        const size_t col = column(uint8_t(bits));
+        _cell[bits] = _cell[256 + bits] = uint8_t(col < _columns ? col : invalid);
+    }
+    for (size_t i = 0; i < CAPS_CELLS; ++i) {
+        _cell[256 + CAPS_MODIFIERS[i]] = uint8_t(_columns + i);
+    }
+
+    // The system uses the first entry for a virtual key, in table order.
+    std::array<bool, 256> defined{};
+    std::array<uint8_t, 256> attr{};
+
+    for (const VK_TO_WCHAR_TABLE* tab = _tables.pVkToWcharTable; tab != nullptr && tab->pVkToWchars != nullptr; tab++) {
+        const size_t count = tab->nModifications;
+        const size_t size = tab->cbSize;
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(tab->pVkToWchars);
+        for (;;) {
+            const VK_TO_WCHARS10* vtwc = reinterpret_cast<const VK_TO_WCHARS10*>(row);
+            if (vtwc->VirtualKey == 0) {
+                break;
+            }
+            const VK_TO_WCHARS10* next = reinterpret_cast<const VK_TO_WCHARS10*>(row + size);
+            const uint8_t vk = vtwc->VirtualKey;
+            if (vk != VK__none_ && !defined[vk]) {
+                defined[vk] = true;
+                attr[vk] = vtwc->Attributes;
+                for (size_t i = 0; i < count; ++i) {
+                    _wch[vk * _cells + i] = vtwc->wch[i];
+                    if (next->VirtualKey == VK__none_) {
+                        _wch2[vk * _cells + i] = next->wch[i];
+                    }
+                }
+            }
+            row += size;
+        }
+    }
+
+    // Apply the lock attributes of each key.
+    for (size_t vk = 0; vk < 256; ++vk) {
+        if ((attr[vk] & (CAPLOK | SGCAPS | CAPLOKALTGR)) != 0) {
+            _vk_locks[vk] |= KLOCK_CAPITAL;
+        }
+        if ((attr[vk] & KANALOK) != 0) {
+            _vk_locks[vk] |= KLOCK_KANA;
+        }
+
+        // Caps Lock cells: Caps Lock acts as Shift, or SGCAPS uses the following VK__none_ entry.
+        for (size_t i = 0; i < CAPS_CELLS; ++i) {
+            const uint8_t bits = CAPS_MODIFIERS[i];
+            const uint8_t others = uint8_t(bits & ~KBDSHIFT);
+            bool sgcaps = false;
+            size_t col = column(bits);
+            if ((attr[vk] & SGCAPS) != 0 && others == 0) {
+                sgcaps = true;
+            }
+            else if (((attr[vk] & CAPLOK) != 0 && others == 0) || ((attr[vk] & CAPLOKALTGR) != 0 && others == (KBDCTRL | KBDALT))) {
+                col = column(bits ^ KBDSHIFT);
+            }
+            if (col < _columns) {
+                const size_t from = vk * _cells + col;
+                const size_t to = vk * _cells + _columns + i;
+                _wch[to] = sgcaps ? _wch2[from] : _wch[from];
+                _wch2[to] = _wch2[from];
+                _caps_column[vk * CAPS_CELLS + i] = uint8_t(col);
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Update the state of tracked keys.
+//----------------------------------------------------------------------------
+
+bool KbdEngine::trackKey(KeyEvent ev, KbdState& state) const
+{
+    const size_t slot = _vk_slot[virtualKey(ev) & 0xFF];
+    if (slot == 0) {
+        return false;
+    }
+    const uint16_t mask = uint16_t(1 << (slot - 1));
+    if ((ev.flags & KEV_BREAK) != 0) {
+        state.keys &= ~mask;
+    }
+    else if ((state.keys & mask) == 0) {
+        state.keys |= mask;
+        const uint8_t lock = _slot_lock[slot - 1];
+        if (lock == KLOCK_CAPITAL && (_tables.fLocaleFlags & KLLF_SHIFTLOCK) != 0) {
+            // Shift lock: Caps Lock sets, Shift clears.
+            state.locks |= KLOCK_CAPITAL;
+        }
+        else {
+            state.locks ^= lock;
+        }
+        if ((_slot_bits[slot - 1] & KBDSHIFT) != 0 && (_tables.fLocaleFlags & KLLF_SHIFTLOCK) != 0) {
+            state.locks &= ~KLOCK_CAPITAL;
+        }
+    }
+    return true;
+}
+
+bool KbdEngine::isLockKey(uint8_t vk) const
+{
+    const size_t slot = _vk_slot[vk];
+    return slot != 0 && (_slot_lock[slot - 1] != 0 || ((_slot_bits[slot - 1] & KBDSHIFT) != 0 && (_tables.fLocaleFlags & KLLF_SHIFTLOCK) != 0));
+}
+
+
+//----------------------------------------------------------------------------
+// Translate one keystroke.
+//----------------------------------------------------------------------------
+
+size_t KbdEngine::translate(KeyEvent ev, KbdState& state, WCHAR* out) const
+{
+    // Numeric keypad, multiple virtual keys and Alt+numpad entries: one test for the common case.
+    const size_t index = prefixIndex(ev) + ev.scancode;
+    if ((_sc_special[index] | state.numpad) != 0) {
+        return translateSpecial(ev, state, out);
+    }
+
+    // Update the state of tracked keys. Only key presses generate characters.
+    if (trackKey(ev, state) || (ev.flags & KEV_BREAK) != 0) {
+        return 0;
+    }
+    return translateKey(uint8_t(_sc_vk[index] & 0xFF), state, out);
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a special keystroke or any keystroke during an Alt+numpad entry.
+//----------------------------------------------------------------------------
+
+size_t KbdEngine::translateSpecial(KeyEvent ev, KbdState& state, WCHAR* out) const
+{
+    const size_t index = _sc_special[prefixIndex(ev) + ev.scancode];
+    const SpecialKey key(index == 0 ? SpecialKey{0, 0, 0, 0} : _special[index - 1]);
+
+    // Tracked keys keep their virtual key. The Alt+numpad character is produced when Alt is released.
+    if (trackKey(ev, state)) {
+        size_t count = 0;
+        if (state.numpad != 0 && (modifiers(state) & KBDALT) == 0) {
+            const WCHAR wc = NumpadCharacter(state.code, (state.numpad & KNUM_ANSI) != 0);
+            if (wc != 0) {
+                // The Alt+numpad character is never composed with a dead key.
+                if (state.dead != 0) {
+                    out[count++] = state.dead;
+                    state.dead = 0;
+                }
+                out[count++] = wc;
+            }
+            state.numpad = state.code = 0;
+        }
+        return count;
+    }
+    if ((ev.flags & KEV_BREAK) != 0) {
+        return 0;
+    }
+
+    // Digits of the numeric keypad with Alt alone: accumulate the character code.
+    const uint8_t modbits = modifiers(state);
+    if (key.digit != 0 && modbits == KBDALT) {
+        const uint8_t digit = uint8_t(key.digit - 1);
+        if (state.numpad == 0) {
+            state.numpad = uint8_t(digit == 0 ? KNUM_ENTRY | KNUM_ANSI : KNUM_ENTRY);
+        }
+        state.code = uint8_t(state.code * 10 + digit);
+        return 0;
+    }
+
+    // Any other key cancels the Alt+numpad entry.
+    state.numpad = state.code = 0;
+
+    // NumLock without Shift selects the digits. Some modifiers select another virtual key.
+    uint8_t vk = uint8_t(_sc_vk[prefixIndex(ev) + ev.scancode] & 0xFF);
+    if (key.numlock_vk != 0 && (state.locks & KLOCK_NUMLOCK) != 0 && (modbits & KBDSHIFT) == 0) {
+        vk = key.numlock_vk;
+    }
+    else if ((modbits & key.multi_bits) != 0) {
+        vk = key.multi_vk;
+    }
+    return translateKey(vk, state, out);
+}
+
+
+//----------------------------------------------------------------------------
+// Character of an Alt+numpad code.
+//----------------------------------------------------------------------------
+
+WCHAR KbdEngine::NumpadCharacter(uint8_t code, bool ansi)
+{
+    if (!ansi) {
+        return OemCharacters[code];
+    }
+    else if (code >= 0x80 && code < 0xA0) {
+        return AnsiCharacters[code - 0x80];
+    }
+    else {
+        return WCHAR(code);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a key press on a virtual key.
+//----------------------------------------------------------------------------
+
+size_t KbdEngine::translateKey(uint8_t vk, KbdState& state, WCHAR* out) const
+{
+    if (vk == VK__none_) {
+        return 0;
+    }
+
+    // Apply the locks which are used by the key: Kana in the modifiers, Caps Lock in the cell.
+    const uint8_t locks = state.locks & _vk_locks[vk];
+    const uint8_t modbits = uint8_t(modifiers(state) | ((locks & KLOCK_KANA) != 0 ? KBDKANA : 0));
+    const size_t cell = _cell[(locks & KLOCK_CAPITAL) != 0 ? 256 + modbits : modbits];
+    const WCHAR wc = _wch[vk * _cells + cell];
+
+    size_t count = 0;
+    if (wc == WCH_NONE) {
+        // No character, a pending dead key remains pending.
+    }
+    else if (wc == WCH_DEAD) {
+        // The dead character is in the following VK__none_ entry.
+        const WCHAR accent = _wch2[vk * _cells + cell];
+        if (state.dead == 0) {
+            state.dead = accent;
+        }
+        else {
+            // Two dead keys in sequence: compose them or output both.
+            bool chained = false;
+            const WCHAR composed = compose(accent, state.dead, chained);
+            if (composed != 0 && chained) {
+                state.dead = composed;
+            }
+            else if (composed != 0) {
+                out[count++] = composed;
+                state.dead = 0;
+            }
+            else {
+                out[count++] = state.dead;
+                out[count++] = accent;
+                state.dead = 0;
+            }
+        }
+    }
+    else if (wc == WCH_LGTR) {
+        // A ligature is never composed with a dead key.
+        if (state.dead != 0) {
+            out[count++] = state.dead;
+            state.dead = 0;
+        }
+        count += ligature(vk, cell, out + count);
+    }
+    else if (state.dead != 0) {
+        bool chained = false;
+        const WCHAR composed = compose(wc, state.dead, chained);
+        if (composed != 0 && chained) {
+            state.dead = composed;
+        }
+        else if (composed != 0) {
+            out[count++] = composed;
+            state.dead = 0;
+        }
+        else {
+            out[count++] = state.dead;
+            out[count++] = wc;
+            state.dead = 0;
+        }
+    }
+    else {
+        out[count++] = wc;
+    }
+    return count;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the characters of a ligature.
+//----------------------------------------------------------------------------
+
+size_t KbdEngine::ligature(uint8_t vk, size_t cell, WCHAR* out) const
+{
+    // The Caps Lock cells use the ligature of their modification number.
+    const size_t col = cell < _columns ? cell : (cell < _columns + CAPS_CELLS ? _caps_column[vk * CAPS_CELLS + cell - _columns] : SHFT_INVALID);
+    const uint8_t* lg = reinterpret_cast<const uint8_t*>(_tables.pLigature);
+    for (; lg != nullptr && reinterpret_cast<const LIGATURE1*>(lg)->VirtualKey != 0; lg += _tables.cbLgEntry) {
+        const LIGATURE1* entry = reinterpret_cast<const LIGATURE1*>(lg);
+        if (entry->VirtualKey == vk && entry->ModificationNumber == col) {
+            size_t count = 0;
+            for (size_t i = 0; i < _tables.nLgMax && entry->wch[i] != WCH_NONE && count < MAX_OUTPUT - 1; ++i) {
+                out[count++] = entry->wch[i];
+            }
+            return count;
+        }
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a sequence of keystrokes.
+//----------------------------------------------------------------------------
+
+void KbdEngine::translate(const KeyEvent* events, size_t count, KbdState& state, std::vector<WCHAR>& out) const
+{
+    WCHAR buffer[MAX_OUTPUT];
+    for (size_t i = 0; i < count; ++i) {
+        const size_t n = translate(events[i], state, buffer);
+        out.insert(out.end(), buffer, buffer + n);
+    }
+}
@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Portable keystroke to Unicode translation engine, using the tables of
+// a keyboard layout (KBDTABLES). Emulates ToUnicodeEx() without any call
+// to the Windows API.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "deadkeys.h"
+
+// One keystroke event, as recorded from the keyboard.
+struct KeyEvent
+{
+    uint8_t scancode;  // Scan code, without prefix.
+    uint8_t flags;     // Bitmask of KEV_xxx.
+};
+
+constexpr uint8_t KEV_BREAK = 0x01;  // Key release (break code). Key press (make code) otherwise.
+constexpr uint8_t KEV_E0    = 0x02;  // Scan code with E0 prefix.
+constexpr uint8_t KEV_E1    = 0x04;  // Scan code with E1 prefix.
+
+// Lock bits in a translation state.
+constexpr uint8_t KLOCK_CAPITAL = 0x01;
+constexpr uint8_t KLOCK_NUMLOCK = 0x02;
+constexpr uint8_t KLOCK_KANA    = 0x04;
+
+// Alt+numpad character entry in a translation state.
+constexpr uint8_t KNUM_ENTRY = 0x01;  // Digits were typed on the numeric keypad with Alt.
+constexpr uint8_t KNUM_ANSI  = 0x02;  // The first digit was zero: ANSI code page, OEM code page otherwise.
+
+// Translation state, carried from one keystroke to the next one.
+// A zero-initialized state means no key pressed, no lock, no pending dead key, no Alt+numpad entry.
+struct KbdState
+{
+    uint16_t keys;    // Currently pressed modifier and lock keys, bitmask of "key slots" in the engine.
+    uint8_t  locks;   // Active locks, bitmask of KLOCK_xxx.
+    uint8_t  numpad;  // Alt+numpad entry in progress, bitmask of KNUM_xxx.
+    WCHAR    dead;    // Pending dead key character, zero if none.
+    uint8_t  code;    // Alt+numpad character code being typed, modulo 256.
+    uint8_t  spare;   // Unused, keep zero.
+
+    bool operator==(const KbdState& other) const = default;
+};
+
+// Translation engine for one keyboard layout.
+class KbdEngine
+{
+public:
+    // Constructor. The tables must remain valid during the life of the engine.
+    KbdEngine(const KBDTABLES&);
+
+    // Maximum number of characters for one keystroke: a pending dead key plus a ligature.
+    static constexpr size_t MAX_OUTPUT = 17;
+
+    // Maximum number of "key slots", keys which are tracked in KbdState.
+    static constexpr size_t MAX_SLOTS = 16;
+
+    // Translate one keystroke. Store the characters in 'out' (at least MAX_OUTPUT).
+    // Return the number of characters.
+    size_t translate(KeyEvent, KbdState&, WCHAR* out) const;
+
+    // Translate a sequence of keystrokes. The characters are appended to 'out'.
+    void translate(const KeyEvent* events, size_t count, KbdState&, std::vector<WCHAR>& out) const;
+
+    // Update the tracked keys and locks of the state for a keystroke, as done by translate().
+    // Return false if the key is not tracked, the state is unchanged.
+    bool trackKey(KeyEvent, KbdState&) const;
+
+    // Check if pressing a virtual key may change the locks of a state.
+    bool isLockKey(uint8_t vk) const;
+
+    // Get the 16-bit virtual key (with KBDEXT and other flags) for a keystroke, without NumLock or modifiers.
+    // Return VK__none_ if the scan code is not mapped.
+    uint16_t virtualKey(KeyEvent ev) const { return _sc_vk[prefixIndex(ev) + ev.scancode]; }
+
+    // Check if the virtual key of a keystroke depends on the state (KBDNUMPAD and KBDMULTIVK keys)
+    // or if the keystroke is a digit for Alt+numpad entries.
+    bool isSpecialKey(KeyEvent ev) const { return _sc_special[prefixIndex(ev) + ev.scancode] != 0; }
+
+    // Get the modifier bits (KBDSHIFT, KBDCTRL, KBDALT, etc) for the current state, without locks.
+    uint8_t modifiers(const KbdState& state) const { return _keys_bits[state.keys & 0xFF] | _keys_bits[256 + (state.keys >> 8)]; }
+
+    // Get the "modification number" (column in VK_TO_WCHARS) for a modifier mask.
+    // Return SHFT_INVALID if the combination of modifiers is not used.
+    size_t column(uint8_t modbits) const { return _mod_column[modbits]; }
+
+    // Get the modifier bits of a virtual key, as defined in VK_TO_BIT, zero if not a modifier.
+    // Left and right keys (VK_LSHIFT, VK_RSHIFT, etc) have the bits of the generic key (VK_SHIFT).
+    uint8_t modifierBits(uint8_t vk) const { return _vk_bits[vk]; }
+
+    // Get the character for a virtual key and a cell, ignoring dead keys. The first cells are the
+    // modification numbers. Return WCH_NONE, WCH_DEAD or WCH_LGTR for special cases.
+    WCHAR character(uint8_t vk, size_t cell) const { return cell < _cells ? _wch[vk * _cells + cell] : WCH_NONE; }
+
+    // Get the pending dead key character for a virtual key and a cell,
+    // when character() returns WCH_DEAD. Return zero otherwise.
+    WCHAR deadCharacter(uint8_t vk, size_t cell) const { return character(vk, cell) == WCH_DEAD ? _wch2[vk * _cells + cell] : 0; }
+
+    // Compiled dead key compositions.
+    const DeadKeyIndex& deadKeys() const { return _dead_keys; }
+
+    // Number of modification numbers (columns) in the character tables.
+    size_t columns() const { return _columns; }
+
+    // Number of cells per virtual key in the character tables: all modification numbers, then
+    // the Caps Lock variants of the modifiers which depend on Caps Lock, then one unused cell,
+    // always WCH_NONE, for invalid combinations of modifiers.
+    size_t cells() const { return _cells; }
+
+    // Get the cell for modifier bits, with or without Caps Lock. For the keys which are not
+    // sensitive to Caps Lock, the Caps Lock cells contain the same characters as without it.
+    size_t cell(uint8_t modbits, bool caps) const { return _cell[caps ? 256 + modbits : modbits]; }
+
+    // Check if a virtual key is tracked in KbdState (modifier or lock key).
+    bool isTracked(uint8_t vk) const { return _vk_slot[vk] != 0; }
+
+    // Get the key slot of a virtual key plus one, zero if the key is not tracked.
+    size_t keySlot(uint8_t vk) const { return _vk_slot[vk]; }
+
+    // Get the modifier bits and the lock bit (KLOCK_xxx) of a key slot.
+    uint8_t slotBits(size_t slot) const { return slot < MAX_SLOTS ? _slot_bits[slot] : 0; }
+    uint8_t slotLock(size_t slot) const { return slot < MAX_SLOTS ? _slot_lock[slot] : 0; }
+
+    // Get the locks which change the characters of a virtual key, bitmask of KLOCK_xxx.
+    uint8_t keyLocks(uint8_t vk) const { return _vk_locks[vk]; }
+
+    // Get the characters of a ligature for a virtual key and a cell, when character() returns WCH_LGTR.
+    // Store the characters in 'out' (at least MAX_OUTPUT) and return the number of characters.
+    size_t ligature(uint8_t vk, size_t cell, WCHAR* out) const;
+
+    // A keystroke with state-dependent processing, compiled from the flags in the scan code tables.
+    struct SpecialKey
+    {
+        uint8_t numlock_vk;  // Virtual key with NumLock and without Shift (KBDNUMPAD), zero if none.
+        uint8_t multi_bits;  // Modifier bits which select multi_vk (KBDMULTIVK), zero if none.
+        uint8_t multi_vk;    // Alternate virtual key with multi_bits.
+        uint8_t digit;       // Alt+numpad digit plus one, zero if not a digit.
+    };
+
+    // Get the special processing of a keystroke, null if isSpecialKey() is false.
+    const SpecialKey* specialKey(KeyEvent ev) const
+    {
+        const size_t index = _sc_special[prefixIndex(ev) + ev.scancode];
+        return index == 0 ? nullptr : &_special[index - 1];
+    }
+
+    // Get the character of an Alt+numpad code, in the ANSI (1252) or OEM (437) code page. Zero if none.
+    static WCHAR NumpadCharacter(uint8_t code, bool ansi);
+
+    // Index of the scan code table for the prefix of a keystroke: 0, 256, 512 or 768.
+    static size_t prefixIndex(KeyEvent ev) { return size_t((ev.flags & (KEV_E0 | KEV_E1)) >> 1) << 8; }
+
+    // Access to the underlying tables.
+    const KBDTABLES& tables() const { return _tables; }
+
+private:
+    // Modifier bits which have a Caps Lock variant: no modifier and AltGr, with and without Shift.
+    static constexpr size_t CAPS_CELLS = 4;
+    static constexpr uint8_t CAPS_MODIFIERS[CAPS_CELLS] = {0, KBDSHIFT, KBDCTRL | KBDALT, KBDSHIFT | KBDCTRL | KBDALT};
+
+    const KBDTABLES&            _tables;
+    std::array<uint16_t, 4*256> _sc_vk;      // Scan code to virtual key, by prefix: none, E0, E1, invalid.
+    std::array<uint8_t, 4*256>  _sc_special; // Index + 1 in _special, zero for other keystrokes.
+    std::vector<SpecialKey>     _special;    // Keystrokes with state-dependent processing.
+    std::array<uint8_t, 256>    _vk_slot;    // Key slot + 1 for tracked keys, zero otherwise.
+    std::array<uint8_t, 256>    _vk_locks;   // Locks which change the characters, bitmask of KLOCK_xxx, by virtual key.
+    std::array<uint8_t, MAX_SLOTS>  _slot_bits;  // Modifier bits of each key slot.
+    std::array<uint8_t, MAX_SLOTS>  _slot_lock;  // Lock bit toggled by each key slot.
+    std::array<uint8_t, 256>    _vk_bits;    // Modifier bits by virtual key, from VK_TO_BIT.
+    std::array<uint8_t, 2*256>  _keys_bits;  // Modifier bits of pressed key slots: low byte, then high byte of KbdState::keys.
+    std::array<uint8_t, 256>    _mod_column; // Modification number by modifier bits, from MODIFIERS, SHFT_INVALID if unused.
+    std::array<uint8_t, 2*256>  _cell;       // Cell by [Caps Lock][modifier bits].
+    std::array<uint8_t, 256*CAPS_CELLS> _caps_column;  // Modification number of the Caps Lock cells, by [vk][cell], for ligatures.
+    size_t                      _columns;    // Maximum number of modification numbers.
+    size_t                      _cells;      // Number of cells per virtual key.
+    std::vector<WCHAR>          _wch;        // Characters, indexed by [vk][cell].
+    std::vector<WCHAR>          _wch2;       // Characters of the following VK__none_ entry (dead keys, SGCAPS).
+    DeadKeyIndex                _dead_keys;  // Compiled dead key compositions.
+
+    // Compose a character with a pending dead key. Return zero if there is no composition.
+    WCHAR compose(WCHAR base, WCHAR accent, bool& chained) const { return _dead_keys.compose(base, accent, chained); }
+
+    // Translate a key press on a virtual key, after the update of tracked keys.
+    size_t translateKey(uint8_t vk, KbdState&, WCHAR* out) const;
+
+    // Translate a special keystroke or any keystroke during an Alt+numpad entry.
+    size_t translateSpecial(KeyEvent, KbdState&, WCHAR* out) const;
+
+    // Build the tables.
+    void buildScanCodes();
+    void buildSpecialKeys();
+    void buildModifiers();
+    void buildSlots();
+    void buildCharacters();
+    uint8_t addSlot(uint8_t vk, uint8_t bits, uint8_t lock);
+};
@@ -0,0 +1,169 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Load the tables of a keyboard layout DLL, without executing its code,
+// or the tables of a compiled keyboard layout file (.wklbin).
+//
+//----------------------------------------------------------------------------
+
+#include "kbdfile.h"
+#include "winutils.h"
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+KbdFile::KbdFile(Error& err) :
+    _err(err),
+    _filename(),
+    _image(),
+    _binary(),
+    _tables(nullptr)
+{
+}
+
+KbdFile::~KbdFile()
+{
+    unload();
+}
+
+
+//----------------------------------------------------------------------------
+// Resolve a keyboard name or file name as a DLL file name.
+//----------------------------------------------------------------------------
+
+WString KbdFile::ResolveName(const WString& name)
+{
+#if defined(_WIN32)
+    if (name.find_first_of(L":\\/.") == WString::npos) {
+        // No separator, must be a keyboard name, not a DLL file name.
+        return GetSystem32() + L"\\kbd" + name + L".dll";
+    }
+#endif
+    return name;
+}
+
+
+//----------------------------------------------------------------------------
+// Expand a list of keyboard names, file names, directories or wildcards.
+//----------------------------------------------------------------------------
+
+void KbdFile::ExpandNames(WStringList& files, const WStringList& names)
+{
+    files.clear();
+    for (const auto& name : names) {
+        // Get a directory and wildcards, if there are some.
+        WString dir;
+        WStringList patterns;
+        if (IsDirectory(name)) {
+            dir = name;
+            patterns.push_back(L"kbd*.dll");
+            patterns.push_back(L"*" WKLBIN_EXTENSION);
+        }
+        else if (name.find_first_of(L"*?") != WString::npos) {
+            const size_t sep = name.find_last_of(L":\\/");
+            dir = sep == WString::npos ? L"." : name.substr(0, sep + 1);
+            patterns.push_back(name.substr(sep == WString::npos ? 0 : sep + 1));
+        }
+        else {
+            files.push_back(ResolveName(name));
+            continue;
+        }
+
+        // Search all files matching the wildcards.
+        WStringList dir_files;
+        for (const auto& pattern : patterns) {
+            WStringList pattern_files;
+            SearchFiles(pattern_files, dir, pattern);
+            dir_files.splice(dir_files.end(), pattern_files);
+        }
+        dir_files.sort();
+        if (!dir.empty() && dir.back() != L'\\' && dir.back() != L'/' && dir.back() != L':') {
+            dir.push_back(PATH_SEPARATOR);
+        }
+        for (const auto& file : dir_files) {
+            files.push_back(dir + file);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Load a keyboard layout DLL or .wklbin file.
+//----------------------------------------------------------------------------
+
+bool KbdFile::load(const WString& name)
+{
+    unload();
+    _filename = ResolveName(name);
+
+    // A compiled keyboard layout file is directly mapped and used, there is no code to decode.
+    if (WklBinFile::IsWklBinName(_filename)) {
+        if (!_binary.load(FilePath(_filename))) {
+            _err.error(_filename + ": " + _binary.errorMessage());
+            return false;
+        }
+        _tables = _binary.kbdTables();
+        return true;
+    }
+
+    // Map the DLL file in memory, the same way the system loader would do, without executing it.
+    if (!_image.load(FilePath(_filename))) {
+        _err.error(_filename + ": " + _image.errorMessage());
+        return false;
+    }
+
+    // Get the DLL entry point.
+    const uint32_t proc_rva = _image.exportRva(KBD_DLL_ENTRY_NAME);
+    if (proc_rva == 0) {
+        _err.error("cannot find " KBD_DLL_ENTRY_NAME " in " + _filename);
+        unload();
+        return false;
+    }
+
+    // The entry point profile is: PKBDTABLES KbdLayerDescriptor()
+    // Decode its code to find the address of the keyboard tables.
+    // A zero RVA means not found, it must not be used: RVA 0 is the DOS header.
+    const uint32_t tables_rva = _image.returnedAddressRva(proc_rva);
+    if (tables_rva == 0) {
+        _err.error("cannot locate keyboard tables from " KBD_DLL_ENTRY_NAME "() in " + _filename);
+        unload();
+        return false;
+    }
+
+    // The pointers in the tables are directly usable when they have the same size as in this process.
+    // Otherwise, the tables are translated into a compiled layout in memory, with 32-bit offsets.
+    if (_image.isRelocated()) {
+        _tables = _image.get<KBDTABLES>(tables_rva);
+    }
+    else if (_binary.load(_image, tables_rva)) {
+        _tables = _binary.kbdTables();
+    }
+    else {
+        _err.error(_filename + ": " + _binary.errorMessage());
+        unload();
+        return false;
+    }
+    if (_tables == nullptr) {
+        _err.error("cannot locate keyboard tables from " KBD_DLL_ENTRY_NAME "() in " + _filename);
+        unload();
+        return false;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Unload the keyboard layout DLL.
+//----------------------------------------------------------------------------
+
+void KbdFile::unload()
+{
+    _image.unload();
+    _binary.unload();
+    _tables = nullptr;
+}
@@ -0,0 +1,59 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Load the tables of a keyboard layout DLL, without executing its code,
+// or the tables of a compiled keyboard layout file (.wklbin).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "error.h"
+#include "pefile.h"
+#include "wklbin.h"
+
+class KbdFile
+{
+public:
+    // Constructor. Specify where to report errors.
+    KbdFile(Error&);
+    ~KbdFile();
+
+    // Load a keyboard layout DLL or .wklbin file. Unload the previous one.
+    // The name is either a file name or a keyboard name, for instance "fr" for C:\Windows\System32\kbdfr.dll
+    // (keyboard names are only resolved on Windows).
+    // Files with a .wklbin extension are loaded as compiled keyboard layout files.
+    bool load(const WString& name);
+
+    // Unload the keyboard layout DLL.
+    void unload();
+
+    // Check if a keyboard layout DLL is loaded.
+    bool isLoaded() const { return _tables != nullptr; }
+
+    // Access the loaded keyboard layout. Null or empty when not loaded.
+    const KBDTABLES* tables() const { return _tables; }
+    const WString& fileName() const { return _filename; }
+    const PeFile& image() const { return _image; }
+    const WklBinFile& binary() const { return _binary; }
+
+    // Resolve a keyboard name or file name as a DLL file name.
+    static WString ResolveName(const WString& name);
+
+    // Expand a list of keyboard names, file names, directories or wildcards into a list of file names.
+    // A directory is expanded into all kbd*.dll and *.wklbin files it contains.
+    static void ExpandNames(WStringList& files, const WStringList& names);
+
+private:
+    Error&           _err;
+    WString          _filename;
+    PeFile           _image;
+    WklBinFile       _binary;
+    const KBDTABLES* _tables;
+
+    // Inaccessible operations.
+    KbdFile(const KbdFile&) = delete;
+    KbdFile& operator=(const KbdFile&) = delete;
+};
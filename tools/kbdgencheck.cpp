@@ -0,0 +1,201 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Comparison harness for a specialized translator, as generated by the
+// command "kbdreverse -s", with the generic translation engine on the
+// same keyboard layout (DLL or .wklbin file): identical output and state,
+// throughput.
+//
+// This program is not part of the Visual Studio solution because it is
+// compiled with one generated header. It is run on each layout, and on the
+// compiled project sources, by the round-trip verification in
+// tools/kbdreverse-test/roundtrip.py. Example on Linux:
+//
+//   host/kbdreverse kbdfrapple.dll -s -o kbdfrapple.h  (host build of tools/Makefile)
+//   g++ -std=c++20 -O2 -Itools/portable -Itools -I. -DKBDGEN_HEADER='"kbdfrapple.h"'
+//       -DKBDGEN_NAMESPACE=kbdfrapple tools/kbdgencheck.cpp tools/kbdengine.cpp
+//       tools/deadkeys.cpp tools/pefile.cpp tools/mappedfile.cpp tools/wklbin.cpp -o kbdgencheck
+//   ./kbdgencheck kbdfrapple.dll
+//
+//---------------------------------------------------------------------------
+
+#include "kbdengine.h"
+#include "pefile.h"
+#include "wklbin.h"
+#include KBDGEN_HEADER
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstring>
+
+namespace gen = KBDGEN_NAMESPACE;
+
+static_assert(sizeof(gen::State) == sizeof(KbdState), "generated state must have the same layout as KbdState");
+
+
+//---------------------------------------------------------------------------
+// Build a reproducible keystroke sequence which exercises all paths:
+// modifiers, locks, dead keys, numeric keypad, Alt+numpad entries.
+//---------------------------------------------------------------------------
+
+static void BuildSequence(std::vector<KeyEvent>& events, size_t keystrokes)
+{
+    std::minstd_rand rand(1);  // fixed seed
+    const auto tap = [&events](uint8_t sc, uint8_t flags) {
+        events.push_back(KeyEvent{sc, flags});
+        events.push_back(KeyEvent{sc, uint8_t(flags | KEV_BREAK)});
+    };
+
+    events.clear();
+    for (size_t i = 0; i < keystrokes; ++i) {
+        const unsigned int dice = rand() % 100;
+        if (dice < 5) {
+            // Alt+numpad entry, sometimes interrupted by another key.
+            events.push_back(KeyEvent{0x38, 0});
+            for (unsigned int n = 1 + rand() % 4; n > 0; --n) {
+                tap(uint8_t(0x47 + rand() % 13), 0);
+            }
+            if (rand() % 5 == 0) {
+                tap(0x1E, 0);
+            }
+            events.push_back(KeyEvent{0x38, KEV_BREAK});
+        }
+        else if (dice < 7) {
+            tap(0x3A, 0);  // Caps Lock
+        }
+        else if (dice < 8) {
+            tap(0x45, 0);  // NumLock
+        }
+        else if (dice < 10) {
+            events.push_back(KeyEvent{uint8_t(rand()), uint8_t(rand() % 8)});  // anything
+        }
+        else {
+            // Alphanumeric block or numeric keypad, with Shift, AltGr, Ctrl.
+            const uint8_t sc = rand() % 4 == 0 ? uint8_t(0x37 + rand() % 29) : uint8_t(0x02 + rand() % 0x38);
+            const bool shift = dice >= 10 && dice < 30;
+            const bool altgr = dice >= 30 && dice < 45;
+            const bool ctrl = dice >= 45 && dice < 48;
+            if (shift) {
+                events.push_back(KeyEvent{0x2A, 0});
+            }
+            if (altgr) {
+                events.push_back(KeyEvent{0x38, KEV_E0});
+            }
+            if (ctrl) {
+                events.push_back(KeyEvent{0x1D, 0});
+            }
+            tap(sc, 0);
+            if (ctrl) {
+                events.push_back(KeyEvent{0x1D, KEV_BREAK});
+            }
+            if (altgr) {
+                events.push_back(KeyEvent{0x38, KEV_E0 | KEV_BREAK});
+            }
+            if (shift) {
+                events.push_back(KeyEvent{0x2A, KEV_BREAK});
+            }
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "syntax: %s kbd-dll-or-wklbin [keystrokes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t keystrokes = argc > 2 ? size_t(std::atol(argv[2])) : 1000000;
+
+    // Load the keyboard tables, without executing the DLL.
+    const std::filesystem::path filename(argv[1]);
+    PeFile pe;
+    WklBinFile bin;
+    const KBDTABLES* tables = nullptr;
+    if (filename.extension() == ".wklbin") {
+        if (!bin.load(filename)) {
+            std::fprintf(stderr, "error loading %s: %s\n", argv[1], bin.errorMessage().c_str());
+            return EXIT_FAILURE;
+        }
+        tables = bin.kbdTables();
+    }
+    else {
+        if (!pe.load(filename)) {
+            std::fprintf(stderr, "error loading %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        // A zero RVA means not found (RVA 0 is the DOS header, not the tables).
+        const uint32_t proc_rva = pe.exportRva("KbdLayerDescriptor");
+        const uint32_t tables_rva = proc_rva == 0 ? 0 : pe.returnedAddressRva(proc_rva);
+        if (tables_rva != 0 && pe.isRelocated()) {
+            tables = pe.get<KBDTABLES>(tables_rva);
+        }
+        else if (tables_rva != 0 && bin.load(pe, tables_rva)) {
+            // Other pointer size: use the tables through their serialized form.
+            tables = bin.kbdTables();
+        }
+    }
+    if (tables == nullptr) {
+        std::fprintf(stderr, "no keyboard tables in %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    const KbdEngine engine(*tables);
+
+    std::vector<KeyEvent> events;
+    BuildSequence(events, keystrokes);
+
+    // Correctness: same characters and same state after each keystroke.
+    size_t errors = 0;
+    KbdState state1{};
+    gen::State state2{};
+    for (size_t i = 0; i < events.size() && errors < 10; ++i) {
+        WCHAR out1[KbdEngine::MAX_OUTPUT];
+        char16_t out2[gen::MAX_OUTPUT];
+        const size_t n1 = engine.translate(events[i], state1, out1);
+        const size_t n2 = gen::Translate(events[i].scancode, events[i].flags, state2, out2);
+        bool same = n1 == n2 && std::memcmp(&state1, &state2, sizeof(state1)) == 0;
+        for (size_t k = 0; same && k < n1; ++k) {
+            same = out1[k] == out2[k];
+        }
+        if (!same) {
+            std::printf("keystroke %zu (%02X, flags %02X): engine %zu chars, generated %zu chars, state differs: %s\n",
+                        i, events[i].scancode, events[i].flags, n1, n2, std::memcmp(&state1, &state2, sizeof(state1)) == 0 ? "no" : "yes");
+            errors++;
+            state2 = *reinterpret_cast<const gen::State*>(&state1);
+        }
+    }
+
+    // Throughput, on the complete sequence.
+    size_t count1 = 0;
+    size_t count2 = 0;
+    const auto start1 = std::chrono::steady_clock::now();
+    {
+        KbdState state{};
+        WCHAR out[KbdEngine::MAX_OUTPUT];
+        for (const auto& ev : events) {
+            count1 += engine.translate(ev, state, out);
+        }
+    }
+    const auto start2 = std::chrono::steady_clock::now();
+    {
+        gen::State state{};
+        char16_t out[gen::MAX_OUTPUT];
+        for (const auto& ev : events) {
+            count2 += gen::Translate(ev.scancode, ev.flags, state, out);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double ns1 = std::chrono::duration<double, std::nano>(start2 - start1).count() / double(events.size());
+    const double ns2 = std::chrono::duration<double, std::nano>(end - start2).count() / double(events.size());
+
+    std::printf("%s: %zu events, %zu characters, %zu errors\n", argv[1], events.size(), count1, errors);
+    std::printf("engine: %.2f ns/event, generated: %.2f ns/event, speedup: %.2f\n", ns1, ns2, ns2 > 0.0 ? ns1 / ns2 : 0.0);
+    return errors == 0 && count1 == count2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,320 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Translate one keystroke sequence through many keyboard layouts at once.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdpack.h"
+#include <bit>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define KBDPACK_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+// With GCC and clang, the vector instructions are enabled function by function.
+// The rest of the code remains compatible with all CPU's.
+#if defined(KBDPACK_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define KBDPACK_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define KBDPACK_TARGET(isa)
+#endif
+
+
+//----------------------------------------------------------------------------
+// Constructor: build the packed tables.
+//----------------------------------------------------------------------------
+
+KbdPack::KbdPack(const std::vector<const KBDTABLES*>& layouts) :
+    _engines(),
+    _lanes(0),
+    _vk(),
+    _wch(),
+    _base()
+{
+    for (const KBDTABLES* tables : layouts) {
+        _engines.emplace_back(*tables);
+    }
+    _lanes = (_engines.size() + LANE_GROUP - 1) / LANE_GROUP * LANE_GROUP;
+    _vk.resize(4 * 256 * _lanes, 0);
+    _base.resize(_lanes, 0);
+
+    // The padding lanes use virtual key zero and the first character, always WCH_NONE.
+    _wch.push_back(WCH_NONE);
+
+    for (size_t lane = 0; lane < _engines.size(); ++lane) {
+        const KbdEngine& engine(_engines[lane]);
+
+        for (size_t index = 0; index < 4 * 256; ++index) {
+            const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((index >> 8) << 1)};
+            // Special keys (numeric keypad, Alt+numpad digits) always use the slow path, as VK__none_.
+            _vk[index * _lanes + lane] = engine.isSpecialKey(ev) ? uint8_t(VK__none_) : uint8_t(engine.virtualKey(ev) & 0xFF);
+        }
+
+        // All cells of the engine, including Caps Lock and invalid combinations of modifiers.
+        _base[lane] = int32_t(_wch.size());
+        for (size_t cell = 0; cell < engine.cells(); ++cell) {
+            for (size_t vk = 0; vk < 256; ++vk) {
+                _wch.push_back(engine.isTracked(uint8_t(vk)) || vk == VK__none_ ? WCH_SLOW : engine.character(uint8_t(vk), cell));
+            }
+        }
+    }
+
+    // The gather instructions load 32 bits at the index of a 16-bit character.
+    _wch.push_back(WCH_NONE);
+}
+
+
+//----------------------------------------------------------------------------
+// Supported kernels.
+//----------------------------------------------------------------------------
+
+bool KbdPack::IsSupported(Kernel kernel)
+{
+    switch (kernel) {
+        case KERNEL_AUTO:
+        case KERNEL_SCALAR:
+            return true;
+#if defined(KBDPACK_X86) && defined(_MSC_VER)
+        case KERNEL_SSE4: {
+            int regs[4];
+            __cpuid(regs, 1);
+            return (regs[2] & (1 << 19)) != 0;
+        }
+        case KERNEL_AVX2: {
+            // AVX2 in the CPU, AVX state saved by the operating system.
+            int regs[4];
+            __cpuid(regs, 1);
+            if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+                return false;
+            }
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+        }
+#elif defined(KBDPACK_X86)
+        case KERNEL_SSE4:
+            return __builtin_cpu_supports("sse4.1");
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+KbdPack::Kernel KbdPack::BestKernel()
+{
+    return IsSupported(KERNEL_AVX2) ? KERNEL_AVX2 : (IsSupported(KERNEL_SSE4) ? KERNEL_SSE4 : KERNEL_SCALAR);
+}
+
+const wchar_t* KbdPack::KernelName(Kernel kernel)
+{
+    switch (kernel) {
+        case KERNEL_AUTO: return L"auto";
+        case KERNEL_SCALAR: return L"scalar";
+        case KERNEL_SSE4: return L"SSE4.1";
+        case KERNEL_AVX2: return L"AVX2";
+        default: return L"unknown";
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a sequence of keystrokes through all layouts.
+//----------------------------------------------------------------------------
+
+void KbdPack::translate(const KeyEvent* events,
+                        size_t count,
+                        std::vector<KbdState>& states,
+                        std::vector<std::vector<WCHAR>>& out,
+                        Kernel kernel) const
+{
+    if (states.size() < _engines.size()) {
+        states.resize(_engines.size(), KbdState());
+    }
+    if (out.size() < _engines.size()) {
+        out.resize(_engines.size());
+    }
+
+    // The padding lanes always point to the first WCH_NONE and never use the slow path.
+    Lanes lanes;
+    lanes.offset.resize(_lanes, 0);
+    lanes.slow.resize(_lanes, 0);
+    for (size_t lane = 0; lane < _engines.size(); ++lane) {
+        refresh(lane, states[lane], lanes);
+    }
+
+    if (kernel == KERNEL_AUTO || !IsSupported(kernel)) {
+        kernel = BestKernel();
+    }
+    switch (kernel) {
+        case KERNEL_AVX2:
+            translateAVX2(events, count, states, out, lanes);
+            break;
+        case KERNEL_SSE4:
+            translateSSE4(events, count, states, out, lanes);
+            break;
+        default:
+            translateScalar(events, count, states, out, lanes);
+            break;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Common processing for all kernels.
+//----------------------------------------------------------------------------
+
+void KbdPack::refresh(size_t lane, const KbdState& state, Lanes& lanes) const
+{
+    // Caps Lock has its own cells. A Kana lock may change the modifiers, key by key.
+    // During an Alt+numpad entry, any key press may end or cancel the entry.
+    const KbdEngine& engine(_engines[lane]);
+    const size_t cell = engine.cell(engine.modifiers(state), (state.locks & KLOCK_CAPITAL) != 0);
+    lanes.offset[lane] = _base[lane] + int32_t(cell * 256);
+    lanes.slow[lane] = state.dead != 0 || state.numpad != 0 || (state.locks & KLOCK_KANA) != 0 ? -1 : 0;
+}
+
+void KbdPack::slowPath(size_t lane, KeyEvent ev, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    WCHAR buffer[KbdEngine::MAX_OUTPUT];
+    const KbdState previous(states[lane]);
+    const size_t count = _engines[lane].translate(ev, states[lane], buffer);
+    out[lane].insert(out[lane].end(), buffer, buffer + count);
+    if (states[lane] != previous) {
+        refresh(lane, states[lane], lanes);
+    }
+}
+
+inline void KbdPack::flush(size_t first, uint32_t chars, uint32_t slow, const int32_t* wc, KeyEvent ev,
+                           std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    while (chars != 0) {
+        const int bit = std::countr_zero(chars);
+        out[first + bit].push_back(WCHAR(wc[bit]));
+        chars &= chars - 1;
+    }
+    while (slow != 0) {
+        const int bit = std::countr_zero(slow);
+        slowPath(first + bit, ev, states, out, lanes);
+        slow &= slow - 1;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Scalar kernel, on the same packed tables.
+//----------------------------------------------------------------------------
+
+void KbdPack::translateScalar(const KeyEvent* events, size_t count, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    const size_t layouts = _engines.size();
+    for (size_t i = 0; i < count; ++i) {
+        const KeyEvent ev = events[i];
+        const bool make = (ev.flags & KEV_BREAK) == 0;
+        const uint8_t* vk = &_vk[(KbdEngine::prefixIndex(ev) + ev.scancode) * _lanes];
+        for (size_t lane = 0; lane < layouts; ++lane) {
+            const WCHAR wc = _wch[size_t(lanes.offset[lane]) + vk[lane]];
+            if (lanes.slow[lane] != 0 || wc > WCH_NONE) {
+                slowPath(lane, ev, states, out, lanes);
+            }
+            else if (make && wc != WCH_NONE) {
+                out[lane].push_back(wc);
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// SSE 4.1 kernel, 4 lanes at a time, emulated gather.
+//----------------------------------------------------------------------------
+
+#if defined(KBDPACK_X86)
+
+KBDPACK_TARGET("sse4.1")
+void KbdPack::translateSSE4(const KeyEvent* events, size_t count, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    const WCHAR* wch = _wch.data();
+    const __m128i none = _mm_set1_epi32(WCH_NONE);
+    alignas(16) int32_t wc[4];
+
+    for (size_t i = 0; i < count; ++i) {
+        const KeyEvent ev = events[i];
+        const bool make = (ev.flags & KEV_BREAK) == 0;
+        const uint8_t* vk = &_vk[(KbdEngine::prefixIndex(ev) + ev.scancode) * _lanes];
+        for (size_t first = 0; first < _lanes; first += 4) {
+            int32_t vk4 = 0;
+            std::memcpy(&vk4, vk + first, sizeof(vk4));
+            const __m128i index = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes.offset[first])),
+                                                _mm_cvtepu8_epi32(_mm_cvtsi32_si128(vk4)));
+            const __m128i chars = _mm_setr_epi32(wch[_mm_extract_epi32(index, 0)],
+                                                 wch[_mm_extract_epi32(index, 1)],
+                                                 wch[_mm_extract_epi32(index, 2)],
+                                                 wch[_mm_extract_epi32(index, 3)]);
+            const __m128i slow = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes.slow[first])),
+                                              _mm_cmpgt_epi32(chars, none));
+            const uint32_t slow_mask = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(slow)));
+            const uint32_t chars_mask = make ? uint32_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(chars, none)))) & ~slow_mask : 0;
+            if ((slow_mask | chars_mask) != 0) {
+                _mm_store_si128(reinterpret_cast<__m128i*>(wc), chars);
+                flush(first, chars_mask, slow_mask, wc, ev, states, out, lanes);
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// AVX2 kernel, 8 lanes at a time, hardware gather.
+//----------------------------------------------------------------------------
+
+KBDPACK_TARGET("avx2")
+void KbdPack::translateAVX2(const KeyEvent* events, size_t count, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    const int* wch = reinterpret_cast<const int*>(_wch.data());
+    const __m256i none = _mm256_set1_epi32(WCH_NONE);
+    const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+    alignas(32) int32_t wc[8];
+
+    for (size_t i = 0; i < count; ++i) {
+        const KeyEvent ev = events[i];
+        const bool make = (ev.flags & KEV_BREAK) == 0;
+        const uint8_t* vk = &_vk[(KbdEngine::prefixIndex(ev) + ev.scancode) * _lanes];
+        for (size_t first = 0; first < _lanes; first += 8) {
+            const __m256i index = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.offset[first])),
+                                                   _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vk + first))));
+            const __m256i chars = _mm256_and_si256(_mm256_i32gather_epi32(wch, index, 2), low16);
+            const __m256i slow = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.slow[first])),
+                                                 _mm256_cmpgt_epi32(chars, none));
+            const uint32_t slow_mask = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(slow)));
+            const uint32_t chars_mask = make ? uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(none, chars)))) & ~slow_mask : 0;
+            if ((slow_mask | chars_mask) != 0) {
+                _mm256_store_si256(reinterpret_cast<__m256i*>(wc), chars);
+                flush(first, chars_mask, slow_mask, wc, ev, states, out, lanes);
+            }
+        }
+    }
+}
+
+#else
+
+// Not an x86 CPU, the vector kernels are never selected.
+void KbdPack::translateSSE4(const KeyEvent* events, size_t count, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    translateScalar(events, count, states, out, lanes);
+}
+
+void KbdPack::translateAVX2(const KeyEvent* events, size_t count, std::vector<KbdState>& states, std::vector<std::vector<WCHAR>>& out, Lanes& lanes) const
+{
+    translateScalar(events, count, states, out, lanes);
+}
+
+#endif
@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Translate one keystroke sequence through many keyboard layouts at once.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdengine.h"
+#include <deque>
+
+// The scan code to virtual key tables and the virtual key x modifiers to
+// character tables of all layouts are packed in a structure of arrays:
+//
+// - The virtual keys are indexed by [prefix + scan code][layout]. For one
+//   keystroke, the virtual keys of all layouts are contiguous bytes, loaded
+//   in one vector operation.
+// - The characters of each layout are stored by [cell][virtual key], where the
+//   cells are the columns of the engine, including the Caps Lock variants. For
+//   one keystroke, the characters of all layouts are fetched using one gather
+//   operation at index "offset of current cell + virtual key".
+//
+// Each layout is a "lane" of the vector kernel. The kernel only handles the
+// common case: a key without dead key, ligature, tracked modifier, numeric
+// keypad, Alt+numpad entry or active Kana lock. All other keystrokes are passed to the KbdEngine of the
+// layout (rarely, in a typical input). The results are always identical to
+// the results of the individual KbdEngine's.
+class KbdPack
+{
+public:
+    // Vector kernels. The AVX2 kernel uses hardware gather instructions.
+    // SSE 4.1 has no gather instruction, the gather is emulated.
+    enum Kernel {
+        KERNEL_AUTO,    // Best supported kernel on this CPU.
+        KERNEL_SCALAR,  // Portable scalar code, same packed tables.
+        KERNEL_SSE4,    // x86 SSE 4.1, 4 layouts at a time.
+        KERNEL_AVX2,    // x86 AVX2, 8 layouts at a time.
+    };
+
+    // Constructor. The tables must remain valid during the life of the pack.
+    KbdPack(const std::vector<const KBDTABLES*>& layouts);
+
+    // Number of layouts in the pack.
+    size_t size() const { return _engines.size(); }
+
+    // Access the translation engine of one layout.
+    const KbdEngine& engine(size_t index) const { return _engines[index]; }
+
+    // Check if a kernel is supported on this CPU. Get the name of a kernel.
+    static bool IsSupported(Kernel);
+    static Kernel BestKernel();
+    static const wchar_t* KernelName(Kernel);
+
+    // Translate a sequence of keystrokes through all layouts. There is one state
+    // and one output stream per layout. The states are resized if necessary.
+    // The characters are appended to the output streams.
+    void translate(const KeyEvent* events,
+                   size_t count,
+                   std::vector<KbdState>& states,
+                   std::vector<std::vector<WCHAR>>& out,
+                   Kernel kernel = KERNEL_AUTO) const;
+
+    // Memory size of the packed tables in bytes.
+    size_t memorySize() const { return _vk.size() + _wch.size() * sizeof(WCHAR) + _base.size() * sizeof(int32_t); }
+
+private:
+    // Number of layouts per vector in the widest kernel. The lanes are padded to this size.
+    static constexpr size_t LANE_GROUP = 8;
+
+    // Character value in the packed tables for tracked and special keys, forcing the slow path.
+    static constexpr WCHAR WCH_SLOW = 0xFFFF;
+
+    // Dynamic state of each lane during a translation.
+    struct Lanes
+    {
+        std::vector<int32_t> offset;  // Offset in _wch of the current cell.
+        std::vector<int32_t> slow;    // -1 when all keystrokes need the slow path, 0 otherwise.
+    };
+
+    std::deque<KbdEngine> _engines;  // One engine per layout.
+    size_t                _lanes;    // Number of lanes, padded to LANE_GROUP.
+    std::vector<uint8_t>  _vk;       // Virtual keys, indexed by [prefix + scan code][lane].
+    std::vector<WCHAR>    _wch;      // Characters, by layout, then [cell][vk].
+    std::vector<int32_t>  _base;     // Index in _wch of the characters of each layout.
+
+    // Recompute the dynamic state of a lane after a state change.
+    void refresh(size_t lane, const KbdState&, Lanes&) const;
+
+    // Translate a keystroke in one lane using the engine of the layout.
+    void slowPath(size_t lane, KeyEvent, std::vector<KbdState>&, std::vector<std::vector<WCHAR>>&, Lanes&) const;
+
+    // Process the results of a group of lanes: characters to output and lanes for the slow path.
+    void flush(size_t first, uint32_t chars, uint32_t slow, const int32_t* wc, KeyEvent,
+               std::vector<KbdState>&, std::vector<std::vector<WCHAR>>&, Lanes&) const;
+
+    // The kernels.
+    void translateScalar(const KeyEvent*, size_t, std::vector<KbdState>&, std::vector<std::vector<WCHAR>>&, Lanes&) const;
+    void translateSSE4(const KeyEvent*, size_t, std::vector<KbdState>&, std::vector<std::vector<WCHAR>>&, Lanes&) const;
+    void translateAVX2(const KeyEvent*, size_t, std::vector<KbdState>&, std::vector<std::vector<WCHAR>>&, Lanes&) const;
+};
@@ -0,0 +1,263 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Multi-core translation of long keystroke sequences, in chunks.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdparallel.h"
+#include <bit>
+
+// All lock bits. The transfer tables are indexed by [...][locks & LOCK_MASK].
+constexpr uint8_t LOCK_MASK = KLOCK_CAPITAL | KLOCK_NUMLOCK | KLOCK_KANA;
+constexpr size_t LOCK_VALUES = LOCK_MASK + 1;
+
+// Extract the bits of 'value' which are selected by 'mask', packed in the low bits.
+static size_t ExtractBits(uint16_t value, uint16_t mask)
+{
+    size_t result = 0;
+    for (size_t bit = 1; mask != 0; bit <<= 1) {
+        const uint16_t low = mask & uint16_t(-mask);
+        if ((value & low) != 0) {
+            result |= bit;
+        }
+        mask &= ~low;
+    }
+    return result;
+}
+
+// Reverse of ExtractBits(): spread the low bits of 'value' over the bits of 'mask'.
+static uint16_t DepositBits(size_t value, uint16_t mask)
+{
+    uint16_t result = 0;
+    for (size_t bit = 1; mask != 0; bit <<= 1) {
+        const uint16_t low = mask & uint16_t(-mask);
+        if ((value & bit) != 0) {
+            result |= low;
+        }
+        mask &= ~low;
+    }
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+ParallelTranslator::ParallelTranslator(const KbdEngine& engine, size_t threads, size_t chunk_size) :
+    _engine(engine),
+    _pool(threads),
+    _chunk_size(chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE),
+    _key_mask(4 * 256, 0),
+    _lock_key(4 * 256, 0),
+    _chunks()
+{
+    // Precompute which keystrokes are tracked keys.
+    for (size_t index = 0; index < 4 * 256; ++index) {
+        const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((index >> 8) << 1)};
+        KbdState state{};
+        if (_engine.trackKey(ev, state)) {
+            _key_mask[index] = state.keys;
+            _lock_key[index] = _engine.isLockKey(uint8_t(_engine.virtualKey(ev) & 0xFF));
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Translate a sequence of keystrokes.
+//----------------------------------------------------------------------------
+
+void ParallelTranslator::translate(const KeyEvent* events, size_t count, KbdState& state, std::vector<WCHAR>& out)
+{
+    const size_t chunk_count = (count + _chunk_size - 1) / _chunk_size;
+    if (chunk_count < 2 || _pool.threadCount() < 2) {
+        _engine.translate(events, count, state, out);
+        return;
+    }
+
+    _chunks.resize(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        _chunks[i].events = events + i * _chunk_size;
+        _chunks[i].count = std::min(_chunk_size, count - i * _chunk_size);
+    }
+
+    // Transfer functions of tracked keys and locks, in parallel, then exact initial states.
+    _pool.run(chunk_count, [this](size_t job, size_t) { computeTransfer(_chunks[job]); });
+    KbdState current(state);
+    for (auto& chunk : _chunks) {
+        chunk.start = current;
+        chunk.start.dead = 0;
+        chunk.start.numpad = chunk.start.code = 0;
+        applyTransfer(chunk, current);
+    }
+
+    // Speculative translation without pending dead key, in parallel, then fix the chunks which had one.
+    _pool.run(chunk_count, [this](size_t job, size_t) { speculate(_chunks[job]); });
+    KbdState pending(state);
+    size_t size = out.size();
+    for (auto& chunk : _chunks) {
+        resolve(chunk, pending);
+        pending = chunk.end;
+        chunk.offset = size;
+        size += chunk.head.size() + chunk.out.size() - chunk.skip;
+    }
+    state = _chunks.back().end;
+
+    // Final output, in parallel.
+    out.resize(size);
+    _pool.run(chunk_count, [this, &out](size_t job, size_t) {
+        const Chunk& chunk(_chunks[job]);
+        WCHAR* dest = std::copy(chunk.head.data(), chunk.head.data() + chunk.head.size(), out.data() + chunk.offset);
+        std::copy(chunk.out.data() + chunk.skip, chunk.out.data() + chunk.out.size(), dest);
+    });
+}
+
+
+//----------------------------------------------------------------------------
+// Compute the transfer function of tracked keys and locks for a chunk.
+//----------------------------------------------------------------------------
+
+void ParallelTranslator::computeTransfer(Chunk& chunk) const
+{
+    // The final state of a tracked key only depends on its last keystroke.
+    KbdState keys{};
+    chunk.touched = 0;
+    chunk.lock_keys = 0;
+    chunk.lock_events.clear();
+    for (size_t i = 0; i < chunk.count; ++i) {
+        const KeyEvent ev = chunk.events[i];
+        const size_t index = KeyIndex(ev);
+        const uint16_t mask = _key_mask[index];
+        if (mask != 0) {
+            _engine.trackKey(ev, keys);
+            if (_lock_key[index] != 0) {
+                // A lock is not toggled by a lock key which is already pressed at the start of the chunk.
+                if ((chunk.touched & mask) == 0 && (ev.flags & KEV_BREAK) == 0) {
+                    chunk.lock_keys |= mask;
+                }
+                chunk.lock_events.push_back(ev);
+            }
+            chunk.touched |= mask;
+        }
+    }
+    chunk.final_keys = keys.keys & chunk.touched;
+
+    // Run the lock keys on all combinations of initial pressed lock keys and locks.
+    const size_t combinations = size_t(1) << std::popcount(chunk.lock_keys);
+    chunk.locks.resize(combinations * LOCK_VALUES);
+    for (size_t combination = 0; combination < combinations; ++combination) {
+        for (size_t locks = 0; locks < LOCK_VALUES; ++locks) {
+            KbdState st{};
+            st.keys = DepositBits(combination, chunk.lock_keys);
+            st.locks = uint8_t(locks);
+            for (const auto& ev : chunk.lock_events) {
+                _engine.trackKey(ev, st);
+            }
+            chunk.locks[combination * LOCK_VALUES + locks] = st.locks;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Apply the transfer function of a chunk on tracked keys and locks.
+//----------------------------------------------------------------------------
+
+void ParallelTranslator::applyTransfer(const Chunk& chunk, KbdState& state) const
+{
+    const size_t combination = ExtractBits(state.keys, chunk.lock_keys);
+    state.locks = uint8_t((state.locks & ~LOCK_MASK) | chunk.locks[combination * LOCK_VALUES + (state.locks & LOCK_MASK)]);
+    state.keys = uint16_t((state.keys & ~chunk.touched) | chunk.final_keys);
+}
+
+
+//----------------------------------------------------------------------------
+// Speculative translation of a chunk, assuming no pending dead key at start.
+//----------------------------------------------------------------------------
+
+void ParallelTranslator::speculate(Chunk& chunk) const
+{
+    KbdState state(chunk.start);
+    WCHAR buffer[KbdEngine::MAX_OUTPUT];
+
+    chunk.first_use = chunk.count;
+    chunk.checkpoints.clear();
+    chunk.head.clear();
+    chunk.out.clear();
+    chunk.skip = 0;
+
+    for (size_t i = 0; i < chunk.count; ++i) {
+        const KeyEvent ev = chunk.events[i];
+        const KbdState previous(state);
+        const size_t count = _engine.translate(ev, state, buffer);
+        chunk.out.insert(chunk.out.end(), buffer, buffer + count);
+
+        // Only the keystrokes which produce characters or dead keys use the pending dead key.
+        // An Alt+numpad entry may be ended by the release of a tracked key or cancelled by another key.
+        const bool tracked = _key_mask[KeyIndex(ev)] != 0;
+        const bool release = (ev.flags & KEV_BREAK) != 0;
+        if (count > 0 || state.dead != previous.dead || state.numpad != previous.numpad || tracked == release) {
+            if (chunk.first_use == chunk.count) {
+                chunk.first_use = i;
+                chunk.before_use = previous;
+            }
+            if (chunk.checkpoints.size() < MAX_CHECKPOINTS) {
+                chunk.checkpoints.push_back(Checkpoint{i, state, chunk.out.size()});
+            }
+        }
+    }
+    chunk.end = state;
+}
+
+
+//----------------------------------------------------------------------------
+// Fix the speculative translation of a chunk with the actual pending dead key.
+//----------------------------------------------------------------------------
+
+void ParallelTranslator::resolve(Chunk& chunk, const KbdState& previous) const
+{
+    chunk.start.dead = previous.dead;
+    chunk.start.numpad = previous.numpad;
+    chunk.start.code = previous.code;
+    if (previous.dead == 0 && previous.numpad == 0) {
+        // The speculation was right.
+        return;
+    }
+    if (chunk.first_use == chunk.count) {
+        // The dead key or Alt+numpad entry remains pending during the whole chunk.
+        chunk.end.dead = previous.dead;
+        chunk.end.numpad = previous.numpad;
+        chunk.end.code = previous.code;
+        return;
+    }
+
+    // Retranslate from the first keystroke using the pending state, until the state is identical to the speculative one.
+    // Before this keystroke, there is no output, in the speculative and actual translations.
+    KbdState state(chunk.before_use);
+    state.dead = previous.dead;
+    state.numpad = previous.numpad;
+    state.code = previous.code;
+    WCHAR buffer[KbdEngine::MAX_OUTPUT];
+    size_t next = 0;
+
+    for (size_t i = chunk.first_use; i < chunk.count; ++i) {
+        const size_t count = _engine.translate(chunk.events[i], state, buffer);
+        chunk.head.insert(chunk.head.end(), buffer, buffer + count);
+        if (next < chunk.checkpoints.size() && chunk.checkpoints[next].index == i) {
+            if (chunk.checkpoints[next].state == state) {
+                chunk.skip = chunk.checkpoints[next].offset;
+                return;
+            }
+            ++next;
+        }
+    }
+
+    // Never rejoined the speculative translation, the whole chunk was retranslated.
+    chunk.skip = chunk.out.size();
+    chunk.end = state;
+}
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Multi-core translation of long keystroke sequences, in chunks.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdengine.h"
+#include "workpool.h"
+
+// The translation is sequential by nature because the state (pressed keys,
+// locks, pending dead key) is carried from one keystroke to the next one.
+// The keystroke sequence is split in chunks which are processed in parallel:
+//
+// 1. In parallel, compute the state transfer function of the tracked keys and
+//    locks of each chunk. The final pressed keys do not depend on the initial
+//    state, except the keys which are not used in the chunk. The final locks
+//    depend on the initial locks and, for the lock keys which are first
+//    pressed in the chunk, whether they were already pressed. This is a small
+//    table, built by running the lock keys of the chunk on all combinations.
+// 2. Prefix scan of the transfer functions: the exact pressed keys and locks
+//    at the start of each chunk.
+// 3. In parallel, translate each chunk, assuming no pending dead key and no
+//    Alt+numpad entry at start. Until the first keystroke which produces a
+//    character or a dead key, presses an untracked key or releases a tracked
+//    key, they are not used and not modified.
+// 4. Prefix scan of the pending dead keys and Alt+numpad entries. When a chunk
+//    actually starts with one of them, retranslate its first keystrokes until
+//    the state is identical to the speculative translation (usually after one
+//    character).
+// 5. In parallel, copy the output of each chunk at its final position.
+//
+// The output and final state are always identical to KbdEngine::translate().
+class ParallelTranslator
+{
+public:
+    // Default number of keystroke events per chunk.
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+    // Constructor. The engine must remain valid during the life of this object.
+    // Zero threads means the number of processors.
+    ParallelTranslator(const KbdEngine&, size_t threads = 0, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    // Number of threads and chunk size.
+    size_t threadCount() const { return _pool.threadCount(); }
+    size_t chunkSize() const { return _chunk_size; }
+
+    // Translate a sequence of keystrokes. The characters are appended to 'out'.
+    // Same as KbdEngine::translate() with the same parameters.
+    void translate(const KeyEvent* events, size_t count, KbdState&, std::vector<WCHAR>& out);
+
+private:
+    // Maximum number of recorded states where a retranslation can rejoin the speculative one.
+    static constexpr size_t MAX_CHECKPOINTS = 16;
+
+    // State after a keystroke which may use the pending dead key or Alt+numpad entry.
+    struct Checkpoint
+    {
+        size_t   index;   // Index of the keystroke in the chunk.
+        KbdState state;   // State after the keystroke.
+        size_t   offset;  // Output size after the keystroke.
+    };
+
+    // Description of a chunk.
+    struct Chunk
+    {
+        const KeyEvent*         events;       // First keystroke.
+        size_t                  count;        // Number of keystrokes.
+        uint16_t                touched;      // Tracked keys which are pressed or released in the chunk.
+        uint16_t                final_keys;   // Final state of the touched keys.
+        uint16_t                lock_keys;    // Lock keys which are first pressed in the chunk.
+        std::vector<KeyEvent>   lock_events;  // Keystrokes on lock keys.
+        std::vector<uint8_t>    locks;        // Final locks, by [lock_keys combination][initial locks].
+        KbdState                start;        // Exact initial state.
+        KbdState                end;          // Final state.
+        size_t                  first_use;    // Index of first keystroke using the pending state, count if none.
+        KbdState                before_use;   // Speculative state before first_use.
+        std::vector<Checkpoint> checkpoints;  // First checkpoints after first_use.
+        std::vector<WCHAR>      head;         // Retranslated output, before the speculative one.
+        std::vector<WCHAR>      out;          // Speculative output.
+        size_t                  skip;         // Number of characters to skip in the speculative output.
+        size_t                  offset;       // Final offset of the chunk output.
+    };
+
+    const KbdEngine&      _engine;
+    WorkPool              _pool;
+    size_t                _chunk_size;
+    std::vector<uint16_t> _key_mask;   // Tracked key mask, by [prefix + scan code].
+    std::vector<bool>     _lock_key;   // Lock key, by [prefix + scan code].
+    std::vector<Chunk>    _chunks;     // Reused from one call to another.
+
+    // Index of a keystroke in _key_mask and _lock_key.
+    static size_t KeyIndex(KeyEvent ev) { return KbdEngine::prefixIndex(ev) + ev.scancode; }
+
+    // Processing steps on one chunk.
+    void computeTransfer(Chunk&) const;
+    void applyTransfer(const Chunk&, KbdState&) const;
+    void speculate(Chunk&) const;
+    void resolve(Chunk&, const KbdState& previous) const;
+};
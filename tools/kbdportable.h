@@ -0,0 +1,29 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Common header for modules which only use the keyboard layout tables.
+// These modules do not call any Windows API and can be compiled on other
+// systems, using the stand-in headers in the "portable" subdirectory.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#if defined(_WIN32)
+    #include "platform.h"
+#else
+    #include <windows.h>  // stand-in from tools/portable
+    #include <kbd.h>      // stand-in from tools/portable
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
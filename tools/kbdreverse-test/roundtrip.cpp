@@ -0,0 +1,107 @@
+//---------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Comparison of the keyboard tables from a C source file, compiled with the
+// host compiler, with the original keyboard layout (DLL or .wklbin file).
+//
+// This program is linked with one compiled layout, where the entry point is
+// renamed RoundTripTables. It is built and run by roundtrip.py. The tables
+// are first compared as .wklbin images, which do not depend on the pointer
+// size and placement of the structures. When the images differ, the tables
+// are compared semantically and the differences are listed. Optionally, the
+// compiled tables are saved as a .wklbin file, for the translator check.
+//
+//---------------------------------------------------------------------------
+
+#include "kbdcontent.h"
+#include "pefile.h"
+#include "wklbin.h"
+#include <cstdio>
+#include <fstream>
+
+extern "C" PKBDTABLES RoundTripTables(void);
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3) {
+        std::fprintf(stderr, "syntax: %s original-kbd-dll-or-wklbin [compiled-wklbin-output]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Load the original tables, without executing the DLL.
+    const std::filesystem::path filename(argv[1]);
+    PeFile pe;
+    WklBinFile bin;
+    const KBDTABLES* original = nullptr;
+    if (filename.extension() == ".wklbin") {
+        if (bin.load(filename)) {
+            original = bin.kbdTables();
+        }
+    }
+    else if (pe.load(filename)) {
+        // A zero RVA means not found (RVA 0 is the DOS header, not the tables).
+        const uint32_t proc_rva = pe.exportRva("KbdLayerDescriptor");
+        const uint32_t tables_rva = proc_rva == 0 ? 0 : pe.returnedAddressRva(proc_rva);
+        if (tables_rva != 0 && pe.isRelocated()) {
+            original = pe.get<KBDTABLES>(tables_rva);
+        }
+        else if (tables_rva != 0 && bin.load(pe, tables_rva)) {
+            // Other pointer size: use the tables through their serialized form.
+            original = bin.kbdTables();
+        }
+    }
+    if (original == nullptr) {
+        std::fprintf(stderr, "error loading keyboard tables from %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    const KBDTABLES* compiled = RoundTripTables();
+
+    // Bit-for-bit comparison of the position-independent images.
+    std::vector<uint8_t> data1;
+    std::vector<uint8_t> data2;
+    WklBinFile::Serialize(data1, *original);
+    WklBinFile::Serialize(data2, *compiled);
+    if (argc > 2) {
+        std::ofstream out(argv[2], std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data2.data()), std::streamsize(data2.size()));
+        if (!out) {
+            std::fprintf(stderr, "error writing %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (data1 == data2) {
+        std::printf("identical, %zu bytes\n", data1.size());
+        return EXIT_SUCCESS;
+    }
+
+    // Semantic comparison.
+    std::vector<KbdContent::Difference> diffs;
+    const KbdContent content1(*original);
+    const KbdContent content2(*compiled);
+    if (content1.compare(content2, &diffs) == 0) {
+        std::printf("equivalent, %zu and %zu bytes\n", data1.size(), data2.size());
+        return EXIT_SUCCESS;
+    }
+    const auto print_value = [](const KbdContent::Value* value) {
+        if (value == nullptr) {
+            std::printf(" -");
+        }
+        else {
+            for (char16_t c : *value) {
+                std::printf(" %04X", unsigned(c));
+            }
+        }
+    };
+    for (const auto& diff : diffs) {
+        std::printf("%ls 0x%X:", KbdContent::SectionName(diff.section), diff.key);
+        print_value(diff.old_value);
+        std::printf(" ->");
+        print_value(diff.new_value);
+        std::printf("\n");
+    }
+    std::printf("%zu differences\n", diffs.size());
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,243 @@
+#!/usr/bin/env python
+#---------------------------------------------------------------------------
+#
+# Windows Keyboards Layouts (WKL)
+# Copyright (c) 2023, Thierry Lelegard
+# BSD-2-Clause license, see the LICENSE file.
+#
+# Round-trip verification of keyboard layouts, on any system:
+#
+#   DLL -> kbdreverse -> C source -> host compiler -> tables -> compare with DLL
+#
+# For each keyboard layout DLL (or .wklbin file), the C source is generated
+# by kbdreverse, compiled with the host compiler against the stand-in headers
+# in tools/portable and linked with roundtrip.cpp, which compares the compiled
+# tables with the original ones. When the layout is a project of this
+# repository, its source file in keyboards/ is verified the same way.
+#
+# For each keyboard layout (DLL or .wklbin file) and each project source, the
+# specialized translator which is generated by "kbdreverse -s" is also compiled
+# with tools/kbdgencheck.cpp and compared with the generic translation engine,
+# so that both cannot drift apart. The tables of a project source are first
+# saved as a .wklbin file by roundtrip.cpp, then processed as any layout.
+#
+# The memory footprint of each layout (kbdreverse -f) is also checked: the
+# data structures must be inside the DLL image and must be exactly the content
+# of a .wklbin file.
+#
+# The layouts are processed in parallel. A timing report is displayed.
+#
+# The host compilers must accept the gcc/clang options (gcc or clang on
+# Linux, macOS or Windows). On other systems than Windows, kbdreverse is the
+# host build of tools/Makefile. Without kbdreverse (no build and no
+# --kbdreverse option), only the source files of the repository are verified.
+#
+#---------------------------------------------------------------------------
+
+import sys, os, glob, time, json, argparse, subprocess, tempfile, shutil
+from concurrent.futures import ThreadPoolExecutor
+
+script_dir = os.path.dirname(os.path.abspath(__file__))
+tools_dir = os.path.dirname(script_dir)
+root_dir = os.path.dirname(tools_dir)
+keyboards_dir = os.path.join(root_dir, 'keyboards')
+exe_suffix = '.exe' if os.name == 'nt' else ''
+
+# Modules of the comparison program, in addition to roundtrip.cpp.
+check_sources = ['kbdcontent.cpp', 'pefile.cpp', 'mappedfile.cpp', 'wklbin.cpp']
+
+# Modules of the translator comparison program, in addition to kbdgencheck.cpp and the generated header.
+translator_sources = ['kbdengine.cpp', 'deadkeys.cpp', 'pefile.cpp', 'mappedfile.cpp', 'wklbin.cpp']
+
+# Command line.
+parser = argparse.ArgumentParser(description='Round-trip verification of keyboard layouts.')
+parser.add_argument('inputs', nargs='*', help='keyboard layout DLL or .wklbin files, or directories, default: x64/Release')
+parser.add_argument('--kbdreverse', help='command to run kbdreverse, default: x64/Release/kbdreverse.exe on Windows, host/kbdreverse elsewhere')
+parser.add_argument('--cc', default=os.environ.get('CC', 'cc'), help='host C compiler, default: $CC or cc')
+parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'), help='host C++ compiler, default: $CXX or c++')
+parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(), help='number of parallel jobs, default: number of processors')
+parser.add_argument('-k', '--keep', action='store_true', help='keep the work directory')
+parser.add_argument('-n', '--keystrokes', type=int, default=200000, help='number of keystrokes in the translator comparison, default: 200000')
+parser.add_argument('-v', '--verbose', action='store_true', help='display the output of failed verifications')
+args = parser.parse_args()
+
+if args.kbdreverse is None and os.name == 'nt':
+    args.kbdreverse = os.path.join(root_dir, 'x64', 'Release', 'kbdreverse.exe')
+elif args.kbdreverse is None and os.path.isfile(os.path.join(root_dir, 'host', 'kbdreverse')):
+    # Host build of tools/Makefile.
+    args.kbdreverse = os.path.join(root_dir, 'host', 'kbdreverse')
+reverse_cmd = args.kbdreverse.split() if args.kbdreverse else None
+
+# Collect the keyboard layout files.
+inputs = args.inputs if args.inputs else [os.path.join(root_dir, 'x64', 'Release')]
+layouts = []
+for name in inputs:
+    if os.path.isdir(name):
+        layouts.extend(sorted(glob.glob(os.path.join(name, 'kbd*.dll')) + glob.glob(os.path.join(name, '*.wklbin'))))
+    elif os.path.isfile(name):
+        layouts.append(name)
+    else:
+        print('error: %s not found' % name, file=sys.stderr)
+        exit(1)
+if not layouts:
+    print('error: no keyboard layout found, try --help', file=sys.stderr)
+    exit(1)
+
+work_dir = tempfile.mkdtemp(prefix='wkl-roundtrip-')
+
+# Run a command, return (success, output, duration in ms).
+def run(cmd):
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, errors='replace')
+    return proc.returncode == 0, proc.stdout, (time.perf_counter() - start) * 1000.0
+
+# Build the objects of the comparison programs once.
+def build_objects(sources):
+    objects = []
+    for src in sources:
+        obj = os.path.join(work_dir, os.path.splitext(os.path.basename(src))[0] + '.o')
+        if not os.path.isfile(obj):
+            ok, out, _ = run([args.cxx, '-std=c++20', '-O1', '-I' + os.path.join(tools_dir, 'portable'), '-I' + tools_dir, '-c', src, '-o', obj])
+            if not ok:
+                print(out, file=sys.stderr)
+                print('error: cannot compile %s' % src, file=sys.stderr)
+                exit(1)
+        objects.append(obj)
+    return objects
+
+# Compile a C source file, link it with the comparison program, run it on the original layout.
+# The compiled tables are saved in the .wklbin file 'compiled', when specified.
+# Return (status, output, duration in ms).
+def verify(csource, original, prefix, compiled=None):
+    obj = prefix + '.o'
+    exe = prefix + exe_suffix
+    include = ['-I' + os.path.join(tools_dir, 'portable'), '-I' + keyboards_dir, '-I' + os.path.dirname(csource)]
+    ok, out, ms1 = run([args.cc, '-std=c11', '-fshort-wchar', '-DKbdLayerDescriptor=RoundTripTables'] + include + ['-c', csource, '-o', obj])
+    if not ok:
+        return 'compile error', out, ms1
+    ok, out, ms2 = run([args.cxx, '-o', exe, obj] + checker_objects)
+    if not ok:
+        return 'link error', out, ms1 + ms2
+    ok, out, ms3 = run([exe, original] + ([compiled] if compiled else []))
+    lines = out.strip().splitlines()
+    status = lines[-1] if lines else 'no output'
+    return status if ok else 'FAILED: ' + status, out, ms1 + ms2 + ms3
+
+# Generate the specialized translator of a layout, compile it with kbdgencheck.cpp, run it on the layout.
+# Return (status, output, duration in ms).
+def verify_translator(path, prefix):
+    header = prefix + '.h'
+    obj = prefix + '.o'
+    exe = prefix + exe_suffix
+    ok, out, ms1 = run(reverse_cmd + ['-s', path, '-o', header])
+    if not ok:
+        return 'kbdreverse error', out, ms1
+    with open(header, 'r', encoding='utf-8', errors='replace') as input:
+        namespaces = [line.split()[1] for line in input if line.startswith('namespace ')]
+    if not namespaces:
+        return 'no namespace', out, ms1
+    defines = ['-DKBDGEN_HEADER="%s"' % os.path.basename(header), '-DKBDGEN_NAMESPACE=' + namespaces[0]]
+    include = ['-I' + os.path.join(tools_dir, 'portable'), '-I' + tools_dir, '-I' + os.path.dirname(header)]
+    ok, out, ms2 = run([args.cxx, '-std=c++20', '-O1'] + defines + include + ['-c', os.path.join(tools_dir, 'kbdgencheck.cpp'), '-o', obj])
+    if not ok:
+        return 'compile error', out, ms1 + ms2
+    ok, out, ms3 = run([args.cxx, '-o', exe, obj] + translator_objects)
+    if not ok:
+        return 'link error', out, ms1 + ms2 + ms3
+    ok, out, ms4 = run([exe, path, str(args.keystrokes)])
+    summary = [line for line in out.splitlines() if ' events, ' in line]
+    status = summary[0].split(', ')[-1] if summary else 'no output'
+    return status if ok else 'FAILED: ' + status, out, ms1 + ms2 + ms3 + ms4
+
+# Report the memory footprint of a layout with kbdreverse -f and check that it is consistent with the file.
+# Return (status, output, duration in ms).
+def verify_footprint(path):
+    ok, out, ms = run(reverse_cmd + ['-f', 'json', path])
+    if not ok:
+        return 'kbdreverse error', out, ms
+    try:
+        fp = json.loads(out)['layouts'][0]
+    except (ValueError, KeyError, IndexError):
+        return 'invalid output', out, ms
+    status = '%d bytes, %d pages' % (fp['total'], fp['pages'])
+    if path.lower().endswith('.wklbin'):
+        size = os.path.getsize(path)
+        valid = fp['total'] == size and fp['pages'] == (size + fp['page_size'] - 1) // fp['page_size']
+    else:
+        valid = 0 < fp['total'] <= fp['image'] and fp['pages'] * fp['page_size'] <= fp['image'] + fp['page_size']
+    return ('consistent, ' if valid else 'inconsistent, ') + status, out, ms
+
+# Verify one layout: the reversed source, the specialized translator, then the source of the project, if any.
+def process(path):
+    name = os.path.splitext(os.path.basename(path))[0]
+    layout_dir = os.path.join(work_dir, name)
+    os.makedirs(layout_dir, exist_ok=True)
+    result = {'name': name, 'reverse': '', 'reverse_ms': 0.0, 'reversed': '', 'reversed_ms': 0.0, 'translator': '', 'translator_ms': 0.0, 'footprint': '', 'footprint_ms': 0.0,
+              'source': '', 'source_ms': 0.0, 'source_translator': '', 'source_translator_ms': 0.0, 'failed': False, 'output': ''}
+    if reverse_cmd:
+        csource = os.path.join(layout_dir, name + '.c')
+        ok, out, result['reverse_ms'] = run(reverse_cmd + [path, '-o', csource])
+        if ok:
+            result['reversed'], out, result['reversed_ms'] = verify(csource, path, os.path.join(layout_dir, 'reversed'))
+        else:
+            result['reversed'] = 'kbdreverse error'
+        if result['reversed'].split(',')[0] not in ('identical', 'equivalent'):
+            result['failed'] = True
+            result['output'] += out
+        result['translator'], out, result['translator_ms'] = verify_translator(path, os.path.join(layout_dir, 'translator'))
+        if result['translator'] != '0 errors':
+            result['failed'] = True
+            result['output'] += out
+        result['footprint'], out, result['footprint_ms'] = verify_footprint(path)
+        if result['footprint'].split(',')[0] != 'consistent':
+            result['failed'] = True
+            result['output'] += out
+    project_source = os.path.join(keyboards_dir, name, name + '.c')
+    if os.path.isfile(project_source):
+        compiled = os.path.join(layout_dir, name + '.wklbin') if reverse_cmd else None
+        result['source'], out, result['source_ms'] = verify(project_source, path, os.path.join(layout_dir, 'source'), compiled)
+        if result['source'].split(',')[0] not in ('identical', 'equivalent'):
+            result['failed'] = True
+            result['output'] += out
+        elif compiled:
+            result['source_translator'], out, result['source_translator_ms'] = verify_translator(compiled, os.path.join(layout_dir, 'source-translator'))
+            if result['source_translator'] != '0 errors':
+                result['failed'] = True
+                result['output'] += out
+    return result
+
+start = time.perf_counter()
+checker_objects = build_objects([os.path.join(script_dir, 'roundtrip.cpp')] + [os.path.join(tools_dir, s) for s in check_sources])
+translator_objects = build_objects([os.path.join(tools_dir, s) for s in translator_sources]) if reverse_cmd else []
+build_ms = (time.perf_counter() - start) * 1000.0
+with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+    results = list(pool.map(process, layouts))
+total_ms = (time.perf_counter() - start) * 1000.0
+
+# Report, one line per layout.
+header = ['Layout', 'Reversed source', 'Time (ms)', 'Translator', 'Time (ms)', 'Footprint', 'Time (ms)', 'Project source', 'Time (ms)', 'Source translator', 'Time (ms)']
+lines = [[r['name'],
+          r['reversed'] or '-', '%.1f' % (r['reverse_ms'] + r['reversed_ms']) if r['reversed'] else '',
+          r['translator'] or '-', '%.1f' % r['translator_ms'] if r['translator'] else '',
+          r['footprint'] or '-', '%.1f' % r['footprint_ms'] if r['footprint'] else '',
+          r['source'] or '-', '%.1f' % r['source_ms'] if r['source'] else '',
+          r['source_translator'] or '-', '%.1f' % r['source_translator_ms'] if r['source_translator'] else ''] for r in results]
+widths = [max(len(line[i]) for line in [header] + lines) for i in range(len(header))]
+for line in [header, ['-' * w for w in widths]] + lines:
+    print('  '.join(line[i].ljust(widths[i]) for i in range(len(line))).rstrip())
+failures = [r for r in results if r['failed']]
+print()
+print('%d layouts, %d failed, %d jobs, %s' % (len(results), len(failures), args.jobs, 'kbdreverse: ' + args.kbdreverse if reverse_cmd else 'no kbdreverse, project sources only'))
+print('checker build: %.1f ms, total: %.1f ms, sum of layout times: %.1f ms' %
+      (build_ms, total_ms, sum(r['reverse_ms'] + r['reversed_ms'] + r['translator_ms'] + r['footprint_ms'] + r['source_ms'] + r['source_translator_ms'] for r in results)))
+if args.verbose:
+    for r in failures:
+        print()
+        print('%s:' % r['name'])
+        print(r['output'].rstrip())
+
+if args.keep:
+    print('work directory: %s' % work_dir)
+else:
+    shutil.rmtree(work_dir, ignore_errors=True)
+exit(1 if failures else 0)
@@ -12,16 +12,30 @@
 #include "options.h"
 #include "strutils.h"
 #include "winutils.h"
-#include "registry.h"
 #include "grid.h"
-#include "fileversion.h"
+#include "kbdfile.h"
+#include "wklbin.h"
+#include "workpool.h"
 #include "winkeymap.h"
+#include "kbdengine.h"
+#include "kbdcontent.h"
+#include "kbdtablelist.h"
+#include "kbdcompactor.h"
 #include "unicode.h"
+#include "symbols.h"
+#include <filesystem>
+#include <sstream>
+#include <chrono>
+#include <memory>
+
+#if defined(_WIN32)
+    #include "registry.h"
+    #include "fileversion.h"
+#endif
 
 // Tables of values => symbols
-typedef __int64 Value;
-typedef std::map<Value, WString> SymbolTable;
-#define SYM(e) {e, L#e}
+typedef int64_t Value;
+#define SYM(e) {e, L"" #e}
 
 // Configure the terminal console on init, restore on exit.
 ConsoleState state;
@@ -48,47 +62,94 @@ public:
     // Command line options.
     WString     dashed;
     WString     input;
+    WStringList inputs;
     WString     output;
+    WString     batch_dir;
     WString     comment;
     WString     map_template;
+    WString     shared_header;
+    WString     footprint;
     WStringList headers;
     int         kbd_type;
+    int         threads;
     bool        num_only;
     bool        hexa_dump;
     bool        gen_resources;
     bool        gen_list;
+    bool        gen_binary;
+    bool        gen_translator;
+    bool        compare;
+    bool        analyze;
+    bool        compact;
 };
 
 ReverseOptions::ReverseOptions(int argc, wchar_t* argv[]) :
     Options(argc, argv,
-        L"[options] kbd-name-or-file\n"
+        L"[options] kbd-name-or-file ...\n"
         L"\n"
         L"  kbd-name-or-file : Either the file name of a keyboard layout DLL or the\n"
         L"  name of a keyboard layout, for instance \"fr\" for C:\\Windows\\System32\\kbdfr.dll\n"
+        L"  or the file name of a compiled keyboard layout (.wklbin)\n"
+        L"  In batch mode (-b) and with -a, -f or -x, several keyboard layouts can be specified, as well as\n"
+        L"  directories and wildcards, for instance \"C:\\dlls\\kbd*.dll\"\n"
         L"\n"
         L"Options:\n"
         L"\n"
+        L"  -a : analyze the tables of several keyboard layouts instead of generating a C source\n"
+        L"       file, report the identical tables in several layouts and their size in bytes\n"
+        L"  -b outdir : batch mode, generate one file per keyboard DLL in the specified directory\n"
         L"  -c \"string\" : comment string in the header\n"
         L"  -d : add hexa dump in final comments\n"
+        L"  -f format : report the memory footprint of the data structures of the keyboard layouts\n"
+        L"       instead of generating a C source file, in bytes per category of structure, with\n"
+        L"       the padding and the unused parts of the memory pages; the format is \"table\" or\n"
+        L"       \"json\"\n"
+        L"  -g header : in batch mode, the tables which are identical in several keyboard layouts\n"
+        L"       are generated once in the specified header file, in the output directory, and\n"
+        L"       the generated C source files include it\n"
         L"  -h : display this help text\n"
+        L"  -j count : number of threads in batch mode, default: number of processors\n"
         L"  -l : generate a list of characters instead of a C source file\n"
         L"  -m infile : generate a keybard map based on the specified template\n"
         L"  -n : numerical output only, do not attempt to translate to source macros\n"
         L"  -o outfile : output file name, default is standard output\n"
         L"  -r : generate a resource file instead of a C source file\n"
+        L"  -s : generate a C++ header with a keystroke translator which is specialized\n"
+        L"       for the keyboard layout instead of a C source file\n"
         L"  -t value : keyboard type, defaults to dwType in kbd table or 4 if unspecified\n"
-        L"  -u outfile : same as -o but update output, keeping leading comments"),
+        L"  -u outfile : same as -o but update output, keeping leading comments\n"
+        L"  -w : generate a compiled keyboard layout file (.wklbin) instead of a C source file,\n"
+        L"       requires -o or -b\n"
+        L"  -x : compare keyboard layouts instead of generating a C source file: with two layouts,\n"
+        L"       list the differences in the tables, one per line; with more layouts (directories\n"
+        L"       or wildcards are allowed), display the number of differences for each pair\n"
+        L"  -z : compact data structures in the C source file: the key names are in one pool\n"
+        L"       of strings, the keys are moved to the narrowest character table, the unused\n"
+        L"       scan codes at end of table are removed and the tables which are used on each\n"
+        L"       keystroke are defined together; the compact tables are verified against the\n"
+        L"       original ones and their estimated size is reported (use -f on the rebuilt\n"
+        L"       DLL's to measure their data sections)"),
     dashed(75, L'-'),
     input(),
+    inputs(),
     output(),
+    batch_dir(),
     comment(L"Windows Keyboards Layouts (WKL)"),
     map_template(),
+    shared_header(),
+    footprint(),
     headers(),
     kbd_type(0),
+    threads(0),
     num_only(false),
     hexa_dump(false),
     gen_resources(false),
-    gen_list(false)
+    gen_list(false),
+    gen_binary(false),
+    gen_translator(false),
+    compare(false),
+    analyze(false),
+    compact(false)
 {
     bool get_headers = false;
 
@@ -97,6 +158,9 @@ ReverseOptions::ReverseOptions(int argc, wchar_t* argv[]) :
         if (args[i] == L"--help" || args[i] == L"-h") {
             usage();
         }
+        else if (args[i] == L"-a") {
+            analyze = true;
+        }
         else if (args[i] == L"-d") {
             hexa_dump = true;
         }
@@ -109,6 +173,18 @@ ReverseOptions::ReverseOptions(int argc, wchar_t* argv[]) :
         else if (args[i] == L"-l") {
             gen_list = true;
         }
+        else if (args[i] == L"-s") {
+            gen_translator = true;
+        }
+        else if (args[i] == L"-w") {
+            gen_binary = true;
+        }
+        else if (args[i] == L"-x") {
+            compare = true;
+        }
+        else if (args[i] == L"-z") {
+            compact = true;
+        }
         else if (args[i] == L"-o" && i + 1 < args.size()) {
             output = args[++i];
         }
@@ -125,20 +201,66 @@ ReverseOptions::ReverseOptions(int argc, wchar_t* argv[]) :
         else if (args[i] == L"-t" && i + 1 < args.size()) {
             kbd_type = ToInt(args[++i]);
         }
-        else if (!args[i].empty() && args[i].front() != '-' && input.empty()) {
-            input = args[i];
+        else if (args[i] == L"-b" && i + 1 < args.size()) {
+            batch_dir = args[++i];
+        }
+        else if (args[i] == L"-j" && i + 1 < args.size()) {
+            threads = ToInt(args[++i]);
+        }
+        else if (args[i] == L"-g" && i + 1 < args.size()) {
+            shared_header = args[++i];
+        }
+        else if (args[i] == L"-f" && i + 1 < args.size()) {
+            footprint = ToLower(args[++i]);
+            if (footprint != L"table" && footprint != L"json") {
+                fatal(L"invalid footprint format '" + footprint + L"', use table or json");
+            }
+        }
+        else if (!args[i].empty() && args[i].front() != '-') {
+            inputs.push_back(args[i]);
         }
         else {
             fatal("invalid option '" + args[i] + "', try --help");
         }
     }
-    if (input.empty()) {
+    if (inputs.empty()) {
         fatal(L"no keyboard layout specified, try --help");
     }
+    if (compare && (!batch_dir.empty() || gen_binary || gen_list || gen_resources || gen_translator || hexa_dump || get_headers || !map_template.empty())) {
+        fatal(L"option -x cannot be used with -b, -d, -l, -m, -r, -s, -u or -w");
+    }
+    if (analyze && (compare || !batch_dir.empty() || gen_binary || gen_list || gen_resources || gen_translator || hexa_dump || get_headers || !map_template.empty())) {
+        fatal(L"option -a cannot be used with -b, -d, -l, -m, -r, -s, -u, -w or -x");
+    }
+    if (!footprint.empty() && (analyze || compare || !batch_dir.empty() || gen_binary || gen_list || gen_resources || gen_translator || hexa_dump || get_headers || !map_template.empty())) {
+        fatal(L"option -f cannot be used with -a, -b, -d, -l, -m, -r, -s, -u, -w or -x");
+    }
+    if (!shared_header.empty() && (batch_dir.empty() || gen_binary || gen_list || gen_translator || hexa_dump || !map_template.empty())) {
+        fatal(L"option -g requires -b and cannot be used with -d, -l, -m, -s or -w");
+    }
+    if (compact && (analyze || compare || !footprint.empty() || !shared_header.empty() || gen_binary || gen_list || gen_resources || gen_translator || !map_template.empty())) {
+        fatal(L"option -z cannot be used with -a, -f, -g, -l, -m, -r, -s, -w or -x");
+    }
+    if (!compare && !analyze && footprint.empty() && batch_dir.empty() && inputs.size() > 1) {
+        fatal(L"only one keyboard layout can be specified without -b, try --help");
+    }
+    if (!batch_dir.empty() && (gen_resources || get_headers || !output.empty())) {
+        fatal(L"options -o, -r and -u are not allowed in batch mode");
+    }
+    if (gen_binary && batch_dir.empty() && output.empty()) {
+        fatal(L"option -w requires an output file (-o) or batch mode (-b)");
+    }
+    if (gen_binary && (gen_list || gen_resources || hexa_dump || get_headers || !map_template.empty())) {
+        fatal(L"option -w cannot be used with -d, -l, -m, -r or -u");
+    }
+    if (gen_translator && (gen_binary || gen_list || gen_resources || hexa_dump || !map_template.empty())) {
+        fatal(L"option -s cannot be used with -d, -l, -m, -r or -w");
+    }
+    input = inputs.front();
     if (get_headers) {
         // -u is used, load existing headers from previous output file, if it exists.
         std::string line;
-        std::ifstream prev(output);
+        std::ifstream prev(FilePath(output));
         while (std::getline(prev, line)) {
             // Remove leading (optional BOM) and trailing control characters.
             while (!line.empty() && line.back() < 0x20) {
@@ -186,7 +308,7 @@ static const WStringVector modifiers_headers {
     L"Shift/AltGr"  // Shift/Ctrl/Alt
 };
 
-const SymbolTable shift_state_symbols {
+constexpr auto shift_state_symbols = SortSymbols({
     SYM(KBDBASE),
     SYM(KBDSHIFT),
     SYM(KBDCTRL),
@@ -195,9 +317,9 @@ const SymbolTable shift_state_symbols {
     SYM(KBDROYA),
     SYM(KBDLOYA),
     SYM(KBDGRPSELTAP)
-};
+});
 
-const SymbolTable vk_symbols {
+constexpr auto vk_symbols = SortSymbols({
     SYM(VK_LBUTTON),
     SYM(VK_RBUTTON),
     SYM(VK_CANCEL),
@@ -427,9 +549,9 @@ const SymbolTable vk_symbols {
     SYM(VK_PA1),
     SYM(VK_OEM_CLEAR),
     SYM(VK__none_)
-};
+});
 
-const SymbolTable vk_flags_symbols {
+constexpr auto vk_flags_symbols = SortSymbols({
     SYM(KBDEXT),
     SYM(KBDMULTIVK),
     SYM(KBDSPECIAL),
@@ -438,18 +560,18 @@ const SymbolTable vk_flags_symbols {
     SYM(KBDINJECTEDVK),
     SYM(KBDMAPPEDVK),
     SYM(KBDBREAK)
-};
+});
 
-const SymbolTable vk_attr_symbols {
+constexpr auto vk_attr_symbols = SortSymbols({
     SYM(CAPLOK),
     SYM(SGCAPS),
     SYM(CAPLOKALTGR),
     SYM(KANALOK),
     SYM(GRPSELTAP)
-};
+});
 
-// Complete symbol for a WCHAR (a character literal).
-const SymbolTable wchar_symbols {
+// Complete symbol for a WCHAR (a character literal). Searched before unicode_symbols.
+constexpr auto wchar_symbols = SortSymbols({
     {'\t', L"L'\\t'"},
     {'\n', L"L'\\n'"},
     {'\r', L"L'\\r'"},
@@ -457,10 +579,12 @@ const SymbolTable wchar_symbols {
     {'\\', L"L'\\\\'"},
     SYM(WCH_NONE),
     SYM(WCH_DEAD),
-    SYM(WCH_LGTR),
-    // Automatically generated file (using a Python script)
-    #include "unicode_syms.h"
-};
+    SYM(WCH_LGTR)
+});
+
+// Automatically generated file (using a Python script), defines unicode_symbols, sorted by value.
+#include "unicode_syms.h"
+static_assert(IsSorted(unicode_symbols), "unicode_symbols must be sorted");
 
 
 //---------------------------------------------------------------------------
@@ -470,17 +594,37 @@ const SymbolTable wchar_symbols {
 class DataStructure
 {
 public:
-    WString name;
+    // Categories of data structures, for the memory footprint.
+    enum Category {
+        CAT_MAIN,          // KBDTABLES
+        CAT_MODIFIERS,     // MODIFIERS, VK_TO_BIT[]
+        CAT_SCANCODES,     // Scan codes to virtual keys
+        CAT_CHARACTERS,    // VK_TO_WCHAR_TABLE[], VK_TO_WCHARSn[]
+        CAT_DEADKEYS,      // DEADKEY[]
+        CAT_LIGATURES,     // LIGATUREn[]
+        CAT_KEYNAMES,      // VSC_LPWSTR[], DEADKEY_LPWSTR[]
+        CAT_STRINGS,       // Strings of the key names
+        CAT_PADDING,       // Zeroes between structures
+        CAT_UNREFERENCED,  // Non-zero data between structures
+        CAT_PAGE,          // Rest of the first and last memory pages
+        CAT_COUNT
+    };
+
+    // Name of a category, as used in footprint reports.
+    static const wchar_t* CategoryName(Category);
+
+    Category     category;
+    WString      name;
     const void*  address;
     size_t       size;
 
     // Constructors with address or integer.
-    DataStructure(const WString& n = L"", const void* a = nullptr, size_t s = 0)
-        : name(n), address(a), size(s) {}
-    DataStructure(const WString& n, const void* a, const void* end)
-        : name(n), address(a), size(uintptr_t(end) - uintptr_t(a)) {}
-    DataStructure(const WString& n, uintptr_t a, size_t s = 0)
-        : name(n), address(reinterpret_cast<const void*>(a)), size(s) {}
+    DataStructure(Category c, const WString& n, const void* a = nullptr, size_t s = 0)
+        : category(c), name(n), address(a), size(s) {}
+    DataStructure(Category c, const WString& n, const void* a, const void* end)
+        : category(c), name(n), address(a), size(uintptr_t(end) - uintptr_t(a)) {}
+    DataStructure(Category c, const WString& n, uintptr_t a, size_t s = 0)
+        : category(c), name(n), address(reinterpret_cast<const void*>(a)), size(s) {}
 
     // Get/set address after last byte.
     const void* end() const { return reinterpret_cast<const uint8_t*>(address) + size; }
@@ -490,10 +634,19 @@ public:
     bool operator<(const DataStructure& s) const { return address < s.address; }
 
     // Hexa dump of the structure.
-    void dump(std::ostream&) const;
+    void dump(UTF8Writer&) const;
 };
 
-void DataStructure::dump(std::ostream& out) const
+const wchar_t* DataStructure::CategoryName(Category cat)
+{
+    static const wchar_t* const names[CAT_COUNT] = {
+        L"main", L"modifiers", L"scancodes", L"characters", L"deadkeys", L"ligatures",
+        L"keynames", L"strings", L"padding", L"unreferenced", L"pagewaste"
+    };
+    return cat < CAT_COUNT ? names[cat] : L"?";
+}
+
+void DataStructure::dump(UTF8Writer& out) const
 {
     const WString header(name + Format(L" (%d bytes)", int(size)));
     out << "//" << std::endl
@@ -503,6 +656,35 @@ void DataStructure::dump(std::ostream& out) const
 }
 
 
+//---------------------------------------------------------------------------
+// Memory footprint of the data structures of a keyboard layout.
+//---------------------------------------------------------------------------
+
+class Footprint
+{
+public:
+    std::array<size_t, DataStructure::CAT_COUNT> bytes {};  // Bytes per category.
+    size_t page_size = 0;   // Size of a memory page.
+    size_t pages = 0;       // Number of memory pages of the data structures.
+    size_t image_size = 0;  // Size of the DLL image in memory, zero for a .wklbin file.
+    size_t data_size = 0;   // Size in memory of the data sections of the DLL (.data, .rdata), zero for a .wklbin file.
+    size_t data_pages = 0;  // Number of memory pages of the data sections of the DLL.
+    size_t block_size = 0;  // Size of the memory block of the data structures (DLL image, .wklbin file), zero if unknown.
+
+    // Total size of the data structures, without the rest of the first and last pages.
+    size_t total() const;
+};
+
+size_t Footprint::total() const
+{
+    size_t size = 0;
+    for (size_t cat = 0; cat < bytes.size(); ++cat) {
+        size += cat == DataStructure::CAT_PAGE ? 0 : bytes[cat];
+    }
+    return size;
+}
+
+
 //---------------------------------------------------------------------------
 // Generate various parts of the source file.
 //---------------------------------------------------------------------------
@@ -510,16 +692,64 @@ void DataStructure::dump(std::ostream& out) const
 class SourceGenerator
 {
 public:
-    // Constructor.
-    SourceGenerator(ReverseOptions& opt) : _ou(opt.out()), _opt(opt), _alldata() {}
+    // Constructor. The optional shared names are the names of the tables, indexed by address,
+    // which are generated in the shared header (option -g) instead of the source file.
+    SourceGenerator(const ReverseOptions& opt, std::ostream& out, const WString& input, const std::map<const void*, WString>* shared = nullptr) :
+        _ou(out), _opt(opt), _input(input), _shared(shared), _compact(nullptr), _binary(nullptr), _blocks(), _block_size(0), _alldata() {}
+
+    // Set the memory block which contains the data structures, the memory pages are relative to
+    // its start. Padding and unreferenced data are only reported inside the block.
+    // By default, the memory pages are computed from absolute addresses.
+    void setBlock(const void* base, size_t size);
+
+    // Measure the tables of a DLL in the mapped file: each section is a distinct memory block,
+    // at its RVA in the image, and the memory pages are relative to the start of the image.
+    void setImage(const PeFile& image);
+
+    // Measure the tables of a .wklbin file in the mapped file: the structures which are built
+    // by WklBinFile::kbdTables() are replaced with their serialized form in the file.
+    void setBinary(const WklBinFile& bin);
+
+    // Generate the tables of a compactor (option -z): the key names are references in the
+    // pool of strings and the tables are defined in reverse order of their memory layout.
+    void setCompact(const KbdCompactor& comp) { _compact = &comp; setBlock(comp.base(), comp.size()); }
 
     // Generate the source 
     void generate(const KBDTABLES&);
 
+    // Get the memory footprint of the data structures, after generate().
+    Footprint footprint();
+
+    // Generate one table of a layout, with the specified name (for the shared header).
+    void genTable(const KBDTABLES&, const KbdTableList::Table&, const WString& name);
+
+    // Name of the macro which enables a shared table in the shared header.
+    static WString SharedMacro(const WString& name) { return L"WKL_" + ToUpper(name); }
+
 private:
-    std::ostream&            _ou;
-    ReverseOptions&          _opt;
-    std::list<DataStructure> _alldata;
+    // A memory block which contains data structures, at some offset in the memory image.
+    struct Block
+    {
+        const uint8_t* base;
+        size_t         size;
+        uintptr_t      offset;
+    };
+
+    UTF8Writer                             _ou;
+    const ReverseOptions&                  _opt;
+    const WString                          _input;
+    const std::map<const void*, WString>*  _shared;
+    const KbdCompactor*                    _compact;
+    const WklBinFile*                      _binary;
+    std::vector<Block>                     _blocks;      // Memory blocks of the data structures.
+    size_t                                 _block_size;  // Size of the DLL image or file.
+    std::list<DataStructure>               _alldata;
+
+    // Name of the pool of strings in compact mode.
+    static constexpr const wchar_t* key_strings_name = L"key_strings";
+
+    // Check if a table is generated in the shared header. If true, get its shared name.
+    bool sharedTable(const void* table, WString& name) const;
 
     // Format an integer as a decimal or hexadecimal string.
     // If hex_digits is zero, format in decimal.
@@ -528,13 +758,13 @@ private:
     // Format an integer as a string, using a table of symbols.
     // If no symbol found or option -n, return a number.
     // If hex_digits is zero, format in decimal.
-    WString symbol(const SymbolTable& symbols, Value value, int hex_digits = 0);
+    WString symbol(SymbolTable symbols, Value value, int hex_digits = 0);
 
     // Format a bit mask of symbols, same principle as symbol().
-    WString bitMask(const SymbolTable& symbols, Value value, int hex_digits = 0);
+    WString bitMask(SymbolTable symbols, Value value, int hex_digits = 0);
 
     // Format a symbol and a bit mask of attributes, same principle as Symbol().
-    WString attributes(const SymbolTable& symbols, const SymbolTable& attributes, Value value, int hex_digits = 0);
+    WString attributes(SymbolTable symbols, SymbolTable attributes, Value value, int hex_digits = 0);
 
     // Format locale flags according to symbols.
     WString localeFlags(DWORD flags);
@@ -545,9 +775,24 @@ private:
     // Format a WCHAR. Add description in descs if one exists.
     WString wchar(wchar_t value);
 
+    // Format a reference to a string in the pool of strings, in compact mode.
+    WString pooledString(const WCHAR* str);
+
+    // Check if an area is inside one memory block of the data structures.
+    bool inBlock(const void* start, const void* end) const;
+
+    // Get the memory block which contains an address, null if there is none.
+    const Block* blockOf(const void* address) const;
+
+    // Get the offset of an address in the memory image, the absolute address when there is no block.
+    uintptr_t memoryOffset(const void* address) const;
+
     // Sort and merge adjacent data structures with same names (typically "Strings in ...").
     void sortDataStructures();
 
+    // Get the page size and the memory pages of the data structures, after sortDataStructures().
+    void pageBounds(size_t& page_size, uintptr_t& first_page, uintptr_t& last_page) const;
+
     // Generate the various data structures.
     void genVkToBits(const VK_TO_BIT*, const WString& name);
     void genCharModifiers(const MODIFIERS&, const WString& name);
@@ -557,6 +802,7 @@ private:
     void genDeadKeys(const DEADKEY*, const WString& name);
     void genVscToString(const VSC_LPWSTR*, const WString& name, const WString& comment = L"");
     void genKeyNames(const DEADKEY_LPWSTR*, const WString& name);
+    void genStringPool();
     void genScanToVk(const USHORT* vk, size_t vk_count, const WString& name);
     void genVscToVk(const VSC_VK*, const WString& name, const WString& comment = L"");
     void genHexaDump();
@@ -571,12 +817,12 @@ WString SourceGenerator::integer(Value value, int hex_digits)
 
 //---------------------------------------------------------------------------
 
-WString SourceGenerator::symbol(const SymbolTable& symbols, Value value, int hex_digits)
+WString SourceGenerator::symbol(SymbolTable symbols, Value value, int hex_digits)
 {
     if (!_opt.num_only) {
-        const auto it = symbols.find(value);
-        if (it != symbols.end()) {
-            return it->second;
+        const wchar_t* const name = FindSymbol(symbols, value);
+        if (name != nullptr) {
+            return name;
         }
     }
     return integer(value, hex_digits);
@@ -584,23 +830,28 @@ WString SourceGenerator::symbol(const SymbolTable& symbols, Value value, int hex
 
 //---------------------------------------------------------------------------
 
-WString SourceGenerator::bitMask(const SymbolTable& symbols, Value value, int hex_digits)
+WString SourceGenerator::bitMask(SymbolTable symbols, Value value, int hex_digits)
 {
     if (!_opt.num_only) {
         WString str;
         Value bits = 0;
-        for (const auto& sym : symbols) {
-            if (sym.first == 0 && value == 0) {
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            const Symbol& sym(symbols[i]);
+            if (i > 0 && sym.value == symbols[i-1].value) {
+                // Same value as previous symbol, use the first one only.
+                continue;
+            }
+            if (sym.value == 0 && value == 0) {
                 // Specific symbol for zero (no flag)
-                return sym.second;
+                return sym.name;
             }
-            if (sym.first != 0 && (value & sym.first) == sym.first) {
+            if (sym.value != 0 && (value & sym.value) == sym.value) {
                 // Found one flag.
                 if (!str.empty()) {
                     str += L" | ";
                 }
-                str += sym.second;
-                bits |= sym.first;
+                str += sym.name;
+                bits |= sym.value;
             }
         }
         if (bits != 0) {
@@ -619,13 +870,13 @@ WString SourceGenerator::bitMask(const SymbolTable& symbols, Value value, int he
 
 //---------------------------------------------------------------------------
 
-WString SourceGenerator::attributes(const SymbolTable& symbols, const SymbolTable& attributes, Value value, int hex_digits)
+WString SourceGenerator::attributes(SymbolTable symbols, SymbolTable attributes, Value value, int hex_digits)
 {
     if (!_opt.num_only) {
         // Compute mask of all possible attributes.
         Value all_attributes = 0;
         for (const auto& sym : attributes) {
-            all_attributes |= sym.first;
+            all_attributes |= sym.value;
         }
         // Base value.
         WString str(symbol(symbols, value & ~all_attributes, hex_digits));
@@ -646,8 +897,10 @@ WString SourceGenerator::localeFlags(const DWORD flags)
         return Format(L"0x%08X", flags);
     }
     else {
-        WString lostr(bitMask({ SYM(KLLF_ALTGR), SYM(KLLF_SHIFTLOCK), SYM(KLLF_LRM_RLM) }, LOWORD(flags), 4));
-        WString histr(symbol({ SYM(KBD_VERSION) }, HIWORD(flags), 4));
+        static constexpr auto locale_symbols = SortSymbols({ SYM(KLLF_ALTGR), SYM(KLLF_SHIFTLOCK), SYM(KLLF_LRM_RLM) });
+        static constexpr auto version_symbols = SortSymbols({ SYM(KBD_VERSION) });
+        WString lostr(bitMask(locale_symbols, LOWORD(flags), 4));
+        WString histr(symbol(version_symbols, HIWORD(flags), 4));
         return L"MAKELONG(" + lostr + L", " + histr + L")";
     }
 }
@@ -665,9 +918,12 @@ WString SourceGenerator::wchar(wchar_t value)
 {
     // Format a WCHAR. Add description in descs if one exists.
     if (!_opt.num_only) {
-        const auto sym = wchar_symbols.find(value);
-        if (sym != wchar_symbols.end()) {
-            return sym->second;
+        const wchar_t* name = FindSymbol(wchar_symbols, value);
+        if (name == nullptr) {
+            name = FindSymbol(unicode_symbols, value);
+        }
+        if (name != nullptr) {
+            return name;
         }
     }
     if (value == L'\'' || value == L'\\') {
@@ -687,8 +943,93 @@ WString SourceGenerator::wchar(wchar_t value)
 
 //---------------------------------------------------------------------------
 
+WString SourceGenerator::pooledString(const WCHAR* str)
+{
+    return str == nullptr ? WString(L"NULL") : Format(L"%s + %zu", key_strings_name, size_t(str - _compact->strings()));
+}
+
+//---------------------------------------------------------------------------
+
+void SourceGenerator::setBinary(const WklBinFile& bin)
+{
+    _binary = &bin;
+    if (bin.isLoaded()) {
+        setBlock(bin.header(), bin.size());
+        _alldata.push_back(DataStructure(DataStructure::CAT_MAIN, L"WklBinHeader", bin.header(), sizeof(WklBinHeader)));
+    }
+}
+
+//---------------------------------------------------------------------------
+
+void SourceGenerator::setBlock(const void* base, size_t size)
+{
+    _blocks.clear();
+    _blocks.push_back(Block{reinterpret_cast<const uint8_t*>(base), size, 0});
+    _block_size = size;
+}
+
+//---------------------------------------------------------------------------
+
+void SourceGenerator::setImage(const PeFile& image)
+{
+    _blocks.clear();
+    for (const auto& sec : image.sections()) {
+        const uint8_t* const base = image.data(sec.rva, sec.file_size);
+        if (base != nullptr && sec.file_size > 0) {
+            _blocks.push_back(Block{base, sec.file_size, sec.rva});
+        }
+    }
+    _block_size = image.imageSize();
+}
+
+//---------------------------------------------------------------------------
+
+const SourceGenerator::Block* SourceGenerator::blockOf(const void* address) const
+{
+    for (const auto& block : _blocks) {
+        if (address >= block.base && address <= block.base + block.size) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+//---------------------------------------------------------------------------
+
+bool SourceGenerator::inBlock(const void* start, const void* end) const
+{
+    const Block* const block = blockOf(start);
+    return block != nullptr && start <= end && end <= block->base + block->size;
+}
+
+//---------------------------------------------------------------------------
+
+uintptr_t SourceGenerator::memoryOffset(const void* address) const
+{
+    const Block* const block = blockOf(address);
+    return block == nullptr ? uintptr_t(address) : block->offset + (reinterpret_cast<const uint8_t*>(address) - block->base);
+}
+
+//---------------------------------------------------------------------------
+
 void SourceGenerator::sortDataStructures()
 {
+    // With a .wklbin file, use the serialized structures in the file instead of the ones in memory.
+    if (_binary != nullptr) {
+        for (auto it = _alldata.begin(); it != _alldata.end(); ) {
+            const auto areas(_binary->serializedAreas(it->address));
+            if (areas.empty()) {
+                ++it;
+            }
+            else {
+                for (const auto& area : areas) {
+                    _alldata.insert(it, DataStructure(it->category, it->name, area.first, area.second));
+                }
+                it = _alldata.erase(it);
+            }
+        }
+    }
+
     // Sort all data structures by address.
     _alldata.sort();
 
@@ -696,7 +1037,9 @@ void SourceGenerator::sortDataStructures()
     auto current = _alldata.begin();
     auto previous = current++;
     while (current != _alldata.end()) {
-        const bool inter_zero = IsZero(previous->end(), current->address);
+        // Spaces between structures are only meaningful inside the same memory block.
+        const bool same_block = inBlock(previous->end(), current->address);
+        const bool inter_zero = same_block && IsZero(previous->end(), current->address);
         // Merge if the two data structures have the same name and are adjacent or
         // only separated by zeroes (typpically padding).
         if (previous->name == current->name && (previous->end() == current->address || inter_zero)) {
@@ -706,8 +1049,9 @@ void SourceGenerator::sortDataStructures()
         }
         else {
             // If there is empty space between the two structures, create a structure for it.
-            if (previous->end() < current->address) {
-                DataStructure inter(inter_zero ? L"Padding" : L"Unreferenced", previous->end(), current->address);
+            if (same_block && previous->end() < current->address) {
+                const DataStructure::Category cat = inter_zero ? DataStructure::CAT_PADDING : DataStructure::CAT_UNREFERENCED;
+                DataStructure inter(cat, inter_zero ? L"Padding" : L"Unreferenced", previous->end(), current->address);
                 current = _alldata.insert(current, inter);
             }
             // Move to next pair of structures.
@@ -721,7 +1065,7 @@ void SourceGenerator::sortDataStructures()
 
 void SourceGenerator::genVkToBits(const VK_TO_BIT* vtb, const WString& name)
 {
-    DataStructure ds(name, vtb);
+    DataStructure ds(DataStructure::CAT_MODIFIERS, name, vtb);
 
     Grid grid;
     for (; vtb->Vk != 0; vtb++) {
@@ -750,21 +1094,22 @@ void SourceGenerator::genVkToBits(const VK_TO_BIT* vtb, const WString& name)
 
 void SourceGenerator::genCharModifiers(const MODIFIERS& mods, const WString& name)
 {
-    const wchar_t* vk_to_bits_name = L"vk_to_bits";
-    if (mods.pVkToBit != nullptr) {
+    WString vk_to_bits_name(L"vk_to_bits");
+    if (mods.pVkToBit != nullptr && !sharedTable(mods.pVkToBit, vk_to_bits_name)) {
         genVkToBits(mods.pVkToBit, vk_to_bits_name);
     }
 
+    static constexpr auto invalid_symbols = SortSymbols({SYM(SHFT_INVALID)});
     Grid grid;
     // Note: wMaxModBits is the "max value", ie. size = wMaxModBits + 1
     for (WORD i = 0; i <= mods.wMaxModBits; ++i) {
-        grid.addLine({symbol({SYM(SHFT_INVALID)}, mods.ModNumber[i]) + ","});
+        grid.addLine({symbol(invalid_symbols, mods.ModNumber[i]) + ","});
         if (!_opt.num_only && i < modifiers_comments.size()) {
             grid.addColumn(L"// " + modifiers_comments[i]);
         }
     }
 
-    DataStructure ds(name, &mods);
+    DataStructure ds(DataStructure::CAT_MODIFIERS, name, &mods);
     ds.setEnd(&mods.ModNumber[0] + mods.wMaxModBits + 1);
     _alldata.push_back(ds);
 
@@ -773,7 +1118,7 @@ void SourceGenerator::genCharModifiers(const MODIFIERS& mods, const WString& nam
         << "//" << _opt.dashed << std::endl
         << std::endl
         << "static MODIFIERS " << name << " = {" << std::endl
-        << "    .pVkToBit    = " << (mods.pVkToBit != nullptr ? vk_to_bits_name : L"NULL") << "," << std::endl
+        << "    .pVkToBit    = " << (mods.pVkToBit != nullptr ? vk_to_bits_name : WString(L"NULL")) << "," << std::endl
         << "    .wMaxModBits = " << mods.wMaxModBits << "," << std::endl
         << "    .ModNumber   = {" << std::endl;
     grid.setMargin(8);
@@ -787,7 +1132,7 @@ void SourceGenerator::genCharModifiers(const MODIFIERS& mods, const WString& nam
 
 void SourceGenerator::genSubVkToWchar(const VK_TO_WCHARS10* vtwc, size_t count, size_t size, const WString& name, const MODIFIERS* mods)
 {
-    DataStructure ds(name, vtwc);
+    DataStructure ds(DataStructure::CAT_CHARACTERS, name, vtwc);
     Grid grid;
 
     // Add header lines of comments to indicate the type of modifier on top of each column.
@@ -850,12 +1195,14 @@ void SourceGenerator::genSubVkToWchar(const VK_TO_WCHARS10* vtwc, size_t count,
 
 void SourceGenerator::genVkToWchar(const VK_TO_WCHAR_TABLE* vtwc, const WString& name, const::MODIFIERS* mods)
 {
-    DataStructure ds(name, vtwc);
+    DataStructure ds(DataStructure::CAT_CHARACTERS, name, vtwc);
 
     Grid grid;
     for (; vtwc->pVkToWchars != nullptr; vtwc++) {
-        const WString sub_name(Format(L"vk_to_wchar%d", vtwc->nModifications));
-        genSubVkToWchar(reinterpret_cast<PVK_TO_WCHARS10>(vtwc->pVkToWchars), vtwc->nModifications, vtwc->cbSize, sub_name, mods);
+        WString sub_name(Format(L"vk_to_wchar%d", vtwc->nModifications));
+        if (!sharedTable(vtwc->pVkToWchars, sub_name)) {
+            genSubVkToWchar(reinterpret_cast<PVK_TO_WCHARS10>(vtwc->pVkToWchars), vtwc->nModifications, vtwc->cbSize, sub_name, mods);
+        }
         grid.addLine({
             L"{(PVK_TO_WCHARS1)" + sub_name + L",",
             Format(L"%d,", vtwc->nModifications),
@@ -882,7 +1229,7 @@ void SourceGenerator::genVkToWchar(const VK_TO_WCHAR_TABLE* vtwc, const WString&
 
 void SourceGenerator::genLgToWchar(const LIGATURE1* ligatures, size_t count, size_t size, const WString& name, const MODIFIERS* mods)
 {
-    DataStructure ds(name, ligatures);
+    DataStructure ds(DataStructure::CAT_LIGATURES, name, ligatures);
     const LIGATURE_MAX* lg = reinterpret_cast<const LIGATURE_MAX*>(ligatures);
 
     Grid grid;
@@ -957,8 +1304,9 @@ void SourceGenerator::genLgToWchar(const LIGATURE1* ligatures, size_t count, siz
 
 void SourceGenerator::genDeadKeys(const DEADKEY* dk, const WString& name)
 {
-    DataStructure ds(name, dk);
+    DataStructure ds(DataStructure::CAT_DEADKEYS, name, dk);
 
+    static constexpr auto dkf_symbols = SortSymbols({SYM(DKF_DEAD)});
     Grid grid;
     grid.addLine({L"//", L"Accent", L"Composed", L"Flags"});
     grid.addUnderlines({L"//"});
@@ -967,7 +1315,7 @@ void SourceGenerator::genDeadKeys(const DEADKEY* dk, const WString& name)
             L"DEADTRANS(" + wchar(LOWORD(dk->dwBoth)) + ",",
             wchar(HIWORD(dk->dwBoth)) + ",",
             wchar(dk->wchComposed) + ",",
-            bitMask({SYM(DKF_DEAD)}, dk->uFlags, 4) + "),"
+            bitMask(dkf_symbols, dk->uFlags, 4) + "),"
         });
     }
     dk++; // last null element
@@ -991,15 +1339,24 @@ void SourceGenerator::genDeadKeys(const DEADKEY* dk, const WString& name)
 
 void SourceGenerator::genVscToString(const VSC_LPWSTR* vts, const WString& name, const WString& comment)
 {
-    DataStructure ds(name, vts);
+    DataStructure ds(DataStructure::CAT_KEYNAMES, name, vts);
 
     Grid grid;
     for (; vts->vsc != 0; vts++) {
-        grid.addLine({
-            L"{" + Format(L"0x%02X", vts->vsc) + L",",
-            WStringLiteral(vts->pwsz) + L"},"
-        });
-        _alldata.push_back(DataStructure("Strings in " + name, vts->pwsz, WStringSize(vts->pwsz)));
+        if (_compact != nullptr) {
+            grid.addLine({
+                L"{" + Format(L"0x%02X", vts->vsc) + L",",
+                pooledString(vts->pwsz) + L"},",
+                L"// " + WStringLiteral(vts->pwsz)
+            });
+        }
+        else {
+            grid.addLine({
+                L"{" + Format(L"0x%02X", vts->vsc) + L",",
+                WStringLiteral(vts->pwsz) + L"},"
+            });
+            _alldata.push_back(DataStructure(DataStructure::CAT_STRINGS, "Strings in " + name, vts->pwsz, WStringSize(vts->pwsz)));
+        }
     }
     grid.addLine({L"{0x00,", L"NULL}"});
     vts++;
@@ -1021,14 +1378,19 @@ void SourceGenerator::genVscToString(const VSC_LPWSTR* vts, const WString& name,
 
 void SourceGenerator::genKeyNames(const DEADKEY_LPWSTR* names, const WString& name)
 {
-    DataStructure ds(name, names);
+    DataStructure ds(DataStructure::CAT_KEYNAMES, name, names);
 
     Grid grid;
     for (; *names != nullptr; ++names) {
         if (**names != 0) {
             WCHAR prefix[2]{ **names, L'\0' };
-            grid.addLine({WStringLiteral(prefix), WStringLiteral(*names + 1) + ","});
-            _alldata.push_back(DataStructure("Strings in " + name, *names, WStringSize(*names)));
+            if (_compact != nullptr) {
+                grid.addLine({pooledString(*names) + ",", L"// " + WStringLiteral(prefix) + L" " + WStringLiteral(*names + 1)});
+            }
+            else {
+                grid.addLine({WStringLiteral(prefix), WStringLiteral(*names + 1) + ","});
+                _alldata.push_back(DataStructure(DataStructure::CAT_STRINGS, "Strings in " + name, *names, WStringSize(*names)));
+            }
         }
     }
     ++names; // skip last null pointer
@@ -1048,9 +1410,45 @@ void SourceGenerator::genKeyNames(const DEADKEY_LPWSTR* names, const WString& na
 
 //---------------------------------------------------------------------------
 
+void SourceGenerator::genStringPool()
+{
+    const WCHAR* const strings = _compact->strings();
+    const size_t count = _compact->stringsCount();
+    _alldata.push_back(DataStructure(DataStructure::CAT_STRINGS, key_strings_name, strings, count * sizeof(WCHAR)));
+
+    // One line per string, the last nul character is implicit.
+    Grid grid;
+    for (size_t start = 0; start < count; ) {
+        size_t end = start;
+        while (end < count && strings[end] != 0) {
+            end++;
+        }
+        WString literal(WStringLiteral(WString(strings + start, strings + end)));
+        if (end + 1 < count) {
+            literal.insert(literal.size() - 1, L"\\0");
+        }
+        else {
+            literal.push_back(L';');
+        }
+        grid.addLine({Format(L"/* %zu */", start), literal});
+        start = end + 1;
+    }
+
+    _ou << "//" << _opt.dashed << std::endl
+        << "// Pool of key names, a name which is the end of another one is not duplicated" << std::endl
+        << "//" << _opt.dashed << std::endl
+        << std::endl
+        << "static WCHAR " << key_strings_name << "[] =" << std::endl;
+    grid.setMargin(4);
+    grid.print(_ou);
+    _ou << std::endl;
+}
+
+//---------------------------------------------------------------------------
+
 void SourceGenerator::genScanToVk(const USHORT* vk, size_t vk_count, const WString& name)
 {
-    DataStructure ds(name, vk, vk_count * sizeof(*vk));
+    DataStructure ds(DataStructure::CAT_SCANCODES, name, vk, vk_count * sizeof(*vk));
     _alldata.push_back(ds);
 
     _ou << "//" << _opt.dashed << std::endl
@@ -1060,7 +1458,7 @@ void SourceGenerator::genScanToVk(const USHORT* vk, size_t vk_count, const WStri
         << "static USHORT " << name << "[] = {" << std::endl;
  
     for (size_t i = 0; i < vk_count; ++i) {
-        _ou << Format(L"    /* %02X */ ", i) << attributes(vk_symbols, vk_flags_symbols, vk[i], 4) << "," << std::endl;
+        _ou.format(L"    /* %02X */ ", i) << attributes(vk_symbols, vk_flags_symbols, vk[i], 4) << "," << std::endl;
     }
 
     _ou << "};" << std::endl << std::endl;
@@ -1070,7 +1468,7 @@ void SourceGenerator::genScanToVk(const USHORT* vk, size_t vk_count, const WStri
 
 void SourceGenerator::genVscToVk(const VSC_VK* vtvk, const WString& name, const WString& comment)
 {
-    DataStructure ds(name, vtvk);
+    DataStructure ds(DataStructure::CAT_SCANCODES, name, vtvk);
 
     Grid grid;
     for (; vtvk->Vsc != 0; vtvk++) {
@@ -1108,7 +1506,7 @@ void SourceGenerator::generate(const KBDTABLES& tables)
     if (_opt.headers.empty()) {
         _ou << "//" << _opt.dashed << std::endl
             << "// " << _opt.comment << std::endl
-            << "// Automatically generated from " << FileName(_opt.input) << std::endl
+            << "// Automatically generated from " << FileName(_input) << std::endl
             << "//" << _opt.dashed << std::endl;
     }
     else {
@@ -1127,33 +1525,62 @@ void SourceGenerator::generate(const KBDTABLES& tables)
     }
     _ou << std::endl;
 
-    const WString key_names_name(L"key_names");
-    if (tables.pKeyNames != nullptr) {
+    // Tables which are generated in the shared header.
+    if (_shared != nullptr && !_shared->empty()) {
+        for (const auto& it : *_shared) {
+            _ou << "#define " << SharedMacro(it.second) << std::endl;
+        }
+        _ou << "#include \"" << FileName(_opt.shared_header) << "\"" << std::endl
+            << std::endl;
+    }
+
+    // In compact mode, the pool of strings is defined first, the dead keys and ligatures
+    // before the scan codes: the tables which are used on each keystroke are defined last.
+    if (_compact != nullptr && _compact->stringsCount() > 0) {
+        genStringPool();
+    }
+
+    WString key_names_name(L"key_names");
+    if (tables.pKeyNames != nullptr && !sharedTable(tables.pKeyNames, key_names_name)) {
         genVscToString(tables.pKeyNames, key_names_name);
     }
 
-    const WString key_names_ext_name(L"key_names_ext");
-    if (tables.pKeyNamesExt != nullptr) {
+    WString key_names_ext_name(L"key_names_ext");
+    if (tables.pKeyNamesExt != nullptr && !sharedTable(tables.pKeyNamesExt, key_names_ext_name)) {
         genVscToString(tables.pKeyNamesExt, key_names_ext_name, L" (extended keypad)");
     }
 
-    const WString key_names_dead_name(L"key_names_dead");
-    if (tables.pKeyNamesDead != nullptr) {
+    WString key_names_dead_name(L"key_names_dead");
+    if (tables.pKeyNamesDead != nullptr && !sharedTable(tables.pKeyNamesDead, key_names_dead_name)) {
         genKeyNames(tables.pKeyNamesDead, key_names_dead_name);
     }
 
-    const WString scancode_to_vk_name(L"scancode_to_vk");
-    if (tables.pusVSCtoVK != nullptr) {
+    WString dead_keys_name(L"dead_keys");
+    WString ligatures_name(L"ligatures");
+    const auto gen_dead_keys = [&]() {
+        if (tables.pDeadKey != nullptr && !sharedTable(tables.pDeadKey, dead_keys_name)) {
+            genDeadKeys(tables.pDeadKey, dead_keys_name);
+        }
+        if (tables.pLigature != nullptr && !sharedTable(tables.pLigature, ligatures_name)) {
+            genLgToWchar(tables.pLigature, tables.nLgMax, tables.cbLgEntry, ligatures_name, tables.pCharModifiers);
+        }
+    };
+    if (_compact != nullptr) {
+        gen_dead_keys();
+    }
+
+    WString scancode_to_vk_name(L"scancode_to_vk");
+    if (tables.pusVSCtoVK != nullptr && !sharedTable(tables.pusVSCtoVK, scancode_to_vk_name)) {
         genScanToVk(tables.pusVSCtoVK, tables.bMaxVSCtoVK, scancode_to_vk_name);
     }
 
-    const WString scancode_to_vk_e0_name(L"scancode_to_vk_e0");
-    if (tables.pVSCtoVK_E0 != nullptr) {
+    WString scancode_to_vk_e0_name(L"scancode_to_vk_e0");
+    if (tables.pVSCtoVK_E0 != nullptr && !sharedTable(tables.pVSCtoVK_E0, scancode_to_vk_e0_name)) {
         genVscToVk(tables.pVSCtoVK_E0, scancode_to_vk_e0_name, L" (scancodes with E0 prefix)");
     }
 
-    const WString scancode_to_vk_e1_name(L"scancode_to_vk_e1");
-    if (tables.pVSCtoVK_E1 != nullptr) {
+    WString scancode_to_vk_e1_name(L"scancode_to_vk_e1");
+    if (tables.pVSCtoVK_E1 != nullptr && !sharedTable(tables.pVSCtoVK_E1, scancode_to_vk_e1_name)) {
         genVscToVk(tables.pVSCtoVK_E1, scancode_to_vk_e1_name, L" (scancodes with E1 prefix)");
     }
 
@@ -1167,19 +1594,13 @@ void SourceGenerator::generate(const KBDTABLES& tables)
         genVkToWchar(tables.pVkToWcharTable, vk_to_wchar_name, tables.pCharModifiers);
     }
 
-    const WString dead_keys_name(L"dead_keys");
-    if (tables.pDeadKey != nullptr) {
-        genDeadKeys(tables.pDeadKey, dead_keys_name);
-    }
-
-    const WString ligatures_name(L"ligatures");
-    if (tables.pLigature != nullptr) {
-        genLgToWchar(tables.pLigature, tables.nLgMax, tables.cbLgEntry, ligatures_name, tables.pCharModifiers);
+    if (_compact == nullptr) {
+        gen_dead_keys();
     }
 
     // Generate main table.
     const WString kbd_table_name(L"kbd_tables");
-    _alldata.push_back(DataStructure(kbd_table_name, &tables, sizeof(tables)));
+    _alldata.push_back(DataStructure(DataStructure::CAT_MAIN, kbd_table_name, &tables, sizeof(tables)));
     _ou << "//" << _opt.dashed << std::endl
         << "// Main keyboard layout structure, point to all tables" << std::endl
         << "//" << _opt.dashed << std::endl
@@ -1216,24 +1637,130 @@ void SourceGenerator::generate(const KBDTABLES& tables)
     if (_opt.hexa_dump) {
         genHexaDump();
     }
+
+    // Write the pending data, the output stream may be used after the generator.
+    _ou.flush();
 }
 
 //---------------------------------------------------------------------------
 
-void SourceGenerator::genHexaDump()
+bool SourceGenerator::sharedTable(const void* table, WString& name) const
 {
-    // Rearrange, merge, describe inter-structure spaces, etc.
-    sortDataStructures();
+    if (_shared != nullptr) {
+        const auto it = _shared->find(table);
+        if (it != _shared->end()) {
+            name = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+
+void SourceGenerator::genTable(const KBDTABLES& tables, const KbdTableList::Table& table, const WString& name)
+{
+    switch (table.kind) {
+        case KbdTableList::KEY_NAMES:
+            genVscToString(tables.pKeyNames, name);
+            break;
+        case KbdTableList::KEY_NAMES_EXT:
+            genVscToString(tables.pKeyNamesExt, name, L" (extended keypad)");
+            break;
+        case KbdTableList::KEY_NAMES_DEAD:
+            genKeyNames(tables.pKeyNamesDead, name);
+            break;
+        case KbdTableList::SCANCODE_TO_VK:
+            genScanToVk(tables.pusVSCtoVK, tables.bMaxVSCtoVK, name);
+            break;
+        case KbdTableList::SCANCODE_TO_VK_E0:
+            genVscToVk(tables.pVSCtoVK_E0, name, L" (scancodes with E0 prefix)");
+            break;
+        case KbdTableList::SCANCODE_TO_VK_E1:
+            genVscToVk(tables.pVSCtoVK_E1, name, L" (scancodes with E1 prefix)");
+            break;
+        case KbdTableList::VK_TO_BITS:
+            genVkToBits(tables.pCharModifiers->pVkToBit, name);
+            break;
+        case KbdTableList::VK_TO_WCHARS:
+            genSubVkToWchar(reinterpret_cast<const VK_TO_WCHARS10*>(table.address), table.columns, table.entry_size, name, tables.pCharModifiers);
+            break;
+        case KbdTableList::DEAD_KEYS:
+            genDeadKeys(tables.pDeadKey, name);
+            break;
+        case KbdTableList::LIGATURES:
+            genLgToWchar(tables.pLigature, tables.nLgMax, tables.cbLgEntry, name, tables.pCharModifiers);
+            break;
+    }
+    _ou.flush();
+}
+
+//---------------------------------------------------------------------------
 
+void SourceGenerator::pageBounds(size_t& page_size, uintptr_t& first_page, uintptr_t& last_page) const
+{
     // Get system page size.
+#if defined(_WIN32)
     SYSTEM_INFO sysinfo;
     GetSystemInfo(&sysinfo);
-    const size_t page_size = size_t(sysinfo.dwPageSize);
+    page_size = size_t(sysinfo.dwPageSize);
+#else
+    page_size = 4096; // page size of Windows on all architectures
+#endif
+
+    // The pages are offsets in the memory image: a mapped file is not necessarily page-aligned
+    // and the sections of a DLL are not at the same distance in the file and in memory.
+    const uintptr_t first_offset = memoryOffset(_alldata.front().address);
+    const uintptr_t last_offset = memoryOffset(_alldata.back().end());
+    first_page = first_offset - first_offset % page_size;
+    last_page = last_offset + (page_size - last_offset % page_size) % page_size;
+}
+
+//---------------------------------------------------------------------------
 
+Footprint SourceGenerator::footprint()
+{
+    sortDataStructures();
+    Footprint fp;
+    for (const auto& data : _alldata) {
+        fp.bytes[data.category] += data.size;
+    }
+    uintptr_t first_page = 0;
+    uintptr_t last_page = 0;
+    pageBounds(fp.page_size, first_page, last_page);
+    fp.pages = (last_page - first_page) / fp.page_size;
+    // The rest of the pages: the first and last pages, and the spaces between memory blocks.
+    const size_t used = fp.total();
+    fp.bytes[DataStructure::CAT_PAGE] = last_page - first_page > used ? last_page - first_page - used : 0;
+    fp.block_size = _block_size;
+    return fp;
+}
+
+//---------------------------------------------------------------------------
+
+void SourceGenerator::genHexaDump()
+{
+    // Rearrange, merge, describe inter-structure spaces, etc.
+    sortDataStructures();
+
+    size_t page_size = 0;
+    uintptr_t first_page = 0;
+    uintptr_t last_page = 0;
+    pageBounds(page_size, first_page, last_page);
     const uintptr_t first_address = uintptr_t(_alldata.front().address);
     const uintptr_t last_address = uintptr_t(_alldata.back().end());
-    const uintptr_t first_page = first_address - first_address % page_size;
-    const uintptr_t last_page = last_address + (page_size - last_address % page_size) % page_size;
+
+    // The rest of the first and last pages, in the memory blocks of the first and last structures.
+    const Block* const first_block = blockOf(_alldata.front().address);
+    const Block* const last_block = blockOf(_alldata.back().end());
+    size_t head = memoryOffset(_alldata.front().address) - first_page;
+    size_t tail = last_page - memoryOffset(_alldata.back().end());
+    if (first_block != nullptr) {
+        head = std::min(head, size_t(first_address - uintptr_t(first_block->base)));
+    }
+    if (last_block != nullptr) {
+        tail = std::min(tail, size_t(uintptr_t(last_block->base) + last_block->size - last_address));
+    }
 
     _ou << std::endl
         << "//" << _opt.dashed << std::endl
@@ -1241,12 +1768,13 @@ void SourceGenerator::genHexaDump()
         << "//" << _opt.dashed << std::endl
         << "//" << std::endl
         << "// Total size: " << (last_page - first_page) << " bytes (" << ((last_page - first_page) / page_size) << " pages)" << std::endl
-        << Format(L"// Base: 0x%08llX", size_t(first_page)) << std::endl
-        << Format(L"// End:  0x%08llX", size_t(last_page)) << std::endl;
+        << "// Base: 0x";
+    _ou.hexa(first_page, 8) << std::endl << "// End:  0x";
+    _ou.hexa(last_page, 8) << std::endl;
 
     // Dump start of memory page, before the first data structure.
-    if (first_page < first_address) {
-        const DataStructure ds(L"Start of memory page before first data structure", first_page, first_address - first_page);
+    if (head > 0) {
+        const DataStructure ds(DataStructure::CAT_PAGE, L"Start of memory page before first data structure", first_address - head, head);
         ds.dump(_ou);
     }
 
@@ -1256,8 +1784,8 @@ void SourceGenerator::genHexaDump()
     }
 
     // Dump end of memory page after last structure.
-    if (last_address < last_page) {
-        const DataStructure ds(L"End of memory page after last data structure", last_address, last_page - last_address);
+    if (tail > 0) {
+        const DataStructure ds(DataStructure::CAT_PAGE, L"End of memory page after last data structure", last_address, tail);
         ds.dump(_ou);
     }
 }
@@ -1267,11 +1795,13 @@ void SourceGenerator::genHexaDump()
 // Generate the partial resource file for WKL project.
 //---------------------------------------------------------------------------
 
-void GenerateResourceFile(ReverseOptions& opt, HMODULE hmod)
+#if defined(_WIN32)
+
+void GenerateResourceFile(ReverseOptions& opt)
 {
     // Extract file information from the file.
     FileVersionInfo info(opt);
-    if (!info.load(hmod)) {
+    if (!info.load(opt.input)) {
         opt.fatal("Error loading version information from " + opt.input);
     }
 
@@ -1357,26 +1887,39 @@ void GenerateResourceFile(ReverseOptions& opt, HMODULE hmod)
     }
 }
 
+#else
+
+void GenerateResourceFile(ReverseOptions& opt)
+{
+    // The version information and the registry are only available on Windows.
+    opt.fatal(L"option -r is only available on Windows");
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Generate a character table for the keyboard DLL.
 //---------------------------------------------------------------------------
 
-void GenerateCharacterTableLine(Grid& grid, uint16_t sc, const VirtualKey& vk, bool extended)
+void GenerateCharacterTableLine(Grid& grid, const WinKeyMap& kmap, uint16_t sc, bool extended)
 {
-    if (sc != 0 && vk.vk != 0) {
-        const auto it = vk_symbols.find(vk.vk);
+    const uint8_t vk = kmap.virtualKey(sc, extended);
+    if (sc != 0 && vk != 0) {
+        const wchar_t* const name = FindSymbol(vk_symbols, vk);
         grid.addLine({
             Format(L"%02X%s", sc, extended ? L" (ext)" : L""),
-            it != vk_symbols.end() ? it->second : Format(L"%02X", vk.vk)
+            name != nullptr ? name : Format(L"%02X", vk)
             });
-        for (wchar_t c : vk.wc) {
+        const wchar_t* const chars = kmap.characters(sc, extended);
+        for (size_t mod = 0; mod < WinKeyMap::MOD_COUNT; ++mod) {
+            const wchar_t c = chars[mod];
             grid.addColumn(c < L' ' || c == UC_DEL ? L"" : WString(1, c));
         }
     }
 }
 
-void GenerateCharacterTable(ReverseOptions& opt, const KBDTABLES* tables)
+void GenerateCharacterTable(std::ostream& out, const KBDTABLES* tables)
 {
     // Header lines.
     Grid grid;
@@ -1386,13 +1929,10 @@ void GenerateCharacterTable(ReverseOptions& opt, const KBDTABLES* tables)
     grid.addUnderlines();
 
     // List of characters.
-    WinKeyMap kmap(tables);
-    WinKeyVector keys;
-    kmap.buildKeyMap(keys);
-
-    for (const auto& wk : keys) {
-        GenerateCharacterTableLine(grid, wk.sc, wk.vk, false);
-        GenerateCharacterTableLine(grid, wk.sc, wk.evk, true);
+    const WinKeyMap kmap(tables);
+    for (uint16_t sc = 0; sc < WinKeyMap::SC_COUNT; ++sc) {
+        GenerateCharacterTableLine(grid, kmap, sc, false);
+        GenerateCharacterTableLine(grid, kmap, sc, true);
     }
 
     // Remove unused spaces.
@@ -1401,8 +1941,8 @@ void GenerateCharacterTable(ReverseOptions& opt, const KBDTABLES* tables)
 
     // Print the grid.
     grid.setSpacing(2);
-    opt.out() << UTF8_BOM;
-    grid.print(opt.out());
+    out << UTF8_BOM;
+    grid.print(out);
 }
 
 
@@ -1410,26 +1950,25 @@ void GenerateCharacterTable(ReverseOptions& opt, const KBDTABLES* tables)
 // Generate a keyboard map for the keyboard DLL.
 //---------------------------------------------------------------------------
 
-void GenerateKeyboardMap(ReverseOptions& opt, const KBDTABLES* tables)
+bool GenerateKeyboardMap(const ReverseOptions& opt, Error& err, std::ostream& out, const KBDTABLES* tables)
 {
     // Open the map template file.
-    std::ifstream inmap(opt.map_template);
+    std::ifstream inmap(FilePath(opt.map_template));
     if (!inmap) {
-        opt.fatal("error opening file " + opt.map_template);
+        err.error("error opening file " + opt.map_template);
+        return false;
     }
 
     // Get lists of characters.
-    WinKeyMap kmap(tables);
-    WinKeyVector keys;
-    kmap.buildKeyMap(keys);
+    const WinKeyMap kmap(tables);
 
     // Read map template line by line and generate the map..
-    opt.out() << UTF8_BOM;
+    out << UTF8_BOM;
     std::string mapline;
     for (size_t linenum = 1; std::getline(inmap, mapline); ++linenum) {
         if (mapline.find_first_of("0123456789abcdefABCEDF") == std::string::npos) {
             // No scancode hexa value, just copy the line
-            opt.out() << mapline << std::endl;
+            out << mapline << std::endl;
         }
         else {
             // Format a double line replacing the scancodes with the generated characters.
@@ -1463,28 +2002,27 @@ void GenerateKeyboardMap(ReverseOptions& opt, const KBDTABLES* tables)
                 assert(hex < end);
                 size_t scancode = 0;
                 if (hex + 2 >= end || !FromHexa(scancode, in.substr(hex, 2))) {
-                    opt.error(Format(L"invalid cell \"%s\" in %s, line %d, col %d", in.substr(start, width).c_str(), opt.map_template.c_str(), linenum, start + 1));
+                    err.error(Format(L"invalid cell \"%s\" in %s, line %d, col %d", in.substr(start, width).c_str(), opt.map_template.c_str(), linenum, start + 1));
                     end = start;
                     break;
                 }
                 const bool extended = hex + 2 < end && in[hex + 2] == L'e';
 
                 // Find corresponding character definition.
-                bool known = scancode < keys.size() && keys[scancode].sc != 0;
-                const VirtualKey& vk(extended ? keys[scancode].evk : keys[scancode].vk);
-                known = known && vk.vk != 0;
+                const bool known = scancode != 0 && scancode < WinKeyMap::SC_COUNT && kmap.virtualKey(scancode, extended) != 0;
+                const wchar_t* const chars = kmap.characters(scancode, extended);
 
                 // Format chars.
                 const WString left(width == 2 ? 0 : (width - 3) / 2, L' ');
                 const WString right(width == 2 ? 0 : width - left.size() - 3, L' ');
                 line1.append(left);
                 line2.append(left);
-                line1.push_back(known ? Printable(vk.wc[KBDSHIFT]) : L' ');
-                line2.push_back(known ? Printable(vk.wc[KBDBASE]) : L' ');
+                line1.push_back(known ? Printable(chars[KBDSHIFT]) : L' ');
+                line2.push_back(known ? Printable(chars[KBDBASE]) : L' ');
                 line1.append(width == 2 ? L"" : L" ");
                 line2.append(width == 2 ? L"" : L" ");
-                line1.push_back(known ? Printable(vk.wc[KBDSHIFT | KBDCTRL | KBDALT]) : L' ');
-                line2.push_back(known ? Printable(vk.wc[KBDCTRL | KBDALT]) : L' ');
+                line1.push_back(known ? Printable(chars[KBDSHIFT | KBDCTRL | KBDALT]) : L' ');
+                line2.push_back(known ? Printable(chars[KBDCTRL | KBDALT]) : L' ');
                 line1.append(right);
                 line2.append(right);
             }
@@ -1492,64 +2030,1394 @@ void GenerateKeyboardMap(ReverseOptions& opt, const KBDTABLES* tables)
             // Append end of template line.
             line1.append(in.substr(end));
             line2.append(in.substr(end));
-            opt.out() << line1 << std::endl << line2 << std::endl;
+            out << line1 << std::endl << line2 << std::endl;
         }
     }
+    return true;
 }
 
 
 //---------------------------------------------------------------------------
-// Application entry point.
+// Generate a C++ header with a keystroke translator specialized for the
+// keyboard layout. The tables are the compiled tables of KbdEngine, emitted
+// as constexpr arrays, and the dead keys and ligatures are switch statements.
 //---------------------------------------------------------------------------
 
-int wmain(int argc, wchar_t* argv[])
+class TranslatorGenerator
 {
-    // Parse command line options.
-    ReverseOptions opt(argc, argv);
+public:
+    // Constructor.
+    TranslatorGenerator(const ReverseOptions& opt, std::ostream& out, const WString& input) : _ou(out), _opt(opt), _input(input) {}
+
+    // Generate the header file.
+    void generate(const KBDTABLES&);
 
-    // Resolve keyboard DLL file name.
-    if (opt.input.find_first_of(L":\\/.") == WString::npos) {
-        // No separator, must be a keyboard name, not a DLL file name.
-        opt.input = GetSystem32() + L"\\kbd" + opt.input + L".dll";
+private:
+    UTF8Writer            _ou;
+    const ReverseOptions& _opt;
+    const WString         _input;
+
+    // Generate a constexpr array of integers, 16 values per line.
+    template <typename INT_T>
+    void genArray(const char* type, const char* name, const std::vector<INT_T>& values, int hex_digits);
+
+    // Generate the dead key and ligature handlers.
+    void genCompose(const KBDTABLES&);
+    void genLigatures(const KbdEngine&);
+};
+
+// Fixed part of the translator, same processing as KbdEngine, using the generated tables.
+// Any change in KbdEngine::translate() must be reported here: tools/kbdreverse-test/roundtrip.py
+// compares both translations on each DLL with tools/kbdgencheck.cpp.
+static const char translator_code[] = R"(
+// Modifier bits of the pressed keys, without locks.
+inline uint8_t Modifiers(const State& state)
+{
+    return uint8_t(KEYS_BITS[state.keys & 0xFF] | KEYS_BITS[256 + (state.keys >> 8)]);
+}
+
+// Update the tracked keys and locks. Return false if the key is not tracked.
+inline bool TrackKey(uint8_t vk, uint8_t flags, State& state)
+{
+    const size_t slot = VK_SLOT[vk];
+    if (slot == 0) {
+        return false;
     }
- 
-    // Load the DLL in our virtual memory space.
-    HMODULE dll = LoadLibraryW(opt.input.c_str());
-    if (dll == nullptr) {
-        const DWORD err = GetLastError();
-        opt.fatal(opt.input + ": " + ErrorText(err));
+    const uint16_t mask = uint16_t(1 << (slot - 1));
+    if ((flags & EV_BREAK) != 0) {
+        state.keys = uint16_t(state.keys & ~mask);
+    }
+    else if ((state.keys & mask) == 0) {
+        state.keys = uint16_t(state.keys | mask);
+        const uint8_t lock = SLOT_LOCK[slot - 1];
+        if (lock == LOCK_CAPITAL && SHIFT_LOCK) {
+            state.locks = uint8_t(state.locks | LOCK_CAPITAL);
+        }
+        else {
+            state.locks = uint8_t(state.locks ^ lock);
+        }
+        if ((SLOT_BITS[slot - 1] & MOD_SHIFT) != 0 && SHIFT_LOCK) {
+            state.locks = uint8_t(state.locks & ~LOCK_CAPITAL);
+        }
     }
+    return true;
+}
 
-    // Get the DLL entry point.
-    FARPROC proc_addr = GetProcAddress(dll, KBD_DLL_ENTRY_NAME);
-    if (proc_addr == nullptr) {
-        const DWORD err = GetLastError();
-        opt.fatal("cannot find " KBD_DLL_ENTRY_NAME " in " + opt.input + ": " + ErrorText(err));
+// Compose a character with a pending dead key, or output both.
+inline size_t ComposeDead(char16_t wc, State& state, char16_t* out)
+{
+    bool chained = false;
+    const char16_t composed = Compose(wc, state.dead, chained);
+    if (composed != 0 && chained) {
+        state.dead = composed;
+        return 0;
+    }
+    else if (composed != 0) {
+        out[0] = composed;
+        state.dead = 0;
+        return 1;
+    }
+    else {
+        out[0] = state.dead;
+        out[1] = wc;
+        state.dead = 0;
+        return 2;
     }
+}
 
-    // Call the entry point to get the keyboard tables.
-    // The entry point profile is: PKBDTABLES KbdLayerDescriptor()
-    PKBDTABLES tables = reinterpret_cast<PKBDTABLES(*)()>(proc_addr)();
-    if (tables == nullptr) {
-        opt.fatal(KBD_DLL_ENTRY_NAME "() returned null in " + opt.input);
+// Translate a key press on a virtual key, after the update of tracked keys.
+inline size_t TranslateKey(uint8_t vk, State& state, char16_t* out)
+{
+    if (vk == VK_NONE) {
+        return 0;
+    }
+    const uint8_t locks = uint8_t(state.locks & VK_LOCKS[vk]);
+    const uint8_t modbits = uint8_t(Modifiers(state) | ((locks & LOCK_KANA) != 0 ? MOD_KANA : 0));
+    const size_t cell = CELL[(locks & LOCK_CAPITAL) != 0 ? 256 + modbits : modbits];
+    const size_t row = VK_ROW[vk];
+    const char16_t wc = WCH[row][cell];
+
+    if (wc == CH_NONE) {
+        return 0;
+    }
+    else if (wc == CH_DEAD) {
+        if (state.dead == 0) {
+            state.dead = DEAD[row][cell];
+            return 0;
+        }
+        return ComposeDead(DEAD[row][cell], state, out);
+    }
+    else if (wc == CH_LGTR) {
+        size_t count = 0;
+        if (state.dead != 0) {
+            out[count++] = state.dead;
+            state.dead = 0;
+        }
+        return count + Ligature(vk, cell, out + count);
+    }
+    else if (state.dead != 0) {
+        return ComposeDead(wc, state, out);
     }
+    else {
+        out[0] = wc;
+        return 1;
+    }
+}
 
-    // Open the output file when specified.
-    opt.setOutput(opt.output);
+// Translate one keystroke: scan code without prefix, EV_xxx flags. Store the characters
+// in 'out' (at least MAX_OUTPUT). Return the number of characters.
+inline size_t Translate(uint8_t scancode, uint8_t flags, State& state, char16_t* out)
+{
+    const size_t index = (size_t((flags & (EV_E0 | EV_E1)) >> 1) << 8) + scancode;
+    const uint8_t vk = SC_VK[index];
 
-    // Generate the source file.
-    if (opt.gen_resources) {
-        GenerateResourceFile(opt, dll);
+    // Common case: no special key, no Alt+numpad entry.
+    if ((SC_SPECIAL[index] | state.numpad) == 0) {
+        if (TrackKey(vk, flags, state) || (flags & EV_BREAK) != 0) {
+            return 0;
+        }
+        return TranslateKey(vk, state, out);
     }
-    else if (opt.gen_list) {
-        GenerateCharacterTable(opt, tables);
+
+    // Tracked keys end the Alt+numpad entry when Alt is released.
+    const Special key(SC_SPECIAL[index] == 0 ? Special{0, 0, 0, 0} : SPECIAL[SC_SPECIAL[index] - 1]);
+    if (TrackKey(vk, flags, state)) {
+        size_t count = 0;
+        if (state.numpad != 0 && (Modifiers(state) & MOD_ALT) == 0) {
+            const uint8_t code = state.code;
+            const char16_t wc = (state.numpad & NUM_ANSI) == 0 ? OEM_CHARS[code] : (code >= 0x80 && code < 0xA0 ? ANSI_CHARS[code - 0x80] : char16_t(code));
+            if (wc != 0) {
+                // The Alt+numpad character is never composed with a dead key.
+                if (state.dead != 0) {
+                    out[count++] = state.dead;
+                    state.dead = 0;
+                }
+                out[count++] = wc;
+            }
+            state.numpad = state.code = 0;
+        }
+        return count;
     }
-    else if (!opt.map_template.empty()) {
-        GenerateKeyboardMap(opt, tables);
+    if ((flags & EV_BREAK) != 0) {
+        return 0;
     }
-    else {
-        SourceGenerator gen(opt);
-        gen.generate(*tables);
+
+    // Digits of the numeric keypad with Alt alone.
+    const uint8_t modbits = Modifiers(state);
+    if (key.digit != 0 && modbits == MOD_ALT) {
+        const uint8_t digit = uint8_t(key.digit - 1);
+        if (state.numpad == 0) {
+            state.numpad = uint8_t(digit == 0 ? NUM_ENTRY | NUM_ANSI : NUM_ENTRY);
+        }
+        state.code = uint8_t(state.code * 10 + digit);
+        return 0;
+    }
+    state.numpad = state.code = 0;
+
+    // NumLock without Shift selects the digits. Some modifiers select another virtual key.
+    if (key.numlock_vk != 0 && (state.locks & LOCK_NUMLOCK) != 0 && (modbits & MOD_SHIFT) == 0) {
+        return TranslateKey(key.numlock_vk, state, out);
+    }
+    else if ((modbits & key.multi_bits) != 0) {
+        return TranslateKey(key.multi_vk, state, out);
+    }
+    else {
+        return TranslateKey(vk, state, out);
+    }
+}
+)";
+
+template <typename INT_T>
+void TranslatorGenerator::genArray(const char* type, const char* name, const std::vector<INT_T>& values, int hex_digits)
+{
+    _ou << "constexpr " << type << " " << name << "[" << values.size() << "] = {";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i % 16 == 0) {
+            _ou << std::endl << "   ";
+        }
+        _ou << " ";
+        _ou.write("0x").hexa(uint64_t(values[i]), hex_digits);
+        _ou << ",";
+    }
+    _ou << std::endl << "};" << std::endl << std::endl;
+}
+
+void TranslatorGenerator::genCompose(const KBDTABLES& tables)
+{
+    // Keep the first composition of each pair, as the system does.
+    std::map<WCHAR, std::map<WCHAR, const DEADKEY*>> accents;
+    for (const DEADKEY* dk = tables.pDeadKey; dk != nullptr && dk->dwBoth != 0; ++dk) {
+        accents[HIWORD(dk->dwBoth)].emplace(LOWORD(dk->dwBoth), dk);
+    }
+
+    _ou << "// Compose a base character with a pending dead key. Return zero if there is no composition." << std::endl
+        << "inline char16_t Compose(char16_t base, char16_t accent, bool& chained)" << std::endl
+        << "{" << std::endl
+        << "    chained = false;" << std::endl;
+    if (accents.empty()) {
+        _ou << "    (void)base;" << std::endl
+            << "    (void)accent;" << std::endl
+            << "    return 0;" << std::endl;
+    }
+    else {
+        _ou << "    switch (accent) {" << std::endl;
+        for (const auto& acc : accents) {
+            _ou << "        case ";
+            _ou.write("0x").hexa(acc.first, 4);
+            _ou << ":" << std::endl
+                << "            switch (base) {" << std::endl;
+            for (const auto& base : acc.second) {
+                _ou << "                case ";
+                _ou.write("0x").hexa(base.first, 4);
+                _ou << ": ";
+                if ((base.second->uFlags & DKF_DEAD) != 0) {
+                    _ou << "chained = true; ";
+                }
+                _ou << "return ";
+                _ou.write("0x").hexa(base.second->wchComposed, 4);
+                _ou << ";" << std::endl;
+            }
+            _ou << "                default: return 0;" << std::endl
+                << "            }" << std::endl;
+        }
+        _ou << "        default:" << std::endl
+            << "            return 0;" << std::endl
+            << "    }" << std::endl;
+    }
+    _ou << "}" << std::endl << std::endl;
+}
+
+void TranslatorGenerator::genLigatures(const KbdEngine& engine)
+{
+    _ou << "// Characters of a ligature by virtual key and cell. Return the number of characters." << std::endl
+        << "inline size_t Ligature(uint8_t vk, size_t cell, char16_t* out)" << std::endl
+        << "{" << std::endl;
+    bool found = false;
+    for (size_t vk = 0; vk < 256; ++vk) {
+        for (size_t cell = 0; cell < engine.cells(); ++cell) {
+            WCHAR lg[KbdEngine::MAX_OUTPUT];
+            const size_t count = engine.character(uint8_t(vk), cell) == WCH_LGTR ? engine.ligature(uint8_t(vk), cell, lg) : 0;
+            if (count > 0) {
+                if (!found) {
+                    _ou << "    switch (vk * CELLS + cell) {" << std::endl;
+                    found = true;
+                }
+                _ou << "        case " << (vk * engine.cells() + cell) << ":";
+                for (size_t i = 0; i < count; ++i) {
+                    _ou << " out[" << i << "] = ";
+                    _ou.write("0x").hexa(lg[i], 4);
+                    _ou << ";";
+                }
+                _ou << " return " << count << ";" << std::endl;
+            }
+        }
+    }
+    if (found) {
+        _ou << "        default: return 0;" << std::endl
+            << "    }" << std::endl;
+    }
+    else {
+        _ou << "    (void)vk;" << std::endl
+            << "    (void)cell;" << std::endl
+            << "    (void)out;" << std::endl
+            << "    return 0;" << std::endl;
+    }
+    _ou << "}" << std::endl << std::endl;
+}
+
+void TranslatorGenerator::generate(const KBDTABLES& tables)
+{
+    const KbdEngine engine(tables);
+    const size_t cells = engine.cells();
+
+    // The namespace is the layout name, as a C++ identifier.
+    std::string name_space(ToUTF8(ToLower(FileBaseName(_input))));
+    for (auto& c : name_space) {
+        if (!std::isalnum(static_cast<unsigned char>(c))) {
+            c = '_';
+        }
+    }
+    if (name_space.empty() || std::isdigit(static_cast<unsigned char>(name_space.front()))) {
+        name_space.insert(0, 1, '_');
+    }
+
+    // Scan codes, with their special processing.
+    std::vector<uint8_t> sc_vk(4 * 256);
+    std::vector<uint8_t> sc_special(4 * 256);
+    std::vector<KbdEngine::SpecialKey> special;
+    for (size_t index = 0; index < sc_vk.size(); ++index) {
+        const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((index >> 8) << 1)};
+        sc_vk[index] = uint8_t(engine.virtualKey(ev) & 0xFF);
+        const KbdEngine::SpecialKey* key = engine.specialKey(ev);
+        if (key != nullptr) {
+            special.push_back(*key);
+            sc_special[index] = uint8_t(special.size());
+        }
+    }
+
+    // Key slots and modifiers.
+    std::vector<uint8_t> vk_slot(256);
+    std::vector<uint8_t> vk_locks(256);
+    std::vector<uint8_t> slot_bits(KbdEngine::MAX_SLOTS);
+    std::vector<uint8_t> slot_lock(KbdEngine::MAX_SLOTS);
+    std::vector<uint8_t> keys_bits(2 * 256);
+    std::vector<uint8_t> cell(2 * 256);
+    for (size_t i = 0; i < 256; ++i) {
+        KbdState low {};
+        KbdState high {};
+        low.keys = uint16_t(i);
+        high.keys = uint16_t(i << 8);
+        vk_slot[i] = uint8_t(engine.keySlot(uint8_t(i)));
+        vk_locks[i] = engine.keyLocks(uint8_t(i));
+        keys_bits[i] = engine.modifiers(low);
+        keys_bits[256 + i] = engine.modifiers(high);
+        cell[i] = uint8_t(engine.cell(uint8_t(i), false));
+        cell[256 + i] = uint8_t(engine.cell(uint8_t(i), true));
+    }
+    for (size_t i = 0; i < KbdEngine::MAX_SLOTS; ++i) {
+        slot_bits[i] = engine.slotBits(i);
+        slot_lock[i] = engine.slotLock(i);
+    }
+
+    // Characters, one row per virtual key which has characters. Row 0 is empty.
+    std::vector<uint16_t> vk_row(256);
+    std::vector<std::vector<WCHAR>> wch{std::vector<WCHAR>(cells, WCH_NONE)};
+    std::vector<std::vector<WCHAR>> dead{std::vector<WCHAR>(cells, 0)};
+    for (size_t vk = 0; vk < 256; ++vk) {
+        std::vector<WCHAR> row(cells);
+        std::vector<WCHAR> drow(cells);
+        for (size_t c = 0; c < cells; ++c) {
+            row[c] = engine.character(uint8_t(vk), c);
+            drow[c] = engine.deadCharacter(uint8_t(vk), c);
+        }
+        if (row != wch[0]) {
+            vk_row[vk] = uint16_t(wch.size());
+            wch.push_back(row);
+            dead.push_back(drow);
+        }
+    }
+
+    // Characters of the Alt+numpad codes.
+    std::vector<WCHAR> oem(256);
+    std::vector<WCHAR> ansi(32);
+    for (size_t i = 0; i < oem.size(); ++i) {
+        oem[i] = KbdEngine::NumpadCharacter(uint8_t(i), false);
+    }
+    for (size_t i = 0; i < ansi.size(); ++i) {
+        ansi[i] = KbdEngine::NumpadCharacter(uint8_t(0x80 + i), true);
+    }
+
+    // File header.
+    if (_opt.headers.empty()) {
+        _ou << "//" << _opt.dashed << std::endl
+            << "// " << _opt.comment << std::endl
+            << "// Automatically generated from " << FileName(_input) << std::endl
+            << "// Keystroke translator specialized for this keyboard layout." << std::endl
+            << "//" << _opt.dashed << std::endl;
+    }
+    else {
+        for (const auto& line : _opt.headers) {
+            _ou << line << std::endl;
+        }
+    }
+    _ou << std::endl
+        << "#pragma once" << std::endl
+        << "#include <cstddef>" << std::endl
+        << "#include <cstdint>" << std::endl
+        << std::endl
+        << "namespace " << name_space << " {" << std::endl
+        << std::endl
+        << "// Same values as the KEV_xxx, KLOCK_xxx, KNUM_xxx constants of the translation engine." << std::endl
+        << "constexpr uint8_t EV_BREAK = 0x01;" << std::endl
+        << "constexpr uint8_t EV_E0 = 0x02;" << std::endl
+        << "constexpr uint8_t EV_E1 = 0x04;" << std::endl
+        << "constexpr uint8_t LOCK_CAPITAL = 0x01;" << std::endl
+        << "constexpr uint8_t LOCK_NUMLOCK = 0x02;" << std::endl
+        << "constexpr uint8_t LOCK_KANA = 0x04;" << std::endl
+        << "constexpr uint8_t NUM_ENTRY = 0x01;" << std::endl
+        << "constexpr uint8_t NUM_ANSI = 0x02;" << std::endl
+        << "constexpr uint8_t MOD_SHIFT = 0x01;" << std::endl
+        << "constexpr uint8_t MOD_ALT = 0x04;" << std::endl
+        << "constexpr uint8_t MOD_KANA = 0x08;" << std::endl
+        << "constexpr uint8_t VK_NONE = 0xFF;" << std::endl
+        << "constexpr char16_t CH_NONE = 0xF000;" << std::endl
+        << "constexpr char16_t CH_DEAD = 0xF001;" << std::endl
+        << "constexpr char16_t CH_LGTR = 0xF002;" << std::endl
+        << std::endl
+        << "// Layout properties." << std::endl
+        << "constexpr bool SHIFT_LOCK = " << ((tables.fLocaleFlags & KLLF_SHIFTLOCK) != 0 ? "true" : "false") << ";" << std::endl
+        << "constexpr size_t CELLS = " << cells << ";" << std::endl
+        << "constexpr size_t MAX_OUTPUT = " << KbdEngine::MAX_OUTPUT << ";" << std::endl
+        << std::endl
+        << "// Translation state, same layout as KbdState. Zero-initialized for the initial state." << std::endl
+        << "struct State" << std::endl
+        << "{" << std::endl
+        << "    uint16_t keys;" << std::endl
+        << "    uint8_t  locks;" << std::endl
+        << "    uint8_t  numpad;" << std::endl
+        << "    char16_t dead;" << std::endl
+        << "    uint8_t  code;" << std::endl
+        << "    uint8_t  spare;" << std::endl
+        << "};" << std::endl
+        << std::endl
+        << "// Special keystroke: NumLock virtual key, modifier bits for the alternate virtual key, Alt+numpad digit plus one." << std::endl
+        << "struct Special" << std::endl
+        << "{" << std::endl
+        << "    uint8_t numlock_vk;" << std::endl
+        << "    uint8_t multi_bits;" << std::endl
+        << "    uint8_t multi_vk;" << std::endl
+        << "    uint8_t digit;" << std::endl
+        << "};" << std::endl
+        << std::endl;
+
+    _ou << "// Virtual key and special keystroke index + 1, by [prefix][scan code]." << std::endl;
+    genArray("uint8_t", "SC_VK", sc_vk, 2);
+    genArray("uint8_t", "SC_SPECIAL", sc_special, 2);
+    _ou << "constexpr Special SPECIAL[" << std::max<size_t>(1, special.size()) << "] = {" << std::endl;
+    for (const auto& key : special) {
+        _ou.write("    {0x").hexa(key.numlock_vk, 2).write(", 0x").hexa(key.multi_bits, 2).write(", 0x").hexa(key.multi_vk, 2);
+        _ou << ", " << int(key.digit) << "}," << std::endl;
+    }
+    if (special.empty()) {
+        _ou << "    {0, 0, 0, 0}," << std::endl;
+    }
+    _ou << "};" << std::endl << std::endl;
+
+    _ou << "// Key slot + 1 and locks by virtual key, modifier bits and lock of each key slot." << std::endl;
+    genArray("uint8_t", "VK_SLOT", vk_slot, 2);
+    genArray("uint8_t", "VK_LOCKS", vk_locks, 2);
+    genArray("uint8_t", "SLOT_BITS", slot_bits, 2);
+    genArray("uint8_t", "SLOT_LOCK", slot_lock, 2);
+    _ou << "// Modifier bits of the pressed key slots, by [low/high byte][keys]." << std::endl;
+    genArray("uint8_t", "KEYS_BITS", keys_bits, 2);
+    _ou << "// Cell by [Caps Lock][modifier bits]." << std::endl;
+    genArray("uint8_t", "CELL", cell, 2);
+
+    _ou << "// Row of characters by virtual key, row 0 has no character." << std::endl;
+    genArray(wch.size() > 256 ? "uint16_t" : "uint8_t", "VK_ROW", vk_row, 2);
+    _ou << "// Characters and pending dead key characters by [row][cell]." << std::endl;
+    for (const auto& table : {std::make_pair("WCH", &wch), std::make_pair("DEAD", &dead)}) {
+        _ou << "constexpr char16_t " << table.first << "[" << table.second->size() << "][CELLS] = {" << std::endl;
+        for (const auto& row : *table.second) {
+            _ou << "    {";
+            for (size_t c = 0; c < cells; ++c) {
+                _ou << (c == 0 ? "" : ", ");
+                _ou.write("0x").hexa(row[c], 4);
+            }
+            _ou << "}," << std::endl;
+        }
+        _ou << "};" << std::endl << std::endl;
+    }
+
+    _ou << "// Characters of Alt+numpad codes: OEM code page, ANSI code page from 0x80 to 0x9F." << std::endl;
+    genArray("char16_t", "OEM_CHARS", oem, 4);
+    genArray("char16_t", "ANSI_CHARS", ansi, 4);
+
+    genCompose(tables);
+    genLigatures(engine);
+
+    _ou << translator_code + 1
+        << std::endl
+        << "} // namespace " << name_space << std::endl;
+}
+
+
+//---------------------------------------------------------------------------
+// Generate a C source file with compact data structures (option -z).
+//---------------------------------------------------------------------------
+
+// Set the memory blocks of the data structures of a keyboard layout: sections of the DLL file or
+// .wklbin file. The tables of a DLL with another pointer size are translated as a .wklbin file.
+void SetDataBlock(SourceGenerator& gen, const KbdFile& kbd)
+{
+    if (kbd.binary().isLoaded()) {
+        gen.setBinary(kbd.binary());
+    }
+    else if (kbd.image().isLoaded()) {
+        gen.setImage(kbd.image());
+    }
+}
+
+// Measure the image and the data sections of a keyboard layout DLL, as built by the linker.
+void ImageFootprint(Footprint& fp, const KbdFile& kbd)
+{
+    fp.image_size = fp.data_size = fp.data_pages = 0;
+    if (kbd.image().isLoaded()) {
+        fp.image_size = kbd.image().imageSize();
+        for (const auto& sec : kbd.image().sections()) {
+            if (sec.name == ".data" || sec.name == ".rdata") {
+                fp.data_size += sec.size;
+                fp.data_pages += (sec.size + fp.page_size - 1) / fp.page_size;
+            }
+        }
+    }
+}
+
+bool GenerateCompact(const ReverseOptions& opt, Error& err, std::ostream& out, const KbdFile& kbd, Footprint* original, Footprint* compact)
+{
+    // The compact tables must have the same semantic content as the original ones.
+    const KbdCompactor comp(*kbd.tables());
+    std::array<size_t, KbdContent::SECTION_COUNT> counts;
+    if (KbdContent(*kbd.tables()).compare(KbdContent(comp.tables()), nullptr, &counts) > 0) {
+        WString sections;
+        for (size_t sec = 0; sec < counts.size(); ++sec) {
+            if (counts[sec] > 0) {
+                sections.append(Format(L", %s %zu", KbdContent::SectionName(KbdContent::Section(sec)), counts[sec]));
+            }
+        }
+        err.error(L"compact tables differ from the original ones" + sections);
+        return false;
+    }
+
+    // Footprint of the original tables, the generated source code is dropped.
+    if (original != nullptr) {
+        std::ostringstream source;
+        SourceGenerator gen(opt, source, kbd.fileName());
+        SetDataBlock(gen, kbd);
+        gen.generate(*kbd.tables());
+        *original = gen.footprint();
+        ImageFootprint(*original, kbd);
+        // The structures are measured inside the DLL image or the .wklbin file.
+        if (original->block_size == 0 || original->total() > original->block_size) {
+            err.error(Format(L"invalid footprint of the original tables, %zu bytes in a block of %zu bytes", original->total(), original->block_size));
+            return false;
+        }
+    }
+
+    SourceGenerator gen(opt, out, kbd.fileName());
+    gen.setCompact(comp);
+    gen.generate(comp.tables());
+    if (compact != nullptr) {
+        *compact = gen.footprint();
+    }
+    err.verbose(Format(L"%zu shared strings, %zu moved keys, %zu removed tables, %zu removed scan codes",
+                       comp.sharedStrings(), comp.movedKeys(), comp.removedTables(), comp.removedScanCodes()));
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Generate the output for one keyboard DLL. In compact mode (-z), the
+// footprints of the original and compact data structures are returned.
+//---------------------------------------------------------------------------
+
+bool GenerateOutput(const ReverseOptions& opt, Error& err, std::ostream& out, const KbdFile& kbd,
+                    const std::map<const void*, WString>* shared = nullptr, Footprint* original = nullptr, Footprint* compact = nullptr)
+{
+    const KBDTABLES* tables = kbd.tables();
+    const WString& input(kbd.fileName());
+    if (opt.gen_binary) {
+        std::vector<uint8_t> data;
+        WklBinFile::Serialize(data, *tables);
+        out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+        return true;
+    }
+    else if (opt.gen_list) {
+        GenerateCharacterTable(out, tables);
+        return true;
+    }
+    else if (!opt.map_template.empty()) {
+        return GenerateKeyboardMap(opt, err, out, tables);
+    }
+    else if (opt.gen_translator) {
+        TranslatorGenerator gen(opt, out, input);
+        gen.generate(*tables);
+        return true;
+    }
+    else if (opt.compact) {
+        return GenerateCompact(opt, err, out, kbd, original, compact);
+    }
+    else {
+        SourceGenerator gen(opt, out, input, shared);
+        SetDataBlock(gen, kbd);
+        gen.generate(*tables);
+        return true;
+    }
+}
+
+
+//---------------------------------------------------------------------------
+// Load several keyboard layouts in parallel and list their tables.
+//---------------------------------------------------------------------------
+
+class LoadedLayout
+{
+public:
+    // Constructor. Load the layout, the errors are reported in the layout.
+    LoadedLayout(const WString& file);
+
+    std::ostringstream            errors;
+    Error                         err;
+    KbdFile                       kbd;
+    std::unique_ptr<KbdTableList> tables;
+};
+
+LoadedLayout::LoadedLayout(const WString& file) :
+    errors(),
+    err(FileName(file) + L": ", &errors),
+    kbd(err),
+    tables()
+{
+    if (kbd.load(file)) {
+        tables = std::make_unique<KbdTableList>(*kbd.tables());
+    }
+}
+
+typedef std::vector<std::unique_ptr<LoadedLayout>> LoadedLayoutVector;
+
+// Return false if at least one layout cannot be loaded, after reporting the errors.
+bool LoadLayouts(LoadedLayoutVector& layouts, const WStringVector& files, WorkPool& pool)
+{
+    layouts.clear();
+    layouts.resize(files.size());
+    pool.run(files.size(), [&](size_t index, size_t) {
+        layouts[index] = std::make_unique<LoadedLayout>(files[index]);
+    });
+    bool success = true;
+    for (const auto& lay : layouts) {
+        std::cerr << lay->errors.str();
+        success = success && lay->tables != nullptr;
+    }
+    return success;
+}
+
+// Group the identical tables of the layouts.
+KbdTableGroups GroupTables(const LoadedLayoutVector& layouts)
+{
+    std::vector<const KbdTableList*> lists;
+    for (const auto& lay : layouts) {
+        lists.push_back(lay->tables.get());
+    }
+    return KbdTableGroups(lists);
+}
+
+
+//---------------------------------------------------------------------------
+// Generate the header file of the tables which are shared by several layouts.
+//---------------------------------------------------------------------------
+
+bool GenerateSharedHeader(const ReverseOptions& opt, const WString& file_name, const LoadedLayoutVector& layouts, const KbdTableGroups& groups)
+{
+    std::ofstream out(FilePath(file_name), std::ios::binary);
+    if (!out) {
+        opt.error("cannot create output file " + file_name);
+        return false;
+    }
+    out << "//" << opt.dashed << std::endl
+        << "// " << opt.comment << std::endl
+        << "// Tables which are identical in several keyboard layouts" << std::endl
+        << "// Automatically generated by kbdreverse, do not modify" << std::endl
+        << "//" << std::endl
+        << "// Each table is compiled only when its macro is defined before including" << std::endl
+        << "// this file. The source file of a layout defines the macros of its tables." << std::endl
+        << "//" << opt.dashed << std::endl
+        << std::endl;
+    for (const auto& grp : groups.groups()) {
+        if (!grp.name.empty()) {
+            // The table is generated from its first layout, they are all identical.
+            const LoadedLayout& lay(*layouts[grp.members.front().layout]);
+            const WString name(ToUTF16(grp.name));
+            out << "#if defined(" << SourceGenerator::SharedMacro(name) << ")" << std::endl << std::endl;
+            SourceGenerator gen(opt, out, lay.kbd.fileName());
+            gen.genTable(*lay.kbd.tables(), lay.tables->tables()[grp.members.front().table], name);
+            out << "#endif" << std::endl << std::endl;
+        }
+    }
+    out.close();
+    if (!out) {
+        opt.error("error writing output file " + file_name);
+        return false;
+    }
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Batch mode: generate one file per keyboard DLL, using several threads.
+//---------------------------------------------------------------------------
+
+bool GenerateBatch(ReverseOptions& opt)
+{
+    // Get the list of keyboard DLL's.
+    WStringList file_list;
+    KbdFile::ExpandNames(file_list, opt.inputs);
+    const WStringVector files(file_list.begin(), file_list.end());
+
+    // Build unique output file names. The same DLL name may come from different directories.
+    const WString suffix(opt.gen_binary ? WKLBIN_EXTENSION : (opt.gen_translator ? L".h" : (opt.gen_list || !opt.map_template.empty() ? L".txt" : L".c")));
+    WStringVector outputs;
+    std::map<WString, int> names_count;
+    for (const auto& file : files) {
+        const WString name(FileBaseName(file));
+        const int count = ++names_count[ToLower(name)];
+        outputs.push_back(opt.batch_dir + PATH_SEPARATOR + name + (count > 1 ? Format(L"-%d", count) : L"") + suffix);
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(FilePath(opt.batch_dir), ec);
+
+    // With a shared header, all layouts are loaded first to find the identical tables.
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    const auto start = std::chrono::steady_clock::now();
+    LoadedLayoutVector layouts;
+    std::unique_ptr<KbdTableGroups> groups;
+    if (!opt.shared_header.empty()) {
+        if (!LoadLayouts(layouts, files, pool)) {
+            return false;
+        }
+        groups = std::make_unique<KbdTableGroups>(GroupTables(layouts));
+        if (!GenerateSharedHeader(opt, opt.batch_dir + PATH_SEPARATOR + FileName(opt.shared_header), layouts, *groups)) {
+            return false;
+        }
+    }
+
+    // Result of each file.
+    struct Result
+    {
+        bool        success = false;
+        double      duration = 0.0;  // in milliseconds
+        size_t      size = 0;
+        Footprint   original;  // With -z only.
+        Footprint   compact;   // With -z only.
+        std::string errors;
+    };
+    std::vector<Result> results(files.size());
+
+    // Process all files in a pool of threads. Each file has its own output and error reporting.
+    pool.run(files.size(), [&](size_t index, size_t) {
+        Result& res(results[index]);
+        const auto file_start = std::chrono::steady_clock::now();
+        std::ostringstream errors;
+        Error err(FileName(files[index]) + L": ", &errors);
+        KbdFile local_kbd(err);
+        const KbdFile& kbd(layouts.empty() ? local_kbd : layouts[index]->kbd);
+        std::map<const void*, WString> shared;
+        if (groups != nullptr) {
+            for (const auto& it : groups->sharedNames(*layouts[index]->tables)) {
+                shared[it.first] = ToUTF16(it.second);
+            }
+        }
+        if (kbd.isLoaded() || local_kbd.load(files[index])) {
+            std::ofstream out(FilePath(outputs[index]), std::ios::binary);
+            if (!out) {
+                err.error("cannot create output file " + outputs[index]);
+            }
+            else {
+                res.success = GenerateOutput(opt, err, out, kbd, groups == nullptr ? nullptr : &shared, &res.original, &res.compact);
+                res.size = size_t(std::streamoff(out.tellp()));
+                out.close();
+                if (!out) {
+                    err.error("error writing output file " + outputs[index]);
+                    res.success = false;
+                }
+            }
+        }
+        res.errors = errors.str();
+        res.duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - file_start).count();
+    });
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Summary table. With -z, the sizes of the data structures are estimated, without the rest of the first
+    // and last pages. The data sections of the original DLL are measured, the compact one is not built.
+    size_t failures = 0;
+    size_t before = 0;
+    size_t after = 0;
+    Grid grid(L"", L"  ");
+    Grid::Line header{L"File", L"Status", L"Time (ms)", L"Size", L"Output"};
+    if (opt.compact) {
+        header.insert(header.end() - 1, {L"Data", L"Before", L"After", L"Saved"});
+    }
+    grid.addLine(header);
+    grid.addUnderlines();
+    for (size_t i = 0; i < files.size(); ++i) {
+        const Result& res(results[i]);
+        failures += res.success ? 0 : 1;
+        Grid::Line line{files[i],
+                        res.success ? L"ok" : L"FAILED",
+                        Format(L"%.1f", res.duration),
+                        res.success ? Format(L"%zu", res.size) : L""};
+        if (opt.compact) {
+            const size_t original = res.success ? res.original.total() : 0;
+            const size_t compact = res.success ? res.compact.total() : 0;
+            line.push_back(res.success && res.original.image_size > 0 ? Format(L"%zu", res.original.data_size) : L"");
+            line.push_back(res.success ? Format(L"%zu", original) : L"");
+            line.push_back(res.success ? Format(L"%zu", compact) : L"");
+            line.push_back(res.success ? Format(L"%zd", ptrdiff_t(original - compact)) : L"");
+            before += original;
+            after += compact;
+        }
+        line.push_back(res.success ? outputs[i] : L"");
+        grid.addLine(line);
+    }
+    grid.print(opt.out());
+    opt.out() << std::endl
+              << Format(L"%zu files, %zu failed, %zu threads, %.1f ms", files.size(), failures, std::min(pool.threadCount(), files.size()), duration)
+              << std::endl;
+    if (opt.compact) {
+        opt.out() << Format(L"Compact data structures (estimated): %zu bytes before, %zu bytes after, %zd bytes saved", before, after, ptrdiff_t(before - after))
+                  << std::endl
+                  << "Data: data sections of the original DLL, use -f on the rebuilt DLL's to measure the compact ones" << std::endl;
+    }
+    if (groups != nullptr) {
+        size_t bytes = 0;
+        for (const auto& grp : groups->groups()) {
+            bytes += grp.name.empty() ? 0 : grp.size * (grp.members.size() - 1);
+        }
+        opt.out() << Format(L"%zu shared tables in %s, %zu duplicated bytes in the source files", groups->sharedCount(), FileName(opt.shared_header).c_str(), bytes)
+                  << std::endl;
+    }
+
+    // Error messages, in the order of files.
+    for (const auto& res : results) {
+        std::cerr << res.errors;
+    }
+    return failures == 0;
+}
+
+
+//---------------------------------------------------------------------------
+// Compare keyboard layouts, using the semantic content of their tables.
+//---------------------------------------------------------------------------
+
+class LayoutComparator
+{
+public:
+    // Constructor.
+    LayoutComparator(const ReverseOptions& opt) : _opt(opt) {}
+
+    // Format one difference as "section key: old -> new". There is no space inside
+    // the fields, except in key names, which are quoted. A missing entry is "-".
+    WString format(const KbdContent::Difference&) const;
+
+private:
+    const ReverseOptions& _opt;
+
+    // Format the fields of a difference.
+    WString key(KbdContent::Section, uint32_t key) const;
+    WString value(KbdContent::Section, uint32_t key, const KbdContent::Value*) const;
+    WString name(SymbolTable symbols, Value value, int hex_digits) const;
+    WString bits(SymbolTable symbols, Value value, int hex_digits) const;
+    WString virtualKey(uint16_t vk) const;
+    WString modifiers(uint8_t modbits) const;
+    WString character(char16_t c) const;
+};
+
+//---------------------------------------------------------------------------
+
+WString LayoutComparator::name(SymbolTable symbols, Value value, int hex_digits) const
+{
+    const wchar_t* const str = _opt.num_only ? nullptr : FindSymbol(symbols, value);
+    return str != nullptr ? WString(str) : Format(L"0x%0*llX", hex_digits, value);
+}
+
+WString LayoutComparator::bits(SymbolTable symbols, Value value, int hex_digits) const
+{
+    WString str;
+    if (!_opt.num_only) {
+        for (const auto& sym : symbols) {
+            if (sym.value != 0 && (value & sym.value) == sym.value) {
+                str.append(str.empty() ? L"" : L"|");
+                str.append(sym.name);
+                value &= ~sym.value;
+            }
+        }
+    }
+    if (value != 0 || str.empty()) {
+        str.append(str.empty() ? L"" : L"|");
+        str.append(Format(L"0x%0*llX", hex_digits, value));
+    }
+    return str;
+}
+
+WString LayoutComparator::virtualKey(uint16_t vk) const
+{
+    WString str(name(vk_symbols, vk & 0xFF, 2));
+    if ((vk & 0xFF00) != 0) {
+        str.append(L"|");
+        str.append(bits(vk_flags_symbols, vk & 0xFF00, 4));
+    }
+    return str;
+}
+
+WString LayoutComparator::modifiers(uint8_t modbits) const
+{
+    if (!_opt.num_only && modbits < modifiers_headers.size()) {
+        return modifiers_headers[modbits];
+    }
+    return bits(shift_state_symbols, modbits, 2);
+}
+
+WString LayoutComparator::character(char16_t c) const
+{
+    if (c == WCH_NONE || c == WCH_DEAD || c == WCH_LGTR) {
+        return name(wchar_symbols, c, 4);
+    }
+    WString str(Format(L"U+%04X", c));
+    if (!_opt.num_only && c > 0x20 && c != 0x7F && (c < 0xD800 || c > 0xDFFF)) {
+        str.push_back(L'(');
+        str.push_back(wchar_t(c));
+        str.push_back(L')');
+    }
+    return str;
+}
+
+//---------------------------------------------------------------------------
+
+WString LayoutComparator::key(KbdContent::Section section, uint32_t key) const
+{
+    switch (section) {
+        case KbdContent::SEC_SCANCODES:
+        case KbdContent::SEC_KEYNAMES:
+            if (key >= 0x10000) {
+                return L"dead:" + character(char16_t(key & 0xFFFF));
+            }
+            return key >= 0x100 ? Format(L"%02X_%02X", key >> 8, key & 0xFF) : Format(L"%02X", key);
+        case KbdContent::SEC_MODIFIERS:
+            return key >= 0x100 ? L"modbits:" + bits(shift_state_symbols, key & 0xFF, 2) : virtualKey(uint16_t(key));
+        case KbdContent::SEC_CHARACTERS:
+        case KbdContent::SEC_LIGATURES:
+            return virtualKey(uint16_t(key >> 8)) + L"/" + modifiers(uint8_t(key & 0xFF));
+        case KbdContent::SEC_DEADKEYS:
+            return character(char16_t(key >> 16)) + L"+" + character(char16_t(key & 0xFFFF));
+        case KbdContent::SEC_FLAGS:
+            return key == 0 ? L"locale" : (key == 1 ? L"type" : (key == 2 ? L"subtype" : virtualKey(uint16_t(key & 0xFF))));
+        default:
+            return Format(L"0x%X", key);
+    }
+}
+
+WString LayoutComparator::value(KbdContent::Section section, uint32_t key, const KbdContent::Value* value) const
+{
+    if (value == nullptr) {
+        return L"-";
+    }
+    WString str;
+    switch (section) {
+        case KbdContent::SEC_SCANCODES:
+            return virtualKey(uint16_t(value->at(0)));
+        case KbdContent::SEC_MODIFIERS:
+            return key >= 0x100 ? L"valid" : bits(shift_state_symbols, value->at(0), 2);
+        case KbdContent::SEC_CHARACTERS:
+        case KbdContent::SEC_LIGATURES:
+            for (char16_t c : *value) {
+                str.append(str.empty() ? L"" : L",");
+                str.append(character(c));
+            }
+            return str;
+        case KbdContent::SEC_DEADKEYS: {
+            static constexpr auto dkf_symbols = SortSymbols({SYM(DKF_DEAD)});
+            return character(value->at(0)) + (value->at(1) == 0 ? L"" : L"|" + bits(dkf_symbols, value->at(1), 4));
+        }
+        case KbdContent::SEC_KEYNAMES:
+            for (char16_t c : *value) {
+                str.push_back(wchar_t(c));
+            }
+            return L"\"" + str + L"\"";
+        case KbdContent::SEC_FLAGS:
+            if (key >= 0x100) {
+                return bits(vk_attr_symbols, value->at(0), 2);
+            }
+            return Format(L"0x%08X", MAKELONG(value->at(0), value->at(1)));
+        default:
+            return L"?";
+    }
+}
+
+WString LayoutComparator::format(const KbdContent::Difference& diff) const
+{
+    return WString(KbdContent::SectionName(diff.section)) + L" " + key(diff.section, diff.key) + L": " +
+        value(diff.section, diff.key, diff.old_value) + L" -> " + value(diff.section, diff.key, diff.new_value);
+}
+
+//---------------------------------------------------------------------------
+
+bool CompareLayouts(ReverseOptions& opt)
+{
+    // Get the list of keyboard layouts.
+    WStringList file_list;
+    KbdFile::ExpandNames(file_list, opt.inputs);
+    const WStringVector files(file_list.begin(), file_list.end());
+    if (files.size() < 2) {
+        opt.error(L"at least two keyboard layouts are required with -x");
+        return false;
+    }
+
+    // Extract the content of all layouts in parallel. The DLL's are unloaded after.
+    std::vector<std::unique_ptr<KbdContent>> contents(files.size());
+    std::vector<std::string> errors(files.size());
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(files.size(), [&](size_t index, size_t) {
+        std::ostringstream err_stream;
+        Error err(FileName(files[index]) + L": ", &err_stream);
+        KbdFile kbd(err);
+        if (kbd.load(files[index])) {
+            contents[index] = std::make_unique<KbdContent>(*kbd.tables());
+        }
+        errors[index] = err_stream.str();
+    });
+    for (const auto& err : errors) {
+        std::cerr << err;
+    }
+    for (const auto& content : contents) {
+        if (content == nullptr) {
+            return false;
+        }
+    }
+
+    // Two layouts: list all differences.
+    opt.setOutput(opt.output);
+    const LayoutComparator comparator(opt);
+    if (files.size() == 2) {
+        std::vector<KbdContent::Difference> diffs;
+        std::array<size_t, KbdContent::SECTION_COUNT> counts;
+        contents[0]->compare(*contents[1], &diffs, &counts);
+        opt.out() << "--- " << files[0] << std::endl << "+++ " << files[1] << std::endl;
+        for (const auto& diff : diffs) {
+            opt.out() << comparator.format(diff) << std::endl;
+        }
+        WString summary;
+        for (size_t sec = 0; sec < counts.size(); ++sec) {
+            summary.append(Format(L", %s %zu", KbdContent::SectionName(KbdContent::Section(sec)), counts[sec]));
+        }
+        opt.out() << Format(L"%zu differences", diffs.size()) << summary << std::endl;
+        return true;
+    }
+
+    // More layouts: number of differences for each pair, computed in parallel, one job per first layout.
+    typedef std::array<size_t, KbdContent::SECTION_COUNT> Counts;
+    std::vector<std::vector<Counts>> pairs(files.size());
+    pool.run(files.size(), [&](size_t i, size_t) {
+        pairs[i].resize(files.size());
+        for (size_t j = i + 1; j < files.size(); ++j) {
+            contents[i]->compare(*contents[j], nullptr, &pairs[i][j]);
+        }
+    });
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    Grid grid(L"", L"  ");
+    Grid::Line header{L"Layout 1", L"Layout 2"};
+    for (size_t sec = 0; sec < KbdContent::SECTION_COUNT; ++sec) {
+        header.push_back(KbdContent::SectionName(KbdContent::Section(sec)));
+    }
+    header.push_back(L"total");
+    grid.addLine(header);
+    grid.addUnderlines();
+    size_t identical = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        for (size_t j = i + 1; j < files.size(); ++j) {
+            Grid::Line line{FileBaseName(files[i]), FileBaseName(files[j])};
+            size_t total = 0;
+            for (size_t count : pairs[i][j]) {
+                line.push_back(Format(L"%zu", count));
+                total += count;
+            }
+            line.push_back(Format(L"%zu", total));
+            grid.addLine(line);
+            identical += total == 0 ? 1 : 0;
+        }
+    }
+    grid.print(opt.out());
+    opt.out() << std::endl
+              << Format(L"%zu layouts, %zu pairs, %zu identical, %zu threads, %.1f ms",
+                        files.size(), files.size() * (files.size() - 1) / 2, identical, pool.threadCount(), duration)
+              << std::endl;
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Analyze the identical tables in several keyboard layouts.
+//---------------------------------------------------------------------------
+
+bool AnalyzeTables(ReverseOptions& opt)
+{
+    // Get the list of keyboard layouts.
+    WStringList file_list;
+    KbdFile::ExpandNames(file_list, opt.inputs);
+    const WStringVector files(file_list.begin(), file_list.end());
+
+    // Load all layouts in parallel and group their identical tables.
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    const auto start = std::chrono::steady_clock::now();
+    LoadedLayoutVector layouts;
+    if (!LoadLayouts(layouts, files, pool)) {
+        return false;
+    }
+    const KbdTableGroups groups(GroupTables(layouts));
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Statistics per table name, in the order of first appearance, and per layout.
+    struct NameStat
+    {
+        size_t layouts = 0;
+        size_t distinct = 0;
+        size_t shared = 0;
+        size_t bytes = 0;
+        size_t duplicated = 0;
+    };
+    std::vector<std::string> names;
+    std::map<std::string, NameStat> name_stats;
+    std::vector<size_t> shared_bytes(layouts.size(), 0);
+    size_t total_tables = 0;
+    size_t total_bytes = 0;
+    size_t duplicated_bytes = 0;
+    for (const auto& grp : groups.groups()) {
+        const auto& first(grp.members.front());
+        const std::string& name(layouts[first.layout]->tables->tables()[first.table].name);
+        if (name_stats.find(name) == name_stats.end()) {
+            names.push_back(name);
+        }
+        NameStat& stat(name_stats[name]);
+        stat.layouts += grp.members.size();
+        stat.distinct++;
+        stat.bytes += grp.size * grp.members.size();
+        total_tables += grp.members.size();
+        total_bytes += grp.size * grp.members.size();
+        if (!grp.name.empty()) {
+            stat.shared++;
+            stat.duplicated += grp.size * (grp.members.size() - 1);
+            duplicated_bytes += grp.size * (grp.members.size() - 1);
+            for (const auto& mem : grp.members) {
+                shared_bytes[mem.layout] += grp.size;
+            }
+        }
+    }
+
+    opt.setOutput(opt.output);
+    Grid grid(L"", L"  ");
+    grid.addLine({L"Table", L"Layouts", L"Distinct", L"Shared", L"Bytes", L"Duplicated"});
+    grid.addUnderlines();
+    for (const auto& name : names) {
+        const NameStat& stat(name_stats[name]);
+        grid.addLine({ToUTF16(name),
+                      Format(L"%zu", stat.layouts),
+                      Format(L"%zu", stat.distinct),
+                      Format(L"%zu", stat.shared),
+                      Format(L"%zu", stat.bytes),
+                      Format(L"%zu", stat.duplicated)});
+    }
+    grid.print(opt.out());
+    opt.out() << std::endl;
+
+    // Bytes of tables per layout: in tables which are identical in other layouts, and in its own tables.
+    // The .data section of the DLL, which contains the tables, is displayed for reference: each DLL keeps
+    // its copy of the identical tables, sharing them in the source files does not change it.
+    // A .wklbin file has no section.
+    grid.clear();
+    grid.addLine({L"Layout", L".data", L"Table bytes", L"In common tables", L"In own tables"});
+    grid.addUnderlines();
+    for (size_t i = 0; i < layouts.size(); ++i) {
+        const LoadedLayout& lay(*layouts[i]);
+        WString data;
+        for (const auto& sec : lay.kbd.image().sections()) {
+            if (sec.name == ".data") {
+                data = Format(L"%u", sec.size);
+            }
+        }
+        const size_t size = lay.tables->totalSize();
+        grid.addLine({FileBaseName(files[i]),
+                      data,
+                      Format(L"%zu", size),
+                      Format(L"%zu", shared_bytes[i]),
+                      Format(L"%zu", size - shared_bytes[i])});
+    }
+    grid.print(opt.out());
+    opt.out() << std::endl
+              << Format(L"%zu layouts, %zu tables, %zu distinct, %zu shared, %zu bytes, %zu duplicated bytes (%.1f%%), %zu threads, %.1f ms",
+                        layouts.size(), total_tables, groups.groups().size(), groups.sharedCount(), total_bytes, duplicated_bytes,
+                        total_bytes == 0 ? 0.0 : (100.0 * double(duplicated_bytes)) / double(total_bytes),
+                        std::min(pool.threadCount(), files.size()), duration)
+              << std::endl;
+    return true;
+}
+
+
+//---------------------------------------------------------------------------
+// Report the memory footprint of the data structures of keyboard layouts.
+//---------------------------------------------------------------------------
+
+// Format a string as a JSON literal.
+WString JsonString(const WString& str)
+{
+    WString res(L"\"");
+    for (wchar_t c : str) {
+        if (c == L'"' || c == L'\\') {
+            res.push_back(L'\\');
+            res.push_back(c);
+        }
+        else if (c < 0x20) {
+            res.append(Format(L"\\u%04X", int(c)));
+        }
+        else {
+            res.push_back(c);
+        }
+    }
+    res.push_back(L'"');
+    return res;
+}
+
+bool FootprintReport(ReverseOptions& opt)
+{
+    // Get the list of keyboard layouts.
+    WStringList file_list;
+    KbdFile::ExpandNames(file_list, opt.inputs);
+    const WStringVector files(file_list.begin(), file_list.end());
+
+    // Walk the data structures of all layouts in parallel, the generated source code is dropped.
+    std::vector<std::unique_ptr<Footprint>> footprints(files.size());
+    std::vector<std::string> errors(files.size());
+    WorkPool pool(opt.threads > 0 ? size_t(opt.threads) : 0);
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(files.size(), [&](size_t index, size_t) {
+        std::ostringstream err_stream;
+        Error err(FileName(files[index]) + L": ", &err_stream);
+        KbdFile kbd(err);
+        if (kbd.load(files[index])) {
+            std::ostringstream source;
+            SourceGenerator gen(opt, source, kbd.fileName());
+            SetDataBlock(gen, kbd);
+            gen.generate(*kbd.tables());
+            footprints[index] = std::make_unique<Footprint>(gen.footprint());
+            ImageFootprint(*footprints[index], kbd);
+        }
+        errors[index] = err_stream.str();
+    });
+    const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool success = true;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::cerr << errors[i];
+        success = success && footprints[i] != nullptr;
+    }
+
+    opt.setOutput(opt.output);
+    if (opt.footprint == L"json") {
+        // One object per layout, the sizes are in bytes.
+        opt.out() << "{" << std::endl << "  \"layouts\": [";
+        bool first = true;
+        for (size_t i = 0; i < files.size(); ++i) {
+            const Footprint* fp = footprints[i].get();
+            if (fp != nullptr) {
+                opt.out() << (first ? "" : ",") << std::endl
+                          << "    {\"file\": " << JsonString(files[i])
+                          << ", \"image\": " << fp->image_size
+                          << ", \"data\": " << fp->data_size
+                          << ", \"data_pages\": " << fp->data_pages
+                          << ", \"page_size\": " << fp->page_size
+                          << ", \"pages\": " << fp->pages
+                          << ", \"total\": " << fp->total()
+                          << ", \"bytes\": {";
+                for (size_t cat = 0; cat < DataStructure::CAT_COUNT; ++cat) {
+                    opt.out() << (cat == 0 ? "" : ", ") << "\"" << DataStructure::CategoryName(DataStructure::Category(cat)) << "\": " << fp->bytes[cat];
+                }
+                opt.out() << "}}";
+                first = false;
+            }
+        }
+        opt.out() << std::endl << "  ]" << std::endl << "}" << std::endl;
+    }
+    else {
+        Grid grid(L"", L"  ");
+        Grid::Line header{L"Layout"};
+        for (size_t cat = 0; cat < DataStructure::CAT_COUNT; ++cat) {
+            header.push_back(DataStructure::CategoryName(DataStructure::Category(cat)));
+        }
+        header.insert(header.end(), {L"total", L"pages", L"image", L"data", L"datapages"});
+        grid.addLine(header);
+        grid.addUnderlines();
+        Footprint all;
+        for (size_t i = 0; i < files.size(); ++i) {
+            const Footprint* fp = footprints[i].get();
+            if (fp != nullptr) {
+                Grid::Line line{FileBaseName(files[i])};
+                for (size_t cat = 0; cat < DataStructure::CAT_COUNT; ++cat) {
+                    line.push_back(Format(L"%zu", fp->bytes[cat]));
+                    all.bytes[cat] += fp->bytes[cat];
+                }
+                line.push_back(Format(L"%zu", fp->total()));
+                line.push_back(Format(L"%zu", fp->pages));
+                line.push_back(fp->image_size == 0 ? L"" : Format(L"%zu", fp->image_size));
+                line.push_back(fp->image_size == 0 ? L"" : Format(L"%zu", fp->data_size));
+                line.push_back(fp->image_size == 0 ? L"" : Format(L"%zu", fp->data_pages));
+                grid.addLine(line);
+                all.pages += fp->pages;
+                all.image_size += fp->image_size;
+                all.data_size += fp->data_size;
+                all.data_pages += fp->data_pages;
+            }
+        }
+        if (files.size() > 1) {
+            grid.addUnderlines();
+            Grid::Line line{L"all"};
+            for (size_t cat = 0; cat < DataStructure::CAT_COUNT; ++cat) {
+                line.push_back(Format(L"%zu", all.bytes[cat]));
+            }
+            line.push_back(Format(L"%zu", all.total()));
+            line.push_back(Format(L"%zu", all.pages));
+            line.push_back(Format(L"%zu", all.image_size));
+            line.push_back(Format(L"%zu", all.data_size));
+            line.push_back(Format(L"%zu", all.data_pages));
+            grid.addLine(line);
+        }
+        grid.print(opt.out());
+        opt.out() << std::endl
+                  << Format(L"%zu layouts, %zu threads, %.1f ms", files.size(), std::min(pool.threadCount(), files.size()), duration)
+                  << std::endl;
+    }
+    return success;
+}
+
+
+//---------------------------------------------------------------------------
+// Application entry point.
+//---------------------------------------------------------------------------
+
+int wmain(int argc, wchar_t* argv[])
+{
+    // Parse command line options.
+    ReverseOptions opt(argc, argv);
+
+    // Comparison of layouts.
+    if (opt.compare) {
+        opt.exit(CompareLayouts(opt) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Memory footprint of the layouts.
+    if (!opt.footprint.empty()) {
+        opt.exit(FootprintReport(opt) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Analysis of identical tables.
+    if (opt.analyze) {
+        opt.exit(AnalyzeTables(opt) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Batch mode, all output files are generated in a directory.
+    if (!opt.batch_dir.empty()) {
+        opt.exit(GenerateBatch(opt) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Load the keyboard layout DLL in our virtual memory space, without executing it.
+    KbdFile kbd(opt);
+    if (!kbd.load(opt.input)) {
+        opt.exit(EXIT_FAILURE);
+    }
+    opt.input = kbd.fileName();
+
+    // Open the output file when specified.
+    opt.setOutput(opt.output, opt.gen_binary);
+
+    // Generate the source file.
+    Footprint original;
+    Footprint compact;
+    if (opt.gen_resources) {
+        GenerateResourceFile(opt);
+    }
+    else if (!GenerateOutput(opt, opt, opt.out(), kbd, nullptr, &original, &compact)) {
+        opt.exit(EXIT_FAILURE);
+    }
+    else if (opt.compact) {
+        opt.info(Format(L"compact data structures (estimated): %zu bytes before, %zu bytes after, %zd bytes saved",
+                        original.total(), compact.total(), ptrdiff_t(original.total() - compact.total())));
     }
     opt.exit(EXIT_SUCCESS);
 }
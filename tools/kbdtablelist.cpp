@@ -0,0 +1,235 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// List of the individual tables of a keyboard layout, with their content.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdtablelist.h"
+
+namespace {
+
+    // Largest ligature entry, to access the characters of entries of any size.
+    TYPEDEF_LIGATURE(16)
+
+    // Append data to a content.
+    void Append(std::vector<uint8_t>& content, const void* data, size_t size)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        content.insert(content.end(), p, p + size);
+    }
+
+    // Append a nul-terminated string to a content, return the size of the string in bytes.
+    size_t AppendString(std::vector<uint8_t>& content, const WCHAR* str)
+    {
+        size_t len = 0;
+        while (str != nullptr && str[len] != 0) {
+            len++;
+        }
+        const WCHAR nul = 0;
+        Append(content, str, len * sizeof(WCHAR));
+        Append(content, &nul, sizeof(nul));
+        return (len + 1) * sizeof(WCHAR);
+    }
+
+    // Append the modification numbers. The generated comments of the character
+    // tables depend on them: identical tables need identical modifiers.
+    void AppendModifiers(std::vector<uint8_t>& content, const MODIFIERS* mods)
+    {
+        if (mods != nullptr) {
+            Append(content, &mods->wMaxModBits, sizeof(mods->wMaxModBits));
+            Append(content, mods->ModNumber, size_t(mods->wMaxModBits) + 1);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: extract the list of tables.
+//----------------------------------------------------------------------------
+
+KbdTableList::KbdTableList(const KBDTABLES& tables) :
+    _tables()
+{
+    // Key names, with their strings.
+    const PVSC_LPWSTR names[2] = {tables.pKeyNames, tables.pKeyNamesExt};
+    for (size_t i = 0; i < 2; ++i) {
+        if (names[i] != nullptr) {
+            Table tab{i == 0 ? KEY_NAMES : KEY_NAMES_EXT, i == 0 ? "key_names" : "key_names_ext", names[i], 0, 0, 0, {}, 0};
+            const VSC_LPWSTR* p = names[i];
+            for (; p->vsc != 0; ++p) {
+                Append(tab.content, &p->vsc, sizeof(p->vsc));
+                tab.size += AppendString(tab.content, p->pwsz);
+            }
+            tab.size += (p - names[i] + 1) * sizeof(VSC_LPWSTR);
+            add(std::move(tab));
+        }
+    }
+    if (tables.pKeyNamesDead != nullptr) {
+        Table tab{KEY_NAMES_DEAD, "key_names_dead", tables.pKeyNamesDead, 0, 0, 0, {}, 0};
+        const DEADKEY_LPWSTR* p = tables.pKeyNamesDead;
+        for (; *p != nullptr; ++p) {
+            tab.size += AppendString(tab.content, *p);
+        }
+        tab.size += (p - tables.pKeyNamesDead + 1) * sizeof(DEADKEY_LPWSTR);
+        add(std::move(tab));
+    }
+
+    // Scan codes.
+    if (tables.pusVSCtoVK != nullptr) {
+        Table tab{SCANCODE_TO_VK, "scancode_to_vk", tables.pusVSCtoVK, tables.bMaxVSCtoVK * sizeof(USHORT), 0, 0, {}, 0};
+        Append(tab.content, tables.pusVSCtoVK, tab.size);
+        add(std::move(tab));
+    }
+    const PVSC_VK prefixed[2] = {tables.pVSCtoVK_E0, tables.pVSCtoVK_E1};
+    for (size_t i = 0; i < 2; ++i) {
+        if (prefixed[i] != nullptr) {
+            Table tab{i == 0 ? SCANCODE_TO_VK_E0 : SCANCODE_TO_VK_E1, i == 0 ? "scancode_to_vk_e0" : "scancode_to_vk_e1", prefixed[i], 0, 0, 0, {}, 0};
+            const VSC_VK* p = prefixed[i];
+            for (; p->Vsc != 0; ++p) {
+                // Field by field, the padding byte is not part of the content.
+                Append(tab.content, &p->Vsc, sizeof(p->Vsc));
+                Append(tab.content, &p->Vk, sizeof(p->Vk));
+            }
+            tab.size = (p - prefixed[i] + 1) * sizeof(VSC_VK);
+            add(std::move(tab));
+        }
+    }
+
+    // Modifiers.
+    const MODIFIERS* const mods = tables.pCharModifiers;
+    if (mods != nullptr && mods->pVkToBit != nullptr) {
+        Table tab{VK_TO_BITS, "vk_to_bits", mods->pVkToBit, 0, 0, 0, {}, 0};
+        const VK_TO_BIT* p = mods->pVkToBit;
+        while (p->Vk != 0) {
+            ++p;
+        }
+        tab.size = (p - mods->pVkToBit + 1) * sizeof(VK_TO_BIT);
+        Append(tab.content, mods->pVkToBit, tab.size);
+        add(std::move(tab));
+    }
+
+    // Characters, one table per number of modifications.
+    for (const VK_TO_WCHAR_TABLE* vtwc = tables.pVkToWcharTable; vtwc != nullptr && vtwc->pVkToWchars != nullptr; ++vtwc) {
+        Table tab{VK_TO_WCHARS, "vk_to_wchar" + std::to_string(vtwc->nModifications), vtwc->pVkToWchars, 0, vtwc->nModifications, vtwc->cbSize, {}, 0};
+        const uint8_t* const base = reinterpret_cast<const uint8_t*>(vtwc->pVkToWchars);
+        const uint8_t* row = base;
+        while (*row != 0) {
+            row += vtwc->cbSize;
+        }
+        tab.size = row - base + vtwc->cbSize;
+        AppendModifiers(tab.content, mods);
+        Append(tab.content, base, tab.size);
+        add(std::move(tab));
+    }
+
+    // Dead keys.
+    if (tables.pDeadKey != nullptr) {
+        Table tab{DEAD_KEYS, "dead_keys", tables.pDeadKey, 0, 0, 0, {}, 0};
+        const DEADKEY* p = tables.pDeadKey;
+        while (p->dwBoth != 0) {
+            ++p;
+        }
+        tab.size = (p - tables.pDeadKey + 1) * sizeof(DEADKEY);
+        Append(tab.content, tables.pDeadKey, tab.size);
+        add(std::move(tab));
+    }
+
+    // Ligatures, field by field, there is a padding byte after the virtual key.
+    if (tables.pLigature != nullptr && tables.cbLgEntry > 0) {
+        Table tab{LIGATURES, "ligatures", tables.pLigature, 0, tables.nLgMax, tables.cbLgEntry, {}, 0};
+        AppendModifiers(tab.content, mods);
+        const uint8_t* const base = reinterpret_cast<const uint8_t*>(tables.pLigature);
+        const uint8_t* entry = base;
+        for (; *entry != 0; entry += tables.cbLgEntry) {
+            const LIGATURE16* lg = reinterpret_cast<const LIGATURE16*>(entry);
+            Append(tab.content, &lg->VirtualKey, sizeof(lg->VirtualKey));
+            Append(tab.content, &lg->ModificationNumber, sizeof(lg->ModificationNumber));
+            Append(tab.content, lg->wch, std::min<size_t>(tables.nLgMax, 16) * sizeof(WCHAR));
+        }
+        tab.size = entry - base + tables.cbLgEntry;
+        add(std::move(tab));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Add a table, compute the hash of its content (FNV-1a, 64 bits).
+//----------------------------------------------------------------------------
+
+void KbdTableList::add(Table&& table)
+{
+    table.hash = 0xCBF29CE484222325ull;
+    for (uint8_t b : table.content) {
+        table.hash = (table.hash ^ b) * 0x00000100000001B3ull;
+    }
+    _tables.push_back(std::move(table));
+}
+
+
+//----------------------------------------------------------------------------
+// Total size in bytes of all tables.
+//----------------------------------------------------------------------------
+
+size_t KbdTableList::totalSize() const
+{
+    size_t size = 0;
+    for (const auto& tab : _tables) {
+        size += tab.size;
+    }
+    return size;
+}
+
+
+//----------------------------------------------------------------------------
+// Group the tables of several layouts.
+//----------------------------------------------------------------------------
+
+KbdTableGroups::KbdTableGroups(const std::vector<const KbdTableList*>& layouts) :
+    _groups(),
+    _index(),
+    _shared_count(0)
+{
+    for (size_t lay = 0; lay < layouts.size(); ++lay) {
+        if (layouts[lay] != nullptr) {
+            const auto& tables(layouts[lay]->tables());
+            for (size_t tab = 0; tab < tables.size(); ++tab) {
+                const auto it = _index.emplace(Key(tables[tab].name, tables[tab].hash, tables[tab].content), _groups.size());
+                if (it.second) {
+                    _groups.push_back(Group{std::string(), tables[tab].size, {}});
+                }
+                _groups[it.first->second].members.push_back(Member{lay, tab});
+            }
+        }
+    }
+
+    // Name the shared tables, with a sequence number per table name.
+    std::map<std::string, size_t> counts;
+    for (auto& grp : _groups) {
+        if (grp.members.size() > 1) {
+            const std::string& name(layouts[grp.members.front().layout]->tables()[grp.members.front().table].name);
+            grp.name = "shared_" + name + "_" + std::to_string(++counts[name]);
+            _shared_count++;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Get the shared names of the tables of a layout.
+//----------------------------------------------------------------------------
+
+std::map<const void*, std::string> KbdTableGroups::sharedNames(const KbdTableList& layout) const
+{
+    std::map<const void*, std::string> names;
+    for (const auto& tab : layout.tables()) {
+        const auto it = _index.find(Key(tab.name, tab.hash, tab.content));
+        if (it != _index.end() && !_groups[it->second].name.empty()) {
+            names[tab.address] = _groups[it->second].name;
+        }
+    }
+    return names;
+}
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// List of the individual tables of a keyboard layout, with their content.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+#include <tuple>
+
+// The tables are the arrays which are referenced by KBDTABLES, MODIFIERS and
+// VK_TO_WCHAR_TABLE. They have no pointer to other tables, except strings,
+// and can be shared between layouts. Each table has a position-independent
+// content (the strings are included, not their addresses) and a 64-bit hash
+// of that content, to find identical tables in several layouts.
+class KbdTableList
+{
+public:
+    // Constructor. Extract the list of tables. The tables must remain valid while the list is used.
+    KbdTableList(const KBDTABLES&);
+
+    // Kinds of tables.
+    enum Kind : uint8_t {
+        KEY_NAMES,          // VSC_LPWSTR[]
+        KEY_NAMES_EXT,      // VSC_LPWSTR[]
+        KEY_NAMES_DEAD,     // DEADKEY_LPWSTR[]
+        SCANCODE_TO_VK,     // USHORT[bMaxVSCtoVK]
+        SCANCODE_TO_VK_E0,  // VSC_VK[]
+        SCANCODE_TO_VK_E1,  // VSC_VK[]
+        VK_TO_BITS,         // VK_TO_BIT[]
+        VK_TO_WCHARS,       // VK_TO_WCHARSn[], one table per number of modifications.
+        DEAD_KEYS,          // DEADKEY[]
+        LIGATURES,          // LIGATUREn[]
+    };
+
+    // Description of one table.
+    struct Table
+    {
+        Kind                 kind;
+        std::string          name;        // Name in the generated source files, e.g. "vk_to_wchar3".
+        const void*          address;     // Address of the table in the layout.
+        size_t               size;        // Size in bytes in the layout, including strings.
+        size_t               columns;     // Number of characters per entry (VK_TO_WCHARS, LIGATURES).
+        size_t               entry_size;  // Size in bytes of an entry (VK_TO_WCHARS, LIGATURES).
+        std::vector<uint8_t> content;     // Position-independent content, for comparisons.
+        uint64_t             hash;        // Hash of the content.
+    };
+
+    // Get the list of tables.
+    const std::vector<Table>& tables() const { return _tables; }
+
+    // Total size in bytes of all tables.
+    size_t totalSize() const;
+
+private:
+    std::vector<Table> _tables;
+
+    // Add a table, compute the hash of its content.
+    void add(Table&& table);
+};
+
+// Groups of identical tables in several layouts. Two tables are identical when
+// they have the same name in the generated source files and the same content.
+class KbdTableGroups
+{
+public:
+    // Constructor. Group the tables of several layouts. Null lists are ignored.
+    KbdTableGroups(const std::vector<const KbdTableList*>& layouts);
+
+    // Reference to a table: index of the layout, index of the table in the layout.
+    struct Member
+    {
+        size_t layout;
+        size_t table;
+    };
+
+    // Description of a group of identical tables.
+    struct Group
+    {
+        std::string         name;     // Shared name, e.g. "shared_key_names_1", empty if only one member.
+        size_t              size;     // Size in bytes of one table.
+        std::vector<Member> members;  // All identical tables, in the order of layouts.
+    };
+
+    // Get the list of groups, in the order of first appearance.
+    const std::vector<Group>& groups() const { return _groups; }
+
+    // Number of groups with a shared name (at least two members).
+    size_t sharedCount() const { return _shared_count; }
+
+    // Get the shared names of the tables of a layout, indexed by table address.
+    // The tables which are not shared with other layouts are not in the map.
+    std::map<const void*, std::string> sharedNames(const KbdTableList& layout) const;
+
+private:
+    typedef std::tuple<std::string, uint64_t, std::vector<uint8_t>> Key;
+    std::vector<Group>    _groups;
+    std::map<Key, size_t> _index;  // Index in _groups.
+    size_t                _shared_count;
+};
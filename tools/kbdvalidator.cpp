@@ -0,0 +1,569 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Static validation of the keyboard tables of a layout.
+//
+//----------------------------------------------------------------------------
+
+#include "kbdvalidator.h"
+#include <cstdio>
+
+namespace {
+
+    // Largest entries, to access the characters of entries of any size.
+    TYPEDEF_LIGATURE(16)
+
+    // Format an integer in hexadecimal.
+    std::string Hex(uint32_t value, int width = 2)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "0x%0*X", width, value);
+        return buf;
+    }
+
+    // Format a character.
+    std::string Char(WCHAR c)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "U+%04X", unsigned(c));
+        return buf;
+    }
+
+    // Check if a virtual key is a non-character key of the standard PC keyboard, which usually
+    // has a name. The other keys (F13-F24, media, OEM specific) are not named in the system layouts.
+    bool NamedKey(uint32_t vk)
+    {
+        return vk == VK_BACK || vk == VK_TAB || vk == VK_RETURN || vk == VK_ESCAPE ||
+            (vk >= VK_SHIFT && vk <= VK_CAPITAL) ||
+            (vk >= VK_SPACE && vk <= VK_DELETE) ||
+            (vk >= VK_LWIN && vk <= VK_APPS) ||
+            (vk >= VK_NUMPAD0 && vk <= VK_F12) ||
+            (vk >= VK_NUMLOCK && vk <= VK_SCROLL) ||
+            (vk >= VK_LSHIFT && vk <= VK_RMENU);
+    }
+
+    // Check if a value is in a vector.
+    template <typename T>
+    bool Contains(const std::vector<T>& vec, const T& value)
+    {
+        return std::find(vec.begin(), vec.end(), value) != vec.end();
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: validate the tables.
+//----------------------------------------------------------------------------
+
+KbdValidator::KbdValidator(const KBDTABLES& tables, const void* area, size_t area_size) :
+    _tables(tables),
+    _area(reinterpret_cast<const uint8_t*>(area)),
+    _area_size(area_size),
+    _issues(),
+    _errors(0),
+    _warnings(0),
+    _structures(),
+    _columns(0),
+    _char_keys(),
+    _dead_chars(),
+    _ligature_keys()
+{
+    if (readable(&tables, sizeof(KBDTABLES), "KBDTABLES")) {
+        addStructure(&tables, sizeof(KBDTABLES), "KBDTABLES");
+        checkModifiers();
+        checkCharacters();
+        checkLigatures();
+        checkDeadKeys();
+        checkScanCodes();
+        checkKeyNames();
+        checkOverlaps();
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Report an issue.
+//----------------------------------------------------------------------------
+
+void KbdValidator::report(Severity severity, const std::string& message)
+{
+    _issues.push_back(Issue{severity, message});
+    if (severity == SEV_ERROR) {
+        _errors++;
+    }
+    else {
+        _warnings++;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check if a memory range is inside the area of the layout.
+//----------------------------------------------------------------------------
+
+bool KbdValidator::readable(const void* address, size_t size, const std::string& name)
+{
+    const uint8_t* const p = reinterpret_cast<const uint8_t*>(address);
+    if (p == nullptr) {
+        report(SEV_ERROR, "null address for " + name);
+        return false;
+    }
+    if (_area != nullptr && (p < _area || p > _area + _area_size || size > size_t(_area + _area_size - p))) {
+        report(SEV_ERROR, name + " is outside the keyboard layout");
+        return false;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Register a data structure for overlap detection.
+//----------------------------------------------------------------------------
+
+void KbdValidator::addStructure(const void* address, size_t size, const std::string& name)
+{
+    if (address != nullptr && size > 0) {
+        _structures.push_back(Structure{reinterpret_cast<const uint8_t*>(address), size, name});
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Count the entries in an array which ends with a terminator entry.
+//----------------------------------------------------------------------------
+
+template <class IS_LAST>
+bool KbdValidator::countEntries(size_t& count, const void* address, size_t entry_size, const std::string& name, IS_LAST is_last)
+{
+    const uint8_t* const base = reinterpret_cast<const uint8_t*>(address);
+    for (count = 0; ; ++count) {
+        const uint8_t* const entry = base + count * entry_size;
+        if (_area != nullptr && (entry < _area || entry_size > size_t(_area + _area_size - entry))) {
+            report(SEV_ERROR, "no terminator in " + name + " after " + std::to_string(count) + " entries");
+            return false;
+        }
+        if (is_last(entry)) {
+            return true;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the modifiers, compute the number of columns.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkModifiers()
+{
+    const MODIFIERS* const mods = _tables.pCharModifiers;
+    if (!readable(mods, offsetof(MODIFIERS, ModNumber), "MODIFIERS")) {
+        return;
+    }
+    if (mods->wMaxModBits > 0xFF) {
+        report(SEV_ERROR, "wMaxModBits " + Hex(mods->wMaxModBits, 4) + " is larger than the modifier bits");
+        return;
+    }
+    const size_t size = offsetof(MODIFIERS, ModNumber) + mods->wMaxModBits + 1;
+    if (!readable(mods, size, "MODIFIERS")) {
+        return;
+    }
+    addStructure(mods, size, "MODIFIERS");
+
+    // Virtual keys of the modifiers.
+    size_t count = 0;
+    if (readable(mods->pVkToBit, sizeof(VK_TO_BIT), "VK_TO_BIT") &&
+        countEntries(count, mods->pVkToBit, sizeof(VK_TO_BIT), "VK_TO_BIT", [](const uint8_t* p) { return reinterpret_cast<const VK_TO_BIT*>(p)->Vk == 0; }))
+    {
+        addStructure(mods->pVkToBit, (count + 1) * sizeof(VK_TO_BIT), "VK_TO_BIT");
+        std::array<bool, 256> seen{};
+        for (size_t i = 0; i < count; ++i) {
+            const VK_TO_BIT& vb(mods->pVkToBit[i]);
+            if (seen[vb.Vk]) {
+                report(SEV_WARNING, "duplicate modifier virtual key " + Hex(vb.Vk) + " in VK_TO_BIT, ignored");
+            }
+            seen[vb.Vk] = true;
+            if (vb.ModBits == 0 || vb.ModBits > mods->wMaxModBits) {
+                report(SEV_ERROR, "modifier bits " + Hex(vb.ModBits) + " of virtual key " + Hex(vb.Vk) + " are not in 1.." + Hex(mods->wMaxModBits));
+            }
+        }
+    }
+
+    // Number of columns in the VK_TO_WCHARS tables.
+    for (size_t bits = 0; bits <= mods->wMaxModBits; ++bits) {
+        if (mods->ModNumber[bits] != SHFT_INVALID) {
+            _columns = std::max<size_t>(_columns, mods->ModNumber[bits] + 1);
+        }
+    }
+    if (mods->ModNumber[0] == SHFT_INVALID) {
+        report(SEV_WARNING, "no modification number for unshifted keys in ModNumber[0]");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the virtual key to characters tables.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkCharacters()
+{
+    const VK_TO_WCHAR_TABLE* const tables = _tables.pVkToWcharTable;
+    size_t tcount = 0;
+    if (!readable(tables, sizeof(VK_TO_WCHAR_TABLE), "VK_TO_WCHAR_TABLE") ||
+        !countEntries(tcount, tables, sizeof(VK_TO_WCHAR_TABLE), "VK_TO_WCHAR_TABLE", [](const uint8_t* p) { return reinterpret_cast<const VK_TO_WCHAR_TABLE*>(p)->pVkToWchars == nullptr; }))
+    {
+        return;
+    }
+    addStructure(tables, (tcount + 1) * sizeof(VK_TO_WCHAR_TABLE), "VK_TO_WCHAR_TABLE");
+
+    // Table index where each virtual key is first defined, the system uses the first one.
+    std::array<size_t, 256> defined;
+    defined.fill(SIZE_MAX);
+
+    for (size_t ti = 0; ti < tcount; ++ti) {
+        const VK_TO_WCHAR_TABLE& tab(tables[ti]);
+        const std::string name = "VK_TO_WCHARS" + std::to_string(tab.nModifications) + " (table #" + std::to_string(ti) + ")";
+        const size_t expected = offsetof(VK_TO_WCHARS1, wch) + tab.nModifications * sizeof(WCHAR);
+        if (tab.nModifications == 0) {
+            report(SEV_ERROR, name + ": nModifications is zero");
+            continue;
+        }
+        if (tab.cbSize != expected) {
+            report(SEV_ERROR, name + ": cbSize is " + std::to_string(tab.cbSize) + " bytes, expected " + std::to_string(expected));
+            if (tab.cbSize < expected) {
+                continue;
+            }
+        }
+        if (tab.nModifications > _columns) {
+            report(SEV_WARNING, name + ": " + std::to_string(tab.nModifications - _columns) + " columns are not used by any combination of modifiers");
+        }
+        size_t rows = 0;
+        if (!readable(tab.pVkToWchars, tab.cbSize, name) ||
+            !countEntries(rows, tab.pVkToWchars, tab.cbSize, name, [](const uint8_t* p) { return *p == 0; }))
+        {
+            continue;
+        }
+        addStructure(tab.pVkToWchars, (rows + 1) * tab.cbSize, name);
+
+        const uint8_t* const base = reinterpret_cast<const uint8_t*>(tab.pVkToWchars);
+        for (size_t ri = 0; ri < rows; ++ri) {
+            const VK_TO_WCHARS10* const row = reinterpret_cast<const VK_TO_WCHARS10*>(base + ri * tab.cbSize);
+            const uint8_t vk = row->VirtualKey;
+            if (vk == VK__none_) {
+                report(SEV_WARNING, name + ": VK__none_ entry at index " + std::to_string(ri) + " does not follow a SGCAPS or dead key entry, ignored");
+                continue;
+            }
+
+            // SGCAPS and dead key entries use the next entry, which is skipped. The system does not
+            // check its virtual key, it is usually VK__none_, sometimes the same virtual key.
+            bool dead = false;
+            for (size_t col = 0; col < tab.nModifications; ++col) {
+                dead = dead || row->wch[col] == WCH_DEAD;
+            }
+            const VK_TO_WCHARS10* next = nullptr;
+            if (dead || (row->Attributes & SGCAPS) != 0) {
+                next = ri + 1 < rows ? reinterpret_cast<const VK_TO_WCHARS10*>(base + (ri + 1) * tab.cbSize) : nullptr;
+                if (next == nullptr || (next->VirtualKey != VK__none_ && next->VirtualKey != vk)) {
+                    report(SEV_ERROR, name + ": virtual key " + Hex(vk) + ((row->Attributes & SGCAPS) != 0 ? " has SGCAPS" : " has dead keys") + " but is not followed by a VK__none_ entry");
+                    next = nullptr;
+                }
+                else {
+                    ++ri;
+                }
+            }
+
+            // The system uses the first definition of a virtual key.
+            if (defined[vk] != SIZE_MAX) {
+                report(SEV_WARNING, name + ": virtual key " + Hex(vk) + " already defined in table #" + std::to_string(defined[vk]) + ", ignored");
+                continue;
+            }
+            defined[vk] = ti;
+            _char_keys[vk] = row->wch[0] != WCH_NONE;
+
+            // Collect dead characters and ligatures for later checks.
+            for (size_t col = 0; col < tab.nModifications; ++col) {
+                if (row->wch[col] == WCH_DEAD && next != nullptr) {
+                    const WCHAR dc = next->wch[col];
+                    if (dc == 0 || dc == WCH_NONE || dc == WCH_DEAD || dc == WCH_LGTR) {
+                        report(SEV_ERROR, name + ": invalid dead character " + Char(dc) + " for virtual key " + Hex(vk) + ", column " + std::to_string(col));
+                    }
+                    else if (!Contains(_dead_chars, dc)) {
+                        _dead_chars.push_back(dc);
+                    }
+                }
+                else if (row->wch[col] == WCH_LGTR) {
+                    _ligature_keys.push_back((uint32_t(vk) << 16) | uint32_t(col));
+                }
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the ligatures.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkLigatures()
+{
+    const uint8_t* const base = reinterpret_cast<const uint8_t*>(_tables.pLigature);
+    if (base == nullptr) {
+        if (!_ligature_keys.empty()) {
+            report(SEV_ERROR, std::to_string(_ligature_keys.size()) + " WCH_LGTR entries but no ligature table");
+        }
+        return;
+    }
+
+    const size_t expected = offsetof(LIGATURE1, wch) + _tables.nLgMax * sizeof(WCHAR);
+    if (_tables.nLgMax == 0 || _tables.nLgMax > 16) {
+        report(SEV_ERROR, "invalid nLgMax " + std::to_string(_tables.nLgMax) + " for ligatures");
+        return;
+    }
+    if (_tables.cbLgEntry != expected) {
+        report(SEV_ERROR, "cbLgEntry is " + std::to_string(_tables.cbLgEntry) + " bytes, expected " + std::to_string(expected) + " for nLgMax " + std::to_string(_tables.nLgMax));
+        if (_tables.cbLgEntry < expected) {
+            return;
+        }
+    }
+    const std::string name = "LIGATURE" + std::to_string(_tables.nLgMax);
+    size_t count = 0;
+    if (!readable(base, _tables.cbLgEntry, name) ||
+        !countEntries(count, base, _tables.cbLgEntry, name, [](const uint8_t* p) { return *p == 0; }))
+    {
+        return;
+    }
+    addStructure(base, (count + 1) * _tables.cbLgEntry, name);
+
+    std::vector<uint32_t> found;
+    for (size_t i = 0; i < count; ++i) {
+        const LIGATURE16* const lg = reinterpret_cast<const LIGATURE16*>(base + i * _tables.cbLgEntry);
+        const uint32_t key = (uint32_t(lg->VirtualKey) << 16) | lg->ModificationNumber;
+        const std::string where = "ligature for virtual key " + Hex(lg->VirtualKey) + ", column " + std::to_string(lg->ModificationNumber);
+        if (lg->ModificationNumber >= _columns) {
+            report(SEV_ERROR, where + ": no such column");
+        }
+        else if (Contains(found, key)) {
+            report(SEV_WARNING, where + ": duplicate, ignored");
+        }
+        else if (!Contains(_ligature_keys, key)) {
+            report(SEV_WARNING, where + ": no WCH_LGTR entry, unreachable");
+        }
+        if (lg->wch[0] == WCH_NONE) {
+            report(SEV_WARNING, where + ": no character");
+        }
+        found.push_back(key);
+    }
+    for (uint32_t key : _ligature_keys) {
+        if (!Contains(found, key)) {
+            report(SEV_ERROR, "WCH_LGTR for virtual key " + Hex(key >> 16) + ", column " + std::to_string(key & 0xFFFF) + " has no ligature entry");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the dead keys and their names.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkDeadKeys()
+{
+    const DEADKEY* const dk = _tables.pDeadKey;
+    size_t count = 0;
+    if (dk == nullptr) {
+        if (!_dead_chars.empty()) {
+            report(SEV_ERROR, std::to_string(_dead_chars.size()) + " dead keys but no DEADKEY table");
+        }
+    }
+    else if (readable(dk, sizeof(DEADKEY), "DEADKEY") &&
+             countEntries(count, dk, sizeof(DEADKEY), "DEADKEY", [](const uint8_t* p) { return reinterpret_cast<const DEADKEY*>(p)->dwBoth == 0; }))
+    {
+        addStructure(dk, (count + 1) * sizeof(DEADKEY), "DEADKEY");
+
+        // Chained dead keys are dead characters as well.
+        std::vector<WCHAR> dead_chars(_dead_chars);
+        for (size_t i = 0; i < count; ++i) {
+            if ((dk[i].uFlags & DKF_DEAD) != 0 && !Contains(dead_chars, dk[i].wchComposed)) {
+                dead_chars.push_back(dk[i].wchComposed);
+            }
+        }
+
+        std::vector<DWORD> seen;
+        std::vector<WCHAR> accents;
+        for (size_t i = 0; i < count; ++i) {
+            const WCHAR accent = HIWORD(dk[i].dwBoth);
+            const std::string where = "DEADTRANS(" + Char(LOWORD(dk[i].dwBoth)) + ", " + Char(accent) + ")";
+            if (Contains(seen, dk[i].dwBoth)) {
+                report(SEV_WARNING, where + ": duplicate, ignored");
+            }
+            else if (!Contains(dead_chars, accent)) {
+                if (!Contains(accents, accent)) {
+                    report(SEV_WARNING, where + ": " + Char(accent) + " is not a dead key, unreachable");
+                }
+            }
+            if ((dk[i].uFlags & ~DKF_DEAD) != 0) {
+                report(SEV_WARNING, where + ": unknown flags " + Hex(dk[i].uFlags, 4));
+            }
+            seen.push_back(dk[i].dwBoth);
+            if (!Contains(accents, accent)) {
+                accents.push_back(accent);
+            }
+        }
+        for (WCHAR dc : dead_chars) {
+            if (!Contains(accents, dc)) {
+                report(SEV_WARNING, "dead key " + Char(dc) + " has no DEADTRANS entry");
+            }
+        }
+    }
+
+    // Names of dead keys, the first character of each string is the dead character.
+    const DEADKEY_LPWSTR* const names = _tables.pKeyNamesDead;
+    if (names == nullptr) {
+        if (!_dead_chars.empty()) {
+            report(SEV_WARNING, "no names for dead keys");
+        }
+        return;
+    }
+    if (!readable(names, sizeof(DEADKEY_LPWSTR), "KEYNAMES_DEAD") ||
+        !countEntries(count, names, sizeof(DEADKEY_LPWSTR), "KEYNAMES_DEAD", [](const uint8_t* p) { return *reinterpret_cast<const DEADKEY_LPWSTR*>(p) == nullptr; }))
+    {
+        return;
+    }
+    addStructure(names, (count + 1) * sizeof(DEADKEY_LPWSTR), "KEYNAMES_DEAD");
+    std::vector<WCHAR> named;
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = 0;
+        const std::string where = "dead key name #" + std::to_string(i);
+        if (readable(names[i], sizeof(WCHAR), where) &&
+            countEntries(len, names[i], sizeof(WCHAR), where, [](const uint8_t* p) { return *reinterpret_cast<const WCHAR*>(p) == 0; }))
+        {
+            if (len < 2) {
+                report(SEV_WARNING, where + ": empty name");
+            }
+            else if (Contains(named, names[i][0])) {
+                report(SEV_WARNING, "duplicate name for dead key " + Char(names[i][0]) + ", ignored");
+            }
+            else {
+                named.push_back(names[i][0]);
+            }
+        }
+    }
+    for (WCHAR dc : _dead_chars) {
+        if (!Contains(named, dc)) {
+            report(SEV_WARNING, "dead key " + Char(dc) + " has no name");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the scan code tables.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkScanCodes()
+{
+    if (_tables.bMaxVSCtoVK == 0) {
+        report(SEV_ERROR, "bMaxVSCtoVK is zero, no scan code");
+    }
+    else if (readable(_tables.pusVSCtoVK, _tables.bMaxVSCtoVK * sizeof(USHORT), "VSC_TO_VK")) {
+        addStructure(_tables.pusVSCtoVK, _tables.bMaxVSCtoVK * sizeof(USHORT), "VSC_TO_VK (bMaxVSCtoVK " + Hex(_tables.bMaxVSCtoVK) + ")");
+        if (_tables.bMaxVSCtoVK > 0x80) {
+            report(SEV_WARNING, "bMaxVSCtoVK " + Hex(_tables.bMaxVSCtoVK) + " includes break codes, above 0x7F");
+        }
+    }
+
+    const PVSC_VK lists[2] = {_tables.pVSCtoVK_E0, _tables.pVSCtoVK_E1};
+    for (size_t i = 0; i < 2; ++i) {
+        const std::string name(i == 0 ? "VSC_TO_VK_E0" : "VSC_TO_VK_E1");
+        size_t count = 0;
+        if (lists[i] != nullptr &&
+            readable(lists[i], sizeof(VSC_VK), name) &&
+            countEntries(count, lists[i], sizeof(VSC_VK), name, [](const uint8_t* p) { return reinterpret_cast<const VSC_VK*>(p)->Vsc == 0; }))
+        {
+            addStructure(lists[i], (count + 1) * sizeof(VSC_VK), name);
+            std::array<bool, 256> seen{};
+            for (size_t n = 0; n < count; ++n) {
+                if (seen[lists[i][n].Vsc]) {
+                    report(SEV_WARNING, name + ": duplicate scan code " + Hex(lists[i][n].Vsc) + ", ignored");
+                }
+                seen[lists[i][n].Vsc] = true;
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the key names. The keys which produce a character are named after it.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkKeyNames()
+{
+    const PVSC_LPWSTR lists[2] = {_tables.pKeyNames, _tables.pKeyNamesExt};
+    std::array<std::array<bool, 256>, 2> named{};
+    for (size_t i = 0; i < 2; ++i) {
+        const std::string name(i == 0 ? "KEYNAMES" : "KEYNAMES_EXT");
+        size_t count = 0;
+        if (lists[i] == nullptr ||
+            !readable(lists[i], sizeof(VSC_LPWSTR), name) ||
+            !countEntries(count, lists[i], sizeof(VSC_LPWSTR), name, [](const uint8_t* p) { return reinterpret_cast<const VSC_LPWSTR*>(p)->vsc == 0; }))
+        {
+            continue;
+        }
+        addStructure(lists[i], (count + 1) * sizeof(VSC_LPWSTR), name);
+        for (size_t n = 0; n < count; ++n) {
+            const VSC_LPWSTR& kn(lists[i][n]);
+            const std::string where = name + ": scan code " + Hex(kn.vsc);
+            size_t len = 0;
+            if (named[i][kn.vsc]) {
+                report(SEV_WARNING, where + ": duplicate name, ignored");
+            }
+            else if (readable(kn.pwsz, sizeof(WCHAR), where) &&
+                     countEntries(len, kn.pwsz, sizeof(WCHAR), where, [](const uint8_t* p) { return *reinterpret_cast<const WCHAR*>(p) == 0; }))
+            {
+                if (len == 0) {
+                    report(SEV_WARNING, where + ": empty name");
+                }
+                named[i][kn.vsc] = true;
+            }
+        }
+    }
+
+    // Mapped non-character keys need a name.
+    const auto check = [this, &named](size_t index, uint8_t sc, USHORT vk) {
+        vk &= 0xFF;
+        if (NamedKey(vk) && !_char_keys[vk] && !named[index][sc]) {
+            report(SEV_WARNING, std::string(index == 0 ? "scan code " : "scan code E0 ") + Hex(sc) + ": no name for virtual key " + Hex(vk));
+        }
+    };
+    // The scan code tables are read without bounds checking, only when no error was found.
+    if (_tables.pusVSCtoVK != nullptr && _errors == 0) {
+        for (size_t sc = 1; sc < _tables.bMaxVSCtoVK; ++sc) {
+            check(0, uint8_t(sc), _tables.pusVSCtoVK[sc]);
+        }
+        for (const VSC_VK* p = _tables.pVSCtoVK_E0; p != nullptr && p->Vsc != 0; ++p) {
+            check(1, p->Vsc, p->Vk);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check that the data structures do not overlap.
+//----------------------------------------------------------------------------
+
+void KbdValidator::checkOverlaps()
+{
+    std::sort(_structures.begin(), _structures.end(), [](const Structure& s1, const Structure& s2) { return s1.address < s2.address; });
+    for (size_t i = 0; i < _structures.size(); ++i) {
+        const Structure& s1(_structures[i]);
+        for (size_t j = i + 1; j < _structures.size() && _structures[j].address < s1.address + s1.size; ++j) {
+            // Identical structures may be shared, for instance two tables with the same content.
+            const Structure& s2(_structures[j]);
+            if (s1.address != s2.address || s1.size != s2.size) {
+                report(SEV_ERROR, s1.name + " overlaps " + s2.name);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Static validation of the keyboard tables of a layout.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+
+// The tables are checked without using them through the system: terminators,
+// sizes of arrays and entries, consistency between tables (dead keys, ligatures,
+// key names). When the memory area of the layout is known (the image of a DLL),
+// all structures are read with bounds checking and a corrupted layout is reported,
+// not crashed on. The structures are also checked for overlaps, which reveal
+// arrays which are larger than their actual content (e.g. bMaxVSCtoVK).
+class KbdValidator
+{
+public:
+    // Constructor. Validate the tables. When 'area' is not null, all structures must
+    // be inside that memory area. The tables are no longer used after construction.
+    KbdValidator(const KBDTABLES& tables, const void* area = nullptr, size_t area_size = 0);
+
+    // Severity of an issue.
+    enum Severity : uint8_t {
+        SEV_WARNING,  // Accepted by the system but probably not intended (ignored or unreachable data).
+        SEV_ERROR,    // Invalid structure, the system may misbehave or crash.
+    };
+
+    // One issue in the tables.
+    struct Issue
+    {
+        Severity    severity;
+        std::string message;
+    };
+
+    // Get the list of issues, in order of detection.
+    const std::vector<Issue>& issues() const { return _issues; }
+
+    // Get the number of issues by severity.
+    size_t errorCount() const { return _errors; }
+    size_t warningCount() const { return _warnings; }
+
+private:
+    // Description of a data structure, for overlap detection.
+    struct Structure
+    {
+        const uint8_t* address;
+        size_t         size;
+        std::string    name;
+    };
+
+    const KBDTABLES&       _tables;
+    const uint8_t*         _area;
+    size_t                 _area_size;
+    std::vector<Issue>     _issues;
+    size_t                 _errors;
+    size_t                 _warnings;
+    std::vector<Structure> _structures;
+    size_t                 _columns;       // Number of columns from ModNumber[].
+    std::array<bool, 256>  _char_keys;     // Virtual keys which produce a character without modifier.
+    std::vector<WCHAR>     _dead_chars;    // Dead characters from the VK_TO_WCHARS tables.
+    std::vector<uint32_t>  _ligature_keys; // (vk << 16) | column of WCH_LGTR entries.
+
+    // Report an issue.
+    void report(Severity severity, const std::string& message);
+
+    // Check if a memory range is inside the area of the layout. Report an error if not.
+    bool readable(const void* address, size_t size, const std::string& name);
+
+    // Register a data structure for overlap detection.
+    void addStructure(const void* address, size_t size, const std::string& name);
+
+    // Count the entries in an array which ends with a terminator entry, register the array.
+    // Return false and report an error if the terminator is outside the area of the layout.
+    template <class IS_LAST>
+    bool countEntries(size_t& count, const void* address, size_t entry_size, const std::string& name, IS_LAST is_last);
+
+    // Checks of each part of the tables. The order matters, later checks use results of earlier ones.
+    void checkModifiers();
+    void checkCharacters();
+    void checkLigatures();
+    void checkDeadKeys();
+    void checkScanCodes();
+    void checkKeyNames();
+    void checkOverlaps();
+
+    // Inaccessible operations.
+    KbdValidator(const KbdValidator&) = delete;
+    KbdValidator& operator=(const KbdValidator&) = delete;
+};
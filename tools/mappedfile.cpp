@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A read-only memory-mapped file.
+//
+//----------------------------------------------------------------------------
+
+#include "mappedfile.h"
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+MappedFile::MappedFile() :
+    _data(nullptr),
+    _size(0),
+    _writable(false)
+#if defined(_WIN32)
+    ,
+    _file(INVALID_HANDLE_VALUE),
+    _mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+//----------------------------------------------------------------------------
+// Map a file in memory.
+//----------------------------------------------------------------------------
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::filesystem::path& filename, size_t max_size, bool copy_on_write)
+{
+    close();
+    LARGE_INTEGER size;
+    _file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file != INVALID_HANDLE_VALUE && GetFileSizeEx(_file, &size) && size.QuadPart > 0 && uint64_t(size.QuadPart) <= max_size) {
+        _mapping = CreateFileMappingW(_file, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping != nullptr) {
+            _data = reinterpret_cast<const uint8_t*>(MapViewOfFile(_mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+            _size = _data == nullptr ? 0 : size_t(size.QuadPart);
+            _writable = _data != nullptr && copy_on_write;
+        }
+    }
+    if (_data == nullptr) {
+        close();
+    }
+    return _data != nullptr;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+        _data = nullptr;
+    }
+    if (_mapping != nullptr) {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+    _size = 0;
+    _writable = false;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& filename, size_t max_size, bool copy_on_write)
+{
+    close();
+    struct stat st;
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        if (::fstat(fd, &st) == 0 && st.st_size > 0 && uint64_t(st.st_size) <= max_size) {
+            void* addr = ::mmap(nullptr, size_t(st.st_size), copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                _data = reinterpret_cast<const uint8_t*>(addr);
+                _size = size_t(st.st_size);
+                _writable = copy_on_write;
+            }
+        }
+        ::close(fd);
+    }
+    return _data != nullptr;
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr) {
+        ::munmap(const_cast<uint8_t*>(_data), _size);
+        _data = nullptr;
+    }
+    _size = 0;
+    _writable = false;
+}
+
+#endif
@@ -0,0 +1,55 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A read-only memory-mapped file.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+#include <filesystem>
+
+// Uses CreateFileMapping() on Windows and mmap() on other systems.
+class MappedFile
+{
+public:
+    // Default maximum file size, sanity check, keyboard files are a few kilobytes.
+    static constexpr size_t DEFAULT_MAX_SIZE = 0x10000000;
+
+    // Constructor and destructor.
+    MappedFile();
+    ~MappedFile();
+
+    // Map a file in memory. Close the previous one. Return false on error.
+    // Empty files and files larger than max_size are rejected. With copy_on_write,
+    // the content can be modified in this process, the file is never modified:
+    // only the modified pages are copied by the system.
+    bool open(const std::filesystem::path& filename, size_t max_size = DEFAULT_MAX_SIZE, bool copy_on_write = false);
+
+    // Unmap the file.
+    void close();
+
+    // Access the content of the file. Null or zero when not open.
+    bool isOpen() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    // Modifiable content of a file which was mapped with copy_on_write. Null otherwise.
+    uint8_t* writableData() const { return _writable ? const_cast<uint8_t*>(_data) : nullptr; }
+
+private:
+    const uint8_t* _data;
+    size_t         _size;
+    bool           _writable;
+#if defined(_WIN32)
+    HANDLE         _file;
+    HANDLE         _mapping;
+#endif
+
+    // Inaccessible operations.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
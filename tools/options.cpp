@@ -35,11 +35,11 @@ Options::Options(int argc, wchar_t* argv[], const WString syntax) :
 // Set an output file or use std::cout.
 //----------------------------------------------------------------------------
 
-void Options::setOutput(const WString& filename)
+void Options::setOutput(const WString& filename, bool binary)
 {
     closeOutput();
     if (!filename.empty()) {
-        _outfile.open(filename);
+        _outfile.open(FilePath(filename), binary ? std::ios::out | std::ios::binary : std::ios::out);
         if (!_outfile) {
             fatal("cannot create output file " + filename);
         }
@@ -22,7 +22,7 @@ public:
     WStringVector args;
 
     // Set an output file or use std::cout.
-    void setOutput(const WString& filename);
+    void setOutput(const WString& filename, bool binary = false);
     void closeOutput();
     std::ostream& out() { return *_out; }
     
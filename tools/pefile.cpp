@@ -0,0 +1,428 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Portable reader of PE32 and PE32+ image files (x86, x64, arm64 DLL's),
+// without loading or executing them.
+//
+//----------------------------------------------------------------------------
+
+#include "pefile.h"
+
+// Some values from the PE/COFF specification.
+#define PE_DOS_SIGNATURE        0x5A4D      // "MZ"
+#define PE_NT_SIGNATURE         0x00004550  // "PE\0\0"
+#define PE_MAGIC_PE32           0x010B
+#define PE_MAGIC_PE64           0x020B
+#define PE_COFF_HEADER_SIZE     20
+#define PE_SECTION_HEADER_SIZE  40
+#define PE_DIRECTORY_EXPORT     0
+#define PE_DIRECTORY_BASERELOC  5
+#define PE_REL_BASED_ABSOLUTE   0
+#define PE_REL_BASED_HIGHLOW    3
+#define PE_REL_BASED_DIR64      10
+#define PE_MAX_IMAGE_SIZE       0x10000000  // Sanity check, a keyboard DLL is a few kilobytes.
+
+
+//----------------------------------------------------------------------------
+// Little endian access in a memory area.
+//----------------------------------------------------------------------------
+
+namespace {
+    inline uint16_t GetLE16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+    inline uint32_t GetLE32(const uint8_t* p) { return uint32_t(GetLE16(p)) | (uint32_t(GetLE16(p + 2)) << 16); }
+    inline uint64_t GetLE64(const uint8_t* p) { return uint64_t(GetLE32(p)) | (uint64_t(GetLE32(p + 4)) << 32); }
+    inline void PutLE32(uint8_t* p, uint32_t v) { for (size_t i = 0; i < 4; ++i) { p[i] = uint8_t(v >> (8 * i)); } }
+    inline void PutLE64(uint8_t* p, uint64_t v) { for (size_t i = 0; i < 8; ++i) { p[i] = uint8_t(v >> (8 * i)); } }
+}
+
+uint16_t PeFile::get16(uint32_t rva) const
+{
+    const uint8_t* const p = data(rva, 2);
+    return p == nullptr ? 0 : GetLE16(p);
+}
+
+uint32_t PeFile::get32(uint32_t rva) const
+{
+    const uint8_t* const p = data(rva, 4);
+    return p == nullptr ? 0 : GetLE32(p);
+}
+
+uint64_t PeFile::get64(uint32_t rva) const
+{
+    const uint8_t* const p = data(rva, 8);
+    return p == nullptr ? 0 : GetLE64(p);
+}
+
+
+//----------------------------------------------------------------------------
+// Resolve RVA's in the mapped file.
+//----------------------------------------------------------------------------
+
+const uint8_t* PeFile::data(uint32_t rva, size_t size) const
+{
+    if (rva < _headers_size && size <= _headers_size - rva) {
+        return _file.data() + rva;
+    }
+    for (const auto& sec : _sections) {
+        if (rva >= sec.rva && rva - sec.rva < sec.file_size && size <= sec.file_size - (rva - sec.rva)) {
+            return _file.data() + sec.file_offset + (rva - sec.rva);
+        }
+    }
+    return nullptr;
+}
+
+uint32_t PeFile::addressRva(const void* address) const
+{
+    const uint8_t* const p = reinterpret_cast<const uint8_t*>(address);
+    if (p < _file.data() || p >= _file.data() + _file.size()) {
+        return 0;
+    }
+    const size_t offset = size_t(p - _file.data());
+    if (offset < _headers_size) {
+        return uint32_t(offset);
+    }
+    for (const auto& sec : _sections) {
+        if (offset >= sec.file_offset && offset - sec.file_offset < sec.file_size) {
+            return uint32_t(sec.rva + (offset - sec.file_offset));
+        }
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+PeFile::PeFile() :
+    _file(),
+    _relocs(),
+    _sections(),
+    _error(),
+    _machine(0),
+    _pe64(false),
+    _relocated(false),
+    _image_base(0),
+    _image_size(0),
+    _headers_size(0),
+    _export_rva(0),
+    _export_size(0)
+{
+}
+
+PeFile::~PeFile()
+{
+    unload();
+}
+
+
+//----------------------------------------------------------------------------
+// Unload the PE file.
+//----------------------------------------------------------------------------
+
+void PeFile::unload()
+{
+    _file.close();
+    _relocs.clear();
+    _sections.clear();
+    _machine = 0;
+    _pe64 = false;
+    _relocated = false;
+    _image_base = 0;
+    _image_size = 0;
+    _headers_size = 0;
+    _export_rva = 0;
+    _export_size = 0;
+}
+
+bool PeFile::fail(const std::string& message)
+{
+    unload();
+    _error = message;
+    return false;
+}
+
+
+//----------------------------------------------------------------------------
+// Load a PE file.
+//----------------------------------------------------------------------------
+
+bool PeFile::load(const std::filesystem::path& filename)
+{
+    unload();
+    _error.clear();
+
+    // Copy-on-write: the relocations are applied in the mapped file.
+    if (!_file.open(filename, PE_MAX_IMAGE_SIZE, true)) {
+        return fail("cannot open or map file");
+    }
+    return build();
+}
+
+
+//----------------------------------------------------------------------------
+// Analyze the headers of the mapped file and apply the relocations.
+//----------------------------------------------------------------------------
+
+bool PeFile::build()
+{
+    const uint8_t* const file = _file.data();
+    const size_t file_size = _file.size();
+
+    // DOS header, then NT headers.
+    if (file_size < 0x40 || GetLE16(file) != PE_DOS_SIGNATURE) {
+        return fail("not a PE file, no DOS header");
+    }
+    const size_t nt = GetLE32(file + 0x3C);
+    if (nt > file_size || file_size - nt < 4 + PE_COFF_HEADER_SIZE || GetLE32(file + nt) != PE_NT_SIGNATURE) {
+        return fail("not a PE file, no NT header");
+    }
+
+    // COFF header.
+    const uint8_t* const coff = file + nt + 4;
+    _machine = GetLE16(coff);
+    const size_t sections_count = GetLE16(coff + 2);
+    const size_t opt_size = GetLE16(coff + 16);
+    const size_t opt = nt + 4 + PE_COFF_HEADER_SIZE;
+    const size_t sections = opt + opt_size;
+    if (opt_size < 2 || sections > file_size || (file_size - sections) / PE_SECTION_HEADER_SIZE < sections_count) {
+        return fail("truncated PE headers");
+    }
+
+    // Optional header.
+    const uint16_t magic = GetLE16(file + opt);
+    if (magic != PE_MAGIC_PE32 && magic != PE_MAGIC_PE64) {
+        return fail("unsupported PE optional header");
+    }
+    _pe64 = magic == PE_MAGIC_PE64;
+    const size_t dir_offset = _pe64 ? 112 : 96;
+    if (opt_size < dir_offset) {
+        return fail("truncated PE optional header");
+    }
+    _image_base = _pe64 ? GetLE64(file + opt + 24) : GetLE32(file + opt + 28);
+    const size_t image_size = GetLE32(file + opt + 56);
+    const size_t headers_size = std::min<size_t>(GetLE32(file + opt + 60), file_size);
+    const size_t dir_count = std::min<size_t>(GetLE32(file + opt + dir_offset - 4), (opt_size - dir_offset) / 8);
+    if (image_size == 0 || image_size > PE_MAX_IMAGE_SIZE || headers_size > image_size) {
+        return fail("invalid PE image size");
+    }
+
+    // The headers and the raw data of the sections are used in place.
+    _image_size = uint32_t(image_size);
+    _headers_size = uint32_t(headers_size);
+    for (size_t i = 0; i < sections_count; ++i) {
+        const uint8_t* const sec = file + sections + i * PE_SECTION_HEADER_SIZE;
+        const size_t virtual_size = GetLE32(sec + 8);
+        const size_t rva = GetLE32(sec + 12);
+        const size_t raw_size = GetLE32(sec + 16);
+        const size_t raw_offset = GetLE32(sec + 20);
+        const size_t size = virtual_size == 0 ? raw_size : std::min(raw_size, virtual_size);
+        if (rva > image_size || size > image_size - rva || raw_offset > file_size || size > file_size - raw_offset) {
+            return fail("invalid PE section");
+        }
+        const char* const name = reinterpret_cast<const char*>(sec);
+        _sections.push_back(Section{std::string(name, strnlen(name, 8)), uint32_t(rva), uint32_t(virtual_size == 0 ? raw_size : virtual_size), uint32_t(raw_offset), uint32_t(size)});
+    }
+
+    // Data directories.
+    const auto directory = [&](size_t index, uint32_t& rva, uint32_t& size) {
+        rva = index < dir_count ? GetLE32(file + opt + dir_offset + 8 * index) : 0;
+        size = index < dir_count ? GetLE32(file + opt + dir_offset + 8 * index + 4) : 0;
+        if (data(rva, size) == nullptr) {
+            rva = size = 0;
+        }
+    };
+    uint32_t reloc_rva = 0;
+    uint32_t reloc_size = 0;
+    directory(PE_DIRECTORY_EXPORT, _export_rva, _export_size);
+    directory(PE_DIRECTORY_BASERELOC, reloc_rva, reloc_size);
+
+    // Collect the base relocations, blocks of 16-bit entries for one 4 kB page.
+    const uint32_t reloc_end = reloc_rva + reloc_size;
+    for (uint32_t block = reloc_rva; block + 8 <= reloc_end; ) {
+        const uint32_t page = get32(block);
+        const uint32_t block_size = get32(block + 4);
+        if (block_size < 8 || block_size > reloc_end - block) {
+            break;
+        }
+        for (uint32_t entry = block + 8; entry + 2 <= block + block_size; entry += 2) {
+            const uint16_t value = get16(entry);
+            const uint32_t type = value >> 12;
+            const uint32_t rva = page + (value & 0x0FFF);
+            if (type == PE_REL_BASED_ABSOLUTE) {
+                continue; // padding
+            }
+            else if ((type == PE_REL_BASED_DIR64 && _pe64) || (type == PE_REL_BASED_HIGHLOW && !_pe64)) {
+                if (data(rva, _pe64 ? 8 : 4) != nullptr) {
+                    _relocs.push_back(rva);
+                }
+            }
+            else {
+                return fail("unsupported PE base relocation type " + std::to_string(type));
+            }
+        }
+        block += block_size;
+    }
+
+    // Apply the relocations when the pointers have the same size as in this process.
+    // Each pointer is redirected to its target in the mapped file, a null pointer
+    // when the target is not in the file (uninitialized data).
+    if (_pe64 == (sizeof(void*) == 8)) {
+        uint8_t* const base = _file.writableData();
+        for (uint32_t rva : _relocs) {
+            uint8_t* const ptr = base + (data(rva) - file);
+            const uint64_t target_rva = _pe64 ? GetLE64(ptr) - _image_base : uint32_t(GetLE32(ptr) - uint32_t(_image_base));
+            const uint8_t* const target = target_rva < _image_size ? data(uint32_t(target_rva)) : nullptr;
+            if (_pe64) {
+                PutLE64(ptr, uint64_t(reinterpret_cast<uintptr_t>(target)));
+            }
+            else {
+                PutLE32(ptr, uint32_t(reinterpret_cast<uintptr_t>(target)));
+            }
+        }
+        _relocated = true;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Convert an absolute address in the image into an RVA.
+//----------------------------------------------------------------------------
+
+uint32_t PeFile::addressToRva(uint64_t address) const
+{
+    // A relocated address points into the mapped file.
+    if (_relocated) {
+        return addressRva(reinterpret_cast<const void*>(uintptr_t(address)));
+    }
+    // With 32-bit images, wrap around 32 bits.
+    uint64_t rva = address - _image_base;
+    if (!_pe64) {
+        rva &= 0xFFFFFFFF;
+    }
+    return rva < _image_size ? uint32_t(rva) : 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the RVA of an exported symbol.
+//----------------------------------------------------------------------------
+
+uint32_t PeFile::exportRva(const std::string& name) const
+{
+    if (_export_size < 40) {
+        return 0;
+    }
+    const uint32_t functions_count = get32(_export_rva + 20);
+    const uint32_t names_count = get32(_export_rva + 24);
+    const uint32_t functions = get32(_export_rva + 28);
+    const uint32_t names = get32(_export_rva + 32);
+    const uint32_t ordinals = get32(_export_rva + 36);
+    if (data(functions, size_t(functions_count) * 4) == nullptr ||
+        data(names, size_t(names_count) * 4) == nullptr ||
+        data(ordinals, size_t(names_count) * 2) == nullptr)
+    {
+        return 0;
+    }
+
+    // Locate the name, then its ordinal, then the function.
+    for (uint32_t i = 0; i < names_count; ++i) {
+        const uint32_t name_rva = get32(names + 4 * i);
+        const uint8_t* const str = data(name_rva, name.size() + 1);
+        if (str != nullptr && std::memcmp(str, name.c_str(), name.size() + 1) == 0) {
+            const uint32_t index = get16(ordinals + 2 * i);
+            const uint32_t rva = index < functions_count ? get32(functions + 4 * index) : 0;
+            // An RVA inside the export directory is a forwarder string, not a function.
+            return rva >= _export_rva && rva < _export_rva + _export_size ? 0 : rva;
+        }
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the RVA of the constant address which is returned by a trivial function.
+//----------------------------------------------------------------------------
+
+uint32_t PeFile::returnedAddressRva(uint32_t rva) const
+{
+    // Follow a few jumps (incremental linking thunks).
+    for (int jumps = 0; jumps < 4; ++jumps) {
+        // Copy the first bytes of the function, the code can be at the end of the raw data of the section.
+        uint8_t code[16] {};
+        size_t code_size = sizeof(code);
+        while (code_size > 0 && data(rva, code_size) == nullptr) {
+            --code_size;
+        }
+        if (code_size == 0) {
+            break;
+        }
+        std::memcpy(code, data(rva, code_size), code_size);
+
+        if (_machine == MACHINE_AMD64) {
+            // lea rax, [rip+disp32] ; ret
+            if (code[0] == 0x48 && code[1] == 0x8D && code[2] == 0x05 && code[7] == 0xC3) {
+                return uint32_t(rva + 7 + GetLE32(code + 3));
+            }
+            // jmp rel32
+            if (code[0] == 0xE9) {
+                rva = uint32_t(rva + 5 + GetLE32(code + 1));
+                continue;
+            }
+        }
+        else if (_machine == MACHINE_I386) {
+            // Optional prologues: mov edi, edi ; push ebp ; mov ebp, esp
+            size_t i = 0;
+            if (code[i] == 0x8B && code[i + 1] == 0xFF) {
+                i += 2;
+            }
+            if (code[i] == 0x55 && code[i + 1] == 0x8B && code[i + 2] == 0xEC) {
+                i += 3;
+            }
+            // mov eax, imm32
+            if (code[i] == 0xB8) {
+                return addressToRva(GetLE32(code + i + 1));
+            }
+            // jmp rel32
+            if (i == 0 && code[0] == 0xE9) {
+                rva = uint32_t(rva + 5 + GetLE32(code + 1));
+                continue;
+            }
+        }
+        else if (_machine == MACHINE_ARM64) {
+            const uint32_t instr0 = GetLE32(code);
+            const uint32_t instr1 = GetLE32(code + 4);
+            // adrp x0, page ; add x0, x0, #offset
+            if ((instr0 & 0x9F00001F) == 0x90000000 && (instr1 & 0xFF8003FF) == 0x91000000) {
+                int64_t page = int64_t((((instr0 >> 5) & 0x7FFFF) << 2) | ((instr0 >> 29) & 0x03));
+                if (page & 0x100000) {
+                    page -= 0x200000; // sign extension on 21 bits
+                }
+                const uint32_t offset = ((instr1 >> 10) & 0x0FFF) << (((instr1 >> 22) & 0x01) * 12);
+                return uint32_t((int64_t(rva & ~uint32_t(0x0FFF)) + page * 0x1000) + offset);
+            }
+            // b rel26
+            if ((instr0 & 0xFC000000) == 0x14000000) {
+                int32_t offset = int32_t(instr0 & 0x03FFFFFF);
+                if (offset & 0x02000000) {
+                    offset -= 0x04000000; // sign extension on 26 bits
+                }
+                rva = uint32_t(int64_t(rva) + int64_t(offset) * 4);
+                continue;
+            }
+        }
+
+        // Unknown instructions, use an absolute address in the first bytes of the function.
+        for (uint32_t reloc : _relocs) {
+            if (reloc >= rva && reloc < rva + 16) {
+                return addressToRva(_pe64 ? get64(reloc) : get32(reloc));
+            }
+        }
+        break;
+    }
+    return 0;
+}
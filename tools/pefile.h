@@ -0,0 +1,129 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Portable reader of PE32 and PE32+ image files (x86, x64, arm64 DLL's),
+// without loading or executing them.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+#include "mappedfile.h"
+#include <filesystem>
+
+// The file is memory-mapped and used in place, there is no copy of the image:
+// the relative virtual addresses (RVA) are resolved into the raw data of the
+// sections in the mapped file. When the pointer size of the image is the same
+// as the current process, the base relocations are applied in the mapped file
+// (copy-on-write, only the pages which contain pointers are copied by the
+// system) so that the pointers in the data sections are directly usable.
+// The uninitialized end of a section (virtual size larger than its raw data
+// in the file) is not accessible and a pointer to it becomes a null pointer.
+class PeFile
+{
+public:
+    // Machine types in the COFF header.
+    static constexpr uint16_t MACHINE_I386  = 0x014C;
+    static constexpr uint16_t MACHINE_AMD64 = 0x8664;
+    static constexpr uint16_t MACHINE_ARM64 = 0xAA64;
+
+    // Constructor and destructor.
+    PeFile();
+    ~PeFile();
+
+    // Load a PE file. Unload the previous one. Return false on error, see errorMessage().
+    bool load(const std::filesystem::path& filename);
+
+    // Unload the PE file.
+    void unload();
+
+    // Last error message.
+    const std::string& errorMessage() const { return _error; }
+
+    // Characteristics of the loaded image.
+    bool isLoaded() const { return _file.isOpen(); }
+    uint16_t machine() const { return _machine; }
+    bool is64Bits() const { return _pe64; }
+    uint64_t imageBase() const { return _image_base; }
+    size_t imageSize() const { return _image_size; }
+
+    // Content of the mapped file.
+    const uint8_t* fileData() const { return _file.data(); }
+    size_t fileSize() const { return _file.size(); }
+
+    // Check if the pointers in the image were relocated and are directly usable in this process.
+    bool isRelocated() const { return _relocated; }
+
+    // Get the address of an area in the mapped file, from its relative virtual address (RVA).
+    // Return null if the area is not entirely in the headers or in the raw data of one section.
+    const uint8_t* data(uint32_t rva, size_t size = 1) const;
+
+    // Get the RVA of an address in the mapped file. Return zero if the address is outside
+    // the headers and the raw data of the sections.
+    uint32_t addressRva(const void* address) const;
+
+    template <typename T>
+    const T* get(uint32_t rva) const { return reinterpret_cast<const T*>(data(rva, sizeof(T))); }
+
+    // Get the RVA of the target of a pointer at some RVA in the image (relocated or not).
+    // Return zero if the pointer is null or its target is outside the image.
+    uint32_t pointerRva(uint32_t rva) const { return addressToRva(_pe64 ? get64(rva) : get32(rva)); }
+
+    // Description of a section of the image.
+    struct Section
+    {
+        std::string name;
+        uint32_t    rva;
+        uint32_t    size;         // Size in memory.
+        uint32_t    file_offset;  // Raw data in the file.
+        uint32_t    file_size;    // Size of the raw data in the file, at most the size in memory.
+    };
+
+    // Get the list of sections.
+    const std::vector<Section>& sections() const { return _sections; }
+
+    // Get the RVA of an exported symbol. Return zero if not found.
+    uint32_t exportRva(const std::string& name) const;
+
+    // Get the RVA of the constant address which is returned by a trivial function, such as:
+    // PKBDTABLES KbdLayerDescriptor() { return &kbd_tables; }
+    // The code of the function is decoded. When the instructions are not recognized, use
+    // the base relocations which are located in the first bytes of the function.
+    // Return zero if not found.
+    uint32_t returnedAddressRva(uint32_t function_rva) const;
+
+private:
+    MappedFile            _file;         // Copy-on-write mapping of the file.
+    std::vector<uint32_t> _relocs;       // RVA of all absolute addresses (base relocations).
+    std::vector<Section>  _sections;
+    std::string           _error;
+    uint16_t              _machine;
+    bool                  _pe64;
+    bool                  _relocated;
+    uint64_t              _image_base;   // Preferred image base in the file.
+    uint32_t              _image_size;   // Size of the image in memory.
+    uint32_t              _headers_size; // Size of the headers in the file.
+    uint32_t              _export_rva;   // Export directory.
+    uint32_t              _export_size;
+
+    // Analyze the headers of the mapped file and apply the relocations.
+    bool build();
+
+    // Read the content of the image at some RVA (little endian). Zero if the RVA is not valid.
+    uint16_t get16(uint32_t rva) const;
+    uint32_t get32(uint32_t rva) const;
+    uint64_t get64(uint32_t rva) const;
+
+    // Convert an absolute address in the image (relocated or not) into an RVA. Return zero if outside the image.
+    uint32_t addressToRva(uint64_t address) const;
+
+    // Set an error message and return false.
+    bool fail(const std::string& message);
+
+    // Inaccessible operations.
+    PeFile(const PeFile&) = delete;
+    PeFile& operator=(const PeFile&) = delete;
+};
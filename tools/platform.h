@@ -6,10 +6,16 @@
 //
 // Common header for Windows platform.
 //
+// On other systems, only the batch tools can be built (see the Makefile),
+// using the stand-in headers in the "portable" subdirectory. The modules
+// which call the Windows API are not compiled there.
+//
 //----------------------------------------------------------------------------
 
 #pragma once
 
+#if defined(_WIN32)
+
 #define _CRT_SECURE_NO_WARNINGS 1 // don't complain about string rtl.
 
 #include <windows.h>
@@ -23,12 +29,23 @@
     #undef max
 #endif
 
+#else
+
+#include <windows.h>  // stand-in from tools/portable
+#include <kbd.h>      // stand-in from tools/portable
+
+// Entry point of the tools, called by main() in wmain.cpp with a UTF-16 command line.
+int wmain(int argc, wchar_t* argv[]);
+
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <string>
+#include <array>
 #include <vector>
 #include <list>
 #include <map>
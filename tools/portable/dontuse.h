@@ -0,0 +1,9 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Stand-in for <dontuse.h> on non-Windows systems (empty).
+//
+//----------------------------------------------------------------------------
@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Stand-in for <kbd.h> on non-Windows systems.
+// The data structures have exactly the same layout as in the Windows SDK
+// so that the keyboard layout source files compile unchanged.
+//
+//----------------------------------------------------------------------------
+
+#if !defined(WKL_PORTABLE_KBD_H)
+#define WKL_PORTABLE_KBD_H 1
+
+#include <windows.h>
+
+#define KBD_LONG_POINTER
+
+// Virtual key flags, in the upper byte of 16-bit virtual key codes.
+#define KBDEXT         0x0100
+#define KBDMULTIVK     0x0200
+#define KBDSPECIAL     0x0400
+#define KBDNUMPAD      0x0800
+#define KBDUNICODE     0x1000
+#define KBDINJECTEDVK  0x2000
+#define KBDMAPPEDVK    0x4000
+#define KBDBREAK       0x8000
+
+// Modifier bits.
+#define KBDBASE        0x00
+#define KBDSHIFT       0x01
+#define KBDCTRL        0x02
+#define KBDALT         0x04
+#define KBDKANA        0x08
+#define KBDROYA        0x10
+#define KBDLOYA        0x20
+#define KBDGRPSELTAP   0x80
+
+// Special virtual key: no virtual key.
+#define VK__none_      0xFF
+
+// Associate a virtual key with a modifier bitmask.
+typedef struct {
+    BYTE Vk;
+    BYTE ModBits;
+} VK_TO_BIT, *KBD_LONG_POINTER PVK_TO_BIT;
+
+// Map character modifier bits to modification number.
+typedef struct {
+    PVK_TO_BIT pVkToBit;
+    WORD       wMaxModBits;
+    BYTE       ModNumber[];
+} MODIFIERS, *KBD_LONG_POINTER PMODIFIERS;
+
+#define SHFT_INVALID   0x0F
+
+// Attributes of VK_TO_WCHARS entries.
+#define CAPLOK         0x01
+#define SGCAPS         0x02
+#define CAPLOKALTGR    0x04
+#define KANALOK        0x08
+#define GRPSELTAP      0x80
+
+// Virtual key to characters, for N modification numbers.
+#define TYPEDEF_VK_TO_WCHARS(n) typedef struct _VK_TO_WCHARS##n { \
+            BYTE  VirtualKey;                                      \
+            BYTE  Attributes;                                      \
+            WCHAR wch[n];                                          \
+        } VK_TO_WCHARS##n, *KBD_LONG_POINTER PVK_TO_WCHARS##n;
+
+TYPEDEF_VK_TO_WCHARS(1)
+TYPEDEF_VK_TO_WCHARS(2)
+TYPEDEF_VK_TO_WCHARS(3)
+TYPEDEF_VK_TO_WCHARS(4)
+TYPEDEF_VK_TO_WCHARS(5)
+TYPEDEF_VK_TO_WCHARS(6)
+TYPEDEF_VK_TO_WCHARS(7)
+TYPEDEF_VK_TO_WCHARS(8)
+TYPEDEF_VK_TO_WCHARS(9)
+TYPEDEF_VK_TO_WCHARS(10)
+
+// Special characters in VK_TO_WCHARS.
+#define WCH_NONE       0xF000
+#define WCH_DEAD       0xF001
+#define WCH_LGTR       0xF002
+
+typedef struct _VK_TO_WCHAR_TABLE {
+    PVK_TO_WCHARS1 pVkToWchars;
+    BYTE           nModifications;
+    BYTE           cbSize;
+} VK_TO_WCHAR_TABLE, *KBD_LONG_POINTER PVK_TO_WCHAR_TABLE;
+
+// Dead keys.
+typedef struct {
+    DWORD  dwBoth;
+    WCHAR  wchComposed;
+    USHORT uFlags;
+} DEADKEY, *KBD_LONG_POINTER PDEADKEY;
+
+#define DEADTRANS(ch, accent, comp, flags) {MAKELONG(ch, accent), comp, flags}
+#define DKF_DEAD       0x0001
+
+// Ligatures.
+#define TYPEDEF_LIGATURE(n) typedef struct _LIGATURE##n { \
+            BYTE  VirtualKey;                              \
+            WORD  ModificationNumber;                      \
+            WCHAR wch[n];                                  \
+        } LIGATURE##n, *KBD_LONG_POINTER PLIGATURE##n;
+
+TYPEDEF_LIGATURE(1)
+TYPEDEF_LIGATURE(2)
+TYPEDEF_LIGATURE(3)
+TYPEDEF_LIGATURE(4)
+TYPEDEF_LIGATURE(5)
+
+// Key names.
+typedef struct {
+    BYTE             vsc;
+    WCHAR *KBD_LONG_POINTER pwsz;
+} VSC_LPWSTR, *KBD_LONG_POINTER PVSC_LPWSTR;
+
+typedef WCHAR *KBD_LONG_POINTER DEADKEY_LPWSTR;
+
+// Scan code to virtual key for prefixed scan codes.
+typedef struct _VSC_VK {
+    BYTE   Vsc;
+    USHORT Vk;
+} VSC_VK, *KBD_LONG_POINTER PVSC_VK;
+
+// Locale flags.
+#define KLLF_ALTGR     0x0001
+#define KLLF_SHIFTLOCK 0x0002
+#define KLLF_LRM_RLM   0x0004
+
+#define KBD_VERSION    1
+#define GET_KBD_VERSION(p) (HIWORD((p)->fLocaleFlags))
+
+// Main keyboard layout structure.
+typedef struct tagKbdLayer {
+    PMODIFIERS         pCharModifiers;
+    PVK_TO_WCHAR_TABLE pVkToWcharTable;
+    PDEADKEY           pDeadKey;
+    PVSC_LPWSTR        pKeyNames;
+    PVSC_LPWSTR        pKeyNamesExt;
+    WCHAR *KBD_LONG_POINTER *KBD_LONG_POINTER pKeyNamesDead;
+    USHORT *KBD_LONG_POINTER pusVSCtoVK;
+    BYTE               bMaxVSCtoVK;
+    PVSC_VK            pVSCtoVK_E0;
+    PVSC_VK            pVSCtoVK_E1;
+    DWORD              fLocaleFlags;
+    BYTE               nLgMax;
+    BYTE               cbLgEntry;
+    PLIGATURE1         pLigature;
+    DWORD              dwType;
+    DWORD              dwSubType;
+} KBDTABLES, *KBD_LONG_POINTER PKBDTABLES;
+
+#endif // WKL_PORTABLE_KBD_H
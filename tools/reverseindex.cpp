@@ -0,0 +1,570 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Reverse index of a keyboard layout: from characters to keystrokes.
+//
+//----------------------------------------------------------------------------
+
+#include "reverseindex.h"
+#include <bit>
+
+namespace {
+
+    // One key, with modifiers and locks, which produces something.
+    struct Stroke
+    {
+        KeyEvent key;    // Key press event.
+        uint8_t  vk;     // Virtual key, after NumLock and modifiers.
+        uint8_t  mods;   // Modifier bits.
+        uint8_t  locks;  // Locks which are toggled on before the key and off after it, KLOCK_xxx.
+        size_t   cell;   // Cell in the character tables of the engine.
+        size_t   cost;   // Number of key events, including modifiers and locks.
+    };
+
+    // Cheapest way to reach a pending dead key.
+    struct Pending
+    {
+        size_t cost;     // Number of key events.
+        size_t depth;    // Number of keys.
+        WCHAR  from;     // Previous pending dead key, zero if none.
+        size_t stroke;   // Last key, index in the list of strokes.
+    };
+
+    // Cheapest way to produce a string.
+    struct Output
+    {
+        size_t cost;     // Number of key events.
+        WCHAR  from;     // Pending dead key before the last key, zero if none.
+        size_t stroke;   // Last key, index in the list of strokes.
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: build the index.
+//----------------------------------------------------------------------------
+
+ReverseIndex::ReverseIndex(const KbdEngine& engine) :
+    _count(0),
+    _shift(32),
+    _mask(0),
+    _keys(),
+    _entries(),
+    _ascii(),
+    _ligatures(),
+    _events()
+{
+    _ascii.fill(NO_ENTRY);
+
+    // Find the first key for each virtual key and for each combination of modifier bits.
+    // The scan codes without prefix come first.
+    std::array<KeyEvent, 256> vk_key{};
+    std::array<bool, 256> vk_found{};
+    std::map<uint8_t, KeyEvent> mod_keys;
+    std::map<uint8_t, KeyEvent> lock_keys;
+    for (size_t index = 0; index < 4 * 256; ++index) {
+        const KeyEvent ev{uint8_t(index & 0xFF), uint8_t((index >> 8) << 1)};
+        const uint8_t vk = uint8_t(engine.virtualKey(ev) & 0xFF);
+        KbdState state{};
+        if (engine.trackKey(ev, state)) {
+            const uint8_t bits = engine.modifiers(state);
+            if (bits != 0 && state.locks == 0) {
+                mod_keys.insert(std::make_pair(bits, ev));
+            }
+            else if (bits == 0 && state.locks != 0) {
+                lock_keys.insert(std::make_pair(state.locks, ev));
+            }
+        }
+        else if (vk != 0 && vk != VK__none_ && !vk_found[vk]) {
+            vk_found[vk] = true;
+            vk_key[vk] = ev;
+        }
+    }
+
+    // Smallest set of modifier keys for each combination of modifier bits.
+    std::vector<KeyEvent> mod_list;
+    for (const auto& it : mod_keys) {
+        mod_list.push_back(it.second);
+    }
+    std::array<std::vector<KeyEvent>, 256> mod_sets;
+    std::array<bool, 256> mod_valid{};
+    mod_valid[0] = true;
+    if (mod_list.size() <= KbdEngine::MAX_SLOTS) {
+        for (size_t subset = 1; subset < (size_t(1) << mod_list.size()); ++subset) {
+            KbdState state{};
+            std::vector<KeyEvent> keys;
+            for (size_t i = 0; i < mod_list.size(); ++i) {
+                if ((subset & (size_t(1) << i)) != 0) {
+                    engine.trackKey(mod_list[i], state);
+                    keys.push_back(mod_list[i]);
+                }
+            }
+            const uint8_t bits = engine.modifiers(state);
+            if (!mod_valid[bits] || keys.size() < mod_sets[bits].size()) {
+                mod_valid[bits] = true;
+                mod_sets[bits] = keys;
+            }
+        }
+    }
+
+    // Cheapest modifier bits for each column.
+    const size_t columns = engine.columns();
+    std::vector<int> col_mods(columns, -1);
+    for (size_t bits = 0; bits < 256; ++bits) {
+        const size_t col = engine.column(uint8_t(bits));
+        if (mod_valid[bits] && col < columns && (col_mods[col] < 0 || mod_sets[bits].size() < mod_sets[col_mods[col]].size())) {
+            col_mods[col] = int(bits);
+        }
+    }
+
+    // Key events which toggle each combination of locks on, then off. A lock key toggles its lock.
+    // With KLLF_SHIFTLOCK, Caps Lock only sets the lock and Shift clears it. A combination of
+    // locks is usable only when the events return to a state without pressed key and lock.
+    std::array<std::vector<KeyEvent>, 8> locks_on;
+    std::array<std::vector<KeyEvent>, 8> locks_off;
+    std::array<bool, 8> locks_valid{};
+    locks_valid[0] = true;
+    for (uint8_t locks = 1; locks < 8; ++locks) {
+        bool valid = true;
+        for (uint8_t bit = 1; valid && bit < 8; bit <<= 1) {
+            valid = (locks & bit) == 0 || lock_keys.contains(bit);
+        }
+        if (!valid) {
+            continue;
+        }
+        KbdState state{};
+        for (const auto& it : lock_keys) {
+            if ((locks & it.first) != 0) {
+                for (auto* events : {&locks_on[locks], &locks_off[locks]}) {
+                    events->push_back(it.second);
+                    events->push_back(KeyEvent{it.second.scancode, uint8_t(it.second.flags | KEV_BREAK)});
+                }
+            }
+        }
+        for (const auto& ev : locks_on[locks]) {
+            engine.trackKey(ev, state);
+        }
+        const bool on = state.locks == locks;
+        for (const auto& ev : locks_off[locks]) {
+            engine.trackKey(ev, state);
+        }
+        if (state.locks != 0 && mod_valid[KBDSHIFT] && mod_sets[KBDSHIFT].size() == 1) {
+            const KeyEvent shift(mod_sets[KBDSHIFT][0]);
+            locks_off[locks].push_back(shift);
+            locks_off[locks].push_back(KeyEvent{shift.scancode, uint8_t(shift.flags | KEV_BREAK)});
+            engine.trackKey(locks_off[locks][locks_off[locks].size() - 2], state);
+            engine.trackKey(locks_off[locks].back(), state);
+        }
+        locks_valid[locks] = on && state == KbdState{};
+    }
+
+    // List all keys which produce something, without lock, then with the locks which change them:
+    // Caps Lock or Kana on the characters of the key, NumLock on the virtual key of the numeric keypad.
+    std::vector<Stroke> strokes;
+    for (size_t base_vk = 0; base_vk < 256; ++base_vk) {
+        if (!vk_found[base_vk] || engine.isTracked(uint8_t(base_vk))) {
+            continue;
+        }
+        const KeyEvent key(vk_key[base_vk]);
+        const KbdEngine::SpecialKey* special = engine.specialKey(key);
+        for (size_t col = 0; col < columns; ++col) {
+            if (col_mods[col] < 0) {
+                continue;
+            }
+            const uint8_t mods = uint8_t(col_mods[col]);
+            for (uint8_t locks = 0; locks < 8; ++locks) {
+                // Virtual key after NumLock and modifiers, as in KbdEngine. Alt alone on a digit of
+                // the numeric keypad starts an Alt+numpad entry.
+                uint8_t vk = uint8_t(base_vk);
+                bool numlock = false;
+                if (special != nullptr) {
+                    if (special->digit != 0 && mods == KBDALT) {
+                        break;
+                    }
+                    if (special->numlock_vk != 0 && (locks & KLOCK_NUMLOCK) != 0 && (mods & KBDSHIFT) == 0) {
+                        vk = special->numlock_vk;
+                        numlock = true;
+                    }
+                    else if ((mods & special->multi_bits) != 0) {
+                        vk = special->multi_vk;
+                    }
+                }
+
+                // Only use the locks which change something on this key.
+                const uint8_t used = uint8_t(engine.keyLocks(vk) | (numlock ? KLOCK_NUMLOCK : 0));
+                if (!locks_valid[locks] || (locks & ~used) != 0) {
+                    continue;
+                }
+
+                // The modifiers must not change the locks (Shift with KLLF_SHIFTLOCK).
+                KbdState state{};
+                for (const auto& ev : locks_on[locks]) {
+                    engine.trackKey(ev, state);
+                }
+                for (const auto& ev : mod_sets[mods]) {
+                    engine.trackKey(ev, state);
+                }
+                if (state.locks != locks) {
+                    continue;
+                }
+
+                const uint8_t bits = uint8_t(mods | ((locks & KLOCK_KANA) != 0 ? KBDKANA : 0));
+                const size_t cell = engine.cell(bits, (locks & KLOCK_CAPITAL) != 0);
+                if (engine.character(vk, cell) != WCH_NONE) {
+                    const size_t cost = 2 + 2 * mod_sets[mods].size() + locks_on[locks].size() + locks_off[locks].size();
+                    strokes.push_back(Stroke{key, vk, mods, locks, cell, cost});
+                }
+            }
+        }
+    }
+
+    // Apply a key on a pending dead key. Return the new pending dead key or zero.
+    // Otherwise, the produced characters are stored in 'str' (nothing on failed compositions).
+    const auto apply = [&](WCHAR pending, const Stroke& stroke, std::vector<WCHAR>& str) -> WCHAR {
+        str.clear();
+        const WCHAR wc = engine.character(stroke.vk, stroke.cell);
+        if (wc == WCH_LGTR) {
+            if (pending == 0) {
+                WCHAR lg[KbdEngine::MAX_OUTPUT];
+                str.assign(lg, lg + engine.ligature(stroke.vk, stroke.cell, lg));
+            }
+            return 0;
+        }
+        const WCHAR base = wc == WCH_DEAD ? engine.deadCharacter(stroke.vk, stroke.cell) : wc;
+        if (pending == 0) {
+            if (wc != WCH_DEAD) {
+                str.push_back(wc);
+            }
+            return wc == WCH_DEAD ? base : 0;
+        }
+        bool chained = false;
+        const WCHAR composed = engine.deadKeys().compose(base, pending, chained);
+        if (composed != 0 && !chained) {
+            str.push_back(composed);
+        }
+        return chained ? composed : 0;
+    };
+
+    // Cheapest way to reach each pending dead key, with at most MAX_KEYS-1 keys.
+    std::map<WCHAR, Pending> pending;
+    pending[0] = Pending{0, 0, 0, 0};
+    std::vector<WCHAR> str;
+    for (bool changed = true; changed; ) {
+        changed = false;
+        const std::map<WCHAR, Pending> current(pending);
+        for (const auto& it : current) {
+            if (it.second.depth + 2 > MAX_KEYS) {
+                continue;
+            }
+            for (size_t i = 0; i < strokes.size(); ++i) {
+                const WCHAR next = apply(it.first, strokes[i], str);
+                const size_t cost = it.second.cost + strokes[i].cost;
+                if (next != 0 && next != it.first && (!pending.contains(next) || cost < pending[next].cost)) {
+                    pending[next] = Pending{cost, it.second.depth + 1, it.first, i};
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Cheapest way to produce each string.
+    std::map<std::vector<WCHAR>, Output> outputs;
+    for (const auto& it : pending) {
+        for (size_t i = 0; i < strokes.size(); ++i) {
+            apply(it.first, strokes[i], str);
+            const size_t cost = it.second.cost + strokes[i].cost;
+            if (!str.empty()) {
+                const auto out = outputs.find(str);
+                if (out == outputs.end()) {
+                    outputs.insert(std::make_pair(str, Output{cost, it.first, i}));
+                }
+                else if (cost < out->second.cost) {
+                    out->second = Output{cost, it.first, i};
+                }
+            }
+        }
+    }
+
+    // Generate the key events for one output.
+    const auto generate = [&](const Output& out) {
+        std::vector<size_t> keys{out.stroke};
+        for (WCHAR p = out.from; p != 0; p = pending[p].from) {
+            keys.push_back(pending[p].stroke);
+        }
+        const uint32_t offset = uint32_t(_events.size());
+        for (size_t k = keys.size(); k-- > 0; ) {
+            const Stroke& stroke(strokes[keys[k]]);
+            const std::vector<KeyEvent>& mods(mod_sets[stroke.mods]);
+            for (const auto& ev : locks_on[stroke.locks]) {
+                _events.push_back(ev);
+            }
+            for (const auto& ev : mods) {
+                _events.push_back(ev);
+            }
+            _events.push_back(stroke.key);
+            _events.push_back(KeyEvent{stroke.key.scancode, uint8_t(stroke.key.flags | KEV_BREAK)});
+            for (size_t m = mods.size(); m-- > 0; ) {
+                _events.push_back(KeyEvent{mods[m].scancode, uint8_t(mods[m].flags | KEV_BREAK)});
+            }
+            for (const auto& ev : locks_off[stroke.locks]) {
+                _events.push_back(ev);
+            }
+        }
+        return offset;
+    };
+
+    // Build the list of characters and ligatures.
+    std::map<char32_t, std::pair<uint32_t, uint32_t>> chars;  // code point -> events offset, count
+    std::u32string code_points;
+    for (const auto& it : outputs) {
+        if (!DecodeUTF16(it.first, code_points)) {
+            continue;
+        }
+        const uint32_t offset = generate(it.second);
+        const uint32_t count = uint32_t(_events.size() - offset);
+        if (code_points.size() == 1) {
+            chars[code_points[0]] = std::make_pair(offset, count);
+            _count++;
+        }
+        else {
+            _ligatures.push_back(Ligature{EncodeUTF8(code_points), offset, count});
+            chars.insert(std::make_pair(code_points[0], std::make_pair(uint32_t(0), uint32_t(0))));
+        }
+    }
+
+    // Ligatures by first code point, longest first.
+    std::stable_sort(_ligatures.begin(), _ligatures.end(), [](const Ligature& l1, const Ligature& l2) {
+        const uint8_t* p1 = reinterpret_cast<const uint8_t*>(l1.text.data());
+        const uint8_t* p2 = reinterpret_cast<const uint8_t*>(l2.text.data());
+        const char32_t c1 = DecodeUTF8(p1, p1 + l1.text.size());
+        const char32_t c2 = DecodeUTF8(p2, p2 + l2.text.size());
+        return c1 != c2 ? c1 < c2 : l1.text.size() > l2.text.size();
+    });
+
+    // Build the hash table, at most half full.
+    size_t bits = 4;
+    while ((size_t(1) << bits) < 2 * chars.size()) {
+        ++bits;
+    }
+    _shift = uint8_t(32 - bits);
+    _mask = uint32_t((size_t(1) << bits) - 1);
+    _keys.resize(size_t(1) << bits, NO_KEY);
+    _entries.resize(size_t(1) << bits, Entry{0, 0, 0, 0});
+    for (const auto& it : chars) {
+        uint32_t index = hash(it.first);
+        while (_keys[index] != NO_KEY) {
+            index = (index + 1) & _mask;
+        }
+        _keys[index] = it.first;
+        _entries[index] = Entry{it.second.first, uint16_t(it.second.second), 0, 0};
+    }
+    for (size_t i = 0; i < _ligatures.size(); ++i) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(_ligatures[i].text.data());
+        Entry& entry(_entries[lookup(DecodeUTF8(p, p + _ligatures[i].text.size()))]);
+        if (entry.ligature_count++ == 0) {
+            entry.first_ligature = uint32_t(i);
+        }
+    }
+
+    // Direct access to ASCII characters.
+    for (char32_t c = 0; c < 128; ++c) {
+        const uint32_t index = lookup(c);
+        if (index != NO_ENTRY && _entries[index].count > 0 && _entries[index].ligature_count == 0) {
+            _ascii[c] = index;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Memory size of the index in bytes.
+//----------------------------------------------------------------------------
+
+size_t ReverseIndex::memorySize() const
+{
+    size_t size = _keys.size() * sizeof(char32_t) + _entries.size() * sizeof(Entry) + sizeof(_ascii) + _events.size() * sizeof(KeyEvent);
+    for (const auto& lg : _ligatures) {
+        size += sizeof(Ligature) + lg.text.size();
+    }
+    return size;
+}
+
+
+//----------------------------------------------------------------------------
+// Find a code point.
+//----------------------------------------------------------------------------
+
+uint32_t ReverseIndex::lookup(char32_t code) const
+{
+    if (!_keys.empty()) {
+        for (uint32_t index = hash(code); _keys[index] != NO_KEY; index = (index + 1) & _mask) {
+            if (_keys[index] == code) {
+                return index;
+            }
+        }
+    }
+    return NO_ENTRY;
+}
+
+const KeyEvent* ReverseIndex::find(char32_t code, size_t& count) const
+{
+    const uint32_t index = lookup(code);
+    count = index == NO_ENTRY ? 0 : _entries[index].count;
+    return count == 0 ? nullptr : _events.data() + _entries[index].offset;
+}
+
+
+//----------------------------------------------------------------------------
+// Convert a UTF-8 text into keystrokes.
+//----------------------------------------------------------------------------
+
+bool ReverseIndex::convert(std::string_view text, std::vector<KeyEvent>& events, std::vector<Unreachable>& unreachable) const
+{
+    const size_t initial_unreachable = unreachable.size();
+    const uint8_t* const begin = reinterpret_cast<const uint8_t*>(text.data());
+    const uint8_t* const end = begin + text.size();
+    const uint8_t* p = begin;
+
+    // The output is written directly in the vector, which is grown by large blocks.
+    // The actual size is adjusted at the end.
+    size_t size = events.size();
+    const auto append = [&](uint32_t offset, size_t count) {
+        if (events.size() - size < count) {
+            events.resize(std::max(2 * events.size(), size + std::max<size_t>(count, 2 * size_t(end - p) + 64)));
+        }
+        std::memcpy(events.data() + size, _events.data() + offset, count * sizeof(KeyEvent));
+        size += count;
+    };
+
+    while (p < end) {
+        // Fast path for ASCII characters.
+        if (*p < 0x80 && _ascii[*p] != NO_ENTRY) {
+            const Entry& entry(_entries[_ascii[*p++]]);
+            append(entry.offset, entry.count);
+            continue;
+        }
+
+        const uint8_t* const start = p;
+        const char32_t code = DecodeUTF8(p, end);
+        const uint32_t index = code == NO_KEY ? NO_ENTRY : lookup(code);
+        if (index == NO_ENTRY) {
+            unreachable.push_back(Unreachable{size_t(start - begin), code == NO_KEY ? 0xFFFD : code});
+            continue;
+        }
+
+        // Longest ligature first, then the character alone.
+        const Entry& entry(_entries[index]);
+        bool done = false;
+        for (size_t i = 0; !done && i < entry.ligature_count; ++i) {
+            const Ligature& lg(_ligatures[entry.first_ligature + i]);
+            if (size_t(end - start) >= lg.text.size() && std::memcmp(start, lg.text.data(), lg.text.size()) == 0) {
+                append(lg.offset, lg.count);
+                p = start + lg.text.size();
+                done = true;
+            }
+        }
+        if (!done && entry.count > 0) {
+            append(entry.offset, entry.count);
+        }
+        else if (!done) {
+            unreachable.push_back(Unreachable{size_t(start - begin), code});
+        }
+    }
+    events.resize(size);
+    return unreachable.size() == initial_unreachable;
+}
+
+
+//----------------------------------------------------------------------------
+// Unicode encoding and decoding.
+//----------------------------------------------------------------------------
+
+char32_t ReverseIndex::DecodeUTF8(const uint8_t*& p, const uint8_t* end)
+{
+    const uint8_t c = *p++;
+    size_t length = 0;
+    char32_t code = 0;
+    char32_t min = 0;
+    if (c < 0x80) {
+        return c;
+    }
+    else if ((c & 0xE0) == 0xC0) {
+        length = 1;
+        code = c & 0x1F;
+        min = 0x80;
+    }
+    else if ((c & 0xF0) == 0xE0) {
+        length = 2;
+        code = c & 0x0F;
+        min = 0x800;
+    }
+    else if ((c & 0xF8) == 0xF0) {
+        length = 3;
+        code = c & 0x07;
+        min = 0x10000;
+    }
+    else {
+        return NO_KEY;
+    }
+    if (size_t(end - p) < length) {
+        return NO_KEY;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return NO_KEY;
+        }
+        code = (code << 6) | (p[i] & 0x3F);
+    }
+    if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+        return NO_KEY;
+    }
+    p += length;
+    return code;
+}
+
+bool ReverseIndex::DecodeUTF16(const std::vector<WCHAR>& str, std::u32string& code_points)
+{
+    code_points.clear();
+    for (size_t i = 0; i < str.size(); ++i) {
+        const char32_t c = str[i];
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < str.size() && str[i + 1] >= 0xDC00 && str[i + 1] < 0xE000) {
+            code_points.push_back(0x10000 + ((c - 0xD800) << 10) + (str[++i] - 0xDC00));
+        }
+        else if (c >= 0xD800 && c < 0xE000) {
+            return false;
+        }
+        else {
+            code_points.push_back(c);
+        }
+    }
+    return true;
+}
+
+std::string ReverseIndex::EncodeUTF8(const std::u32string& code_points)
+{
+    std::string str;
+    for (char32_t c : code_points) {
+        if (c < 0x80) {
+            str.push_back(char(c));
+        }
+        else if (c < 0x800) {
+            str.push_back(char(0xC0 | (c >> 6)));
+            str.push_back(char(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000) {
+            str.push_back(char(0xE0 | (c >> 12)));
+            str.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+            str.push_back(char(0x80 | (c & 0x3F)));
+        }
+        else {
+            str.push_back(char(0xF0 | (c >> 18)));
+            str.push_back(char(0x80 | ((c >> 12) & 0x3F)));
+            str.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+            str.push_back(char(0x80 | (c & 0x3F)));
+        }
+    }
+    return str;
+}
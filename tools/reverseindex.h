@@ -0,0 +1,107 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Reverse index of a keyboard layout: from characters to keystrokes.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdengine.h"
+#include <string_view>
+
+// For each character which can be typed on a keyboard layout, the index gives
+// the cheapest sequence of keystrokes, the one with the fewest key events.
+// This can be a single key with modifiers, one or more dead keys followed by
+// a key (DEADKEY compositions) or a ligature key (LIGATURE entries).
+//
+// All sequences start and end with no pressed key, no lock, no pending dead
+// key. A lock (Caps Lock, NumLock, Kana) which changes the character of a key
+// is toggled on before the key and off after it, as in Caps, key, Caps.
+// Translating the keystrokes with KbdEngine gives the characters back.
+//
+// The characters are stored in an open addressing hash table, keyed by code
+// point. Ligatures of several code points are found by longest match on the
+// text, from their first code point.
+class ReverseIndex
+{
+public:
+    // Constructor. Build the index of the layout of the engine.
+    ReverseIndex(const KbdEngine&);
+
+    // Maximum number of keys (with their modifiers) to type one character.
+    static constexpr size_t MAX_KEYS = 4;
+
+    // A character which cannot be typed on the layout.
+    struct Unreachable
+    {
+        size_t   offset;  // Byte offset in the UTF-8 text.
+        char32_t code;    // Code point, U+FFFD for invalid UTF-8 sequences.
+    };
+
+    // Get the keystrokes for a code point. Return null if the character cannot be typed.
+    // The number of key events is returned in 'count'.
+    const KeyEvent* find(char32_t code, size_t& count) const;
+
+    // Convert a UTF-8 text into keystrokes. The key events are appended to 'events'.
+    // The characters which cannot be typed are skipped and appended to 'unreachable'.
+    // Return true if all characters were converted.
+    bool convert(std::string_view text, std::vector<KeyEvent>& events, std::vector<Unreachable>& unreachable) const;
+
+    // Number of characters which can be typed, number of ligatures of several code points.
+    size_t size() const { return _count; }
+    size_t ligatureCount() const { return _ligatures.size(); }
+
+    // Memory size of the index in bytes.
+    size_t memorySize() const;
+
+    // Value which is not a valid code point, returned by DecodeUTF8() on invalid sequences.
+    static constexpr char32_t NO_KEY = 0xFFFFFFFF;
+
+    // Decode one UTF-8 sequence. Return NO_KEY on invalid sequence, skipping one byte.
+    static char32_t DecodeUTF8(const uint8_t*& p, const uint8_t* end);
+
+private:
+    // One character in the hash table.
+    struct Entry
+    {
+        uint32_t offset;           // Index of the key events in _events.
+        uint16_t count;            // Number of key events, zero if the character cannot be typed alone.
+        uint16_t ligature_count;   // Number of ligatures starting with this character.
+        uint32_t first_ligature;   // Index of the first one in _ligatures, longest first.
+    };
+
+    // A ligature of several code points.
+    struct Ligature
+    {
+        std::string text;    // UTF-8 text of the ligature.
+        uint32_t    offset;  // Index of the key events in _events.
+        uint32_t    count;   // Number of key events.
+    };
+
+    // Value of empty slots in _keys is NO_KEY.
+    static constexpr uint32_t NO_ENTRY = 0xFFFFFFFF;
+
+    size_t                    _count;
+    uint8_t                   _shift;      // Hash shift, 32 - log2(table size).
+    uint32_t                  _mask;       // Table size - 1.
+    std::vector<char32_t>     _keys;       // Code points of the hash table, NO_KEY when unused.
+    std::vector<Entry>        _entries;    // Same index as _keys.
+    std::array<uint32_t, 128> _ascii;      // Index in _entries of ASCII characters without ligature, NO_ENTRY otherwise.
+    std::vector<Ligature>     _ligatures;
+    std::vector<KeyEvent>     _events;     // All key events.
+
+    // Multiplicative hash of a code point.
+    uint32_t hash(char32_t code) const { return uint32_t(code * 0x9E3779B1u) >> _shift; }
+
+    // Index of a code point in the hash table, NO_ENTRY if not found.
+    uint32_t lookup(char32_t code) const;
+
+    // Decode a UTF-16 string into code points. Return false on unpaired surrogate.
+    static bool DecodeUTF16(const std::vector<WCHAR>& str, std::u32string& code_points);
+
+    // Encode code points in UTF-8.
+    static std::string EncodeUTF8(const std::u32string& code_points);
+};
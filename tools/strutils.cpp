@@ -9,8 +9,10 @@
 //----------------------------------------------------------------------------
 
 #include "strutils.h"
+#include "utf8writer.h"
 #include <cstdarg>
 #include <algorithm>
+#include <sstream>
 
 
 //---------------------------------------------------------------------------
@@ -20,26 +22,90 @@
 WString Format(const wchar_t* fmt, ...)
 {
     va_list ap;
-
-    // Get required output size.
+    WString buf;
     va_start(ap, fmt);
-    int len = _vsnwprintf(nullptr, 0, fmt, ap);
+    FormatArgs(buf, fmt, ap);
     va_end(ap);
+    return buf;
+}
+
+#if defined(_WIN32)
+
+void FormatArgs(WString& buf, const wchar_t* fmt, va_list ap)
+{
+    // Get required output size.
+    va_list ap2;
+    va_copy(ap2, ap);
+    int len = _vsnwprintf(nullptr, 0, fmt, ap2);
+    va_end(ap2);
 
     if (len < 0) {
-        return WString(); // error
+        buf.clear(); // error
+        return;
     }
 
     // Actual formatting.
-    WString buf(len + 1, '\0');
-    va_start(ap, fmt);
+    buf.resize(size_t(len) + 1);
     len = _vsnwprintf(&buf[0], buf.size(), fmt, ap);
-    va_end(ap);
-
     buf.resize(std::min<size_t>(buf.size(), std::max(0, len)));
-    return buf;
 }
 
+#else
+
+// Translate the Microsoft format into the ISO one, where "%s" and "%c" are narrow, "%ls" and "%lc" are wide.
+static WString ISOFormat(const wchar_t* fmt)
+{
+    WString iso;
+    while (*fmt != 0) {
+        iso.push_back(*fmt);
+        if (*fmt++ != L'%') {
+            continue;
+        }
+        // Flags, width, precision.
+        while (*fmt != 0 && std::wcschr(L"-+ #0123456789.*", *fmt) != nullptr) {
+            iso.push_back(*fmt++);
+        }
+        // Size prefix of characters and strings.
+        if (*fmt == L'h' && (fmt[1] == L's' || fmt[1] == L'c')) {
+            iso.push_back(*++fmt);
+            fmt++;
+        }
+        else if (*fmt == L's' || *fmt == L'c') {
+            iso.push_back(L'l');
+            iso.push_back(*fmt++);
+        }
+        else if (*fmt == L'S' || *fmt == L'C') {
+            iso.push_back(wchar_t(std::tolower(*fmt++)));
+        }
+    }
+    return iso;
+}
+
+void FormatArgs(WString& buf, const wchar_t* fmt, va_list ap)
+{
+    const WString iso(ISOFormat(fmt));
+
+    // vswprintf() cannot compute the required size, grow the buffer until the result fits. Stop at 1M characters.
+    buf.resize(std::max<size_t>(buf.capacity(), 256));
+    for (;;) {
+        va_list ap2;
+        va_copy(ap2, ap);
+        const int len = std::vswprintf(&buf[0], buf.size(), iso.c_str(), ap2);
+        va_end(ap2);
+        if (len >= 0 && size_t(len) < buf.size()) {
+            buf.resize(size_t(len));
+            return;
+        }
+        if (buf.size() >= 1000000) {
+            buf.clear(); // error
+            return;
+        }
+        buf.resize(2 * buf.size());
+    }
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Length of a string. Size in bytes of it (including trailing null).
@@ -61,6 +127,26 @@ size_t WStringSize(const wchar_t* s)
     return s == nullptr ? 0 : (WStringLength(s) + 1) * sizeof(wchar_t);
 }
 
+#if !defined(_WIN32)
+
+size_t WStringLength(const WCHAR* s)
+{
+    size_t len = 0;
+    if (s != nullptr) {
+        while (*s++ != 0) {
+            len++;
+        }
+    }
+    return len;
+}
+
+size_t WStringSize(const WCHAR* s)
+{
+    return s == nullptr ? 0 : (WStringLength(s) + 1) * sizeof(WCHAR);
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Case conversions.
@@ -163,6 +249,10 @@ WString WStringLiteral(const wchar_t* value)
             }
             else {
                 str.append(Format(L"\\x%04x", *value));
+                // A hexadecimal escape sequence has no length limit, split the literal before a hexadecimal digit.
+                if (value[1] != 0 && std::wcschr(L"0123456789ABCDEFabcdef", value[1]) != nullptr) {
+                    str.append(L"\" L\"");
+                }
             }
         }
         str.push_back(L'"');
@@ -170,11 +260,22 @@ WString WStringLiteral(const wchar_t* value)
     }
 }
 
+#if !defined(_WIN32)
+
+WString WStringLiteral(const WCHAR* value)
+{
+    return value == nullptr ? WString(L"NULL") : WStringLiteral(WString(value, value + WStringLength(value)));
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // UTF-8 / UTF-16 conversions.
 //---------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 WString ToUTF16(const std::string& str)
 {
     if (str.empty()) {
@@ -203,6 +304,44 @@ std::string ToUTF8(const WString& str)
     }
 }
 
+#else
+
+WString ToUTF16(const std::string& str)
+{
+    // Invalid sequences are replaced by U+FFFD, as MultiByteToWideChar() does.
+    WString out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ) {
+        const uint8_t b = uint8_t(str[i++]);
+        const size_t more = b < 0x80 ? 0 : b >= 0xF0 && b < 0xF8 ? 3 : b >= 0xE0 ? 2 : b >= 0xC0 ? 1 : 4;
+        uint32_t c = more == 0 ? b : more == 4 ? 0xFFFD : b & (0x3F >> more);
+        for (size_t n = 0; more < 4 && n < more; ++n) {
+            if (i >= str.size() || (uint8_t(str[i]) & 0xC0) != 0x80) {
+                c = 0xFFFD;
+                break;
+            }
+            c = (c << 6) | (uint8_t(str[i++]) & 0x3F);
+        }
+        if (c >= 0x10000 && c < 0x110000) {
+            out.push_back(wchar_t(0xD800 + ((c - 0x10000) >> 10)));
+            out.push_back(wchar_t(0xDC00 + (c & 0x3FF)));
+        }
+        else {
+            out.push_back(wchar_t(c < 0x110000 ? c : 0xFFFD));
+        }
+    }
+    return out;
+}
+
+std::string ToUTF8(const WString& str)
+{
+    std::ostringstream out;
+    UTF8Writer(out).write(str);
+    return out.str();
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Check if a memory area is not empty and full of zeroes.
@@ -242,24 +381,6 @@ char Hexa(int nibble)
 
 void PrintHexa(std::ostream& out, const void* addr, size_t size, const WString& margin, bool show_addr)
 {
-    const uint8_t* cur = reinterpret_cast<const uint8_t*>(addr);
-    const uint8_t* end = cur + size;
-    constexpr size_t bytes_per_line = 16;
-
-    while (cur < end) {
-        const size_t count = std::min<size_t>(bytes_per_line, end - cur);
-        out << margin;
-        if (show_addr) {
-            out << Format(L"0x%08llX: ", size_t(cur));
-        }
-        for (size_t i = 0; i < count; ++i) {
-            out << Hexa(cur[i] >> 4) << Hexa(cur[i]) << ' ';
-        }
-        out << std::string(2 + 3 * (bytes_per_line - count), ' ');
-        for (size_t i = 0; i < count; ++i) {
-            out << char(cur[i] >= ' ' && cur[i] < 0x7F ? cur[i] : '.');
-        }
-        out << std::endl;
-        cur += count;
-    }
+    UTF8Writer writer(out);
+    PrintHexa(writer, addr, size, margin, show_addr);
 }
@@ -10,6 +10,7 @@
 
 #pragma once
 #include "platform.h"
+#include <cstdarg>
 
 // We use wide strings only.
 typedef std::wstring WString;
@@ -18,6 +19,9 @@ typedef std::wstring WString;
 // Use "%s" for wchar_t* arguments and "%S" for char* arguments.
 WString Format(const wchar_t* fmt, ...);
 
+// Same as Format() with a list of arguments, into a reusable buffer.
+void FormatArgs(WString& buf, const wchar_t* fmt, va_list ap);
+
 // Length of a string. Size in bytes of it (including trailing null).
 size_t WStringLength(const wchar_t*);
 size_t WStringSize(const wchar_t*);
@@ -41,8 +45,15 @@ bool EndsWith(const WString&, const WString& suffix);
 WString WStringLiteral(const wchar_t*);
 inline WString WStringLiteral(const WString& s) { return WStringLiteral(s.c_str()); }
 
+#if !defined(_WIN32)
+// On other systems, the strings of the keyboard tables are 16-bit WCHAR, not wchar_t.
+size_t WStringLength(const WCHAR*);
+size_t WStringSize(const WCHAR*);
+WString WStringLiteral(const WCHAR*);
+#endif
+
 // Decode a string as an integer. Return 0 on error.
-inline int ToInt(const WString& str) { return _wtoi(str.c_str()); }
+inline int ToInt(const WString& str) { return int(std::wcstol(str.c_str(), nullptr, 10)); }
 
 // Decode an hexa value with error checking.
 template <typename INT_T, typename std::enable_if<std::is_integral<INT_T>::value, int>::type = 0>
@@ -64,7 +75,8 @@ bool IsZero(const void* base, const void* end);
 // The UTF-8 Byte Order Mark
 #define UTF8_BOM "\xEF\xBB\xBF"
 
-// UTF-8 / UTF-16 conversions.
+// UTF-8 / UTF-16 conversions. A WString always contains UTF-16 code units, even
+// on systems where wchar_t is 32-bit wide.
 WString ToUTF16(const std::string&);
 std::string ToUTF8(const WString&);
 
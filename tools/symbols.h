@@ -0,0 +1,74 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compile-time tables of symbols, values => names.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <algorithm>
+
+// One symbol: a value and its name.
+struct Symbol
+{
+    int64_t        value;
+    const wchar_t* name;
+};
+
+// A table of symbols, sorted by value. When several symbols have the
+// same value, the first one in the original declaration order comes first.
+typedef std::span<const Symbol> SymbolTable;
+
+// Build a sorted array of symbols at compile time.
+// Usage: constexpr auto table = SortSymbols({{value1, L"name1"}, {value2, L"name2"}, ...});
+template <size_t N>
+constexpr std::array<Symbol, N> SortSymbols(const Symbol (&symbols)[N])
+{
+    // Sort on value, then on original index. The index makes the sort stable.
+    std::array<std::pair<Symbol, size_t>, N> tmp {};
+    for (size_t i = 0; i < N; ++i) {
+        tmp[i] = std::make_pair(symbols[i], i);
+    }
+    std::sort(tmp.begin(), tmp.end(), [](const auto& a, const auto& b) {
+        return a.first.value < b.first.value || (a.first.value == b.first.value && a.second < b.second);
+    });
+    std::array<Symbol, N> result {};
+    for (size_t i = 0; i < N; ++i) {
+        result[i] = tmp[i].first;
+    }
+    return result;
+}
+
+// Check at compile time that a table of symbols is sorted.
+constexpr bool IsSorted(SymbolTable symbols)
+{
+    for (size_t i = 1; i < symbols.size(); ++i) {
+        if (symbols[i].value < symbols[i-1].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find the name of a value in a table of symbols. Return null if not found.
+// Branch-free binary search, the loop only depends on the size of the table.
+inline const wchar_t* FindSymbol(SymbolTable symbols, int64_t value)
+{
+    if (symbols.empty()) {
+        return nullptr;
+    }
+    const Symbol* base = symbols.data();
+    for (size_t size = symbols.size(); size > 1; ) {
+        const size_t half = size / 2;
+        base = base[half - 1].value < value ? base + half : base;
+        size -= half;
+    }
+    return base->value == value ? base->name : nullptr;
+}
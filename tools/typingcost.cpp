@@ -0,0 +1,188 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Typing cost of a text corpus on keyboard layouts.
+//
+//----------------------------------------------------------------------------
+
+#include "typingcost.h"
+
+
+//----------------------------------------------------------------------------
+// Count the code points of a text.
+//----------------------------------------------------------------------------
+
+CharCounts::CharCounts() :
+    _bmp(0x10000, 0),
+    _others(),
+    _total(0),
+    _invalid(0)
+{
+}
+
+void CharCounts::add(const uint8_t* data, size_t size)
+{
+    const uint8_t* p = data;
+    const uint8_t* const end = data + size;
+    uint64_t* const bmp = _bmp.data();
+    uint64_t total = 0;
+
+    while (p < end) {
+        // Fast path for ASCII characters, the most frequent ones in most texts.
+        if (*p < 0x80) {
+            bmp[*p++]++;
+            total++;
+            continue;
+        }
+        const char32_t code = ReverseIndex::DecodeUTF8(p, end);
+        if (code == ReverseIndex::NO_KEY) {
+            _invalid++;
+        }
+        else if (code < 0x10000) {
+            bmp[code]++;
+            total++;
+        }
+        else {
+            _others[code]++;
+            total++;
+        }
+    }
+    _total += total;
+}
+
+CharCounts& CharCounts::operator+=(const CharCounts& other)
+{
+    for (size_t i = 0; i < _bmp.size(); ++i) {
+        _bmp[i] += other._bmp[i];
+    }
+    for (const auto& it : other._others) {
+        _others[it.first] += it.second;
+    }
+    _total += other._total;
+    _invalid += other._invalid;
+    return *this;
+}
+
+uint64_t CharCounts::count(char32_t code) const
+{
+    if (code < 0x10000) {
+        return _bmp[code];
+    }
+    const auto it = _others.find(code);
+    return it == _others.end() ? 0 : it->second;
+}
+
+void CharCounts::getCodePoints(std::vector<char32_t>& codes) const
+{
+    codes.clear();
+    for (size_t i = 0; i < _bmp.size(); ++i) {
+        if (_bmp[i] != 0) {
+            codes.push_back(char32_t(i));
+        }
+    }
+    for (const auto& it : _others) {
+        codes.push_back(it.first);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Typing cost on a keyboard layout.
+//----------------------------------------------------------------------------
+
+TypingCost::TypingCost(const KbdEngine& engine, const ReverseIndex& index) :
+    _engine(engine),
+    _index(index)
+{
+}
+
+bool TypingCost::cost(char32_t code, Cost& result) const
+{
+    result = Cost();
+    size_t count = 0;
+    const KeyEvent* events = _index.find(code, count);
+    if (events == nullptr) {
+        return false;
+    }
+
+    // Replay the keystrokes to identify the dead keys. The modifiers are identified by the bits of their key slot.
+    KbdState state{};
+    WCHAR out[KbdEngine::MAX_OUTPUT];
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t vk = uint8_t(_engine.virtualKey(events[i]) & 0xFF);
+        _engine.translate(events[i], state, out);
+        if ((events[i].flags & KEV_BREAK) != 0) {
+            continue;
+        }
+        result.keystrokes++;
+        const size_t slot = _engine.keySlot(vk);
+        if (slot > 0) {
+            const uint8_t bits = _engine.slotBits(slot - 1);
+            if ((bits & (KBDCTRL | KBDALT)) == (KBDCTRL | KBDALT)) {
+                result.altgr++;
+            }
+            else if ((bits & KBDCTRL) != 0) {
+                result.ctrl++;
+            }
+            else if ((bits & KBDALT) != 0) {
+                result.alt++;
+            }
+            if ((bits & KBDSHIFT) != 0) {
+                result.shift++;
+            }
+        }
+        else if (state.dead != 0) {
+            result.dead_keys++;
+        }
+    }
+    return true;
+}
+
+void TypingCost::evaluate(const CharCounts& counts, Counters& counters) const
+{
+    std::vector<char32_t> codes;
+    counts.getCodePoints(codes);
+    for (char32_t code : codes) {
+        if (code == U'\r' || code == 0xFEFF) {
+            continue;
+        }
+        const uint64_t n = counts.count(code);
+        Cost c;
+        if (cost(code == U'\n' ? U'\r' : code, c)) {
+            counters.characters += n;
+            counters.keystrokes += n * c.keystrokes;
+            counters.shift += n * c.shift;
+            counters.altgr += n * c.altgr;
+            counters.ctrl += n * c.ctrl;
+            counters.alt += n * c.alt;
+            counters.dead_keys += n * c.dead_keys;
+        }
+        else {
+            counters.unreachable += n;
+            counters.missing[code] += n;
+        }
+    }
+}
+
+bool TypingCost::check(const CharCounts& counts, const CharCoverage& coverage, std::vector<char32_t>& mismatches) const
+{
+    mismatches.clear();
+    const CharSet typable(coverage.direct() | coverage.deadKeys());
+    std::vector<char32_t> codes;
+    counts.getCodePoints(codes);
+    for (char32_t code : codes) {
+        // Same characters as evaluate(). The coverage is limited to the BMP.
+        if (code == U'\r' || code == 0xFEFF || code >= CharSet::BITS) {
+            continue;
+        }
+        const char32_t typed = code == U'\n' ? U'\r' : code;
+        size_t count = 0;
+        if ((_index.find(typed, count) != nullptr) != typable.test(WCHAR(typed))) {
+            mismatches.push_back(code);
+        }
+    }
+    return mismatches.empty();
+}
@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Typing cost of a text corpus on keyboard layouts.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "reverseindex.h"
+#include "charcoverage.h"
+
+// Number of occurrences of each code point in a UTF-8 text. The text can be
+// counted in several parts, possibly in several threads with one instance per
+// thread, the instances are then merged. Since the typing cost of a text is the
+// sum of the costs of its characters, the counts are sufficient to evaluate the
+// cost of the text on any number of layouts, without reading the text again.
+class CharCounts
+{
+public:
+    // Constructor: empty counts.
+    CharCounts();
+
+    // Count the code points of a UTF-8 text. The text shall not start or end in
+    // the middle of a UTF-8 sequence. Invalid sequences are counted apart.
+    void add(const uint8_t* data, size_t size);
+
+    // Merge the counts of another instance.
+    CharCounts& operator+=(const CharCounts&);
+
+    // Number of occurrences of a code point.
+    uint64_t count(char32_t code) const;
+
+    // Total number of code points, number of invalid UTF-8 sequences.
+    uint64_t total() const { return _total; }
+    uint64_t invalid() const { return _invalid; }
+
+    // Get all code points with a non-zero count, in increasing order.
+    void getCodePoints(std::vector<char32_t>&) const;
+
+    // Check if a position in a UTF-8 text is the start of a sequence (or of an invalid byte).
+    static bool IsSequenceStart(uint8_t b) { return (b & 0xC0) != 0x80; }
+
+private:
+    std::vector<uint64_t>        _bmp;      // Counts of BMP code points, by code point.
+    std::map<char32_t, uint64_t> _others;   // Counts of code points outside the BMP.
+    uint64_t                     _total;
+    uint64_t                     _invalid;
+};
+
+// Cost of typing characters on one keyboard layout, using the cheapest keystrokes
+// of a reverse index: key presses, modifiers and dead keys. New lines are typed
+// with the Enter key. Carriage returns and byte order marks are ignored.
+// Characters which can be typed only as part of a ligature of several code points
+// are unreachable, the cost is evaluated code point by code point.
+class TypingCost
+{
+public:
+    // Constructor. The engine and the index must remain valid during the life of the instance.
+    TypingCost(const KbdEngine&, const ReverseIndex&);
+
+    // Typing cost of a text.
+    struct Counters
+    {
+        uint64_t characters = 0;   // Typed characters.
+        uint64_t keystrokes = 0;   // Key presses, including modifiers and dead keys.
+        uint64_t shift = 0;        // Presses on Shift keys.
+        uint64_t altgr = 0;        // Presses on AltGr keys (Ctrl+Alt in one key).
+        uint64_t ctrl = 0;         // Presses on Ctrl keys.
+        uint64_t alt = 0;          // Presses on Alt keys.
+        uint64_t dead_keys = 0;    // Presses on dead keys.
+        uint64_t unreachable = 0;  // Characters which cannot be typed, not in 'characters'.
+        std::map<char32_t, uint64_t> missing;  // Occurrences of each unreachable code point.
+    };
+
+    // Cost of typing one character.
+    struct Cost
+    {
+        uint8_t keystrokes = 0;
+        uint8_t shift = 0;
+        uint8_t altgr = 0;
+        uint8_t ctrl = 0;
+        uint8_t alt = 0;
+        uint8_t dead_keys = 0;
+    };
+
+    // Get the cost of one code point. Return false if it cannot be typed.
+    bool cost(char32_t code, Cost&) const;
+
+    // Evaluate the cost of a text from its code point counts. The cost is added to 'counters'.
+    void evaluate(const CharCounts&, Counters&) const;
+
+    // Check that the cost agrees with the character coverage of the layout on the code points of a
+    // text: a BMP code point can be typed if and only if it is in the coverage, outside ligatures.
+    // The code points which disagree are returned in 'mismatches'. Return true if there is none.
+    bool check(const CharCounts&, const CharCoverage&, std::vector<char32_t>& mismatches) const;
+
+private:
+    const KbdEngine&    _engine;
+    const ReverseIndex& _index;
+};
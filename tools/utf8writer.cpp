@@ -0,0 +1,199 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Buffered UTF-8 text output.
+//
+//----------------------------------------------------------------------------
+
+#include "utf8writer.h"
+#include <cstdarg>
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+UTF8Writer::UTF8Writer(std::ostream& out, size_t block_size) :
+    _out(out),
+    _buffer(std::max<size_t>(block_size, 256)),
+    _size(0),
+    _wbuf()
+{
+}
+
+UTF8Writer::~UTF8Writer()
+{
+    flush();
+}
+
+
+//----------------------------------------------------------------------------
+// Write the pending data to the output stream.
+//----------------------------------------------------------------------------
+
+void UTF8Writer::flush()
+{
+    if (_size > 0) {
+        _out.write(_buffer.data(), std::streamsize(_size));
+        _size = 0;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Get the address where to write at most 'size' bytes.
+//----------------------------------------------------------------------------
+
+char* UTF8Writer::room(size_t size)
+{
+    if (_size + size > _buffer.size()) {
+        flush();
+        if (size > _buffer.size()) {
+            // Exceptionally large write, grow the buffer once for all.
+            _buffer.resize(size);
+        }
+    }
+    return _buffer.data() + _size;
+}
+
+
+//----------------------------------------------------------------------------
+// Append text.
+//----------------------------------------------------------------------------
+
+UTF8Writer& UTF8Writer::write(std::string_view str)
+{
+    ::memcpy(room(str.size()), str.data(), str.size());
+    _size += str.size();
+    return *this;
+}
+
+UTF8Writer& UTF8Writer::put(char c, size_t count)
+{
+    ::memset(room(count), c, count);
+    _size += count;
+    return *this;
+}
+
+UTF8Writer& UTF8Writer::write(std::wstring_view str)
+{
+    // There is at most 4 bytes per UTF-16 character.
+    char* out = room(4 * str.size());
+    char* const start = out;
+
+    for (size_t i = 0; i < str.size(); ++i) {
+        uint32_t c = uint32_t(str[i]);
+        if (c < 0x80) {
+            *out++ = char(c);
+            continue;
+        }
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < str.size() && str[i+1] >= 0xDC00 && str[i+1] < 0xE000) {
+            // Surrogate pair.
+            c = 0x10000 + ((c - 0xD800) << 10) + (uint32_t(str[++i]) - 0xDC00);
+        }
+        else if ((c >= 0xD800 && c < 0xE000) || c > 0x10FFFF) {
+            // Unpaired surrogate, replaced by U+FFFD, as WideCharToMultiByte() does.
+            c = 0xFFFD;
+        }
+        if (c < 0x800) {
+            *out++ = char(0xC0 | (c >> 6));
+        }
+        else if (c < 0x10000) {
+            *out++ = char(0xE0 | (c >> 12));
+            *out++ = char(0x80 | ((c >> 6) & 0x3F));
+        }
+        else {
+            *out++ = char(0xF0 | (c >> 18));
+            *out++ = char(0x80 | ((c >> 12) & 0x3F));
+            *out++ = char(0x80 | ((c >> 6) & 0x3F));
+        }
+        *out++ = char(0x80 | (c & 0x3F));
+    }
+
+    _size += out - start;
+    return *this;
+}
+
+
+//----------------------------------------------------------------------------
+// Append a formatted string.
+//----------------------------------------------------------------------------
+
+UTF8Writer& UTF8Writer::format(const wchar_t* fmt, ...)
+{
+    // Format in the reusable buffer, its capacity never shrinks.
+    va_list ap;
+    va_start(ap, fmt);
+    FormatArgs(_wbuf, fmt, ap);
+    va_end(ap);
+    return write(std::wstring_view(_wbuf));
+}
+
+
+//----------------------------------------------------------------------------
+// Append a string of hexadecimal digits.
+//----------------------------------------------------------------------------
+
+UTF8Writer& UTF8Writer::hexa(uint64_t value, int digits)
+{
+    // Same as "%0*llX": use more digits when necessary.
+    size_t count = size_t(std::max(digits, 1));
+    while (count < 16 && (value >> (4 * count)) != 0) {
+        ++count;
+    }
+    char* const start = room(count);
+    for (char* p = start + count; p > start; value >>= 4) {
+        *--p = Hexa(int(value));
+    }
+    _size += count;
+    return *this;
+}
+
+
+//----------------------------------------------------------------------------
+// Support for manipulators.
+//----------------------------------------------------------------------------
+
+UTF8Writer& UTF8Writer::operator<<(std::ostream& (*manip)(std::ostream&))
+{
+    if (manip == static_cast<std::ostream& (*)(std::ostream&)>(std::endl)) {
+        newLine();
+    }
+    else {
+        flush();
+        manip(_out);
+    }
+    return *this;
+}
+
+
+//---------------------------------------------------------------------------
+// Hexadecimal dump.
+//---------------------------------------------------------------------------
+
+void PrintHexa(UTF8Writer& out, const void* addr, size_t size, const WString& margin, bool show_addr)
+{
+    const uint8_t* cur = reinterpret_cast<const uint8_t*>(addr);
+    const uint8_t* end = cur + size;
+    constexpr size_t bytes_per_line = 16;
+
+    while (cur < end) {
+        const size_t count = std::min<size_t>(bytes_per_line, end - cur);
+        out << margin;
+        if (show_addr) {
+            out.write("0x").hexa(uintptr_t(cur), 8).write(": ");
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out.hexa(cur[i], 2).put(' ');
+        }
+        out.put(' ', 2 + 3 * (bytes_per_line - count));
+        for (size_t i = 0; i < count; ++i) {
+            out.put(char(cur[i] >= ' ' && cur[i] < 0x7F ? cur[i] : '.'));
+        }
+        out.newLine();
+        cur += count;
+    }
+}
@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Buffered UTF-8 text output.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "strutils.h"
+#include <string_view>
+#include <charconv>
+
+// Text is directly encoded in UTF-8 into a reusable buffer which is written
+// to the output stream in large blocks. Unlike operator<< on std::ostream,
+// there is no intermediate std::string for each wide string.
+class UTF8Writer
+{
+public:
+    // Default size of output blocks.
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    // Constructor and destructor. The destructor writes the pending data.
+    UTF8Writer(std::ostream& out, size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~UTF8Writer();
+
+    // Write the pending data to the output stream.
+    void flush();
+
+    // Append text.
+    UTF8Writer& write(std::string_view str);
+    UTF8Writer& write(std::wstring_view str);
+    UTF8Writer& put(char c, size_t count = 1);
+    UTF8Writer& newLine() { return put('\n'); }
+
+    // Append a formatted string, in a printf-way, same as Format().
+    UTF8Writer& format(const wchar_t* fmt, ...);
+
+    // Append an integer in decimal.
+    template <typename INT_T, typename std::enable_if<std::is_integral<INT_T>::value, int>::type = 0>
+    UTF8Writer& integer(INT_T value);
+
+    // Append an integer in hexadecimal, using at least the specified number of digits.
+    UTF8Writer& hexa(uint64_t value, int digits);
+
+    // Output operators. Integers are displayed in decimal, except 8-bit ones which are ambiguous.
+    UTF8Writer& operator<<(std::string_view str) { return write(str); }
+    UTF8Writer& operator<<(std::wstring_view str) { return write(str); }
+    UTF8Writer& operator<<(const char* str) { return write(std::string_view(str)); }
+    UTF8Writer& operator<<(const wchar_t* str) { return write(std::wstring_view(str)); }
+    UTF8Writer& operator<<(const std::string& str) { return write(std::string_view(str)); }
+    UTF8Writer& operator<<(const WString& str) { return write(std::wstring_view(str)); }
+    UTF8Writer& operator<<(char c) { return put(c); }
+
+    template <typename INT_T, typename std::enable_if<std::is_integral<INT_T>::value && (sizeof(INT_T) > 1) && !std::is_same<INT_T, wchar_t>::value, int>::type = 0>
+    UTF8Writer& operator<<(INT_T value) { return integer(value); }
+
+    // Support for std::endl, without flushing the output stream on each line.
+    // Other manipulators are applied to the output stream after writing the pending data.
+    UTF8Writer& operator<<(std::ostream& (*manip)(std::ostream&));
+
+private:
+    std::ostream&     _out;
+    std::vector<char> _buffer;  // Buffer size is the block size, unless a larger write is needed.
+    size_t            _size;    // Used size in _buffer.
+    WString           _wbuf;    // Reusable buffer for format().
+
+    // Get the address where to write at most 'size' bytes, writing the pending data when necessary.
+    char* room(size_t size);
+
+    // Inaccessible operations.
+    UTF8Writer(const UTF8Writer&) = delete;
+    UTF8Writer& operator=(const UTF8Writer&) = delete;
+};
+
+// Hexadecimal dump, same as PrintHexa() on an std::ostream.
+void PrintHexa(UTF8Writer& out, const void* addr, size_t size, const WString& margin = L"", bool show_addr = false);
+
+
+//----------------------------------------------------------------------------
+// Expansions of templates
+//----------------------------------------------------------------------------
+
+template <typename INT_T, typename std::enable_if<std::is_integral<INT_T>::value, int>::type>
+UTF8Writer& UTF8Writer::integer(INT_T value)
+{
+    // 24 characters are enough for any 64-bit integer.
+    char* const start = room(24);
+    _size += std::to_chars(start, start + 24, value).ptr - start;
+    return *this;
+}
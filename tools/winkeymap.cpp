@@ -4,7 +4,7 @@
 // Copyright (c) 2023, Thierry Lelegard
 // BSD-2-Clause license, see the LICENSE file.
 //
-// Description of a Windows key in a keyboard.
+// Description of the Windows keys in a keyboard.
 //
 //----------------------------------------------------------------------------
 
@@ -12,27 +12,17 @@
 
 
 //----------------------------------------------------------------------------
-// Constructors.
+// Constructor.
 //----------------------------------------------------------------------------
 
-VirtualKey::VirtualKey() :
-    vk(0),
-    wc(8, L'\0')
-{
-}
-
-WinKey::WinKey() :
-    sc(0),
-    vk(),
-    evk()
-{
-}
-
 WinKeyMap::WinKeyMap(const KBDTABLES* tables) :
     _tables(tables),
-    _mods(8, SHFT_INVALID)
+    _mods(),
+    _vk(),
+    _wc()
 {
     // Build the conversion table from "modifier number" to modifier masks.
+    _mods.fill(SHFT_INVALID);
     if (_tables != nullptr && _tables->pCharModifiers != nullptr) {
         for (size_t i = 0; i <= _tables->pCharModifiers->wMaxModBits; ++i) {
             if (_tables->pCharModifiers->ModNumber[i] < _mods.size()) {
@@ -40,54 +30,57 @@ WinKeyMap::WinKeyMap(const KBDTABLES* tables) :
             }
         }
     }
+    build();
 }
 
 
 //----------------------------------------------------------------------------
-// Convert a "modifier number" (index in wch[] of VK_TO_WCHARS)
+// Build the matrix of all scan codes in a keymap.
 //----------------------------------------------------------------------------
 
-size_t WinKeyMap::modNumberToModMask(size_t modnum)
+void WinKeyMap::build()
 {
-    return modnum < _mods.size() ? _mods[modnum] : SHFT_INVALID;
-}
-
-
-//----------------------------------------------------------------------------
-// Get a map of all scan codes in a keymap.
-//----------------------------------------------------------------------------
-
-void WinKeyMap::buildKeyMap(WinKeyVector& keys)
-{
-    keys.clear();
+    _vk.fill(0);
+    _wc.fill(0);
     if (_tables == nullptr || _tables->pVkToWcharTable == nullptr) {
         return;
     }
 
-    // Build a multimap of virtual key => scan code.
-    // The scan code can have attributes KBDEXT.
-    std::multimap<uint16_t, uint16_t> vk2sc;
+    // List of all scan codes. Each one can have attribute KBDEXT.
+    std::vector<std::pair<uint8_t, uint16_t>> scvk; // vk, scan code
     if (_tables->pusVSCtoVK != nullptr) {
         for (uint16_t i = 0; i < _tables->bMaxVSCtoVK; ++i) {
             if ((_tables->pusVSCtoVK[i] & 0xFF) != VK__none_) {
-                vk2sc.insert(std::make_pair(_tables->pusVSCtoVK[i] & 0xFF, i | (_tables->pusVSCtoVK[i] & KBDEXT)));
+                scvk.push_back(std::make_pair(uint8_t(_tables->pusVSCtoVK[i] & 0xFF), uint16_t(i | (_tables->pusVSCtoVK[i] & KBDEXT))));
             }
         }
     }
-    if (_tables->pVSCtoVK_E0 != nullptr) {
-        for (const VSC_VK* p = _tables->pVSCtoVK_E0; p->Vsc != 0; ++p) {
-            vk2sc.insert(std::make_pair(p->Vk & 0xFF, p->Vsc | (p->Vk & KBDEXT)));
+    for (const VSC_VK* p : {_tables->pVSCtoVK_E0, _tables->pVSCtoVK_E1}) {
+        for (; p != nullptr && p->Vsc != 0; ++p) {
+            scvk.push_back(std::make_pair(uint8_t(p->Vk & 0xFF), uint16_t(p->Vsc | (p->Vk & KBDEXT))));
         }
     }
-    if (_tables->pVSCtoVK_E1 != nullptr) {
-        for (const VSC_VK* p = _tables->pVSCtoVK_E1; p->Vsc != 0; ++p) {
-            vk2sc.insert(std::make_pair(p->Vk & 0xFF, p->Vsc | (p->Vk & KBDEXT)));
-        }
+
+    // Sort the scan codes by virtual key (counting sort, keep the order of scan codes for each virtual key).
+    // The scan codes for virtual key vk are in vk2sc[first[vk]] to vk2sc[first[vk+1]-1].
+    std::array<uint16_t, 257> first;
+    first.fill(0);
+    for (const auto& it : scvk) {
+        first[it.first + 1]++;
+    }
+    for (size_t vk = 1; vk < first.size(); ++vk) {
+        first[vk] += first[vk - 1];
+    }
+    std::array<uint16_t, 256> next;
+    std::copy(first.begin(), first.begin() + next.size(), next.begin());
+    std::vector<uint16_t> vk2sc(scvk.size());
+    for (const auto& it : scvk) {
+        vk2sc[next[it.first]++] = it.second;
     }
 
     // Loop on all VK_TO_WCHARS tables.
     for (const VK_TO_WCHAR_TABLE* tab = _tables->pVkToWcharTable; tab->pVkToWchars != nullptr; tab++) {
-        
+
         // Each VK_TO_WCHARS table has a different type. Consider the type with the largest number of elements.
         const VK_TO_WCHARS10* vtwc = reinterpret_cast<const VK_TO_WCHARS10*>(tab->pVkToWchars);
         const size_t wch_count = tab->nModifications;
@@ -99,26 +92,16 @@ void WinKeyMap::buildKeyMap(WinKeyVector& keys)
             const uint16_t vk = vtwc->VirtualKey != VK__none_ ? vtwc->VirtualKey : previous_vk;
             if (vk != VK__none_) {
                 // Loop on all scan codes for this virtual key.
-                for (auto it = vk2sc.lower_bound(vk); it != vk2sc.end() && it->first == vk; ++it) {
-                    const uint16_t sc = it->second & 0xFF;
-                    const bool extended = (it->second & KBDEXT) != 0;
-
-                    // Make sure the keymap contains the scan code.
-                    if (sc >= keys.size()) {
-                        keys.resize(sc + 1);
-                    }
-                    keys[sc].sc = sc;
-
-                    // The virtual key description to update.
-                    VirtualKey& vkd(extended ? keys[sc].evk : keys[sc].vk);
-                    vkd.vk = vk;
+                for (size_t i = first[vk]; i < first[vk + 1]; ++i) {
+                    const size_t idx = index(vk2sc[i] & 0xFF, (vk2sc[i] & KBDEXT) != 0);
+                    _vk[idx] = uint8_t(vk);
 
                     // Loop on all modified characters.
-                    for (size_t i = 0; i < wch_count; ++i) {
-                        const wchar_t wc = vtwc->wch[i];
-                        const size_t modmask = modNumberToModMask(i);
-                        if (modmask < vkd.wc.size() && wc != 0 && wc != WCH_NONE && wc != WCH_DEAD && wc != WCH_LGTR) {
-                            vkd.wc[modmask] = wc;
+                    for (size_t modnum = 0; modnum < wch_count; ++modnum) {
+                        const wchar_t wc = vtwc->wch[modnum];
+                        const size_t modmask = modNumberToModMask(modnum);
+                        if (modmask < MOD_COUNT && wc != 0 && wc != WCH_NONE && wc != WCH_DEAD && wc != WCH_LGTR) {
+                            _wc[idx * MOD_COUNT + modmask] = wc;
                         }
                     }
                 }
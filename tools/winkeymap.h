@@ -4,51 +4,48 @@
 // Copyright (c) 2023, Thierry Lelegard
 // BSD-2-Clause license, see the LICENSE file.
 //
-// Description of a Windows key in a keyboard.
+// Description of the Windows keys in a keyboard.
 //
 //----------------------------------------------------------------------------
 
 #pragma once
 #include "strutils.h"
 
-// Description of one virtual key.
-class VirtualKey
-{
-public:
-    VirtualKey();    // Constructor.
-    uint16_t vk;     // Virtual key, without modifier. Zero means unused.
-    WString  wc;     // Unicode characters. Index in string is a bitmask of KBDSHIFT, KBDCTRL, KBDALT. Zero means unused.
-};
-
-// Description of one key
-class WinKey
-{
-public:
-    WinKey();        // Constructor.
-    uint16_t   sc;   // Scan code. Zero means unused.
-    VirtualKey vk;   // Virtual key.
-    VirtualKey evk;  // Extended virtual key.
-};
-
-// A vector of WinKey. Index in the vector is a scan code.
-typedef std::vector<WinKey> WinKeyVector;
-
-// Description of a complete keyboard.
+// Description of a complete keyboard: dense matrix of all characters,
+// indexed by scan code, extended flag and modifier mask.
 class WinKeyMap
 {
 public:
-    // Constructor.
+    // Number of scan codes and modifier masks (bitmask of KBDSHIFT, KBDCTRL, KBDALT) in the matrix.
+    static constexpr size_t SC_COUNT = 256;
+    static constexpr size_t MOD_COUNT = 8;
+
+    // Constructor. Build the matrix.
     WinKeyMap(const KBDTABLES*);
 
     // Convert a "modifier number" (index in wch[] of VK_TO_WCHARS)
     // into a bitmak of KBDSHIFT, KBDCTRL, KBDALT (0 to 7).
     // Return SHFT_INVALID (>7) if the nodifier number is invalid.
-    size_t modNumberToModMask(size_t modnum);
+    size_t modNumberToModMask(size_t modnum) const { return modnum < _mods.size() ? _mods[modnum] : SHFT_INVALID; }
+
+    // Get the virtual key, without modifier, of a scan code. Zero means unused.
+    uint8_t virtualKey(size_t sc, bool extended) const { return _vk[index(sc, extended)]; }
 
-    // Get a map of all scan codes in a keymap.
-    void buildKeyMap(WinKeyVector&);
+    // Get the Unicode character for a scan code and a modifier mask. Zero means unused.
+    wchar_t character(size_t sc, bool extended, size_t modmask) const { return modmask < MOD_COUNT ? _wc[index(sc, extended) * MOD_COUNT + modmask] : 0; }
+
+    // Get the MOD_COUNT Unicode characters for a scan code, indexed by modifier mask.
+    const wchar_t* characters(size_t sc, bool extended) const { return &_wc[index(sc, extended) * MOD_COUNT]; }
 
 private:
-    const KBDTABLES*    _tables;
-    std::vector<size_t> _mods;   // Modifier masks, indexed by "modifier number".
+    const KBDTABLES*                        _tables;
+    std::array<size_t, MOD_COUNT>           _mods;  // Modifier masks, indexed by "modifier number".
+    std::array<uint8_t, 2 * SC_COUNT>       _vk;    // Virtual keys, indexed by [sc][extended].
+    std::array<wchar_t, 2 * SC_COUNT * MOD_COUNT> _wc;  // Characters, indexed by [sc][extended][modmask].
+
+    // Index of a scan code in the matrix.
+    static size_t index(size_t sc, bool extended) { return 2 * (sc & 0xFF) + (extended ? 1 : 0); }
+
+    // Build the matrix.
+    void build();
 };
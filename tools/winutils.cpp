@@ -11,11 +11,17 @@
 #include "winutils.h"
 #include "strutils.h"
 
+#if !defined(_WIN32)
+    #include <fnmatch.h>
+#endif
+
 
 //----------------------------------------------------------------------------
 // Transform an error code into an error message string.
 //----------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 WString ErrorText(DWORD code)
 {
     WString message(1024, ' ');
@@ -35,11 +41,15 @@ WString ErrorText(DWORD code)
     }
 }
 
+#endif
+
 
 //----------------------------------------------------------------------------
 // File name (without directory), file base name (without directory and prefix).
 //----------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 WString FullName(const WString& name, bool include_dir, bool include_file)
 {
     if (!include_dir && !include_file) {
@@ -69,6 +79,30 @@ WString FullName(const WString& name, bool include_dir, bool include_file)
     return path;
 }
 
+#else
+
+WString FullName(const WString& name, bool include_dir, bool include_file)
+{
+    if (!include_dir && !include_file) {
+        return WString();
+    }
+
+    std::error_code ec;
+    const std::filesystem::path full(std::filesystem::absolute(FilePath(name), ec));
+    WString path(ToUTF16((ec ? FilePath(name) : full).lexically_normal().string()));
+    const size_t sep = path.rfind(PATH_SEPARATOR);
+
+    if (!include_dir) {
+        return sep == WString::npos ? path : path.substr(sep + 1);
+    }
+    if (!include_file && sep != WString::npos) {
+        path.resize(sep == 0 ? 1 : sep);
+    }
+    return path;
+}
+
+#endif
+
 WString DirName(const WString& name)
 {
     return FullName(name, true, false);
@@ -86,11 +120,22 @@ WString FileBaseName(const WString& name)
     return pos == std::string::npos ? filename : filename.substr(0, pos);
 }
 
+std::filesystem::path FilePath(const WString& name)
+{
+#if defined(_WIN32)
+    return std::filesystem::path(name);
+#else
+    return std::filesystem::path(ToUTF8(name));
+#endif
+}
+
 
 //----------------------------------------------------------------------------
 // Check if a file or directory exists
 //----------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 bool FileExists(const WString& path)
 {
     return GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES;
@@ -102,11 +147,29 @@ bool IsDirectory(const WString& path)
     return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
 }
 
+#else
+
+bool FileExists(const WString& path)
+{
+    std::error_code ec;
+    return std::filesystem::exists(FilePath(path), ec);
+}
+
+bool IsDirectory(const WString& path)
+{
+    std::error_code ec;
+    return std::filesystem::is_directory(FilePath(path), ec);
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Search files matching a wildcard.
 //---------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 bool SearchFiles(WStringList& files, const WString& directory, const WString& pattern)
 {
     files.clear();
@@ -139,11 +202,39 @@ bool SearchFiles(WStringList& files, const WString& directory, const WString& pa
     return err == ERROR_SUCCESS || err == ERROR_NO_MORE_FILES; // normal end of search
 }
 
+#else
+
+bool SearchFiles(WStringList& files, const WString& directory, const WString& pattern)
+{
+    files.clear();
+
+    // The wildcards are not case-sensitive, as on Windows.
+#if defined(FNM_CASEFOLD)
+    const int flags = FNM_CASEFOLD;
+#else
+    const int flags = 0;
+#endif
+
+    std::error_code ec;
+    const std::string utf8_pattern(ToUTF8(pattern));
+    for (std::filesystem::directory_iterator it(FilePath(directory), ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string file(it->path().filename().string());
+        if (::fnmatch(utf8_pattern.c_str(), file.c_str(), flags) == 0) {
+            files.push_back(ToUTF16(file));
+        }
+    }
+    return !ec;
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Get the value of an environment variable.
 //---------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 WString GetEnv(const WString& name, const WString& def)
 {
     WString value(2048, ' ');
@@ -156,11 +247,23 @@ WString GetEnv(const WString& name, const WString& def)
     return value.empty() ? def : value;
 }
 
+#else
+
+WString GetEnv(const WString& name, const WString& def)
+{
+    const char* value = std::getenv(ToUTF8(name).c_str());
+    return value == nullptr || *value == 0 ? def : ToUTF16(value);
+}
+
+#endif
+
 
 //---------------------------------------------------------------------------
 // Get the path of the System32 and system temp directories.
 //---------------------------------------------------------------------------
 
+#if defined(_WIN32)
+
 WString GetSystem32()
 {
     return GetEnv(L"SystemRoot", L"C:\\Windows") + L"\\System32";
@@ -327,3 +430,5 @@ ConsoleState::~ConsoleState()
     SetConsoleCP(_input_cp);
     SetConsoleOutputCP(_output_cp);
 }
+
+#endif
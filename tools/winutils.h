@@ -10,23 +10,27 @@
 
 #pragma once
 #include "strutils.h"
+#include <filesystem>
 
-// Transform an error code into an error message string.
-WString ErrorText(DWORD code = GetLastError());
+// Separator of directories in file paths.
+#if defined(_WIN32)
+    #define PATH_SEPARATOR L'\\'
+#else
+    #define PATH_SEPARATOR L'/'
+#endif
 
 // Get the value of an environment variable.
 WString GetEnv(const WString& name, const WString& def = L"");
 
-// Get the path of the System32 and system temp directories.
-WString GetSystem32();
-WString GetSystemTemp();
-
 // Directory name, file name (without directory), file base name (without directory and prefix).
 WString FullName(const WString&, bool include_dir = true, bool include_file = true);
 WString DirName(const WString&);
 WString FileName(const WString&);
 WString FileBaseName(const WString&);
 
+// File path for the C++ library. On systems other than Windows, the path is encoded in UTF-8.
+std::filesystem::path FilePath(const WString&);
+
 // Check if a file or directory exists
 bool FileExists(const WString&);
 
@@ -36,6 +40,15 @@ bool IsDirectory(const WString&);
 // Search files matching a wildcard in a directory.
 bool SearchFiles(WStringList& files, const WString& directory, const WString& pattern);
 
+#if defined(_WIN32)
+
+// Transform an error code into an error message string.
+WString ErrorText(DWORD code = GetLastError());
+
+// Get the path of the System32 and system temp directories.
+WString GetSystem32();
+WString GetSystemTemp();
+
 // Get the file name of a module in a process.
 WString ModuleFileName(HANDLE process, HMODULE module);
 
@@ -67,3 +80,12 @@ private:
     const UINT _input_cp;
     const UINT _output_cp;
 };
+
+#else
+
+// The terminals of other systems already use UTF-8.
+class ConsoleState
+{
+};
+
+#endif
@@ -0,0 +1,690 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compiled keyboard layout files (.wklbin), a position-independent
+// serialization of the KBDTABLES structure.
+//
+//----------------------------------------------------------------------------
+
+#include "wklbin.h"
+#include <cstddef>
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+WklBinFile::WklBinFile() :
+    _file(),
+    _buffer(),
+    _data(nullptr),
+    _size(0),
+    _error(),
+    _header(nullptr),
+    _tables(nullptr),
+    _kbd_valid(false),
+    _kbd(),
+    _modifiers(),
+    _vk_to_wchar(),
+    _key_names(),
+    _key_names_ext(),
+    _key_names_dead()
+{
+}
+
+WklBinFile::~WklBinFile()
+{
+    unload();
+}
+
+
+//----------------------------------------------------------------------------
+// Check if a file name has the .wklbin extension.
+//----------------------------------------------------------------------------
+
+bool WklBinFile::IsWklBinName(const std::wstring& filename)
+{
+    const std::wstring ext(WKLBIN_EXTENSION);
+    if (filename.size() < ext.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < ext.size(); ++i) {
+        wchar_t c = filename[filename.size() - ext.size() + i];
+        if (c >= L'A' && c <= L'Z') {
+            c += L'a' - L'A';
+        }
+        if (c != ext[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// CRC-32.
+//----------------------------------------------------------------------------
+
+namespace {
+    constexpr std::array<uint32_t, 256> MakeCrcTable()
+    {
+        std::array<uint32_t, 256> table {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) != 0 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+    constexpr auto crc_table = MakeCrcTable();
+}
+
+uint32_t WklBinFile::Checksum(const void* data, size_t size, uint32_t crc)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+//----------------------------------------------------------------------------
+// Serialize keyboard tables in .wklbin format.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Growing buffer, all structures are 4-byte aligned.
+    class BinWriter
+    {
+    public:
+        BinWriter(std::vector<uint8_t>& data) : _data(data) {}
+
+        // Allocate a zeroed area, return its offset.
+        uint32_t alloc(size_t size)
+        {
+            _data.resize((_data.size() + 3) & ~size_t(3), 0);
+            const uint32_t offset = uint32_t(_data.size());
+            _data.resize(_data.size() + size, 0);
+            return offset;
+        }
+
+        // Append a copy of a memory area, return its offset, zero if there is nothing to copy.
+        uint32_t append(const void* addr, size_t size)
+        {
+            if (addr == nullptr || size == 0) {
+                return 0;
+            }
+            const uint32_t offset = alloc(size);
+            std::memcpy(_data.data() + offset, addr, size);
+            return offset;
+        }
+
+        // Append a nul-terminated string.
+        uint32_t appendString(const WCHAR* str)
+        {
+            size_t len = 0;
+            while (str != nullptr && str[len] != 0) {
+                len++;
+            }
+            return append(str, (len + 1) * sizeof(WCHAR));
+        }
+
+        // Overwrite a structure at a given offset.
+        template <typename T>
+        void set(uint32_t offset, const T& value) { std::memcpy(_data.data() + offset, &value, sizeof(T)); }
+
+    private:
+        std::vector<uint8_t>& _data;
+    };
+
+    // Size in bytes of a terminated array in memory, including the terminating entry.
+    template <typename T, class IS_LAST>
+    size_t MemArraySize(const T* addr, size_t entry_size, IS_LAST is_last)
+    {
+        if (addr == nullptr || entry_size == 0) {
+            return 0;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(addr);
+        while (!is_last(reinterpret_cast<const T*>(p))) {
+            p += entry_size;
+        }
+        return p - reinterpret_cast<const uint8_t*>(addr) + entry_size;
+    }
+}
+
+void WklBinFile::Serialize(std::vector<uint8_t>& data, const KBDTABLES& kt)
+{
+    data.clear();
+    BinWriter out(data);
+    const uint32_t header_offset = out.alloc(sizeof(WklBinHeader));
+    const uint32_t tables_offset = out.alloc(sizeof(WklBinTables));
+    WklBinTables tables {};
+
+    if (kt.pCharModifiers != nullptr) {
+        const MODIFIERS& mods(*kt.pCharModifiers);
+        WklBinModifiers wmods {};
+        wmods.vk_to_bit = out.append(mods.pVkToBit, MemArraySize(mods.pVkToBit, sizeof(VK_TO_BIT), [](const VK_TO_BIT* p) { return p->Vk == 0; }));
+        wmods.mod_number = out.append(mods.ModNumber, size_t(mods.wMaxModBits) + 1);
+        wmods.max_mod_bits = mods.wMaxModBits;
+        tables.char_modifiers = out.alloc(sizeof(wmods));
+        out.set(tables.char_modifiers, wmods);
+    }
+
+    if (kt.pVkToWcharTable != nullptr) {
+        std::vector<WklBinVkToWcharTable> vtw;
+        for (const VK_TO_WCHAR_TABLE* p = kt.pVkToWcharTable; p->pVkToWchars != nullptr; ++p) {
+            WklBinVkToWcharTable entry {};
+            entry.vk_to_wchars = out.append(p->pVkToWchars, MemArraySize(p->pVkToWchars, p->cbSize, [](const VK_TO_WCHARS1* e) { return e->VirtualKey == 0; }));
+            entry.modifications = p->nModifications;
+            entry.entry_size = p->cbSize;
+            vtw.push_back(entry);
+        }
+        vtw.push_back(WklBinVkToWcharTable{});
+        tables.vk_to_wchar = out.append(vtw.data(), vtw.size() * sizeof(WklBinVkToWcharTable));
+    }
+
+    tables.dead_keys = out.append(kt.pDeadKey, MemArraySize(kt.pDeadKey, sizeof(DEADKEY), [](const DEADKEY* p) { return p->dwBoth == 0; }));
+
+    const auto key_names = [&out](const VSC_LPWSTR* names) -> uint32_t {
+        if (names == nullptr) {
+            return 0;
+        }
+        std::vector<WklBinKeyName> wnames;
+        for (; names->vsc != 0; ++names) {
+            wnames.push_back(WklBinKeyName{names->vsc, out.appendString(names->pwsz)});
+        }
+        wnames.push_back(WklBinKeyName{0, 0});
+        return out.append(wnames.data(), wnames.size() * sizeof(WklBinKeyName));
+    };
+    tables.key_names = key_names(kt.pKeyNames);
+    tables.key_names_ext = key_names(kt.pKeyNamesExt);
+
+    if (kt.pKeyNamesDead != nullptr) {
+        std::vector<uint32_t> names;
+        for (const DEADKEY_LPWSTR* p = kt.pKeyNamesDead; *p != nullptr; ++p) {
+            names.push_back(out.appendString(*p));
+        }
+        names.push_back(0);
+        tables.key_names_dead = out.append(names.data(), names.size() * sizeof(uint32_t));
+    }
+
+    tables.vsc_to_vk = out.append(kt.pusVSCtoVK, kt.bMaxVSCtoVK * sizeof(USHORT));
+    tables.vsc_to_vk_count = tables.vsc_to_vk == 0 ? 0 : kt.bMaxVSCtoVK;
+    tables.vsc_to_vk_e0 = out.append(kt.pVSCtoVK_E0, MemArraySize(kt.pVSCtoVK_E0, sizeof(VSC_VK), [](const VSC_VK* p) { return p->Vsc == 0; }));
+    tables.vsc_to_vk_e1 = out.append(kt.pVSCtoVK_E1, MemArraySize(kt.pVSCtoVK_E1, sizeof(VSC_VK), [](const VSC_VK* p) { return p->Vsc == 0; }));
+    tables.ligatures = out.append(kt.pLigature, MemArraySize(kt.pLigature, kt.cbLgEntry, [](const LIGATURE1* p) { return p->VirtualKey == 0; }));
+    tables.lg_max = kt.nLgMax;
+    tables.lg_entry_size = kt.cbLgEntry;
+    tables.locale_flags = kt.fLocaleFlags;
+    tables.type = kt.dwType;
+    tables.subtype = kt.dwSubType;
+    out.set(tables_offset, tables);
+
+    // Finally build the header.
+    WklBinHeader header {};
+    std::memcpy(header.magic, WKLBIN_MAGIC, sizeof(header.magic));
+    header.version = WKLBIN_VERSION;
+    header.header_size = uint32_t(sizeof(WklBinHeader));
+    header.file_size = uint32_t(data.size());
+    header.checksum = Checksum(data.data() + sizeof(WklBinHeader), data.size() - sizeof(WklBinHeader));
+    header.tables = tables_offset;
+    out.set(header_offset, header);
+}
+
+
+//----------------------------------------------------------------------------
+// Load and validate a .wklbin file.
+//----------------------------------------------------------------------------
+
+bool WklBinFile::load(const std::filesystem::path& filename, bool verify_checksum)
+{
+    unload();
+    _error.clear();
+
+    if (!_file.open(filename)) {
+        return fail("cannot open or map file");
+    }
+    _data = _file.data();
+    _size = _file.size();
+    return loadContent(verify_checksum);
+}
+
+bool WklBinFile::loadContent(bool verify_checksum)
+{
+    const size_t size = _size;
+    const WklBinHeader* header = reinterpret_cast<const WklBinHeader*>(_data);
+    if (size < sizeof(WklBinHeader) || std::memcmp(header->magic, WKLBIN_MAGIC, sizeof(header->magic)) != 0) {
+        return fail("not a .wklbin file");
+    }
+    if (header->version != WKLBIN_VERSION) {
+        return fail("unsupported .wklbin version " + std::to_string(header->version));
+    }
+    if (header->header_size != sizeof(WklBinHeader) || header->file_size != size) {
+        return fail("invalid .wklbin header or truncated file");
+    }
+    if (verify_checksum && Checksum(_data + sizeof(WklBinHeader), size - sizeof(WklBinHeader)) != header->checksum) {
+        return fail("checksum error in .wklbin file");
+    }
+    if (header->tables == 0 || !valid(header->tables, sizeof(WklBinTables))) {
+        return fail("invalid keyboard tables offset");
+    }
+    _header = header;
+    _tables = get<WklBinTables>(header->tables);
+    return validate();
+}
+
+//----------------------------------------------------------------------------
+// Serialize the keyboard tables of a DLL with a different pointer size.
+//----------------------------------------------------------------------------
+
+bool WklBinFile::load(const PeFile& image, uint32_t tables_rva)
+{
+    unload();
+    _error.clear();
+
+    // Layout of the structures with pointers in the DLL (natural alignment).
+    const uint32_t ptr = image.is64Bits() ? 8 : 4;
+    const uint32_t lg_offset = (10 * ptr + 6 + ptr - 1) & ~(ptr - 1);  // KBDTABLES::pLigature
+    const uint32_t tables_size = lg_offset + ptr + 8;
+    const auto byte_at = [&image](uint32_t rva) -> uint8_t { const uint8_t* p = image.data(rva); return p == nullptr ? 0 : *p; };
+    const auto dword_at = [&image](uint32_t rva) { uint32_t v = 0; const uint8_t* p = image.data(rva, 4); if (p != nullptr) { std::memcpy(&v, p, 4); } return v; };
+
+    // Get a structure without pointers which is used in place: an array, up to and including its terminating entry.
+    bool valid = true;
+    const auto in_place = [&image, &valid](uint32_t rva, size_t entry_size, auto is_last) -> const uint8_t* {
+        if (rva == 0 || entry_size == 0) {
+            return nullptr;
+        }
+        for (uint32_t entry = rva; ; entry += uint32_t(entry_size)) {
+            const uint8_t* const p = image.data(entry, entry_size);
+            if (p == nullptr) {
+                valid = false;
+                return nullptr;
+            }
+            if (is_last(p)) {
+                return image.data(rva);
+            }
+        }
+    };
+    const auto is_zero16 = [](const uint8_t* p) { return p[0] == 0 && p[1] == 0; };
+    const auto is_zero8 = [](const uint8_t* p) { return p[0] == 0; };
+    const auto is_zero32 = [](const uint8_t* p) { return p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 0; };
+
+    if (image.data(tables_rva, tables_size) == nullptr) {
+        return fail("keyboard tables outside the DLL");
+    }
+
+    // Build a native view of the tables, then serialize it.
+    KBDTABLES kt {};
+    std::vector<uint8_t> modifiers;
+    std::vector<VK_TO_WCHAR_TABLE> vk_to_wchar;
+    std::vector<VSC_LPWSTR> key_names;
+    std::vector<VSC_LPWSTR> key_names_ext;
+    std::vector<DEADKEY_LPWSTR> key_names_dead;
+
+    const uint32_t mods_rva = image.pointerRva(tables_rva);
+    if (mods_rva != 0) {
+        const size_t count = size_t(byte_at(mods_rva + ptr)) + (size_t(byte_at(mods_rva + ptr + 1)) << 8) + 1;
+        const uint8_t* const numbers = image.data(mods_rva + ptr + 2, count);
+        if (numbers == nullptr) {
+            return fail("invalid MODIFIERS in the DLL");
+        }
+        modifiers.assign(std::max(sizeof(MODIFIERS), offsetof(MODIFIERS, ModNumber) + count), 0);
+        MODIFIERS* const mods = reinterpret_cast<MODIFIERS*>(modifiers.data());
+        mods->pVkToBit = reinterpret_cast<PVK_TO_BIT>(const_cast<uint8_t*>(in_place(image.pointerRva(mods_rva), sizeof(VK_TO_BIT), is_zero8)));
+        mods->wMaxModBits = WORD(count - 1);
+        std::memcpy(mods->ModNumber, numbers, count);
+        kt.pCharModifiers = mods;
+    }
+
+    const uint32_t vtw_rva = image.pointerRva(tables_rva + ptr);
+    if (vtw_rva != 0) {
+        for (uint32_t entry = vtw_rva; valid; entry += 2 * ptr) {
+            if (image.data(entry, 2 * ptr) == nullptr) {
+                return fail("invalid VK_TO_WCHAR_TABLE in the DLL");
+            }
+            const uint32_t chars_rva = image.pointerRva(entry);
+            if (chars_rva == 0) {
+                break;
+            }
+            const BYTE size = byte_at(entry + ptr + 1);
+            const uint8_t* const chars = in_place(chars_rva, size, is_zero8);
+            vk_to_wchar.push_back(VK_TO_WCHAR_TABLE{reinterpret_cast<PVK_TO_WCHARS1>(const_cast<uint8_t*>(chars)), byte_at(entry + ptr), size});
+        }
+        vk_to_wchar.push_back(VK_TO_WCHAR_TABLE{nullptr, 0, 0});
+        kt.pVkToWcharTable = vk_to_wchar.data();
+    }
+
+    kt.pDeadKey = reinterpret_cast<PDEADKEY>(const_cast<uint8_t*>(in_place(image.pointerRva(tables_rva + 2 * ptr), sizeof(DEADKEY), is_zero32)));
+
+    const auto names = [&](std::vector<VSC_LPWSTR>& list, uint32_t rva) -> PVSC_LPWSTR {
+        if (rva == 0) {
+            return nullptr;
+        }
+        for (uint32_t entry = rva; valid; entry += 2 * ptr) {
+            if (image.data(entry, 2 * ptr) == nullptr) {
+                valid = false;
+                break;
+            }
+            const BYTE vsc = byte_at(entry);
+            if (vsc == 0) {
+                break;
+            }
+            list.push_back(VSC_LPWSTR{vsc, reinterpret_cast<WCHAR*>(const_cast<uint8_t*>(in_place(image.pointerRva(entry + ptr), sizeof(WCHAR), is_zero16)))});
+        }
+        list.push_back(VSC_LPWSTR{0, nullptr});
+        return list.data();
+    };
+    kt.pKeyNames = names(key_names, image.pointerRva(tables_rva + 3 * ptr));
+    kt.pKeyNamesExt = names(key_names_ext, image.pointerRva(tables_rva + 4 * ptr));
+
+    const uint32_t dead_rva = image.pointerRva(tables_rva + 5 * ptr);
+    if (dead_rva != 0) {
+        for (uint32_t entry = dead_rva; valid; entry += ptr) {
+            if (image.data(entry, ptr) == nullptr) {
+                return fail("invalid dead key names in the DLL");
+            }
+            const uint32_t name_rva = image.pointerRva(entry);
+            if (name_rva == 0) {
+                break;
+            }
+            key_names_dead.push_back(reinterpret_cast<WCHAR*>(const_cast<uint8_t*>(in_place(name_rva, sizeof(WCHAR), is_zero16))));
+        }
+        key_names_dead.push_back(nullptr);
+        kt.pKeyNamesDead = key_names_dead.data();
+    }
+
+    kt.bMaxVSCtoVK = byte_at(tables_rva + 7 * ptr);
+    kt.pusVSCtoVK = reinterpret_cast<USHORT*>(const_cast<uint8_t*>(image.data(image.pointerRva(tables_rva + 6 * ptr), kt.bMaxVSCtoVK * sizeof(USHORT))));
+    kt.pVSCtoVK_E0 = reinterpret_cast<PVSC_VK>(const_cast<uint8_t*>(in_place(image.pointerRva(tables_rva + 8 * ptr), sizeof(VSC_VK), is_zero8)));
+    kt.pVSCtoVK_E1 = reinterpret_cast<PVSC_VK>(const_cast<uint8_t*>(in_place(image.pointerRva(tables_rva + 9 * ptr), sizeof(VSC_VK), is_zero8)));
+    kt.fLocaleFlags = dword_at(tables_rva + 10 * ptr);
+    kt.nLgMax = byte_at(tables_rva + 10 * ptr + 4);
+    kt.cbLgEntry = byte_at(tables_rva + 10 * ptr + 5);
+    kt.pLigature = reinterpret_cast<PLIGATURE1>(const_cast<uint8_t*>(in_place(image.pointerRva(tables_rva + lg_offset), kt.cbLgEntry, is_zero8)));
+    kt.dwType = dword_at(tables_rva + lg_offset + ptr);
+    kt.dwSubType = dword_at(tables_rva + lg_offset + ptr + 4);
+
+    if (!valid) {
+        return fail("unterminated array in the keyboard tables of the DLL");
+    }
+    Serialize(_buffer, kt);
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return loadContent(false);
+}
+
+bool WklBinFile::fail(const std::string& message)
+{
+    unload();
+    _error = message;
+    return false;
+}
+
+
+//----------------------------------------------------------------------------
+// Unload the file.
+//----------------------------------------------------------------------------
+
+void WklBinFile::unload()
+{
+    _header = nullptr;
+    _tables = nullptr;
+    _kbd_valid = false;
+    _kbd = KBDTABLES{};
+    _modifiers.clear();
+    _vk_to_wchar.clear();
+    _key_names.clear();
+    _key_names_ext.clear();
+    _key_names_dead.clear();
+    _file.close();
+    _buffer.clear();
+    _data = nullptr;
+    _size = 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Check the location of data in the file.
+//----------------------------------------------------------------------------
+
+bool WklBinFile::valid(uint32_t offset, size_t size, size_t alignment) const
+{
+    return offset == 0 || (offset % alignment == 0 && offset <= _size && _size - offset >= size);
+}
+
+template <class IS_LAST>
+size_t WklBinFile::arraySize(uint32_t offset, size_t entry_size, size_t alignment, IS_LAST is_last) const
+{
+    if (offset != 0 && entry_size != 0 && offset % alignment == 0) {
+        for (size_t size = entry_size; offset <= _size && _size - offset >= size; size += entry_size) {
+            if (is_last(_data + offset + size - entry_size)) {
+                return size;
+            }
+        }
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Validate the structure of the loaded file.
+// After this, all offsets and arrays are known to be inside the file.
+//----------------------------------------------------------------------------
+
+bool WklBinFile::validate()
+{
+    const WklBinTables& tables(*_tables);
+
+    // Check a nul-terminated string.
+    const auto string_ok = [this](uint32_t offset) {
+        return offset == 0 || arraySize(offset, sizeof(WCHAR), alignof(WCHAR), [](const uint8_t* p) { return *reinterpret_cast<const WCHAR*>(p) == 0; }) > 0;
+    };
+
+    // Check an optional terminated array.
+    const auto array_ok = [this](uint32_t offset, size_t entry_size, size_t alignment, auto is_last) {
+        return offset == 0 || arraySize(offset, entry_size, alignment, is_last) > 0;
+    };
+
+    if (tables.char_modifiers != 0) {
+        if (!valid(tables.char_modifiers, sizeof(WklBinModifiers))) {
+            return fail("invalid modifiers offset");
+        }
+        const WklBinModifiers* mods = get<WklBinModifiers>(tables.char_modifiers);
+        if (!array_ok(mods->vk_to_bit, sizeof(VK_TO_BIT), alignof(VK_TO_BIT), [](const uint8_t* p) { return reinterpret_cast<const VK_TO_BIT*>(p)->Vk == 0; }) ||
+            !valid(mods->mod_number, size_t(mods->max_mod_bits) + 1, 1))
+        {
+            return fail("invalid modifiers table");
+        }
+    }
+
+    if (tables.vk_to_wchar != 0) {
+        const size_t size = arraySize(tables.vk_to_wchar, sizeof(WklBinVkToWcharTable), 4, [](const uint8_t* p) { return reinterpret_cast<const WklBinVkToWcharTable*>(p)->vk_to_wchars == 0; });
+        if (size == 0) {
+            return fail("invalid virtual key to characters table");
+        }
+        const WklBinVkToWcharTable* vtw = get<WklBinVkToWcharTable>(tables.vk_to_wchar);
+        for (size_t i = 0; i < size / sizeof(WklBinVkToWcharTable) - 1; ++i) {
+            if (vtw[i].entry_size < offsetof(VK_TO_WCHARS1, wch) + vtw[i].modifications * sizeof(WCHAR) ||
+                !array_ok(vtw[i].vk_to_wchars, vtw[i].entry_size, alignof(VK_TO_WCHARS1), [](const uint8_t* p) { return reinterpret_cast<const VK_TO_WCHARS1*>(p)->VirtualKey == 0; }))
+            {
+                return fail("invalid virtual key to characters table");
+            }
+        }
+    }
+
+    if (!array_ok(tables.dead_keys, sizeof(DEADKEY), alignof(DEADKEY), [](const uint8_t* p) { return reinterpret_cast<const DEADKEY*>(p)->dwBoth == 0; })) {
+        return fail("invalid dead keys table");
+    }
+
+    for (uint32_t offset : {tables.key_names, tables.key_names_ext}) {
+        const size_t size = arraySize(offset, sizeof(WklBinKeyName), 4, [](const uint8_t* p) { return reinterpret_cast<const WklBinKeyName*>(p)->vsc == 0; });
+        if (offset != 0 && size == 0) {
+            return fail("invalid key names table");
+        }
+        const WklBinKeyName* names = get<WklBinKeyName>(offset);
+        for (size_t i = 0; i < size / sizeof(WklBinKeyName); ++i) {
+            if (names[i].vsc > 0xFF || !string_ok(names[i].name)) {
+                return fail("invalid key name");
+            }
+        }
+    }
+
+    if (tables.key_names_dead != 0) {
+        const size_t size = arraySize(tables.key_names_dead, sizeof(uint32_t), 4, [](const uint8_t* p) { return *reinterpret_cast<const uint32_t*>(p) == 0; });
+        if (size == 0) {
+            return fail("invalid dead key names table");
+        }
+        const uint32_t* names = get<uint32_t>(tables.key_names_dead);
+        for (size_t i = 0; i < size / sizeof(uint32_t); ++i) {
+            if (!string_ok(names[i])) {
+                return fail("invalid dead key name");
+            }
+        }
+    }
+
+    if (!valid(tables.vsc_to_vk, tables.vsc_to_vk_count * sizeof(USHORT), alignof(USHORT))) {
+        return fail("invalid scan code to virtual key table");
+    }
+    for (uint32_t offset : {tables.vsc_to_vk_e0, tables.vsc_to_vk_e1}) {
+        if (!array_ok(offset, sizeof(VSC_VK), alignof(VSC_VK), [](const uint8_t* p) { return reinterpret_cast<const VSC_VK*>(p)->Vsc == 0; })) {
+            return fail("invalid extended scan code to virtual key table");
+        }
+    }
+
+    if (tables.ligatures != 0 && (tables.lg_entry_size < offsetof(LIGATURE1, wch) + tables.lg_max * sizeof(WCHAR) ||
+        !array_ok(tables.ligatures, tables.lg_entry_size, alignof(LIGATURE1), [](const uint8_t* p) { return reinterpret_cast<const LIGATURE1*>(p)->VirtualKey == 0; })))
+    {
+        return fail("invalid ligatures table");
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Get a KBDTABLES which can be used by all tools.
+//----------------------------------------------------------------------------
+
+void WklBinFile::buildKeyNames(std::vector<VSC_LPWSTR>& names, uint32_t offset)
+{
+    names.clear();
+    for (const WklBinKeyName* wn = get<WklBinKeyName>(offset); wn->vsc != 0; ++wn) {
+        names.push_back(VSC_LPWSTR{BYTE(wn->vsc), const_cast<WCHAR*>(get<WCHAR>(wn->name))});
+    }
+    names.push_back(VSC_LPWSTR{0, nullptr});
+}
+
+const KBDTABLES* WklBinFile::kbdTables()
+{
+    if (_tables == nullptr) {
+        return nullptr;
+    }
+    if (_kbd_valid) {
+        return &_kbd;
+    }
+
+    const WklBinTables& tables(*_tables);
+    _kbd = KBDTABLES{};
+
+    if (tables.char_modifiers != 0) {
+        // MODIFIERS is a variable-size structure, the ModNumber array is at the end.
+        const WklBinModifiers* wmods = get<WklBinModifiers>(tables.char_modifiers);
+        const size_t count = size_t(wmods->max_mod_bits) + 1;
+        _modifiers.assign(std::max(sizeof(MODIFIERS), offsetof(MODIFIERS, ModNumber) + count), 0);
+        MODIFIERS* mods = reinterpret_cast<MODIFIERS*>(_modifiers.data());
+        mods->pVkToBit = const_cast<PVK_TO_BIT>(get<VK_TO_BIT>(wmods->vk_to_bit));
+        mods->wMaxModBits = wmods->max_mod_bits;
+        if (wmods->mod_number != 0) {
+            std::memcpy(mods->ModNumber, get<uint8_t>(wmods->mod_number), count);
+        }
+        _kbd.pCharModifiers = mods;
+    }
+
+    if (tables.vk_to_wchar != 0) {
+        _vk_to_wchar.clear();
+        for (const WklBinVkToWcharTable* vtw = get<WklBinVkToWcharTable>(tables.vk_to_wchar); vtw->vk_to_wchars != 0; ++vtw) {
+            _vk_to_wchar.push_back(VK_TO_WCHAR_TABLE{const_cast<PVK_TO_WCHARS1>(get<VK_TO_WCHARS1>(vtw->vk_to_wchars)), vtw->modifications, vtw->entry_size});
+        }
+        _vk_to_wchar.push_back(VK_TO_WCHAR_TABLE{nullptr, 0, 0});
+        _kbd.pVkToWcharTable = _vk_to_wchar.data();
+    }
+
+    if (tables.key_names != 0) {
+        buildKeyNames(_key_names, tables.key_names);
+        _kbd.pKeyNames = _key_names.data();
+    }
+    if (tables.key_names_ext != 0) {
+        buildKeyNames(_key_names_ext, tables.key_names_ext);
+        _kbd.pKeyNamesExt = _key_names_ext.data();
+    }
+
+    if (tables.key_names_dead != 0) {
+        _key_names_dead.clear();
+        for (const uint32_t* name = get<uint32_t>(tables.key_names_dead); *name != 0; ++name) {
+            _key_names_dead.push_back(const_cast<WCHAR*>(get<WCHAR>(*name)));
+        }
+        _key_names_dead.push_back(nullptr);
+        _kbd.pKeyNamesDead = _key_names_dead.data();
+    }
+
+    // All other structures are directly used in the mapped file.
+    _kbd.pDeadKey = const_cast<PDEADKEY>(get<DEADKEY>(tables.dead_keys));
+    _kbd.pusVSCtoVK = const_cast<USHORT*>(get<USHORT>(tables.vsc_to_vk));
+    _kbd.bMaxVSCtoVK = tables.vsc_to_vk_count;
+    _kbd.pVSCtoVK_E0 = const_cast<PVSC_VK>(get<VSC_VK>(tables.vsc_to_vk_e0));
+    _kbd.pVSCtoVK_E1 = const_cast<PVSC_VK>(get<VSC_VK>(tables.vsc_to_vk_e1));
+    _kbd.fLocaleFlags = tables.locale_flags;
+    _kbd.nLgMax = tables.lg_max;
+    _kbd.cbLgEntry = tables.lg_entry_size;
+    _kbd.pLigature = const_cast<PLIGATURE1>(get<LIGATURE1>(tables.ligatures));
+    _kbd.dwType = tables.type;
+    _kbd.dwSubType = tables.subtype;
+
+    _kbd_valid = true;
+    return &_kbd;
+}
+
+
+//----------------------------------------------------------------------------
+// Serialized form of the structures which are built by kbdTables().
+//----------------------------------------------------------------------------
+
+std::vector<std::pair<const void*, size_t>> WklBinFile::serializedAreas(const void* address) const
+{
+    std::vector<std::pair<const void*, size_t>> areas;
+    if (!_kbd_valid || address == nullptr) {
+        return areas;
+    }
+    const WklBinTables& tables(*_tables);
+    if (address == &_kbd) {
+        areas.push_back({_tables, sizeof(WklBinTables)});
+    }
+    else if (address == _modifiers.data() && tables.char_modifiers != 0) {
+        // The ModNumber array is stored separately.
+        const WklBinModifiers* wmods = get<WklBinModifiers>(tables.char_modifiers);
+        areas.push_back({wmods, sizeof(WklBinModifiers)});
+        if (wmods->mod_number != 0) {
+            areas.push_back({get<uint8_t>(wmods->mod_number), size_t(wmods->max_mod_bits) + 1});
+        }
+    }
+    else if (address == _vk_to_wchar.data() && tables.vk_to_wchar != 0) {
+        areas.push_back({get<WklBinVkToWcharTable>(tables.vk_to_wchar), _vk_to_wchar.size() * sizeof(WklBinVkToWcharTable)});
+    }
+    else if (address == _key_names.data() && tables.key_names != 0) {
+        areas.push_back({get<WklBinKeyName>(tables.key_names), _key_names.size() * sizeof(WklBinKeyName)});
+    }
+    else if (address == _key_names_ext.data() && tables.key_names_ext != 0) {
+        areas.push_back({get<WklBinKeyName>(tables.key_names_ext), _key_names_ext.size() * sizeof(WklBinKeyName)});
+    }
+    else if (address == _key_names_dead.data() && tables.key_names_dead != 0) {
+        areas.push_back({get<uint32_t>(tables.key_names_dead), _key_names_dead.size() * sizeof(uint32_t)});
+    }
+    return areas;
+}
@@ -0,0 +1,194 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compiled keyboard layout files (.wklbin), a position-independent
+// serialization of the KBDTABLES structure.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "kbdportable.h"
+#include "mappedfile.h"
+#include "pefile.h"
+
+// File format:
+// - All integers are little endian. All offsets are relative to the start of
+//   the file. A zero offset is a null pointer. All structures are 4-byte aligned.
+// - The file starts with a WklBinHeader. The checksum is a CRC-32 of the rest
+//   of the file, after the header.
+// - The structures without pointers (VK_TO_BIT, VK_TO_WCHARSn, DEADKEY, VSC_VK,
+//   LIGATUREn, scan code to virtual key table and strings) are stored exactly as
+//   in memory, including their terminating null entry. They are used in place.
+// - The structures with pointers (KBDTABLES, MODIFIERS, VK_TO_WCHAR_TABLE, key
+//   names) are replaced with the WklBin structures below, using offsets.
+
+#define WKLBIN_MAGIC      "WKLBIN\x1A"   // 8 bytes, including the trailing nul
+#define WKLBIN_VERSION    1
+#define WKLBIN_EXTENSION  L".wklbin"
+
+struct WklBinHeader
+{
+    char     magic[8];        // WKLBIN_MAGIC
+    uint32_t version;         // WKLBIN_VERSION
+    uint32_t header_size;     // sizeof(WklBinHeader)
+    uint32_t file_size;       // Total file size in bytes.
+    uint32_t checksum;        // CRC-32 of the file after the header.
+    uint32_t tables;          // WklBinTables
+    uint32_t reserved;
+};
+
+// Same as KBDTABLES.
+struct WklBinTables
+{
+    uint32_t char_modifiers;  // WklBinModifiers
+    uint32_t vk_to_wchar;     // WklBinVkToWcharTable[], terminated by a zero vk_to_wchars.
+    uint32_t dead_keys;       // DEADKEY[]
+    uint32_t key_names;       // WklBinKeyName[], terminated by a zero vsc.
+    uint32_t key_names_ext;   // WklBinKeyName[], terminated by a zero vsc.
+    uint32_t key_names_dead;  // uint32_t[] offsets of strings, terminated by a zero offset.
+    uint32_t vsc_to_vk;       // USHORT[vsc_to_vk_count]
+    uint32_t vsc_to_vk_e0;    // VSC_VK[]
+    uint32_t vsc_to_vk_e1;    // VSC_VK[]
+    uint32_t ligatures;       // LIGATUREn[], entries of lg_entry_size bytes.
+    uint32_t locale_flags;
+    uint32_t type;
+    uint32_t subtype;
+    uint8_t  vsc_to_vk_count;
+    uint8_t  lg_max;
+    uint8_t  lg_entry_size;
+    uint8_t  reserved;
+};
+
+// Same as MODIFIERS.
+struct WklBinModifiers
+{
+    uint32_t vk_to_bit;       // VK_TO_BIT[]
+    uint32_t mod_number;      // BYTE[max_mod_bits + 1]
+    uint16_t max_mod_bits;
+    uint16_t reserved;
+};
+
+// Same as VK_TO_WCHAR_TABLE.
+struct WklBinVkToWcharTable
+{
+    uint32_t vk_to_wchars;    // VK_TO_WCHARSn[], entries of entry_size bytes.
+    uint8_t  modifications;
+    uint8_t  entry_size;
+    uint16_t reserved;
+};
+
+// Same as VSC_LPWSTR.
+struct WklBinKeyName
+{
+    uint32_t vsc;
+    uint32_t name;            // Nul-terminated WCHAR string.
+};
+
+static_assert(sizeof(WklBinHeader) == 32, "invalid WklBinHeader");
+static_assert(sizeof(WklBinTables) == 56, "invalid WklBinTables");
+static_assert(sizeof(WklBinModifiers) == 12, "invalid WklBinModifiers");
+static_assert(sizeof(WklBinVkToWcharTable) == 8, "invalid WklBinVkToWcharTable");
+static_assert(sizeof(WklBinKeyName) == 8, "invalid WklBinKeyName");
+static_assert(sizeof(WCHAR) == 2 && sizeof(DEADKEY) == 8 && sizeof(VSC_VK) == 4 && sizeof(VK_TO_BIT) == 2, "unexpected kbd.h layout");
+
+// A compiled keyboard layout file. The file is memory-mapped and validated
+// once, then its content is directly used, without copy or relocation.
+// The tables of a DLL whose pointers cannot be used in this process (32-bit
+// DLL in a 64-bit process or the reverse) can also be serialized in memory
+// and used the same way.
+class WklBinFile
+{
+public:
+    // Constructor and destructor.
+    WklBinFile();
+    ~WklBinFile();
+
+    // Serialize keyboard tables in .wklbin format.
+    static void Serialize(std::vector<uint8_t>& data, const KBDTABLES& tables);
+
+    // Check if a file name has the .wklbin extension.
+    static bool IsWklBinName(const std::wstring& filename);
+
+    // CRC-32 (same as zip, png, etc.)
+    static uint32_t Checksum(const void* data, size_t size, uint32_t crc = 0);
+
+    // Map and validate a .wklbin file. Unload the previous one. Return false on error, see errorMessage().
+    // Skipping the checksum verification avoids reading the complete file, the structure is always validated.
+    bool load(const std::filesystem::path& filename, bool verify_checksum = true);
+
+    // Serialize in memory the keyboard tables of a DLL, at some RVA, when the pointer size of the DLL
+    // differs from this process. The structures are read in the mapped DLL, with its pointer size.
+    // Unload the previous content. Return false on error, see errorMessage().
+    bool load(const PeFile& image, uint32_t tables_rva);
+
+    // Unload the file.
+    void unload();
+
+    // Last error message.
+    const std::string& errorMessage() const { return _error; }
+
+    // Read-only view of the mapped file or serialized DLL tables. Null when not loaded.
+    bool isLoaded() const { return _header != nullptr; }
+    const WklBinHeader* header() const { return _header; }
+    size_t size() const { return _header == nullptr ? 0 : _size; }
+    const WklBinTables* tables() const { return _tables; }
+
+    // Get a structure in the mapped file from its offset. Null for a zero offset.
+    // The offsets in the file were validated by load().
+    template <typename T>
+    const T* get(uint32_t offset) const { return offset == 0 ? nullptr : reinterpret_cast<const T*>(_data + offset); }
+
+    // Get a KBDTABLES which can be used by all tools. Only the small structures
+    // containing pointers (KBDTABLES, MODIFIERS, VK_TO_WCHAR_TABLE, key names)
+    // are built in this object, the bulk of the data remains in the mapped file.
+    // Null when not loaded.
+    const KBDTABLES* kbdTables();
+
+    // Get the areas of the mapped file which contain the serialized form of a structure
+    // which is built by kbdTables() in this object (KBDTABLES, MODIFIERS, VK_TO_WCHAR_TABLE[],
+    // key names). Used to measure the file as it is. Empty if the address is not one of them.
+    std::vector<std::pair<const void*, size_t>> serializedAreas(const void* address) const;
+
+private:
+    MappedFile                     _file;
+    std::vector<uint8_t>           _buffer;         // Serialized DLL tables, when not loaded from a file.
+    const uint8_t*                 _data;           // Content of _file or _buffer.
+    size_t                         _size;
+    std::string                    _error;
+    const WklBinHeader*            _header;
+    const WklBinTables*            _tables;
+    bool                           _kbd_valid;
+    KBDTABLES                      _kbd;
+    std::vector<uint8_t>           _modifiers;      // MODIFIERS, variable size.
+    std::vector<VK_TO_WCHAR_TABLE> _vk_to_wchar;
+    std::vector<VSC_LPWSTR>        _key_names;
+    std::vector<VSC_LPWSTR>        _key_names_ext;
+    std::vector<DEADKEY_LPWSTR>    _key_names_dead;
+
+    // Check the header of the loaded content, then validate its structure.
+    bool loadContent(bool verify_checksum);
+
+    // Validate the structure of the loaded file.
+    bool validate();
+
+    // Size in bytes of an array in the file, including its terminating entry.
+    // Return zero if the offset is invalid or the array is not terminated inside the file.
+    template <class IS_LAST>
+    size_t arraySize(uint32_t offset, size_t entry_size, size_t alignment, IS_LAST is_last) const;
+
+    // Check that an area is entirely inside the file. Zero offsets are accepted.
+    bool valid(uint32_t offset, size_t size, size_t alignment = 4) const;
+
+    // Build the key names with pointers.
+    void buildKeyNames(std::vector<VSC_LPWSTR>& names, uint32_t offset);
+
+    // Set an error message and return false.
+    bool fail(const std::string& message);
+
+    // Inaccessible operations.
+    WklBinFile(const WklBinFile&) = delete;
+    WklBinFile& operator=(const WklBinFile&) = delete;
+};
@@ -0,0 +1,27 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Entry point of the tools on systems other than Windows: the UTF-8
+// command line is converted to UTF-16 and passed to wmain(), as on Windows.
+// This file is not part of the Visual Studio solution.
+//
+//----------------------------------------------------------------------------
+
+#include "strutils.h"
+
+int main(int argc, char* argv[])
+{
+    WStringVector args;
+    for (int i = 0; i < argc; ++i) {
+        args.push_back(ToUTF16(argv[i]));
+    }
+    std::vector<wchar_t*> wargv;
+    for (auto& arg : args) {
+        wargv.push_back(arg.data());
+    }
+    wargv.push_back(nullptr);
+    return wmain(argc, wargv.data());
+}
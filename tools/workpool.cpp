@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A simple work-stealing pool of threads.
+//
+//----------------------------------------------------------------------------
+
+#include "workpool.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+WorkPool::WorkPool(size_t threads) :
+    _threads(threads > 0 ? threads : std::max<size_t>(1, std::thread::hardware_concurrency()))
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Get next job for a thread.
+//----------------------------------------------------------------------------
+
+bool WorkPool::NextJob(std::deque<Queue>& queues, size_t thread, size_t& job)
+{
+    // First, get the next job in our own queue.
+    {
+        std::lock_guard<std::mutex> lock(queues[thread].mutex);
+        if (!queues[thread].jobs.empty()) {
+            job = queues[thread].jobs.front();
+            queues[thread].jobs.pop_front();
+            return true;
+        }
+    }
+
+    // Then, steal the last job of another thread. No job is added after
+    // the start, so there is nothing left when all queues are empty.
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& other(queues[(thread + i) % queues.size()]);
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty()) {
+            job = other.jobs.back();
+            other.jobs.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//----------------------------------------------------------------------------
+// Run jobs.
+//----------------------------------------------------------------------------
+
+void WorkPool::run(size_t count, const Job& job)
+{
+    const size_t threads = std::max<size_t>(1, std::min(_threads, count));
+
+    // Initial distribution of jobs, interleaved to balance the queues.
+    std::deque<Queue> queues(threads);
+    for (size_t i = 0; i < count; ++i) {
+        queues[i % threads].jobs.push_back(i);
+    }
+
+    // Thread main code.
+    const auto worker = [&queues, &job](size_t thread) {
+        size_t index = 0;
+        while (NextJob(queues, thread, index)) {
+            job(index, thread);
+        }
+    };
+
+    // The current thread is used as thread index zero.
+    std::vector<std::thread> others;
+    for (size_t i = 1; i < threads; ++i) {
+        others.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& th : others) {
+        th.join();
+    }
+}
@@ -0,0 +1,50 @@
+//----------------------------------------------------------------------------
+//
+// Windows Keyboards Layouts (WKL)
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A simple work-stealing pool of threads.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <deque>
+#include <mutex>
+
+// Each thread starts with its own queue of jobs. When its queue is empty,
+// a thread steals jobs from the end of the queues of the other threads.
+// This class does not depend on the Windows API.
+class WorkPool
+{
+public:
+    // Constructor. Zero means the number of processors.
+    WorkPool(size_t threads = 0);
+
+    // Number of threads in the pool.
+    size_t threadCount() const { return _threads; }
+
+    // Profile of a job function. A job is identified by its index.
+    // The thread index is in the range 0 to threadCount()-1. There is at
+    // most one job at a time per thread index, it can be used to address
+    // per-thread data without synchronization.
+    typedef std::function<void(size_t job, size_t thread)> Job;
+
+    // Run 'count' jobs, return when all of them are completed.
+    void run(size_t count, const Job& job);
+
+private:
+    // Queue of jobs for one thread.
+    struct Queue
+    {
+        std::mutex         mutex;
+        std::deque<size_t> jobs;
+    };
+
+    size_t _threads;
+
+    // Get next job for a thread. Return false when there is no more job.
+    static bool NextJob(std::deque<Queue>& queues, size_t thread, size_t& job);
+};